@@ -0,0 +1,459 @@
+/**
+ * @file gps_bench.c
+ * @brief Micro-benchmarks of the hot kernels and end-to-end batch throughput.
+ *
+ * Each micro-benchmark repeats one call, doubling the iteration count until a
+ * run lasts at least the minimum time, and reports nanoseconds per call (and
+ * MB/s for the parsers):
+ *
+ *  - parse_rtcm_1074 / parse_rtcm_1019 on the first such line of the text log;
+ *  - rtcm3_decode_1074 / rtcm3_decode_1019 on the first such frame of the binary
+ *    log (when one is given);
+ *  - satellite_eci_position + satellite_eci_to_ecef, the per-observation kernel
+ *    of satellite_position_eci(), swept over two hours around the TOE;
+ *  - solve_receiver_epoch (cold start) and solve_receiver_epoch_from (warm start
+ *    from the previous fix) on an 8-satellite geometry;
+ *  - ecef_to_geodetic_batch (exact and fast) over a track of BENCH_TRACK_POINTS
+ *    fixes, reported per point.
+ *
+ * The end-to-end benchmark runs the batch pipeline of file_input_mode() (ingest
+ * without the observation cache, sort, satellite positions, receiver solve) on
+ * every log and reports the stage times, input MB/s and solved epochs per second.
+ * Plots and tracks are not written. Logs for it come from rtcm_loggen.
+ *
+ * Usage: gps_bench [-m MIN_MS] [-b BINARY_LOG] [TEXT_LOG]
+ * The solver thread count follows GPS_RESOLVER_THREADS as in gps_resolver.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/rtcm_reader.h"
+#include "../include/rtcm3_decoder.h"
+#include "../include/gnss_context.h"
+#include "../include/satellites.h"
+#include "../include/receiver.h"
+#include "../include/perf_stats.h"
+
+#include <fcntl.h>
+
+#define BENCH_LINE_MAX ((size_t)1 << 16)
+#define BENCH_SOLVE_SVS 8
+#define BENCH_TRACK_POINTS 1024
+
+/// Benchmark body: performs @p iters calls
+typedef void (*bench_fn_t)(void *ctx, long iters);
+
+static double bench_min_ns = 300e6; ///< Minimum run time of one measurement
+static volatile double bench_sink;  ///< Keeps results observable to the optimizer
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Times @p fn and prints one result row.
+ *
+ * @param name         Row label.
+ * @param fn           Benchmark body.
+ * @param ctx          Passed to @p fn.
+ * @param bytes_per_op Input bytes per call for the MB/s column, 0 for none.
+ */
+static void run_bench(const char *name, bench_fn_t fn, void *ctx, size_t bytes_per_op)
+{
+    long iters = 1;
+    double elapsed = 0.0;
+    fn(ctx, 1); // warm caches
+    for (;;)
+    {
+        int64_t t0 = perf_now_ns();
+        fn(ctx, iters);
+        elapsed = (double)(perf_now_ns() - t0);
+        if (elapsed >= bench_min_ns || iters > (1L << 40))
+            break;
+        iters *= 2;
+    }
+
+    double ns_op = elapsed / (double)iters;
+    printf("  %-40s %12ld %12.1f", name, iters, ns_op);
+    if (bytes_per_op > 0)
+        printf(" %10.1f", (double)bytes_per_op / ns_op * 1e3);
+    printf("\n");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Parsers
+
+/// A single input message (text line or binary payload)
+typedef struct
+{
+    char *data;
+    size_t len;
+} bench_msg_t;
+
+static void bench_parse_1074(void *ctx, long iters)
+{
+    const bench_msg_t *m = ctx;
+    static rtcm_1074_msm4_t msm4;
+    for (long i = 0; i < iters; i++)
+    {
+        parse_rtcm_1074(m->data, m->len, &msm4);
+        bench_sink = msm4.pseudorange[0];
+    }
+}
+
+static void bench_parse_1019(void *ctx, long iters)
+{
+    const bench_msg_t *m = ctx;
+    rtcm_1019_ephemeris_t eph;
+    for (long i = 0; i < iters; i++)
+    {
+        parse_rtcm_1019(m->data, m->len, &eph);
+        bench_sink = eph.mean_anomaly;
+    }
+}
+
+static void bench_decode_1074(void *ctx, long iters)
+{
+    const bench_msg_t *m = ctx;
+    static rtcm_1074_msm4_t msm4;
+    for (long i = 0; i < iters; i++)
+    {
+        rtcm3_decode_1074((const uint8_t *)m->data, m->len, &msm4);
+        bench_sink = msm4.pseudorange[0];
+    }
+}
+
+static void bench_decode_1019(void *ctx, long iters)
+{
+    const bench_msg_t *m = ctx;
+    rtcm_1019_ephemeris_t eph;
+    for (long i = 0; i < iters; i++)
+    {
+        rtcm3_decode_1019((const uint8_t *)m->data, m->len, &eph);
+        bench_sink = eph.mean_anomaly;
+    }
+}
+
+/**
+ * @brief Copies the first line of the text log that starts with @p prefix.
+ *
+ * @return 0 on success, -1 if the log has no such line.
+ */
+static int find_text_line(const char *path, const char *prefix, bench_msg_t *out)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return -1;
+    char *line = malloc(BENCH_LINE_MAX);
+    int status = -1;
+    while (line && fgets(line, (int)BENCH_LINE_MAX, fp))
+    {
+        if (strncmp(line, prefix, strlen(prefix)) == 0)
+        {
+            out->len = strcspn(line, "\r\n");
+            line[out->len] = '\0';
+            out->data = line;
+            line = NULL;
+            status = 0;
+        }
+    }
+    free(line);
+    fclose(fp);
+    return status;
+}
+
+/**
+ * @brief Copies the payload of the first frame of type @p msg_type in a binary log.
+ *
+ * @return 0 on success, -1 if the log has no such frame.
+ */
+static int find_binary_frame(const char *path, unsigned msg_type, bench_msg_t *out)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+    rtcm3_framer_t framer;
+    rtcm3_framer_init(&framer);
+    uint8_t chunk[4096];
+    size_t n;
+    int status = -1;
+    while (status != 0 && (n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+    {
+        size_t off = 0;
+        while (status != 0 && off < n)
+        {
+            size_t used = 0;
+            if (rtcm3_framer_next(&framer, chunk + off, n - off, &used) == 1)
+            {
+                const uint8_t *payload = RTCM3_FRAME_PAYLOAD(&framer);
+                size_t len = RTCM3_FRAME_PAYLOAD_LEN(&framer);
+                if (len >= 2 && rtcm3_getbitu(payload, 0, 12) == msg_type && (out->data = malloc(len)) != NULL)
+                {
+                    memcpy(out->data, payload, len);
+                    out->len = len;
+                    status = 0;
+                }
+            }
+            off += used;
+        }
+    }
+    fclose(fp);
+    return status;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Satellite position and receiver solve
+
+static void bench_satellite_position(void *ctx, long iters)
+{
+    const rtcm_1019_ephemeris_t *eph = ctx;
+    double eci[3], ecef[3], acc = 0.0;
+    for (long i = 0; i < iters; i++)
+    {
+        double t = (double)eph->gps_toe - 3600.0 + (double)(i % 7200);
+        satellite_eci_position(eph, t, eci);
+        satellite_eci_to_ecef(eci, t, ecef);
+        acc += ecef[0];
+    }
+    bench_sink = acc;
+}
+
+/// Fixed solver geometry: satellites around a receiver on the WGS-84 ellipsoid
+typedef struct
+{
+    double ecefs[BENCH_SOLVE_SVS][3];
+    double pseudoranges[BENCH_SOLVE_SVS];
+    double truth[4];
+} bench_geometry_t;
+
+/** @brief Places BENCH_SOLVE_SVS satellites 20200 km above a receiver at 49N 123W. */
+static void make_geometry(bench_geometry_t *g)
+{
+    const double lat = 49.188 * PI / 180.0, lon = -123.117 * PI / 180.0, r_earth = 6366000.0;
+    const double up[3] = {cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat)};
+    const double east[3] = {-sin(lon), cos(lon), 0.0};
+    const double north[3] = {-sin(lat) * cos(lon), -sin(lat) * sin(lon), cos(lat)};
+    for (int k = 0; k < 3; k++)
+        g->truth[k] = r_earth * up[k];
+    g->truth[3] = 93.0; // clock bias (m)
+
+    for (int s = 0; s < BENCH_SOLVE_SVS; s++)
+    {
+        double az = 2.0 * PI * s / BENCH_SOLVE_SVS + 0.3;
+        double el = (s % 2 ? 20.0 : 55.0) * PI / 180.0;
+        double dir[3], dist = 2.2e7 - 2.0e6 * sin(el);
+        double rng = 0.0;
+        for (int k = 0; k < 3; k++)
+        {
+            dir[k] = cos(el) * (sin(az) * east[k] + cos(az) * north[k]) + sin(el) * up[k];
+            g->ecefs[s][k] = g->truth[k] + dist * dir[k];
+            rng += dist * dir[k] * dist * dir[k];
+        }
+        g->pseudoranges[s] = sqrt(rng) + g->truth[3] + 0.5 * sin(7.0 * s);
+    }
+}
+
+static void bench_solve_cold(void *ctx, long iters)
+{
+    const bench_geometry_t *g = ctx;
+    double pos[3], bias;
+    for (long i = 0; i < iters; i++)
+    {
+        solve_receiver_epoch(BENCH_SOLVE_SVS, g->ecefs, g->pseudoranges, pos, &bias);
+        bench_sink = pos[0];
+    }
+}
+
+static void bench_solve_warm(void *ctx, long iters)
+{
+    const bench_geometry_t *g = ctx;
+    double pos[3], bias;
+    double start[4] = {g->truth[0] + 3.0, g->truth[1] - 2.0, g->truth[2] + 4.0, g->truth[3] + 1.0};
+    for (long i = 0; i < iters; i++)
+    {
+        solve_receiver_epoch_from(BENCH_SOLVE_SVS, g->ecefs, g->pseudoranges, start, pos, &bias);
+        bench_sink = pos[0];
+    }
+}
+
+/// Receiver track in both frames, for the geodetic conversion
+typedef struct
+{
+    double x[BENCH_TRACK_POINTS], y[BENCH_TRACK_POINTS], z[BENCH_TRACK_POINTS];
+    double lat[BENCH_TRACK_POINTS], lon[BENCH_TRACK_POINTS], alt[BENCH_TRACK_POINTS];
+    geodetic_precision_t precision;
+} bench_track_t;
+
+/** @brief Spreads BENCH_TRACK_POINTS fixes pole to pole along one meridian, 0 to 10 km high. */
+static void make_track(bench_track_t *t, geodetic_precision_t precision)
+{
+    for (int i = 0; i < BENCH_TRACK_POINTS; i++)
+    {
+        t->lat[i] = -90.0 + 180.0 * i / (BENCH_TRACK_POINTS - 1);
+        t->lon[i] = -123.117;
+        t->alt[i] = 10.0 * (i % 1000);
+    }
+    geodetic_to_ecef_batch(BENCH_TRACK_POINTS, t->lat, t->lon, t->alt, t->x, t->y, t->z);
+    t->precision = precision;
+}
+
+/** One iteration converts a single point; the whole track is converted per BENCH_TRACK_POINTS iterations. */
+static void bench_geodetic(void *ctx, long iters)
+{
+    bench_track_t *t = ctx;
+    for (long i = 0; i < iters; i += BENCH_TRACK_POINTS)
+    {
+        ecef_to_geodetic_batch(BENCH_TRACK_POINTS, t->x, t->y, t->z, t->precision, t->lat, t->lon, t->alt);
+        bench_sink = t->alt[i % BENCH_TRACK_POINTS];
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// End to end
+
+/**
+ * @brief Runs ingest, sort, satellite positions and receiver solve on one log
+ *        and prints its throughput. The pipeline's own progress output is muted.
+ *
+ * @return 0 on success, -1 if a stage failed.
+ */
+static int bench_end_to_end(const char *path, bool is_parsed)
+{
+    FILE *fp = fopen(path, is_parsed ? "r" : "rb");
+    if (!fp)
+    {
+        fprintf(stderr, COLOR_RED "Error: Cannot open %s: %s\n" COLOR_RESET, path, strerror(errno));
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0)
+        dup2(devnull, STDOUT_FILENO);
+
+    gnss_context_t ctx;
+    gnss_context_init(&ctx);
+    perf_reset();
+    int status = 0;
+    perf_stage_begin(PERF_STAGE_INGEST);
+    status |= is_parsed ? read_next_rtcm_message(fp, NULL, &ctx) : rtcm3_read_stream(fp, NULL, &ctx);
+    perf_stage_end(PERF_STAGE_INGEST);
+    perf_stage_begin(PERF_STAGE_SORT);
+    status |= status == 0 ? sort_satellites(&ctx) : 0;
+    perf_stage_end(PERF_STAGE_SORT);
+    perf_stage_begin(PERF_STAGE_SATELLITE_ECI_ECEF);
+    status |= status == 0 ? satellite_position_eci(&ctx) : 0;
+    perf_stage_end(PERF_STAGE_SATELLITE_ECI_ECEF);
+    perf_stage_begin(PERF_STAGE_RECEIVER);
+    status |= status == 0 ? estimate_receiver_positions(&ctx) : 0;
+    perf_stage_end(PERF_STAGE_RECEIVER);
+    int64_t total_ns = perf_stage_ns(PERF_STAGE_INGEST) + perf_stage_ns(PERF_STAGE_SORT) +
+                       perf_stage_ns(PERF_STAGE_SATELLITE_ECI_ECEF) + perf_stage_ns(PERF_STAGE_RECEIVER);
+
+    fflush(stdout);
+    if (saved_stdout >= 0)
+    {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+    if (devnull >= 0)
+        close(devnull);
+    fclose(fp);
+    gnss_context_free(&ctx);
+
+    if (status != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: The pipeline failed on %s\n" COLOR_RESET, path);
+        return -1;
+    }
+
+    uint64_t n_msgs = perf_counter_value(PERF_MSG_1019) + perf_counter_value(PERF_MSG_1074) +
+                      perf_counter_value(PERF_MSG_1002) + perf_counter_value(PERF_MSG_MSM_OTHER) +
+                      perf_counter_value(PERF_MSG_EPH_OTHER) + perf_counter_value(PERF_MSG_MSM4_OTHER);
+    uint64_t n_solved = perf_counter_value(PERF_EPOCHS_SOLVED);
+    double total_s = (double)total_ns * 1e-9;
+    printf("  %s (%s, %.1f MiB, %llu messages)\n", path, is_parsed ? "text" : "binary",
+           (double)size / (1024.0 * 1024.0), (unsigned long long)n_msgs);
+    printf("    ingest %.1f ms, sort %.1f ms, satellites %.1f ms, receiver %.1f ms, total %.1f ms\n",
+           (double)perf_stage_ns(PERF_STAGE_INGEST) * 1e-6, (double)perf_stage_ns(PERF_STAGE_SORT) * 1e-6,
+           (double)perf_stage_ns(PERF_STAGE_SATELLITE_ECI_ECEF) * 1e-6,
+           (double)perf_stage_ns(PERF_STAGE_RECEIVER) * 1e-6, total_s * 1e3);
+    printf("    %.1f MB/s ingest, %.0f messages/s, %llu epochs solved (%.0f epochs/s), %llu Newton iterations\n",
+           (double)size / ((double)perf_stage_ns(PERF_STAGE_INGEST) * 1e-9) * 1e-6,
+           (double)n_msgs / ((double)perf_stage_ns(PERF_STAGE_INGEST) * 1e-9), (unsigned long long)n_solved,
+           (double)n_solved / total_s, (unsigned long long)perf_counter_value(PERF_NEWTON_ITERATIONS));
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+    const char *text_log = "example/parsed_log.txt";
+    const char *binary_log = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+            bench_min_ns = strtod(argv[++i], NULL) * 1e6;
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            binary_log = argv[++i];
+        else if (argv[i][0] != '-')
+            text_log = argv[i];
+        else
+        {
+            fprintf(stderr, "Usage: gps_bench [-m MIN_MS] [-b BINARY_LOG] [TEXT_LOG]\n");
+            return 2;
+        }
+    }
+
+    bench_msg_t line_1074 = {0}, line_1019 = {0}, frame_1074 = {0}, frame_1019 = {0};
+    if (find_text_line(text_log, "<RTCM(1074", &line_1074) != 0 || find_text_line(text_log, "<RTCM(1019", &line_1019) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: %s needs at least one 1074 and one 1019 line.\n" COLOR_RESET, text_log);
+        return 1;
+    }
+
+    printf(COLOR_BLUE "Micro-benchmarks" COLOR_RESET " (%d solver threads)\n", configured_thread_count());
+    printf("  %-40s %12s %12s %10s\n", "benchmark", "iterations", "ns/op", "MB/s");
+    run_bench("parse_rtcm_1074 (text)", bench_parse_1074, &line_1074, line_1074.len);
+    run_bench("parse_rtcm_1019 (text)", bench_parse_1019, &line_1019, line_1019.len);
+    if (binary_log)
+    {
+        if (find_binary_frame(binary_log, 1074, &frame_1074) == 0)
+            run_bench("rtcm3_decode_1074 (binary)", bench_decode_1074, &frame_1074, frame_1074.len);
+        if (find_binary_frame(binary_log, 1019, &frame_1019) == 0)
+            run_bench("rtcm3_decode_1019 (binary)", bench_decode_1019, &frame_1019, frame_1019.len);
+    }
+
+    rtcm_1019_ephemeris_t eph;
+    parse_rtcm_1019(line_1019.data, line_1019.len, &eph);
+    run_bench("satellite_eci_position + eci_to_ecef", bench_satellite_position, &eph, 0);
+
+    bench_geometry_t geometry;
+    make_geometry(&geometry);
+    run_bench("solve_receiver_epoch (cold, 8 SVs)", bench_solve_cold, &geometry, 0);
+    run_bench("solve_receiver_epoch_from (warm, 8 SVs)", bench_solve_warm, &geometry, 0);
+
+    static bench_track_t track;
+    make_track(&track, GEODETIC_EXACT);
+    run_bench("ecef_to_geodetic_batch (exact, per point)", bench_geodetic, &track, 0);
+    make_track(&track, GEODETIC_FAST);
+    run_bench("ecef_to_geodetic_batch (fast, per point)", bench_geodetic, &track, 0);
+
+    printf(COLOR_BLUE "End to end" COLOR_RESET "\n");
+    int status = bench_end_to_end(text_log, true);
+    if (binary_log && bench_end_to_end(binary_log, false) != 0)
+        status = -1;
+
+    long rss = perf_peak_rss_kib();
+    if (rss >= 0)
+        printf("  peak RSS %.1f MiB\n", (double)rss / 1024.0);
+
+    free(line_1074.data);
+    free(line_1019.data);
+    free(frame_1074.data);
+    free(frame_1019.data);
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,817 @@
+/**
+ * @file rtcm_loggen.c
+ * @brief Synthesizes long GPS MSM4 (1074) + ephemeris (1019) logs for benchmarking.
+ *
+ * The broadcast ephemerides found in an input log (text or binary, e.g. the
+ * bundled example) seed the constellation. Every two hours each satellite gets a
+ * new ephemeris, propagated from the seed so the orbit stays continuous (TOE,
+ * TOC, M0, OMEGA0, i0 and the clock terms move forward, IODE/IODC advance). For
+ * every epoch the satellites above the elevation mask are positioned with the
+ * IS-GPS-200 orbit model at their transmit time, and L1 C/A (plus L5 on every
+ * other PRN) code and phase are built from the geometric range, the satellite
+ * and receiver clocks, a simple ionosphere / troposphere and Gaussian noise.
+ *
+ * Messages are quantized once to their RTCM field resolution and then written
+ * either as PyRTCM text lines (like example/parsed_log.txt) or as CRC-24Q framed
+ * binary RTCM3, so both formats of the same run decode to identical values.
+ *
+ * Usage: rtcm_loggen -o OUT [-b] [-i EPH_LOG] [-r HZ] [-d HOURS] [-t TOW]
+ *                    [-p LAT,LON,ALT] [-m DEG] [-e SEC] [-s SEED]
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/rtcm_reader.h"
+#include "../include/rtcm3_decoder.h"
+#include "../include/receiver.h"
+
+#define GPS_MU 3.986005e14          ///< IS-GPS-200 gravitational parameter (m^3/s^2)
+#define GPS_OMEGA_E 7.2921151467e-5 ///< IS-GPS-200 Earth rotation rate (rad/s)
+#define GPS_REL_F -4.442807633e-10  ///< Relativistic clock constant (s/m^0.5)
+#define SECONDS_PER_WEEK 604800.0
+
+#define EPH_BLOCK_S 7200.0             ///< Interval between broadcast ephemeris updates
+#define RX_CLOCK_BIAS_S 3.1e-7         ///< Receiver clock offset applied to every range
+#define IONO_ZENITH_M 4.0              ///< L1 zenith ionospheric delay
+#define TROPO_ZENITH_M 2.4             ///< Zenith tropospheric delay
+#define CODE_NOISE_M 0.4               ///< Code noise (1 sigma)
+#define PHASE_NOISE_M 0.003            ///< Carrier phase noise (1 sigma)
+#define L5_IONO_SCALE 1.7933           ///< (f_L1 / f_L5)^2
+#define INITIAL_LOCK_MS 600000         ///< Lock time of satellites already up at the start
+#define MSM_SIG_1C 2                   ///< GPS MSM signal ID of L1 C/A
+#define MSM_SIG_5Q 23                  ///< GPS MSM signal ID of L5 Q
+#define GPS_MAX_PRN 32
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// RTCM 1019 fields
+
+/// One field of the 1019 message, in transmission order
+typedef struct
+{
+    const char *label; ///< PyRTCM label
+    unsigned bits;     ///< Width in the binary message
+    int scale_exp;     ///< Value = raw * 2^scale_exp
+    bool is_signed;    ///< Two's complement field
+    bool is_float;     ///< Printed as a float in text logs
+} msg_field_t;
+
+enum
+{
+    F_MSG, F_PRN, F_WN, F_ACC, F_L2, F_IDOT, F_IODE, F_TOC, F_AF2, F_AF1, F_AF0,
+    F_IODC, F_CRS, F_DN, F_M0, F_CUC, F_E, F_CUS, F_SQRTA, F_TOE, F_CIC, F_OMEGA0,
+    F_CIS, F_I0, F_CRC, F_OMEGA, F_OMEGADOT, F_TGD, F_HEALTH, F_L2P, F_FIT, N_1019
+};
+
+static const msg_field_t fields_1019[N_1019] = {
+    {"DF002", 12, 0, false, false}, {"DF009", 6, 0, false, false}, {"DF076", 10, 0, false, false},
+    {"DF077", 4, 0, false, false}, {"DF078", 2, 0, false, false}, {"DF079", 14, -43, true, true},
+    {"DF071", 8, 0, false, false}, {"DF081", 16, 4, false, false}, {"DF082", 8, -55, true, true},
+    {"DF083", 16, -43, true, true}, {"DF084", 22, -31, true, true}, {"DF085", 10, 0, false, false},
+    {"DF086", 16, -5, true, true}, {"DF087", 16, -43, true, true}, {"DF088", 32, -31, true, true},
+    {"DF089", 16, -29, true, true}, {"DF090", 32, -33, false, true}, {"DF091", 16, -29, true, true},
+    {"DF092", 32, -19, false, true}, {"DF093", 16, 4, false, false}, {"DF094", 16, -29, true, true},
+    {"DF095", 32, -31, true, true}, {"DF096", 16, -29, true, true}, {"DF097", 32, -31, true, true},
+    {"DF098", 16, -5, true, true}, {"DF099", 32, -31, true, true}, {"DF100", 24, -43, true, true},
+    {"DF101", 8, -31, true, true}, {"DF102", 6, 0, false, false}, {"DF103", 1, 0, false, false},
+    {"DF137", 1, 0, false, false}};
+
+/// Broadcast ephemeris: field values in RTCM units (semicircles, s, m) and raw integers
+typedef struct
+{
+    double v[N_1019];
+    int64_t raw[N_1019];
+} gen_eph_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Generator state
+
+/// Command line settings
+typedef struct
+{
+    const char *eph_path;
+    const char *out_path;
+    bool binary;
+    int rate_hz;
+    double hours;
+    double start_tow; ///< < 0: first epoch of the seed log (else earliest seed TOE)
+    double lat_deg, lon_deg, alt_m;
+    double mask_deg;
+    int eph_interval_s;
+    uint64_t seed;
+} loggen_opts_t;
+
+/// Per-satellite state
+typedef struct
+{
+    bool have_seed;
+    gen_eph_t seed;    ///< Ephemeris read from the input log
+    long block;        ///< Block index of cur (EPH_BLOCK_S steps from the seed TOE)
+    bool have_cur;
+    gen_eph_t cur;     ///< Ephemeris broadcast at the current epoch
+    bool visible;
+    int64_t rise_ms;   ///< Epoch the satellite came above the mask (lock start)
+    int64_t sent_ms;   ///< Last 1019 written, -1 if never
+    long sent_block;
+} sat_state_t;
+
+/// One MSM4 cell before quantization
+typedef struct
+{
+    uint8_t prn;
+    uint8_t sig;        ///< MSM signal ID
+    double code_ms;     ///< Pseudorange (ms)
+    double phase_ms;    ///< Phase range (ms)
+    unsigned lock_ind;  ///< DF402
+    unsigned cnr;       ///< DF403
+} gen_cell_t;
+
+static sat_state_t sats[GPS_MAX_PRN + 1];
+static uint64_t rng_state;
+static int64_t seed_first_epoch_ms = -1; ///< DF004 of the first MSM4 in the seed log
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+/** @brief xorshift64* pseudo random number in [0, 1). */
+static double rng_uniform(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (double)((rng_state * 2685821657736338717ull) >> 11) * 0x1p-53;
+}
+
+/** @brief Standard normal deviate (Box-Muller). */
+static double rng_gauss(void)
+{
+    double u1 = rng_uniform();
+    double u2 = rng_uniform();
+    if (u1 < 1e-300)
+        u1 = 1e-300;
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2);
+}
+
+/** @brief Wraps an angle in semicircles into [-1, 1). */
+static double wrap_semicircles(double x)
+{
+    x = fmod(x + 1.0, 2.0);
+    if (x < 0.0)
+        x += 2.0;
+    return x - 1.0;
+}
+
+/** @brief Quantizes every field of @p e to its RTCM resolution and range. */
+static void quantize_eph(gen_eph_t *e)
+{
+    for (int f = 0; f < N_1019; f++)
+    {
+        const msg_field_t *fd = &fields_1019[f];
+        int64_t lo = fd->is_signed ? -((int64_t)1 << (fd->bits - 1)) : 0;
+        int64_t hi = fd->is_signed ? ((int64_t)1 << (fd->bits - 1)) - 1 : ((int64_t)1 << fd->bits) - 1;
+        int64_t r = (int64_t)llround(ldexp(e->v[f], -fd->scale_exp));
+        r = r < lo ? lo : (r > hi ? hi : r);
+        e->raw[f] = r;
+        e->v[f] = ldexp((double)r, fd->scale_exp);
+    }
+}
+
+/** @brief Copies a decoded 1019 into generator form. */
+static void eph_from_message(const rtcm_1019_ephemeris_t *m, gen_eph_t *e)
+{
+    double *v = e->v;
+    v[F_MSG] = 1019;
+    v[F_PRN] = m->satellite_id;
+    v[F_WN] = m->gps_wn;
+    v[F_ACC] = m->gps_sv_acc;
+    v[F_L2] = m->gps_code_l2;
+    v[F_IDOT] = m->gps_idot;
+    v[F_IODE] = m->gps_iode;
+    v[F_TOC] = m->gps_toc;
+    v[F_AF2] = m->gps_af2;
+    v[F_AF1] = m->gps_af1;
+    v[F_AF0] = m->gps_af0;
+    v[F_IODC] = m->gps_iodc;
+    v[F_CRS] = m->gps_crs;
+    v[F_DN] = m->gps_delta_n;
+    v[F_M0] = m->gps_m0;
+    v[F_CUC] = m->gps_cuc;
+    v[F_E] = m->gps_eccentricity;
+    v[F_CUS] = m->gps_cus;
+    v[F_SQRTA] = m->gps_sqrt_a;
+    v[F_TOE] = m->gps_toe;
+    v[F_CIC] = m->gps_cic;
+    v[F_OMEGA0] = m->gps_omega0;
+    v[F_CIS] = m->gps_cis;
+    v[F_I0] = m->gps_i0;
+    v[F_CRC] = m->gps_crc;
+    v[F_OMEGA] = m->gps_omega;
+    v[F_OMEGADOT] = m->gps_omega_dot;
+    v[F_TGD] = m->gps_tgd;
+    v[F_HEALTH] = m->gps_sv_health;
+    v[F_L2P] = m->gps_l2p_data_flag;
+    v[F_FIT] = m->gps_fit_interval;
+    quantize_eph(e);
+}
+
+/**
+ * @brief Moves an ephemeris @p blocks update intervals forward, keeping the orbit
+ *        and clock it describes continuous.
+ */
+static void advance_eph(const gen_eph_t *seed, long blocks, gen_eph_t *out)
+{
+    *out = *seed;
+    double dt = EPH_BLOCK_S * (double)blocks;
+    double *v = out->v;
+    double a = seed->v[F_SQRTA] * seed->v[F_SQRTA];
+    double n_sc = sqrt(GPS_MU / (a * a * a)) / PI + seed->v[F_DN]; // semicircles/s
+
+    v[F_TOE] += dt;
+    v[F_TOC] += dt;
+    v[F_M0] = wrap_semicircles(seed->v[F_M0] + n_sc * dt);
+    v[F_OMEGA0] = wrap_semicircles(seed->v[F_OMEGA0] + seed->v[F_OMEGADOT] * dt);
+    v[F_I0] = seed->v[F_I0] + seed->v[F_IDOT] * dt;
+    v[F_AF0] = seed->v[F_AF0] + seed->v[F_AF1] * dt + seed->v[F_AF2] * dt * dt;
+    v[F_AF1] = seed->v[F_AF1] + 2.0 * seed->v[F_AF2] * dt;
+    long iode = (((long)seed->v[F_IODE] + blocks) % 256 + 256) % 256;
+    v[F_IODE] = (double)iode;
+    v[F_IODC] = (double)(((long)seed->v[F_IODC] & 0x300) | iode);
+    quantize_eph(out);
+}
+
+/**
+ * @brief IS-GPS-200 satellite ECEF position and clock offset at transmit time @p t.
+ *
+ * @param e     Ephemeris.
+ * @param t     GPS time of week (s).
+ * @param pos   Output ECEF position (m).
+ * @param dt_sv Output satellite clock offset (s), L1 group delay included.
+ */
+static void eph_position(const gen_eph_t *e, double t, double pos[3], double *dt_sv)
+{
+    const double *v = e->v;
+    double a = v[F_SQRTA] * v[F_SQRTA];
+    double ecc = v[F_E];
+    double tk = t - v[F_TOE];
+    if (tk > SECONDS_PER_WEEK / 2)
+        tk -= SECONDS_PER_WEEK;
+    else if (tk < -SECONDS_PER_WEEK / 2)
+        tk += SECONDS_PER_WEEK;
+
+    double n = sqrt(GPS_MU / (a * a * a)) + v[F_DN] * PI;
+    double m = v[F_M0] * PI + n * tk;
+    double ea = m;
+    for (int it = 0; it < 10; it++)
+        ea = m + ecc * sin(ea);
+
+    double nu = atan2(sqrt(1.0 - ecc * ecc) * sin(ea), cos(ea) - ecc);
+    double phi = nu + v[F_OMEGA] * PI;
+    double s2 = sin(2.0 * phi), c2 = cos(2.0 * phi);
+    double u = phi + v[F_CUS] * s2 + v[F_CUC] * c2;
+    double r = a * (1.0 - ecc * cos(ea)) + v[F_CRS] * s2 + v[F_CRC] * c2;
+    double inc = v[F_I0] * PI + v[F_CIS] * s2 + v[F_CIC] * c2 + v[F_IDOT] * PI * tk;
+    double xp = r * cos(u), yp = r * sin(u);
+    double om = v[F_OMEGA0] * PI + (v[F_OMEGADOT] * PI - GPS_OMEGA_E) * tk - GPS_OMEGA_E * v[F_TOE];
+
+    pos[0] = xp * cos(om) - yp * cos(inc) * sin(om);
+    pos[1] = xp * sin(om) + yp * cos(inc) * cos(om);
+    pos[2] = yp * sin(inc);
+
+    double tc = t - v[F_TOC];
+    *dt_sv = v[F_AF0] + v[F_AF1] * tc + v[F_AF2] * tc * tc +
+             GPS_REL_F * ecc * v[F_SQRTA] * sin(ea) - v[F_TGD];
+}
+
+/** @brief MSM lock time indicator (DF402) for @p lock_ms of continuous tracking. */
+static unsigned lock_indicator(int64_t lock_ms)
+{
+    unsigned ind = 0;
+    for (int64_t th = 32; ind < 15 && lock_ms >= th; th *= 2)
+        ind++;
+    return ind;
+}
+
+/** @brief Satellites that also broadcast L5 in the synthetic constellation. */
+static bool has_l5(uint8_t prn)
+{
+    return prn % 2 == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Output
+
+/// Output log (text or binary) with a bit buffer for the message under construction
+typedef struct
+{
+    FILE *fp;
+    bool binary;
+    uint8_t payload[RTCM3_MAX_PAYLOAD];
+    size_t bitpos;
+    unsigned long n_messages;
+} log_out_t;
+
+/** @brief Appends the low @p bits of @p value (MSB first) to the payload. */
+static void put_bits(log_out_t *out, unsigned bits, uint64_t value)
+{
+    for (unsigned i = 0; i < bits; i++)
+    {
+        size_t pos = out->bitpos++;
+        uint8_t bit = (uint8_t)((value >> (bits - 1 - i)) & 1u);
+        out->payload[pos / 8] = (uint8_t)(out->payload[pos / 8] | (bit << (7 - pos % 8)));
+    }
+}
+
+/** @brief Starts a new binary payload. */
+static void begin_frame(log_out_t *out)
+{
+    memset(out->payload, 0, sizeof(out->payload));
+    out->bitpos = 0;
+}
+
+/** @brief Frames the payload (preamble, length, CRC-24Q) and writes it. */
+static void end_frame(log_out_t *out)
+{
+    size_t len = (out->bitpos + 7) / 8;
+    uint8_t frame[RTCM3_MAX_FRAME];
+    frame[0] = RTCM3_PREAMBLE;
+    frame[1] = (uint8_t)(len >> 8);
+    frame[2] = (uint8_t)(len & 0xFF);
+    memcpy(frame + 3, out->payload, len);
+    uint32_t crc = rtcm3_crc24q(frame, 3 + len);
+    frame[3 + len] = (uint8_t)(crc >> 16);
+    frame[4 + len] = (uint8_t)(crc >> 8);
+    frame[5 + len] = (uint8_t)crc;
+    fwrite(frame, 1, len + 6, out->fp);
+    out->n_messages++;
+}
+
+/**
+ * @brief Prints @p v the way Python's repr() does (shortest round-trip form,
+ *        always with a decimal point or exponent), as PyRTCM logs do.
+ */
+static void put_float(FILE *fp, double v)
+{
+    char buf[40];
+    for (int prec = 15; prec <= 17; prec++)
+    {
+        snprintf(buf, sizeof(buf), "%.*g", prec, v);
+        if (strtod(buf, NULL) == v)
+            break;
+    }
+    fputs(buf, fp);
+    if (!strpbrk(buf, ".en"))
+        fputs(".0", fp);
+}
+
+/** @brief Writes one 1019 message. */
+static void write_1019(log_out_t *out, const gen_eph_t *e)
+{
+    if (out->binary)
+    {
+        begin_frame(out);
+        for (int f = 0; f < N_1019; f++)
+            put_bits(out, fields_1019[f].bits, (uint64_t)e->raw[f]);
+        end_frame(out);
+        return;
+    }
+
+    fputs("<RTCM(1019", out->fp);
+    for (int f = 0; f < N_1019; f++)
+    {
+        fprintf(out->fp, ", %s=", fields_1019[f].label);
+        if (fields_1019[f].is_float)
+            put_float(out->fp, e->v[f]);
+        else
+            fprintf(out->fp, "%lld", (long long)e->v[f]);
+    }
+    fputs(")>\n", out->fp);
+    out->n_messages++;
+}
+
+/**
+ * @brief Writes one GPS MSM4 message for epoch @p tow_ms.
+ *
+ * @param out     Output log.
+ * @param tow_ms  DF004 epoch time.
+ * @param cells   Cells, satellite-major with ascending PRN, 1C before 5Q.
+ * @param n_cells Number of cells.
+ */
+static void write_1074(log_out_t *out, uint32_t tow_ms, const gen_cell_t *cells, int n_cells)
+{
+    // Satellite / signal lists and masks
+    uint8_t prns[GPS_MAX_PRN];
+    int n_sat = 0;
+    bool sig_l1 = false, sig_l5 = false;
+    for (int c = 0; c < n_cells; c++)
+    {
+        if (n_sat == 0 || prns[n_sat - 1] != cells[c].prn)
+            prns[n_sat++] = cells[c].prn;
+        sig_l1 |= cells[c].sig == MSM_SIG_1C;
+        sig_l5 |= cells[c].sig == MSM_SIG_5Q;
+    }
+    uint8_t sigs[2];
+    int n_sig = 0;
+    if (sig_l1)
+        sigs[n_sig++] = MSM_SIG_1C;
+    if (sig_l5)
+        sigs[n_sig++] = MSM_SIG_5Q;
+
+    uint64_t sat_mask = 0, cell_mask = 0;
+    uint32_t sig_mask = 0;
+    for (int s = 0; s < n_sat; s++)
+        sat_mask |= (uint64_t)1 << (64 - prns[s]);
+    for (int g = 0; g < n_sig; g++)
+        sig_mask |= (uint32_t)1 << (32 - sigs[g]);
+
+    // Rough range per satellite (from its first cell) and the quantized cell fields
+    uint32_t rough_int[GPS_MAX_PRN], rough_frac[GPS_MAX_PRN];
+    int32_t fine[MAX_CELL], phase[MAX_CELL];
+    int c = 0;
+    for (int s = 0; s < n_sat; s++)
+    {
+        int64_t r10 = (int64_t)llround(cells[c].code_ms * 1024.0);
+        rough_int[s] = (uint32_t)(r10 >> 10);
+        rough_frac[s] = (uint32_t)(r10 & 1023);
+        double rough_ms = (double)r10 / 1024.0;
+        for (int g = 0; g < n_sig; g++)
+        {
+            cell_mask <<= 1;
+            if (c < n_cells && cells[c].prn == prns[s] && cells[c].sig == sigs[g])
+            {
+                cell_mask |= 1u;
+                int64_t f = (int64_t)llround((cells[c].code_ms - rough_ms) * 0x1p24);
+                int64_t p = (int64_t)llround((cells[c].phase_ms - rough_ms) * 0x1p29);
+                fine[c] = (int32_t)(f < -16383 ? -16383 : (f > 16383 ? 16383 : f));
+                phase[c] = (int32_t)(p < -2097151 ? -2097151 : (p > 2097151 ? 2097151 : p));
+                c++;
+            }
+        }
+    }
+
+    if (out->binary)
+    {
+        begin_frame(out);
+        put_bits(out, 12, 1074);
+        put_bits(out, 12, 0);      // DF003
+        put_bits(out, 30, tow_ms); // DF004
+        put_bits(out, 1, 0);       // DF393: last MSM of the epoch
+        put_bits(out, 3, 0);       // DF409
+        put_bits(out, 7, 0);       // DF001_7
+        put_bits(out, 2, 0);       // DF411
+        put_bits(out, 2, 0);       // DF412
+        put_bits(out, 1, 0);       // DF417
+        put_bits(out, 3, 0);       // DF418
+        put_bits(out, 64, sat_mask);
+        put_bits(out, 32, sig_mask);
+        put_bits(out, (unsigned)(n_sat * n_sig), cell_mask);
+        for (int s = 0; s < n_sat; s++)
+            put_bits(out, 8, rough_int[s]);
+        for (int s = 0; s < n_sat; s++)
+            put_bits(out, 10, rough_frac[s]);
+        for (int i = 0; i < n_cells; i++)
+            put_bits(out, 15, (uint64_t)(int64_t)fine[i]);
+        for (int i = 0; i < n_cells; i++)
+            put_bits(out, 22, (uint64_t)(int64_t)phase[i]);
+        for (int i = 0; i < n_cells; i++)
+            put_bits(out, 4, cells[i].lock_ind);
+        for (int i = 0; i < n_cells; i++)
+            put_bits(out, 1, 0); // DF420
+        for (int i = 0; i < n_cells; i++)
+            put_bits(out, 6, cells[i].cnr);
+        end_frame(out);
+        return;
+    }
+
+    FILE *fp = out->fp;
+    fprintf(fp, "<RTCM(1074, DF002=1074, DF003=0, DF004=%u, DF393=0, DF409=0, DF001_7=0, DF411=0, "
+                "DF412=0, DF417=0, DF418=0, DF394=%llu, NSat=%d, DF395=%u, NSig=%d, DF396=%llu, NCell=%d",
+            tow_ms, (unsigned long long)sat_mask, n_sat, sig_mask, n_sig, (unsigned long long)cell_mask, n_cells);
+    for (int s = 0; s < n_sat; s++)
+        fprintf(fp, ", PRN_%02d=%03u", s + 1, prns[s]);
+    for (int s = 0; s < n_sat; s++)
+        fprintf(fp, ", DF397_%02d=%u", s + 1, rough_int[s]);
+    for (int s = 0; s < n_sat; s++)
+    {
+        fprintf(fp, ", DF398_%02d=", s + 1);
+        put_float(fp, ldexp((double)rough_frac[s], -10));
+    }
+    for (int i = 0; i < n_cells; i++)
+        fprintf(fp, ", CELLPRN_%02d=%03u, CELLSIG_%02d=%s", i + 1, cells[i].prn, i + 1,
+                cells[i].sig == MSM_SIG_1C ? "1C" : "5Q");
+    for (int i = 0; i < n_cells; i++)
+    {
+        fprintf(fp, ", DF400_%02d=", i + 1);
+        put_float(fp, ldexp((double)fine[i], -24));
+    }
+    for (int i = 0; i < n_cells; i++)
+    {
+        fprintf(fp, ", DF401_%02d=", i + 1);
+        put_float(fp, ldexp((double)phase[i], -29));
+    }
+    for (int i = 0; i < n_cells; i++)
+        fprintf(fp, ", DF402_%02d=%u", i + 1, cells[i].lock_ind);
+    for (int i = 0; i < n_cells; i++)
+        fprintf(fp, ", DF420_%02d=0", i + 1);
+    for (int i = 0; i < n_cells; i++)
+        fprintf(fp, ", DF403_%02d=%u", i + 1, cells[i].cnr);
+    fputs(")>\n", fp);
+    out->n_messages++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Simulation
+
+/**
+ * @brief Keeps the first healthy ephemeris of every PRN found in the seed log
+ *        and the time of its first MSM4 epoch.
+ */
+static void collect_seed(const rtcm_message_t *msg, void *ctx)
+{
+    (void)ctx;
+    if (msg->msg_type == 1074 && seed_first_epoch_ms < 0)
+        seed_first_epoch_ms = msg->data.msm4.gps_epoch_time;
+    if (msg->msg_type != 1019)
+        return;
+    const rtcm_1019_ephemeris_t *m = &msg->data.eph;
+    if (m->satellite_id < 1 || m->satellite_id > GPS_MAX_PRN || m->gps_sv_health != 0 ||
+        sats[m->satellite_id].have_seed)
+        return;
+    eph_from_message(m, &sats[m->satellite_id].seed);
+    sats[m->satellite_id].have_seed = true;
+}
+
+/** @brief Reads the seed ephemerides from a text or binary log. */
+static int load_seed(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, COLOR_RED "Error: Cannot open ephemeris log %s: %s\n" COLOR_RESET, path, strerror(errno));
+        return -1;
+    }
+    int first = fgetc(fp);
+    rewind(fp);
+    int status = first == RTCM3_PREAMBLE ? rtcm3_read_stream(fp, collect_seed, NULL)
+                                         : read_next_rtcm_message(fp, collect_seed, NULL);
+    fclose(fp);
+    if (status != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Failed to read ephemeris log %s\n" COLOR_RESET, path);
+        return -1;
+    }
+    return 0;
+}
+
+/** @brief Ephemeris of @p prn broadcast at time @p t (block nearest to its TOE). */
+static const gen_eph_t *current_eph(int prn, double t)
+{
+    sat_state_t *st = &sats[prn];
+    long block = lround((t - st->seed.v[F_TOE]) / EPH_BLOCK_S);
+    if (!st->have_cur || block != st->block)
+    {
+        advance_eph(&st->seed, block, &st->cur);
+        st->block = block;
+        st->have_cur = true;
+    }
+    return &st->cur;
+}
+
+/**
+ * @brief Builds the cells of all satellites above the mask at @p tow_ms.
+ *
+ * Writes due ephemerides (first sighting, new block, or repeat interval) first.
+ *
+ * @return Number of cells.
+ */
+static int simulate_epoch(const loggen_opts_t *o, const double rx[3], const double up[3],
+                          int64_t tow_ms, log_out_t *out, gen_cell_t *cells)
+{
+    double t = (double)tow_ms * 1e-3;
+    int n_cells = 0;
+
+    for (int prn = 1; prn <= GPS_MAX_PRN; prn++)
+    {
+        sat_state_t *st = &sats[prn];
+        if (!st->have_seed)
+            continue;
+        const gen_eph_t *e = current_eph(prn, t);
+
+        // Light time with Earth rotation during the flight
+        double pos[3], dt_sv = 0.0, rho = 0.0, los[3] = {0};
+        double tau = 0.075;
+        for (int it = 0; it < 3; it++)
+        {
+            double p[3];
+            eph_position(e, t - tau, p, &dt_sv);
+            double wt = GPS_OMEGA_E * tau;
+            pos[0] = p[0] * cos(wt) + p[1] * sin(wt);
+            pos[1] = -p[0] * sin(wt) + p[1] * cos(wt);
+            pos[2] = p[2];
+            for (int k = 0; k < 3; k++)
+                los[k] = pos[k] - rx[k];
+            rho = sqrt(los[0] * los[0] + los[1] * los[1] + los[2] * los[2]);
+            tau = rho / SPEED_OF_LIGHT;
+        }
+        double sin_el = (los[0] * up[0] + los[1] * up[1] + los[2] * up[2]) / rho;
+        double el = asin(sin_el);
+
+        if (el < o->mask_deg * PI / 180.0)
+        {
+            st->visible = false;
+            continue;
+        }
+        if (!st->visible)
+        {
+            st->visible = true;
+            bool at_start = tow_ms == (int64_t)llround(o->start_tow * 1000.0);
+            st->rise_ms = at_start ? tow_ms - INITIAL_LOCK_MS : tow_ms;
+        }
+
+        if (st->sent_ms < 0 || st->sent_block != st->block || tow_ms - st->sent_ms >= (int64_t)o->eph_interval_s * 1000)
+        {
+            write_1019(out, e);
+            st->sent_ms = tow_ms;
+            st->sent_block = st->block;
+        }
+
+        // Atmosphere: thin-shell ionosphere obliquity, simple tropospheric mapping
+        double cos_el = cos(el);
+        double iono = IONO_ZENITH_M / sqrt(1.0 - 0.8836 * cos_el * cos_el);
+        double tropo = TROPO_ZENITH_M / sin(sqrt(el * el + 0.0019));
+        double base = rho + SPEED_OF_LIGHT * (RX_CLOCK_BIAS_S - dt_sv) + tropo;
+        unsigned lock = lock_indicator(tow_ms - st->rise_ms);
+        double cnr = 22.0 + 28.0 * sin_el + rng_gauss();
+        unsigned cnr_u = (unsigned)(cnr < 0.0 ? 0.0 : (cnr > 63.0 ? 63.0 : round(cnr)));
+
+        const double m_to_ms = 1e3 / SPEED_OF_LIGHT;
+        cells[n_cells++] = (gen_cell_t){(uint8_t)prn, MSM_SIG_1C,
+                                        (base + iono + CODE_NOISE_M * rng_gauss()) * m_to_ms,
+                                        (base - iono + PHASE_NOISE_M * rng_gauss()) * m_to_ms, lock, cnr_u};
+        if (has_l5((uint8_t)prn))
+        {
+            double iono5 = iono * L5_IONO_SCALE;
+            cells[n_cells++] = (gen_cell_t){(uint8_t)prn, MSM_SIG_5Q,
+                                            (base + iono5 + CODE_NOISE_M * rng_gauss()) * m_to_ms,
+                                            (base - iono5 + PHASE_NOISE_M * rng_gauss()) * m_to_ms, lock,
+                                            cnr_u > 2 ? cnr_u - 2 : 0};
+        }
+    }
+    return n_cells;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Prints the command line help. */
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: rtcm_loggen -o OUT [options]\n"
+            "  -o OUT          output log\n"
+            "  -b              write binary RTCM3 (default: PyRTCM text)\n"
+            "  -i EPH_LOG      log with the seed 1019 ephemerides, text or binary (default example/parsed_log.txt)\n"
+            "  -r HZ           epoch rate: 1, 2, 4, 5, 8, 10 or 20 (default 1)\n"
+            "  -d HOURS        duration (default 1)\n"
+            "  -t TOW          start time of week in s (default: first epoch of EPH_LOG)\n"
+            "  -p LAT,LON,ALT  receiver position in degrees / m (default 49.18804128,-123.11684646,3.6)\n"
+            "  -m DEG          elevation mask (default 10)\n"
+            "  -e SEC          ephemeris repeat interval (default 30)\n"
+            "  -s SEED         noise seed (default 1)\n");
+}
+
+/** @brief Parses the command line into @p o. @return 0, or -1 on a bad argument. */
+static int parse_args(int argc, char **argv, loggen_opts_t *o)
+{
+    *o = (loggen_opts_t){.eph_path = "example/parsed_log.txt", .rate_hz = 1, .hours = 1.0, .start_tow = -1.0,
+                         .lat_deg = 49.18804128, .lon_deg = -123.11684646, .alt_m = 3.6, .mask_deg = 10.0,
+                         .eph_interval_s = 30, .seed = 1};
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        if (strcmp(a, "-b") == 0)
+        {
+            o->binary = true;
+            continue;
+        }
+        if (a[0] != '-' || strlen(a) != 2 || i + 1 >= argc)
+            return -1;
+        const char *val = argv[++i];
+        char *end = NULL;
+        switch (a[1])
+        {
+        case 'o':
+            o->out_path = val;
+            break;
+        case 'i':
+            o->eph_path = val;
+            break;
+        case 'r':
+            o->rate_hz = (int)strtol(val, &end, 10);
+            break;
+        case 'd':
+            o->hours = strtod(val, &end);
+            break;
+        case 't':
+            o->start_tow = strtod(val, &end);
+            break;
+        case 'p':
+            if (sscanf(val, "%lf,%lf,%lf", &o->lat_deg, &o->lon_deg, &o->alt_m) != 3)
+                return -1;
+            break;
+        case 'm':
+            o->mask_deg = strtod(val, &end);
+            break;
+        case 'e':
+            o->eph_interval_s = (int)strtol(val, &end, 10);
+            break;
+        case 's':
+            o->seed = strtoull(val, &end, 10);
+            break;
+        default:
+            return -1;
+        }
+        if (end && *end != '\0')
+            return -1;
+    }
+    if (!o->out_path || o->rate_hz < 1 || o->rate_hz > 20 || 1000 % o->rate_hz != 0 || !(o->hours > 0.0) ||
+        o->eph_interval_s < 1)
+        return -1;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    loggen_opts_t o;
+    if (parse_args(argc, argv, &o) != 0)
+    {
+        usage();
+        return 2;
+    }
+    if (load_seed(o.eph_path) != 0)
+        return 1;
+
+    int n_seed = 0;
+    double first_toe = SECONDS_PER_WEEK;
+    for (int prn = 1; prn <= GPS_MAX_PRN; prn++)
+    {
+        sats[prn].sent_ms = -1;
+        if (sats[prn].have_seed)
+        {
+            n_seed++;
+            first_toe = fmin(first_toe, sats[prn].seed.v[F_TOE]);
+        }
+    }
+    if (n_seed == 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: No healthy GPS ephemeris (1019) in %s\n" COLOR_RESET, o.eph_path);
+        return 1;
+    }
+    if (o.start_tow < 0.0)
+        o.start_tow = seed_first_epoch_ms >= 0 ? (double)seed_first_epoch_ms * 1e-3 : first_toe;
+
+    int64_t period_ms = 1000 / o.rate_hz;
+    int64_t start_ms = (int64_t)llround(o.start_tow * 1000.0);
+    start_ms -= start_ms % period_ms;
+    o.start_tow = (double)start_ms * 1e-3;
+    int64_t n_epochs = (int64_t)llround(o.hours * 3600.0 * o.rate_hz);
+    if (start_ms + n_epochs * period_ms > (int64_t)(SECONDS_PER_WEEK - EPH_BLOCK_S) * 1000)
+    {
+        fprintf(stderr, COLOR_RED "Error: The log must end at least %.0f s before the end of the GPS week.\n" COLOR_RESET,
+                EPH_BLOCK_S);
+        return 1;
+    }
+
+    log_out_t out = {.binary = o.binary};
+    out.fp = fopen(o.out_path, o.binary ? "wb" : "w");
+    if (!out.fp)
+    {
+        fprintf(stderr, COLOR_RED "Error: Cannot create %s: %s\n" COLOR_RESET, o.out_path, strerror(errno));
+        return 1;
+    }
+    setvbuf(out.fp, NULL, _IOFBF, (size_t)1 << 20);
+    rng_state = o.seed * 0x9E3779B97F4A7C15ull + 1u;
+
+    double rx[3], up[3];
+    geodetic_to_ecef(o.lat_deg, o.lon_deg, o.alt_m, rx);
+    double lat = o.lat_deg * PI / 180.0, lon = o.lon_deg * PI / 180.0;
+    up[0] = cos(lat) * cos(lon);
+    up[1] = cos(lat) * sin(lon);
+    up[2] = sin(lat);
+
+    gen_cell_t cells[MAX_CELL];
+    for (int64_t i = 0; i < n_epochs; i++)
+    {
+        int64_t tow_ms = start_ms + i * period_ms;
+        int n_cells = simulate_epoch(&o, rx, up, tow_ms, &out, cells);
+        write_1074(&out, (uint32_t)tow_ms, cells, n_cells);
+    }
+
+    long size = ftell(out.fp);
+    if (fclose(out.fp) != 0 || size < 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Failed to write %s\n" COLOR_RESET, o.out_path);
+        return 1;
+    }
+    printf(COLOR_GREEN "Wrote %s: %lld epochs at %d Hz from TOW %.3f s, %lu messages, %.1f MiB (%s)\n" COLOR_RESET,
+           o.out_path, (long long)n_epochs, o.rate_hz, o.start_tow, out.n_messages, (double)size / (1024.0 * 1024.0),
+           o.binary ? "binary RTCM3" : "text");
+    return 0;
+}
@@ -14,6 +14,8 @@
 #include <string.h>    /**< String manipulation functions */
 #include <math.h>      /**< Math functions such as sqrt, sin, cos */
 #include <stdbool.h>   /**< Boolean type support for C99 and above */
+#include <stdint.h>    /**< Fixed-width integer types (uint8_t, uint32_t, etc.) */
+#include <stddef.h>    /**< offsetof, size_t */
 #include <time.h>      /**< Time and date functions */
 #include <unistd.h>    /**< POSIX API (read, write, close, etc.) */
 #include <sys/types.h> /**< System data types (pid_t, size_t, etc.) */
@@ -34,15 +36,29 @@ void app_menu(void);
 /* App Cleanup */
 void app_cleanup(void);
 
+/* Worker threads (GPS_RESOLVER_THREADS) */
+#define MAX_WORKER_THREADS 64
+int configured_thread_count(void);
+
 /* Option 1: Serial connection */
+#define SERIAL_DEFAULT_BAUD 115200L
 #ifdef _WIN32
 #include <windows.h>
-HANDLE serial_connect_windows(char *selected_port, size_t size);
+HANDLE serial_connect_windows(char *selected_port, size_t size, long baud);
 #else
-int serial_connect_mac(char *selected_port, size_t size);
+int serial_connect_mac(char *selected_port, size_t size, long baud);
 #endif
-void *serial_connect(char *selected_port, size_t size);
+bool serial_baud_supported(long baud);
+void *serial_connect(char *selected_port, size_t size, long baud);
+int serial_input_mode(void);
 
 /* Option 2: File connection */
 FILE *file_connect(bool is_parsed);
+FILE *file_connect_path(bool is_parsed, char *path, size_t size);
 int file_input_mode(bool is_parsed);
+
+/* Option 4: Streaming file input (epoch-by-epoch solve) */
+int stream_input_mode(void);
+
+/* Option 5: Network input (NTRIP casters / TCP, several streams at once) */
+int net_input_mode(void);
@@ -0,0 +1,18 @@
+#ifndef BATCH_CLI_H
+#define BATCH_CLI_H
+
+#include "../include/algo.h"
+#include "../include/track_sink.h"
+
+/// Outputs of a batch run: the TRACK_SINK_CSV / NMEA / KML tracks plus these
+#define BATCH_OUTPUT_PLOTS 0x10u ///< The gnuplot .dat files (write_all_plots())
+#define BATCH_OUTPUT_STATS 0x20u ///< run_stats.json
+#define BATCH_OUTPUT_ALL (TRACK_SINK_CSV | TRACK_SINK_NMEA | TRACK_SINK_KML | BATCH_OUTPUT_PLOTS | BATCH_OUTPUT_STATS)
+
+/// Per-log console output file in command line mode
+#define BATCH_LOG_NAME "gps_resolver.log"
+
+int batch_process_file(const char *path, bool is_parsed, const char *out_dir, unsigned outputs);
+int batch_cli(int argc, char **argv);
+
+#endif // BATCH_CLI_H
@@ -2,12 +2,13 @@
 #define DF_PARSER_H
 
 #include "../include/algo.h"
+#include "../include/gnss_sat.h"
 
 // Mathematical Pi constant
 #define PI 3.14159265358979323846264338327950288
 
-/// Maximum number of GPS satellites (PRNs 1–32)
-#define MAX_SAT 32
+/// Maximum number of satellites in one MSM message (DF394 is a 64-bit mask)
+#define MSM_MAX_SAT 64
 
 /// Maximum number of signal types in MSM messages (e.g., L1, L2, L5)
 #define MAX_SIG 32
@@ -15,35 +16,19 @@
 /// Maximum number of signal-satellite combinations (cells)
 #define MAX_CELL 64
 
-// Maximum number of epochs to store in pseudorange history
-#define MAX_EPOCHS 10000
+/// Frequency band of an MSM cell, as stored in rtcm_1074_msm4_t::cell_sig
+#define MSM_BAND_OTHER 0   ///< A signal the solver does not use
+#define MSM_BAND_PRIMARY 1 ///< First-frequency code: signal ID 2 ("1C", BeiDou B1I "2I")
+#define MSM_BAND_L5 2      ///< L5 / E5a / B2a: signal IDs 22-24 ("5I", "5Q", "5X", BeiDou "5D", "5P")
 
-/// Maximum number of satellites to store in ephemeris history
-#define MAX_EPH_HISTORY 10000
+/// rtcm_1074_msm4_t::primary_cell / l5_cell value of a satellite without that band
+#define MSM_NO_CELL 0xFF
 
 // Speed of light in meters per second
 #define SPEED_OF_LIGHT 299792458.0
 
-/**
- * @brief Utility macro to extract a field from a line by DF label.
- *
- * This macro simplifies repeated code where a specific DFxxx field value
- * needs to be parsed from a text-formatted RTCM message. It uses `strstr()`
- * to locate the field, and `sscanf()` to extract its value.
- *
- * @param field  The DF field label as a string (e.g., "DF009")
- * @param format The sscanf-compatible format string (e.g., "%lf")
- * @param target A pointer to the variable where the value should be stored
- */
-#define EXTRACT(field, format, target)                       \
-    do                                                       \
-    {                                                        \
-        const char *ptr = strstr(line, field "=");           \
-        if (ptr)                                             \
-            sscanf(ptr + strlen(field) + 1, format, target); \
-    } while (0)
-
-uint8_t observation_type; // Global variable to track the type of observation being processed
+/// Session state: stored messages and solver tables (defined in gnss_context.h)
+typedef struct gnss_context gnss_context_t;
 
 /**
  * @brief Data structure for RTCM 1019 (GPS Ephemeris) message.
@@ -51,30 +36,37 @@ uint8_t observation_type; // Global variable to track the type of observation be
  * This structure holds the parsed contents of an RTCM 1019 message,
  * which contains broadcast orbital parameters for a GPS satellite.
  * It is typically used for precise satellite position calculation.
+ *
+ * Galileo (1045 F/NAV, 1046 I/NAV) and BeiDou (1042) ephemerides carry the same
+ * Keplerian parameter set and are stored in the same members (DF numbers of
+ * those messages in parentheses where they differ in meaning); `msg_type`
+ * tells the constellation and `satellite_id` is the PRN within it.
+ * finalize_ephemeris() moves BeiDou TOE / TOC from BDT to GPS time and every
+ * week number to a GPS week modulo 1024, so all systems share one time scale.
  */
 typedef struct
 {
-    uint16_t msg_type;                        ///< DF002: Message number (should be 1019)
-    uint8_t satellite_id;                     ///< DF009: Satellite PRN (space vehicle ID)
+    uint16_t msg_type;                        ///< DF002: Message number (1019, 1042, 1045 or 1046)
+    uint8_t satellite_id;                     ///< DF009: Satellite PRN (space vehicle ID) (DF252, DF488)
     uint8_t sv;                               ///< DF009: Satellite PRN (space vehicle ID)
     uint16_t gps_wn;                          ///< DF076: GPS week number (modulo 1024)
     uint16_t week_number;                     ///< DF076 unscaled: GPS week number = gps_wn
     uint8_t gps_sv_acc;                       ///< DF077: SV accuracy index (URA)
     uint8_t gps_code_l2;                      ///< DF078: GPS code on L2 (00=reserved, 01=P code on, 10=C/A code on, 11=L2C on)
     double gps_idot;                          ///< DF079: GPS IDOT
-    uint16_t gps_iode;                        ///< DF071 GPS IODE
+    uint16_t gps_iode;                        ///< DF071 GPS IODE (DF290 IODnav, DF492 AODE)
     uint32_t gps_toc;                         ///< DF081: GPS time of clock (s of GPS week)
     double gps_af2;                           ///< DF082: Polynomial clock drift coefficient (s/s^2)
     double gps_af1;                           ///< DF083: Polynomial clock drift coefficient (s/s)
     double gps_af0;                           ///< DF084: Clock bias (s)
-    uint16_t gps_iodc;                        ///< DF071 GPS IODC
+    uint16_t gps_iodc;                        ///< DF071 GPS IODC (DF497 AODC)
     double gps_crs;                           ///< DF086: Radius correction sine term (m)
     double gps_delta_n;                       ///< DF087: Mean motion difference from computed value (rad/s)
     double gps_m0;                            ///< DF088: Mean anomaly at reference time (rad)
     double mean_anomaly;                      ///< DF088 unscaled: Mean anomaly = gps_m0 * pi
     double gps_cuc;                           ///< DF089: Latitude correction cosine term (rad)
     double gps_eccentricity;                  ///< DF090: Eccentricity
-    double eccentricity;                      ///< DF090 unscaled: Eccentricity = gps_eccentricity * 2e-33
+    double eccentricity;                      ///< DF090: Eccentricity = gps_eccentricity
     double gps_cus;                           ///< DF091: Latitude correction sine term (rad)
     double gps_sqrt_a;                        ///< DF092: Square root of semi-major axis (sqrt(m))
     double semi_major_axis;                   ///< DF092 unscaled: Semi-major axis = gps_sqrt_a ** 2
@@ -90,8 +82,9 @@ typedef struct
     double gps_omega;                         ///< DF099: Argument of perigee (rad)
     double argument_of_periapsis;             ///< DF099 unscaled: Argument of perigee = gps_omega * pi
     double gps_omega_dot;                     ///< DF100: Rate of right ascension (rad/s)
-    double gps_tgd;                           ///< DF101: Group delay differential (s)
-    uint8_t gps_sv_health;                    ///< DF102: SV health status (0=healthy, 1=unhealthy, 2=unknown)
+    double gps_tgd;                           ///< DF101: Group delay differential (s) (DF312 BGD E5a/E1, DF513 TGD1)
+    uint8_t gps_sv_health;                    ///< DF102: SV health status (0=healthy, 1=unhealthy, 2=unknown) (DF314 / DF287 signal health, DF515)
+    uint8_t data_validity;                    ///< Galileo DF315 / DF288: Navigation data validity status (0=valid, 1=working without guarantee)
     uint8_t gps_l2p_data_flag;                ///< DF103: L2 P data flag (0=L2P P-code nav data available, 1=L2P P-code nav data unavailable
     uint16_t gps_fit_interval;                ///< DF137: GPS fit interval (0=not fit, 1=fit, 2=unknown)
     uint32_t time_since_epoch;                ///< Time since epoch in seconds = ((week_number * 604800) + time_of_week)
@@ -102,13 +95,21 @@ typedef struct
  *
  * This structure stores the parsed contents of an MSM4 RTCM message,
  * typically used for GPS L1 pseudorange and carrier phase measurements.
+ * GLONASS (1084), Galileo (1094) and BeiDou (1124) MSM4 share the layout;
+ * only the epoch time field differs (see gnss_epoch_to_gps_ms()).
+ *
+ * Every cell of the message is kept at its raw index, tagged with its band
+ * (MSM_BAND_*). finalize_msm4_cells() then points each satellite at its
+ * primary and L5-band cell and computes both pseudoranges, so either signal
+ * set can be solved from one parse.
  */
 typedef struct
 {
-    uint16_t msg_type;            ///< DF002: Message number (1074 for GPS MSM4)
+    uint16_t msg_type;            ///< DF002: Message number (1074, 1084, 1094 or 1124)
     uint16_t station_id;          ///< DF003: Reference station ID
-    uint32_t gps_epoch_time;      ///< DF004: Epoch time in milliseconds of the week
-    uint32_t time_of_pseudorange; ///< DF004: Epoch time in milliseconds of the week
+    uint32_t gps_epoch_time;      ///< DF004 / DF034 / DF248 / DF427: Epoch time in milliseconds of the system's week (day for GLONASS)
+    uint8_t glo_day_of_week;      ///< DF416: GLONASS day of week (0 = Sunday)
+    uint32_t time_of_pseudorange; ///< Epoch time in GPS milliseconds of the week
     uint8_t msm_sync_flag;        ///< DF393: Epoch sync flag
     uint8_t iods_reserved;        ///< IODS – Issue Of Data Station
     uint8_t reserved_DF001_07;    ///< DF001_7: Reserved for future use
@@ -125,13 +126,16 @@ typedef struct
     uint8_t n_cell; ///< Number of satellite-signal combinations (NCell)
 
     uint8_t cell_prn[MAX_CELL]; ///< Cell PRN mapping (CELLPRN_01, _02, ...)
-    uint8_t cell_sig[MAX_CELL]; ///< Cell signal mapping (CELLSIG_01, _02, ...)
+    uint8_t cell_sig[MAX_CELL]; ///< Cell band (MSM_BAND_*) from CELLSIG_01, _02, ... / DF395
 
-    uint8_t prn[MAX_SAT];                 ///< PRN_01..PRN_N: Satellite PRNs
-    uint8_t pseudorange_integer[MAX_SAT]; ///< DF397_*: Rough range integer in milliseconds
-    double pseudorange_mod_1s[MAX_SAT];   ///< DF398_*: Pseudorange modulo 1 second)
-    double pseudorange_fine[MAX_CELL];    ///< DF400: Pseudorange residuals (seconds * c)
-    double pseudorange[MAX_SAT];          ///< Pseudorange = integer + mod_1s + fine (seconds * c)
+    uint8_t prn[MSM_MAX_SAT];                 ///< PRN_01..PRN_N: Satellite PRNs (within the constellation)
+    uint8_t pseudorange_integer[MSM_MAX_SAT]; ///< DF397_*: Rough range integer in milliseconds
+    double pseudorange_mod_1s[MSM_MAX_SAT];   ///< DF398_*: Pseudorange modulo 1 second)
+    double pseudorange_fine[MAX_CELL];        ///< DF400: Pseudorange residuals (seconds * c)
+    double pseudorange[MSM_MAX_SAT];          ///< Pseudorange = integer + mod_1s + fine (seconds * c), -1 without a primary signal
+    double pseudorange_l5[MSM_MAX_SAT];       ///< Same on the L5-band cell, -1 without one
+    uint8_t primary_cell[MSM_MAX_SAT];        ///< Cell of satellite s on MSM_BAND_PRIMARY, or MSM_NO_CELL
+    uint8_t l5_cell[MSM_MAX_SAT];             ///< Cell of satellite s on MSM_BAND_L5, or MSM_NO_CELL
     double phase_range[MAX_CELL];         ///< DF401: Carrier phase residuals (seconds * c)
     uint8_t lock_time[MAX_CELL];          ///< DF402: Lock time indicators
     uint8_t half_cycle_amb[MAX_CELL];     ///< DF420: Half-cycle ambiguity indicators
@@ -155,31 +159,105 @@ typedef struct
     uint8_t smooth_interval;       ///< DF008: GPS Smoothing interval)
     uint8_t svs[MAX_CELL];         ///< DF009: Sat PRN (01 - 32)
     uint8_t sig_id[MAX_SIG];       ///< DF010: Signal ID (00 = C/A, 01 = P(Y))
-    double remainders[MAX_SAT];    ///< DF011: pseudorange (m)
-    double pseudoranges[MAX_SAT];  ///< Full Pseudorange (m)
-    double phase_pr_diff[MAX_SAT]; ///< DF012: Carrier phase range (m)
-    uint8_t lock_time[MAX_SAT];    ///< DF013: Lock time indicator
-    uint8_t ambiguities[MAX_SAT];  ///< DF014: Pseudorange modulus ambiguity
-    uint8_t cnr[MAX_SAT];          ///< DF015: Carrier-to-noise ratio (dBHz scaled)
+    double remainders[MAX_PRN_GPS];    ///< DF011: pseudorange (m)
+    double pseudoranges[MAX_PRN_GPS];  ///< Full Pseudorange (m)
+    double phase_pr_diff[MAX_PRN_GPS]; ///< DF012: Carrier phase range (m)
+    uint8_t lock_time[MAX_PRN_GPS];    ///< DF013: Lock time indicator
+    uint8_t ambiguities[MAX_PRN_GPS];  ///< DF014: Pseudorange modulus ambiguity
+    uint8_t cnr[MAX_PRN_GPS];          ///< DF015: Carrier-to-noise ratio (dBHz scaled)
 } rtcm_1002_msm1_t;
 
+/**
+ * @brief Common header of an MSM message that is not decoded any further.
+ *
+ * MSM messages other than the MSM4 of GPS, GLONASS, Galileo and BeiDou (QZSS,
+ * SBAS, MSM5/MSM7, ...) are not used for positioning, but their DF393 flag still
+ * marks the last message of an epoch.
+ */
+typedef struct
+{
+    uint16_t msg_type;     ///< DF002: Message number (107x–113x)
+    uint16_t station_id;   ///< DF003: Reference station ID
+    uint8_t msm_sync_flag; ///< DF393: 1 if more MSM messages follow for the same epoch
+} rtcm_msm_header_t;
+
+/// True for any MSM1–MSM7 message number of any constellation (1071–1137)
+#define RTCM_IS_MSM(type) ((type) >= 1071 && (type) <= 1137 && (type) % 10 >= 1 && (type) % 10 <= 7)
+
+/// True for the MSM4 messages decoded into rtcm_1074_msm4_t (GPS, GLONASS, Galileo, BeiDou)
+#define RTCM_IS_MSM4_OBS(type) ((type) == 1074 || (type) == 1084 || (type) == 1094 || (type) == 1124)
+
+/// True for the ephemeris messages decoded into rtcm_1019_ephemeris_t (GPS, BeiDou, Galileo F/NAV and I/NAV)
+#define RTCM_IS_EPHEMERIS(type) ((type) == 1019 || (type) == 1042 || (type) == 1045 || (type) == 1046)
+
+/**
+ * @brief One decoded RTCM message of any supported type.
+ *
+ * Common currency between the input front-ends (text parser, binary RTCM3
+ * decoder) and the storage/solver back-ends. `msg_type` selects the active
+ * union member.
+ */
+typedef struct
+{
+    uint16_t msg_type; ///< 1002, an RTCM_IS_EPHEMERIS() or RTCM_IS_MSM4_OBS() type, or any other MSM number
+    union
+    {
+        rtcm_1019_ephemeris_t eph;    ///< Valid when RTCM_IS_EPHEMERIS(msg_type)
+        rtcm_1074_msm4_t msm4;        ///< Valid when RTCM_IS_MSM4_OBS(msg_type)
+        rtcm_1002_msm1_t msm1;        ///< Valid when msg_type == 1002
+        rtcm_msm_header_t msm_header; ///< Valid for any other RTCM_IS_MSM(msg_type)
+    } data;
+} rtcm_message_t;
+
+/**
+ * @brief Consumer of decoded messages, called by the input readers once per message.
+ *
+ * @param msg Decoded message, only valid for the duration of the call.
+ * @param ctx Caller-supplied context pointer.
+ */
+typedef void (*rtcm_message_handler_t)(const rtcm_message_t *msg, void *ctx);
+
 /**
  * @brief Parses a line of RTCM 1019 text-formatted input into a structured ephemeris object.
  *
  * @param line The input line containing a text-formatted RTCM 1019 message.
+ * @param len  Length of @p line in bytes (need not be NUL-terminated).
+ * @param eph Pointer to the ephemeris structure to be populated.
+ * @return 0 on success, non-zero on failure.
+ */
+int parse_rtcm_1019(const char *line, size_t len, rtcm_1019_ephemeris_t *eph);
+
+/**
+ * @brief Parses a line of RTCM 1045 / 1046 (Galileo ephemeris) text-formatted input.
+ *
+ * @param line The input line containing a text-formatted RTCM 1045 or 1046 message.
+ * @param len  Length of @p line in bytes (need not be NUL-terminated).
+ * @param eph Pointer to the ephemeris structure to be populated.
+ * @return 0 on success, non-zero on failure.
+ */
+int parse_rtcm_1045(const char *line, size_t len, rtcm_1019_ephemeris_t *eph);
+
+/**
+ * @brief Parses a line of RTCM 1042 (BeiDou ephemeris) text-formatted input.
+ *
+ * @param line The input line containing a text-formatted RTCM 1042 message.
+ * @param len  Length of @p line in bytes (need not be NUL-terminated).
  * @param eph Pointer to the ephemeris structure to be populated.
  * @return 0 on success, non-zero on failure.
  */
-int parse_rtcm_1019(const char *line, rtcm_1019_ephemeris_t *eph);
+int parse_rtcm_1042(const char *line, size_t len, rtcm_1019_ephemeris_t *eph);
 
 /**
  * @brief Parses a line of RTCM 1074 MSM4 text-formatted input into a structured observation object.
  *
+ * Also parses the 1084 / 1094 / 1124 MSM4 of the other constellations.
+ *
  * @param line The input line containing a text-formatted RTCM 1074 MSM4 message.
+ * @param len  Length of @p line in bytes (need not be NUL-terminated).
  * @param msm4 Pointer to the observation structure to be populated.
  * @return 0 on success, non-zero on failure.
  */
-int parse_rtcm_1074(const char *line, rtcm_1074_msm4_t *msm4);
+int parse_rtcm_1074(const char *line, size_t len, rtcm_1074_msm4_t *msm4);
 
 /**
  * @brief Parses a line of RTCM 1002 (GPS L1) text-formatted input into a structured observation object.
@@ -189,10 +267,46 @@ int parse_rtcm_1074(const char *line, rtcm_1074_msm4_t *msm4);
  * and stores them in the provided observation structure.
  *
  * @param line  Pointer to the input line containing the text-formatted RTCM 1002 message.
+ * @param len   Length of @p line in bytes (need not be NUL-terminated).
  * @param msm1  Pointer to the RTCM 1002 observation structure to be populated.
  * @return 0 on success, non-zero on failure.
  */
-int parse_rtcm_1002(const char *line, rtcm_1002_msm1_t *msm1);
+int parse_rtcm_1002(const char *line, size_t len, rtcm_1002_msm1_t *msm1);
+
+/**
+ * @brief Parses the common header of a text-formatted MSM message of any constellation.
+ *
+ * @param line The input line containing a text-formatted MSM message.
+ * @param len  Length of @p line in bytes (need not be NUL-terminated).
+ * @param hdr Pointer to the header structure to be populated.
+ * @return 0 on success, non-zero on failure.
+ */
+int parse_rtcm_msm_header(const char *line, size_t len, rtcm_msm_header_t *hdr);
+
+/**
+ * @brief Fills the derived (unscaled) ephemeris fields from the broadcast DF values.
+ *
+ * @param eph Ephemeris structure whose DF fields are already populated.
+ */
+void finalize_ephemeris(rtcm_1019_ephemeris_t *eph);
+
+/**
+ * @brief Pairs every satellite of a decoded MSM4 message with its primary and
+ *        L5-band cells and computes their pseudoranges and the GPS epoch time.
+ *
+ * Cell arrays must be filled at their raw cell index with `cell_sig[i]` set to
+ * the cell's MSM_BAND_* value.
+ *
+ * @param msm4 MSM4 structure to finalize in place.
+ */
+void finalize_msm4_cells(rtcm_1074_msm4_t *msm4);
+
+/**
+ * @brief Computes the full pseudorange of every satellite in a decoded MSM1 message.
+ *
+ * @param msm1 MSM1 structure whose DF fields are already populated.
+ */
+void finalize_msm1(rtcm_1002_msm1_t *msm1);
 
 /**
  * @brief Prints the contents of a parsed RTCM 1002 (GPS L1) legacy observation structure.
@@ -236,7 +350,7 @@ void print_ephemeris(const rtcm_1019_ephemeris_t *eph);
  * @param fine_sec Pseudorange residuals in seconds scaled by speed of light.
  * @return Computed pseudorange in seconds.
  */
-double compute_pseudorange(uint32_t integer_ms, double mod1s_sec, double fine_sec);
+double compute_pseudorange(uint32_t integer_ms, double mod1s_ms, double fine_ms);
 
 /**
  * @brief Computes the pseudorange for an RTCM 1002 (MSM1) observation.
@@ -254,31 +368,28 @@ double compute_pseudorange(uint32_t integer_ms, double mod1s_sec, double fine_se
  */
 double compute_pseudorange_msm1(double amb, double rem);
 
-// Pseudorange history: [PRN][epoch]
+/// DF401 value flagging an invalid phase range (-2^21 * 2^-29 ms)
+#define MSM_PHASE_RANGE_INVALID (-0x1p-8)
+/// DF012 value flagging an invalid phase range (-2^19 * 0.0005 m)
+#define MSM1_PHASE_PR_DIFF_INVALID (-262.144)
 
-int store_ephemeris(const rtcm_1019_ephemeris_t *new_eph);
-int store_msm4(const rtcm_1074_msm4_t *new_msm4);
-int store_msm1(const rtcm_1002_msm1_t *new_msm1);
-int store_pseudorange(const rtcm_1074_msm4_t *msm4);
-int store_pseudorange_msm1(const rtcm_1002_msm1_t *msm1);
-void print_all_stored_ephemeris(void);
-void print_all_stored_pseudoranges(void);
+double compute_carrier_range(uint32_t integer_ms, double mod1s_ms, double phase_range_ms);
+double compute_carrier_range_msm1(double pseudorange, double phase_pr_diff);
 
+int ephemeris_sat_index(const rtcm_1019_ephemeris_t *eph);
+int store_ephemeris(gnss_context_t *ctx, const rtcm_1019_ephemeris_t *new_eph);
+int store_msm4(gnss_context_t *ctx, const rtcm_1074_msm4_t *new_msm4);
+int store_msm1(gnss_context_t *ctx, const rtcm_1002_msm1_t *new_msm1);
+int store_rtcm_message(gnss_context_t *ctx, const rtcm_message_t *msg);
+void print_all_stored_ephemeris(const gnss_context_t *ctx);
+void print_all_stored_pseudoranges(const gnss_context_t *ctx);
+
+/// Growable per-satellite ephemeris history (see eph_history_insert() for the order)
 typedef struct
 {
-    rtcm_1019_ephemeris_t eph[MAX_EPH_HISTORY];
-    size_t count;
+    rtcm_1019_ephemeris_t *eph; ///< Heap array of stored ephemerides
+    size_t count;               ///< Entries in use
+    size_t cap;                 ///< Entries allocated
 } eph_history_t;
 
-eph_history_t eph_history[MAX_SAT + 1]; // Index 1–32 (PRNs)
-
-extern bool eph_available[MAX_SAT + 1];
-extern size_t msm4_count[MAX_SAT + 1];
-extern size_t msm1_count[MAX_SAT + 1];
-extern double pseudorange_history[MAX_SAT + 1][MAX_EPOCHS];
-extern size_t pseudorange_count[MAX_SAT + 1];
-extern rtcm_1074_msm4_t msm4_history[MAX_SAT + 1][MAX_EPOCHS];
-rtcm_1002_msm1_t msm1_history[MAX_SAT + 1][MAX_EPOCHS];
-extern rtcm_1019_ephemeris_t eph_table[MAX_SAT + 1];
-
 #endif // DF_PARSER_H
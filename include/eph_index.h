@@ -0,0 +1,19 @@
+#ifndef EPH_INDEX_H
+#define EPH_INDEX_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+
+/// Maximum |t - TOE| (s) for a broadcast ephemeris to be considered valid (GPS 4 h fit interval)
+#define EPH_MAX_AGE_S 7200.0
+/// Half a GPS week (s): time-of-week differences are wrapped into [-EPH_HALF_WEEK_S, EPH_HALF_WEEK_S]
+#define EPH_HALF_WEEK_S 302400.0
+
+double eph_toe_diff(const rtcm_1019_ephemeris_t *a, const rtcm_1019_ephemeris_t *b);
+double eph_time_from_toe(const rtcm_1019_ephemeris_t *eph, double t_sec);
+int eph_history_insert(eph_history_t *hist, const rtcm_1019_ephemeris_t *eph);
+bool eph_is_valid_at(const rtcm_1019_ephemeris_t *eph, double t_sec);
+const rtcm_1019_ephemeris_t *eph_select(const eph_history_t *hist, double t_sec);
+const rtcm_1019_ephemeris_t *eph_select_cursor(const eph_history_t *hist, double t_sec, size_t *cursor);
+
+#endif // EPH_INDEX_H
@@ -0,0 +1,59 @@
+#ifndef EPOCH_ASSEMBLER_H
+#define EPOCH_ASSEMBLER_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/obs_store.h"
+
+/**
+ * @brief One complete observation epoch: every satellite observed at one DF004 time.
+ *
+ * Only the satellites with have[sat] set are valid; the first observation
+ * received for a satellite wins.
+ */
+typedef struct
+{
+    uint32_t time_ms;              ///< Epoch time in GPS milliseconds of the week
+    int n_sats;                    ///< Satellites with an observation
+    int n_msgs;                    ///< Observation messages merged into the epoch
+    int n_duplicates;              ///< Observations dropped because their satellite was already set
+    bool have[MAX_SAT + 1];        ///< True if obs[sat] is set
+    obs_record_t obs[MAX_SAT + 1]; ///< Observation per satellite index
+    uint32_t tag[MAX_SAT + 1];     ///< Caller tag of obs[sat] (see epoch_assembler_add())
+} gnss_epoch_t;
+
+/**
+ * @brief Consumer of assembled epochs, called exactly once per epoch.
+ *
+ * @param epoch Complete epoch, only valid for the duration of the call.
+ * @param ctx   Caller-supplied context pointer.
+ */
+typedef void (*epoch_handler_t)(const gnss_epoch_t *epoch, void *ctx);
+
+/**
+ * @brief Groups observation messages into epochs as they arrive.
+ *
+ * An epoch closes on its last message (DF393 / DF005 == 0, on any MSM message
+ * of any constellation), when a message with another time shows up, or on
+ * epoch_assembler_flush(). Messages for the epoch emitted last are late: they
+ * are counted and dropped, so no epoch is ever emitted twice.
+ */
+typedef struct
+{
+    gnss_epoch_t epoch;       ///< Epoch being assembled
+    bool open;                ///< True once an observation message for epoch.time_ms arrived
+    bool have_last;           ///< True once an epoch was emitted
+    uint32_t last_time_ms;    ///< Time of the epoch emitted last
+    epoch_handler_t on_epoch; ///< Called for every complete epoch (may be NULL)
+    void *ctx;                ///< Passed through to on_epoch
+    unsigned long n_epochs;   ///< Epochs emitted
+    unsigned long n_late;     ///< Observation messages dropped as late
+} epoch_assembler_t;
+
+void epoch_assembler_init(epoch_assembler_t *assembler, epoch_handler_t on_epoch, void *ctx);
+void epoch_assembler_add(epoch_assembler_t *assembler, uint32_t time_ms, const obs_record_t *recs,
+                         const uint32_t *tags, int n_recs, bool more);
+void epoch_assembler_push(epoch_assembler_t *assembler, const rtcm_message_t *msg);
+void epoch_assembler_flush(epoch_assembler_t *assembler);
+
+#endif // EPOCH_ASSEMBLER_H
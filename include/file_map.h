@@ -0,0 +1,23 @@
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include "../include/algo.h"
+
+/**
+ * @brief Read-only memory mapping of an input file, from the stream position on.
+ *
+ * Lets the readers scan a log in place instead of copying it through stdio.
+ * The mapping is independent of the FILE position: the FILE is not advanced.
+ */
+typedef struct
+{
+    const uint8_t *data; ///< Byte at the stream position when the map was opened
+    size_t len;          ///< Bytes from data to the end of the file
+    void *base;          ///< Start of the mapping (offset 0 of the file)
+    size_t map_len;      ///< Length of the mapping
+} file_map_t;
+
+int file_map_open(FILE *fp, file_map_t *map);
+void file_map_close(file_map_t *map);
+
+#endif // FILE_MAP_H
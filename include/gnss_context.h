@@ -0,0 +1,60 @@
+#ifndef GNSS_CONTEXT_H
+#define GNSS_CONTEXT_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/obs_store.h"
+#include "../include/orbit_cache.h"
+#include "../include/satellites.h"
+#include "../include/receiver.h"
+#include "../include/track_sink.h"
+
+/**
+ * @brief State of one processing session: stored messages and every solver table.
+ *
+ * The readers (NULL handler), store_rtcm_message() and the batch stages
+ * (sort_satellites(), satellite_position_eci(), satellite_orbit_eci(),
+ * estimate_receiver_positions(), write_all_plots()) only touch the context
+ * they are given, so independent sessions can run on different threads of
+ * one process. The solver tables are heap arrays sized to the data of the
+ * session (see the gnss_context_alloc_* functions).
+ *
+ * Initialize with gnss_context_init() and release with gnss_context_free().
+ * The run statistics (perf_stats.c) stay process-wide.
+ */
+struct gnss_context
+{
+    // Stored messages (readers, store_rtcm_message(), obs_cache_load())
+    uint8_t observation_type;                     ///< Last observation type stored (1 = MSM1, 4 = MSM4, 0 = none)
+    obs_store_t obs_store;                        ///< MSM4 / MSM1 observations
+    eph_history_t eph_history[MAX_SAT + 1];       ///< TOE-sorted ephemerides per satellite index
+    rtcm_1019_ephemeris_t eph_table[MAX_SAT + 1]; ///< Last ephemeris received per satellite index
+    bool eph_available[MAX_SAT + 1];              ///< True if eph_table[sat] is set
+    orbit_cache_t orbit_cache[MAX_SAT + 1];       ///< Interpolation nodes per satellite index
+    sat_orbit_sweep_t orbit_sweep[MAX_SAT + 1];   ///< Plotted orbit per satellite index, swept on demand
+
+    // Solver tables (sort_satellites() onwards)
+    gps_satellite_data_t gps_list[MAX_SAT + 1];         ///< Per-satellite observation and ephemeris series
+    sat_eci_history_t sat_eci_positions[MAX_SAT + 1];   ///< Satellite ECI position per gps_list sample
+    sat_ecef_history_t sat_ecef_positions[MAX_SAT + 1]; ///< Satellite ECEF position per gps_list sample
+    estimated_position_t estimated_positions_ecef;      ///< Receiver ECEF fix per epoch
+    latlonalt_position_t latlonalt_positions;           ///< Receiver geodetic fix per epoch
+    int n_times;                                        ///< Epochs of the last estimate_receiver_positions()
+
+    // Settings (kept by gnss_context_free())
+    int n_threads;                  ///< Solver threads; 0 = configured_thread_count()
+    gnss_signal_mode_t signal_mode; ///< Observables of the solve; GNSS_SIGNALS_DEFAULT = configured_signal_mode()
+    rx_solver_mode_t solver_mode;   ///< Batch solver; RX_SOLVER_DEFAULT = configured_solver_mode()
+    track_sink_t *track_sink;       ///< Receives the fixes of estimate_receiver_positions(), or NULL
+};
+
+void gnss_context_init(gnss_context_t *ctx);
+void gnss_context_free(gnss_context_t *ctx);
+void gnss_context_free_solution(gnss_context_t *ctx);
+
+int gnss_context_alloc_series(gnss_context_t *ctx, int prn, size_t n_pseudoranges, size_t n_ephemerides);
+int gnss_context_alloc_sat_positions(gnss_context_t *ctx);
+int gnss_context_alloc_orbit_sweep(gnss_context_t *ctx, int prn, size_t n_points);
+int gnss_context_alloc_fixes(gnss_context_t *ctx, size_t n_epochs);
+
+#endif // GNSS_CONTEXT_H
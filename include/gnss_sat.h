@@ -0,0 +1,68 @@
+#ifndef GNSS_SAT_H
+#define GNSS_SAT_H
+
+#include "../include/algo.h"
+
+/// Constellations carried through the pipeline (order fixes the satellite index ranges)
+typedef enum
+{
+    GNSS_GPS,       ///< GPS (1019, 1002, 107x)
+    GNSS_GLO,       ///< GLONASS (108x; observations only, no 1020 ephemeris decoder)
+    GNSS_GAL,       ///< Galileo (1045, 1046, 109x)
+    GNSS_BDS,       ///< BeiDou (1042, 112x)
+    GNSS_SYS_COUNT, ///< Number of constellations
+    GNSS_SYS_NONE = -1
+} gnss_sys_t;
+
+/// Highest PRN / slot number per constellation (DF009, DF038, DF252, DF488 ranges)
+#define MAX_PRN_GPS 32
+#define MAX_PRN_GLO 27
+#define MAX_PRN_GAL 36
+#define MAX_PRN_BDS 63
+
+/**
+ * @brief Number of satellite indices (1..MAX_SAT) over all constellations.
+ *
+ * Every per-satellite table is indexed by this compact satellite index: GPS
+ * PRNs 1–32 keep indices 1–32, then GLONASS, Galileo and BeiDou follow. 158
+ * entries cover every satellite the four systems can broadcast, and the index
+ * still fits the uint8_t of obs_record_t.
+ */
+#define MAX_SAT (MAX_PRN_GPS + MAX_PRN_GLO + MAX_PRN_GAL + MAX_PRN_BDS)
+
+/// Length of a satellite name from gnss_sat_name() ("G05", "E11", "C59") plus the terminator
+#define GNSS_SAT_NAME_LEN 4
+
+/// Seconds BDT runs behind GPS time (BDT epoch 2006-01-01 vs. GPS 1980-01-06)
+#define GNSS_BDT_OFFSET_S 14
+/// GPS week of BDT and GST week 0 (broadcast weeks are stored as GPS weeks modulo 1024, like DF076)
+#define GNSS_BDT_WEEK_OFFSET 1356
+#define GNSS_GST_WEEK_OFFSET 1024
+/// GPS - UTC leap seconds for the GLONASS (UTC(SU) + 3 h) epoch time conversion
+#define GNSS_GPS_UTC_LEAP_S 18
+
+/// Observables of the position solve (gnss_context_t::signal_mode, GPS_RESOLVER_SIGNALS)
+typedef enum
+{
+    GNSS_SIGNALS_DEFAULT, ///< As configured_signal_mode()
+    GNSS_SIGNALS_L1,      ///< Primary-signal pseudoranges (L1 / E1 / B1I / G1)
+    GNSS_SIGNALS_IFLC     ///< Ionosphere-free L1 / L5 combination; satellites without L5 are left out
+} gnss_signal_mode_t;
+
+/// Carrier frequencies (Hz) of the primary and the L5-band signals
+#define GNSS_FREQ_L1 1575.42e6
+#define GNSS_FREQ_B1I 1561.098e6
+#define GNSS_FREQ_L5 1176.45e6
+
+int gnss_sat_index(gnss_sys_t sys, int prn);
+gnss_sys_t gnss_sat_sys(int sat);
+int gnss_sat_prn(int sat);
+const char *gnss_sat_name(int sat, char name[GNSS_SAT_NAME_LEN]);
+gnss_sys_t gnss_msg_sys(unsigned msg_type);
+uint32_t gnss_epoch_to_gps_ms(gnss_sys_t sys, uint32_t epoch_time, uint8_t glo_day);
+gnss_signal_mode_t configured_signal_mode(void);
+double gnss_iono_free(gnss_sys_t sys, double pr_primary, double pr_l5);
+double gnss_solve_pseudorange(gnss_signal_mode_t mode, gnss_sys_t sys, double pr_primary, double pr_l5);
+double gnss_solve_variance_factor(gnss_signal_mode_t mode, gnss_sys_t sys);
+
+#endif // GNSS_SAT_H
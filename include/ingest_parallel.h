@@ -0,0 +1,13 @@
+#ifndef INGEST_PARALLEL_H
+#define INGEST_PARALLEL_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+
+/// Smallest input share (bytes) worth a thread of its own
+#define INGEST_MIN_CHUNK_BYTES ((size_t)1 << 20)
+
+int ingest_thread_count(size_t len);
+int ingest_text_parallel(gnss_context_t *ctx, const char *data, size_t len, int n_threads);
+
+#endif // INGEST_PARALLEL_H
@@ -0,0 +1,21 @@
+#ifndef LOG_INPUT_H
+#define LOG_INPUT_H
+
+#include "../include/algo.h"
+
+/// Compression of a recorded log, detected from its first bytes
+typedef enum
+{
+    LOG_PLAIN, ///< Uncompressed text or binary log
+    LOG_GZIP,  ///< gzip (.gz), needs a build with WITH_ZLIB=1
+    LOG_ZSTD   ///< Zstandard (.zst), needs a build with WITH_ZSTD=1
+} log_compression_t;
+
+/// Compressed bytes read per step of the decompression thread
+#define LOG_INPUT_CHUNK ((size_t)1 << 16)
+
+log_compression_t log_compression_of(FILE *fp);
+const char *log_compression_name(log_compression_t kind);
+FILE *log_open(const char *path, bool binary);
+
+#endif // LOG_INPUT_H
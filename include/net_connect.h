@@ -0,0 +1,47 @@
+#ifndef NET_CONNECT_H
+#define NET_CONNECT_H
+
+#include "../include/algo.h"
+
+/// Default NTRIP caster port
+#define NTRIP_DEFAULT_PORT "2101"
+/// Longest caster response header accepted before the RTCM data starts (bytes)
+#define NTRIP_HEADER_MAX 4096
+
+/// Transport of a network RTCM source
+typedef enum
+{
+    NET_SOURCE_TCP,  ///< Raw RTCM3 bytes straight from a TCP socket
+    NET_SOURCE_NTRIP ///< NTRIP caster mountpoint (request, response header, then RTCM3)
+} net_source_kind_t;
+
+/**
+ * @brief One network RTCM source, parsed from a stream URL (see net_parse_endpoint()).
+ */
+typedef struct
+{
+    net_source_kind_t kind; ///< TCP or NTRIP
+    char host[256];         ///< Host name or address
+    char port[8];           ///< Service port
+    char mount[128];        ///< NTRIP mountpoint (without the leading '/'); empty for TCP
+    char user[64];          ///< NTRIP user name (empty: no Authorization header)
+    char password[64];      ///< NTRIP password
+    char name[64];          ///< Short label for messages and the output directory
+} net_endpoint_t;
+
+/// Outcome of net_ntrip_response()
+typedef enum
+{
+    NTRIP_RESPONSE_PARTIAL = 0,  ///< Header incomplete, read more
+    NTRIP_RESPONSE_OK = 1,       ///< Stream accepted; RTCM data follows the header
+    NTRIP_RESPONSE_RETRY = -1,   ///< Caster error that may clear up (busy, 5xx, garbage)
+    NTRIP_RESPONSE_REJECTED = -2 ///< Unknown mountpoint (source table) or bad credentials
+} ntrip_response_t;
+
+int net_parse_endpoint(const char *url, net_endpoint_t *ep);
+int net_connect_start(const net_endpoint_t *ep);
+int net_connect_finish(int fd);
+size_t net_ntrip_request(const net_endpoint_t *ep, char *buf, size_t size);
+ntrip_response_t net_ntrip_response(const char *buf, size_t len, size_t *header_len);
+
+#endif // NET_CONNECT_H
@@ -0,0 +1,15 @@
+#ifndef OBS_CACHE_H
+#define OBS_CACHE_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+
+/// Appended to the source log path to name its cache file
+#define OBS_CACHE_SUFFIX ".obscache"
+/// Bump whenever the file layout, a cached structure or the meaning of a cached value changes
+#define OBS_CACHE_VERSION 7u
+
+int obs_cache_load(gnss_context_t *ctx, const char *src_path);
+int obs_cache_save(const gnss_context_t *ctx, const char *src_path);
+
+#endif // OBS_CACHE_H
@@ -0,0 +1,96 @@
+#ifndef OBS_STORE_H
+#define OBS_STORE_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+
+/**
+ * @brief One MSM4 signal cell (satellite-signal combination) of an observation record.
+ */
+typedef struct
+{
+    double pseudorange; ///< Full pseudorange of the signal (m)
+    double phase_range; ///< DF401: Carrier phase range term
+    uint8_t band;       ///< MSM_BAND_* of the signal (MSM_BAND_OTHER for e.g. L2)
+    uint8_t cnr;        ///< DF403: Carrier-to-noise ratio (dBHz)
+    uint8_t lock_time;  ///< DF402: Lock time indicator
+    uint8_t half_cycle; ///< DF420: Half-cycle ambiguity indicator
+} obs_cell_t;
+
+/**
+ * @brief One satellite's observation at one epoch: the solver's primary-signal
+ *        (L1 / E1 / B1I / G1) view plus every signal cell of the message.
+ *
+ * The scalar members are what the solver reads: the primary cell's pseudorange,
+ * phase, CNR and lock time, the L5-band pseudorange for the ionosphere-free
+ * solve and the full carrier range, assembled once for the range-rate series.
+ * All MSM4 cells of the satellite, primary and L5 included, are kept in
+ * arrival order in a cell arena (obs_store_t::cells for stored records, see
+ * OBS_STORE_CELLS()), so other signal modes need no second parse. 1002
+ * records have no cells (their one L1 signal is the record itself).
+ */
+typedef struct
+{
+    uint32_t time_ms;   ///< Epoch time in GPS milliseconds of the week
+    uint8_t prn;        ///< Satellite index (1–MAX_SAT, see gnss_sat_index())
+    uint8_t cnr;        ///< DF403 / DF015: Carrier-to-noise ratio (dBHz)
+    uint8_t lock_time;  ///< DF402 / DF013: Lock time indicator
+    uint8_t n_cells;    ///< Signal cells of the satellite (0 for 1002)
+    double pseudorange;    ///< Full pseudorange (m)
+    double pseudorange_l5; ///< L5 / E5a / B2a pseudorange (m), -1 if not observed
+    double phase_range; ///< DF401 / DF012: Carrier phase range term
+    double carrier_range;  ///< Full carrier-phase range (m), 0 if the phase is not tracked
+    size_t first_cell;     ///< Index of the first cell in the cell arena
+} obs_record_t;
+
+/**
+ * @brief One stored observation message: a contiguous run of records in the arena.
+ */
+typedef struct
+{
+    uint32_t time_ms;  ///< DF004: Epoch time in milliseconds of the week
+    uint16_t msg_type; ///< 1074 / 1084 / 1094 / 1124 or 1002
+    uint8_t n_obs;     ///< Number of records
+    bool more;         ///< DF393 / DF005: further messages of the same epoch follow
+    size_t first;      ///< Index of the first record in obs_store_t::obs
+} obs_epoch_t;
+
+/**
+ * @brief Growable observation store.
+ *
+ * Records are appended once per message into a single arena; each satellite keeps a
+ * list of record indices in arrival order, so a per-satellite series is a direct
+ * walk over its list. All buffers grow on demand, so memory follows the log length.
+ */
+typedef struct
+{
+    obs_record_t *obs;             ///< Record arena
+    size_t n_obs;                  ///< Records in use
+    size_t cap_obs;                ///< Records allocated
+    obs_cell_t *cells;             ///< Cell arena (see obs_record_t::first_cell)
+    size_t n_cells;                ///< Cells in use
+    size_t cap_cells;              ///< Cells allocated
+    obs_epoch_t *epochs;           ///< One entry per stored message
+    size_t n_epochs;               ///< Entries in use
+    size_t cap_epochs;             ///< Entries allocated
+    size_t *prn_obs[MAX_SAT + 1];  ///< Per-satellite record indices, in arrival order
+    size_t prn_count[MAX_SAT + 1]; ///< Entries in use per satellite
+    size_t prn_cap[MAX_SAT + 1];   ///< Entries allocated per satellite
+} obs_store_t;
+
+int grow_array(void **buf, size_t *cap, size_t need, size_t elem_size);
+int obs_store_append(obs_store_t *store, uint16_t msg_type, uint32_t time_ms, bool more,
+                     const obs_record_t *recs, uint8_t n_recs, const obs_cell_t *cells);
+uint8_t obs_records_from_msm4(const rtcm_1074_msm4_t *msm4, obs_record_t recs[MSM_MAX_SAT], obs_cell_t cells[MAX_CELL]);
+uint8_t obs_records_from_msm1(const rtcm_1002_msm1_t *msm1, obs_record_t recs[MAX_PRN_GPS]);
+int obs_store_add_msm4(obs_store_t *store, const rtcm_1074_msm4_t *msm4);
+int obs_store_add_msm1(obs_store_t *store, const rtcm_1002_msm1_t *msm1);
+int obs_store_merge(obs_store_t *dst, const obs_store_t *src);
+void obs_store_free(obs_store_t *store);
+
+/// Record @p i (0-based, arrival order) of satellite @p prn
+#define OBS_STORE_PRN_RECORD(store, prn, i) (&(store)->obs[(store)->prn_obs[prn][i]])
+/// First of the obs_record_t::n_cells signal cells of stored record @p rec
+#define OBS_STORE_CELLS(store, rec) (&(store)->cells[(rec)->first_cell])
+
+#endif // OBS_STORE_H
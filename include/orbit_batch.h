@@ -0,0 +1,72 @@
+#ifndef ORBIT_BATCH_H
+#define ORBIT_BATCH_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+
+/// Newton steps of the fixed-iteration Kepler solve (from E0 = M + e sin M, error ~1e-16 for e <= 0.05)
+#define KEPLER_ITERATIONS 2
+/// Largest eccentricity handled by the fixed-iteration solve (GPS orbits: e < 0.03); larger e use libm
+#define KEPLER_SERIES_MAX_E 0.05
+
+/// orbit_batch_t flag: also compute ECEF velocities (vx, vy, vz)
+#define ORBIT_BATCH_VELOCITY 0x1u
+/// orbit_batch_t flag: also compute satellite clock corrections (clk)
+#define ORBIT_BATCH_CLOCK 0x2u
+
+/**
+ * @brief Structure-of-arrays batch of (ephemeris, time) propagation jobs.
+ *
+ * orbit_batch_add() copies the inputs out of the ephemeris and precomputes the
+ * terms that depend only on the orbital elements (reused from the previous job
+ * when it has the same elements); orbit_batch_propagate() then fills the outputs
+ * of every job. Optional arrays are only allocated when their flag is set.
+ */
+typedef struct
+{
+    size_t n;       ///< Jobs in use
+    size_t cap;     ///< Jobs allocated per array
+    unsigned flags; ///< ORBIT_BATCH_* options
+
+    // Inputs (one entry per job); element-derived terms are cached across jobs of one ephemeris
+    double *a;                   ///< Semi-major axis (m)
+    double *e;                   ///< Eccentricity
+    double *m0;                  ///< Mean anomaly at TOE (rad)
+    double *tk;                  ///< Time from TOE (s, week crossover handled)
+    double *t;                   ///< Propagation time (s of week)
+    double *mean_motion;         ///< sqrt(MU / a^3) + delta n (rad/s)
+    double *sqrt1me2;            ///< sqrt(1 - e^2)
+    double *cos_w, *sin_w;       ///< Argument of perigee
+    double *cos_i0, *sin_i0;     ///< Inclination at TOE
+    double *cos_node, *sin_node; ///< Longitude of the node at TOE in the ECI frame (see orbit_batch_add())
+    double *i_dot;               ///< Rate of inclination (rad/s)
+    double *node_dot;            ///< Rate of right ascension (rad/s)
+    double *cuc, *cus;           ///< Argument of latitude harmonic corrections (rad)
+    double *crc, *crs;           ///< Orbit radius harmonic corrections (m)
+    double *cic, *cis;           ///< Inclination harmonic corrections (rad)
+    double *af0;                 ///< Clock bias (s), ORBIT_BATCH_CLOCK only
+    double *af1;                 ///< Clock drift (s/s), ORBIT_BATCH_CLOCK only
+    double *af2;                 ///< Clock drift rate (s/s^2), ORBIT_BATCH_CLOCK only
+    double *toc;                 ///< Time of clock (s of week), ORBIT_BATCH_CLOCK only
+    double *tgd;                 ///< Group delay differential (s), ORBIT_BATCH_CLOCK only
+
+    // Outputs (one entry per job)
+    double *ecc_anom;              ///< Eccentric anomaly (rad)
+    double *sin_E, *cos_E;         ///< sin / cos of the eccentric anomaly
+    double *eci_x, *eci_y, *eci_z; ///< ECI position (m)
+    double *x, *y, *z;             ///< ECEF position (m)
+    double *vx, *vy, *vz;          ///< ECEF velocity (m/s), ORBIT_BATCH_VELOCITY only
+    double *clk;                   ///< L1 C/A satellite clock offset (s), ORBIT_BATCH_CLOCK only
+    uint8_t *ok;                   ///< 1 if the job produced a valid position
+
+    double last_inc, last_node, last_argp; ///< Angles behind the last computed sin / cos terms
+} orbit_batch_t;
+
+void orbit_batch_init(orbit_batch_t *batch, unsigned flags);
+int orbit_batch_reserve(orbit_batch_t *batch, size_t n_jobs);
+int orbit_batch_add(orbit_batch_t *batch, const rtcm_1019_ephemeris_t *eph, double t_sec);
+size_t orbit_batch_propagate(orbit_batch_t *batch);
+void orbit_batch_clear(orbit_batch_t *batch);
+void orbit_batch_free(orbit_batch_t *batch);
+
+#endif // ORBIT_BATCH_H
@@ -0,0 +1,41 @@
+#ifndef ORBIT_CACHE_H
+#define ORBIT_CACHE_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+
+/// Spacing (s) of the interpolation nodes on the GPS time-of-week grid
+#define ORBIT_CACHE_NODE_S 30.0
+/// Lagrange interpolation points per query (degree ORBIT_CACHE_POINTS - 1)
+#define ORBIT_CACHE_POINTS 6
+
+/**
+ * @brief Satellite positions of one ephemeris sampled on a regular time grid.
+ *
+ * Node k holds the position, velocity and satellite clock offset at
+ * t = (k_first + k) * ORBIT_CACHE_NODE_S. The cache belongs to the ephemeris
+ * identified by (toe, iode); querying it with another ephemeris starts over.
+ */
+typedef struct
+{
+    bool valid;        ///< True once toe/iode and the nodes are set
+    uint32_t toe;      ///< DF093 of the cached ephemeris
+    uint16_t iode;     ///< DF071 of the cached ephemeris
+    long k_first;      ///< Grid index of node 0
+    size_t n_nodes;    ///< Nodes in use
+    size_t cap;        ///< Nodes allocated
+    double (*eci)[3];  ///< ECI position per node (m)
+    double (*ecef)[3]; ///< ECEF position per node (m)
+    double (*vel)[3];  ///< ECEF velocity per node (m/s)
+    double *clk;       ///< Satellite clock offset per node (s, see ORBIT_BATCH_CLOCK)
+    uint8_t *ok;       ///< 1 if the node was propagated successfully
+} orbit_cache_t;
+
+int orbit_cache_prepare(orbit_cache_t *cache, const rtcm_1019_ephemeris_t *eph, double t_from, double t_to);
+int orbit_cache_position(const orbit_cache_t *cache, double t_sec, double eci[3], double ecef[3], double ecef_vel[3],
+                         double *sat_clk);
+size_t orbit_cache_nodes_for(double t_from, double t_to);
+void orbit_cache_invalidate(orbit_cache_t *cache);
+void orbit_cache_free(orbit_cache_t *cache);
+
+#endif // ORBIT_CACHE_H
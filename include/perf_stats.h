@@ -0,0 +1,89 @@
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include "../include/algo.h"
+
+/// Timed stages of file_input_mode(), in pipeline order
+typedef enum
+{
+    PERF_STAGE_INGEST,             ///< Reading the log (or loading its cache)
+    PERF_STAGE_SORT,               ///< sort_satellites()
+    PERF_STAGE_SATELLITE_ECI_ECEF, ///< satellite_position_eci() (ECEF rotation fused in)
+    PERF_STAGE_RECEIVER,           ///< estimate_receiver_positions() (incl. the streamed track files)
+    PERF_STAGE_ORBIT,              ///< satellite_orbit_eci() (plots only)
+    PERF_STAGE_OUTPUT,             ///< write_all_plots()
+    PERF_STAGE_COUNT
+} perf_stage_t;
+
+/// Run counters
+typedef enum
+{
+    PERF_LINES_READ,         ///< Text lines scanned
+    PERF_FRAMES_READ,        ///< CRC-valid RTCM3 frames
+    PERF_CRC_ERRORS,         ///< RTCM3 frames with a bad CRC
+    PERF_MSG_1002,           ///< RTCM 1002 messages parsed
+    PERF_MSG_1019,           ///< RTCM 1019 messages parsed
+    PERF_MSG_1074,           ///< RTCM 1074 messages parsed
+    PERF_MSG_EPH_OTHER,      ///< RTCM 1042 / 1045 / 1046 ephemerides parsed
+    PERF_MSG_MSM4_OTHER,     ///< RTCM 1084 / 1094 / 1124 messages parsed
+    PERF_MSG_MSM_OTHER,      ///< Other MSM messages (header only)
+    PERF_MSG_UNSUPPORTED,    ///< Binary frames of a type that is not decoded
+    PERF_PARSE_FAILURES,     ///< Messages that failed to parse / decode
+    PERF_EPOCHS_SOLVED,      ///< Batch epochs with a fix
+    PERF_EPOCHS_SKIPPED,     ///< Batch epochs without one (too few satellites, singular, unconverged)
+    PERF_NEWTON_ITERATIONS,  ///< Least-squares iterations over all solves
+    PERF_NEWTON_UNCONVERGED, ///< Least-squares solves still moving after ITERATIONS steps (rejected)
+    PERF_RAIM_EXCLUSIONS,    ///< Batch epochs with one satellite excluded by RAIM
+    PERF_RAIM_ALERTS,        ///< Batch epochs failing the RAIM test with no exclusion that passes
+    PERF_ORBIT_SWEEPS,       ///< Orbit sweeps computed (cached sweeps are not counted)
+    PERF_COUNTER_COUNT
+} perf_counter_t;
+
+/**
+ * @brief Counters accumulated locally by one reader / worker, published once
+ *        with perf_add_tally() so hot loops never touch shared cache lines.
+ */
+typedef struct
+{
+    uint64_t n[PERF_COUNTER_COUNT]; ///< Per perf_counter_t
+} perf_tally_t;
+
+/**
+ * @brief Counts one parsed / decoded message in @p tally.
+ *
+ * @param tally    Local tally.
+ * @param status   Parser result: 0 parsed, > 0 unsupported, < 0 failed.
+ * @param msg_type RTCM message type (valid when @p status <= 0).
+ */
+static inline void perf_tally_message(perf_tally_t *tally, int status, unsigned msg_type)
+{
+    if (status < 0)
+        tally->n[PERF_PARSE_FAILURES]++;
+    else if (status > 0)
+        tally->n[PERF_MSG_UNSUPPORTED]++;
+    else if (msg_type == 1002)
+        tally->n[PERF_MSG_1002]++;
+    else if (msg_type == 1019)
+        tally->n[PERF_MSG_1019]++;
+    else if (msg_type == 1074)
+        tally->n[PERF_MSG_1074]++;
+    else if (msg_type == 1042 || msg_type == 1045 || msg_type == 1046)
+        tally->n[PERF_MSG_EPH_OTHER]++;
+    else if (msg_type == 1084 || msg_type == 1094 || msg_type == 1124)
+        tally->n[PERF_MSG_MSM4_OTHER]++;
+    else
+        tally->n[PERF_MSG_MSM_OTHER]++;
+}
+
+void perf_reset(void);
+int64_t perf_now_ns(void);
+void perf_stage_begin(perf_stage_t stage);
+void perf_stage_end(perf_stage_t stage);
+void perf_count(perf_counter_t counter, uint64_t n);
+void perf_add_tally(const perf_tally_t *tally);
+uint64_t perf_counter_value(perf_counter_t counter);
+int64_t perf_stage_ns(perf_stage_t stage);
+long perf_peak_rss_kib(void);
+int perf_write_json(const char *path, const char *input);
+
+#endif // PERF_STATS_H
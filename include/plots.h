@@ -1,11 +1,17 @@
 #ifndef PLOTS_H
 #define PLOTS_H
 
-int write_receiver_track_ecef(const char *path, int n_epochs);
-int write_sat_orbits(const char *path);
-int write_receiver_track_geo(const char *path, int n_epochs);
-int write_receiver_ecef_epoch_km(const char *path, int n_epochs);
-int write_sat_xyz_km(const char *path);
-int write_pseudorange_time_km(const char *path);
+#include "../include/gnss_context.h"
+
+int write_receiver_track_ecef(const gnss_context_t *ctx, const char *path);
+int write_sat_orbits(const gnss_context_t *ctx, const char *path);
+int write_receiver_track_geo(const gnss_context_t *ctx, const char *path);
+int write_receiver_ecef_epoch_km(const gnss_context_t *ctx, const char *path);
+int write_sat_xyz_km(const gnss_context_t *ctx, const char *path);
+int write_pseudorange_time_km(const gnss_context_t *ctx, const char *path);
+int write_receiver_velocity_ecef(const gnss_context_t *ctx, const char *path);
+int write_sat_velocity_ecef(const gnss_context_t *ctx, const char *path);
+int write_sat_orbit_eci(const gnss_context_t *ctx, const char *path);
+int write_all_plots(const gnss_context_t *ctx, const char *dir);
 
 #endif // PLOTS_H
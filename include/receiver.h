@@ -3,6 +3,7 @@
 
 #include "../include/algo.h"
 #include "../include/satellites.h"
+#include "../include/track_sink.h"
 #include <assert.h>
 #include <math.h>
 #include <float.h>
@@ -10,12 +11,22 @@
 #include <string.h>
 
 #define ITERATIONS 10
+#define CONVERGENCE_M 1e-4 // Newton stops once |d pos| and |d clock| are below this (m)
 #define MIN_SATS 4
+#define RX_STATE_MAX (3 + GNSS_SYS_COUNT) // x, y, z and one clock bias per constellation
 #define RAD2DEG (180.0 / M_PI)
+// Measurement model of the weighted batch solve (see solve_receiver_epoch_wls())
+#define WLS_SIGMA_A_M 0.3       // code noise floor (m)
+#define WLS_SIGMA_B_M 0.3       // elevation-dependent code noise (m), divided by sin(elevation)
+#define WLS_MIN_SIN_EL 0.1      // sin(elevation) floor of the weighting (~5.7 deg)
+#define WLS_CNR_REF_DBHZ 45.0   // C/N0 at and above which the CNR term adds no variance
+#define WLS_COLD_STEPS 3        // unit-weight Newton steps before the weights of a cold start
+#define RAIM_Z_FA 3.0902        // standard normal quantile of the 1e-3 RAIM false-alarm rate
 // ========================= TUNABLES / DEBUG =========================
 #define ENABLE_LSQ_DEBUG 1
-#define MAX_UNIQUE_EPOCHS 100000 // hard cap to avoid huge working sets
 #define MAX_SV_USED MAX_SAT      // per-epoch satellite cap (<= MAX_SAT)
+#define RECEIVER_EPOCH_CHUNK 64  // epochs handed to a solver thread at a time
+#define RECEIVER_MAX_THREADS 64  // upper bound for gnss_context_t::n_threads / GPS_RESOLVER_THREADS
 // ===================================================================
 
 #if ENABLE_LSQ_DEBUGs
@@ -31,28 +42,84 @@
     } while (0)
 #endif
 
+// Receiver fixes, one entry per epoch (see gnss_context_alloc_fixes())
 typedef struct
 {
-    double x[MAX_EPOCHS];
-    double y[MAX_EPOCHS];
-    double z[MAX_EPOCHS];
+    double *x;
+    double *y;
+    double *z;
+    double *vx;          // ECEF velocity (m/s), NAN where no velocity was solved
+    double *vy;
+    double *vz;
+    double *clock_drift; // Receiver clock drift (m/s), NAN where no velocity was solved
 } estimated_position_t;
 
-extern estimated_position_t estimated_positions_ecef;
+/// Batch solver of estimate_receiver_positions() (gnss_context_t::solver_mode, GPS_RESOLVER_SOLVER)
+typedef enum
+{
+    RX_SOLVER_DEFAULT, ///< As configured_solver_mode()
+    RX_SOLVER_LSQ,     ///< Independent weighted least-squares snapshot per epoch, with RAIM
+    RX_SOLVER_EKF      ///< Recursive filter over the epochs in time order (see receiver_ekf.h)
+} rx_solver_mode_t;
+
+/// Measurement weighting and fault detection of solve_receiver_epoch_wls()
+typedef struct
+{
+    const double *var_factor; ///< Per-satellite variance factor (C/N0, signal combination), or NULL for 1
+    bool raim;                ///< Test the residuals and exclude at most one faulty satellite
+} rx_wls_opts_t;
 
-int estimate_receiver_positions(void);
+/// Integrity result of solve_receiver_epoch_wls()
+typedef struct
+{
+    int n_used;       ///< Satellites in the final solution
+    int excluded;     ///< Row excluded by RAIM, or -1
+    double test_stat; ///< Weighted sum of squared residuals of the final solution
+    double threshold; ///< Chi-square threshold it was tested against, 0 if untested
+    bool alert;       ///< The test failed and no single exclusion passed it
+} rx_wls_quality_t;
+
+int estimate_receiver_positions(gnss_context_t *ctx);
+rx_solver_mode_t configured_solver_mode(void);
+void sat_transmit_position(const double ecef[3], const double vel[3], double pseudorange, double out[3]);
+double wls_pseudorange_variance(const double pos[3], const double los[3], double range, double var_factor);
+double cnr_variance_factor(uint8_t cnr_dbhz);
+int solve_receiver_epoch(int n_svs, const double ecefs[][3], const double pseudoranges[],
+                         double pos[3], double *clock_bias_out);
+int solve_receiver_epoch_sys(int n_svs, const double ecefs[][3], const double pseudoranges[],
+                             const uint8_t systems[], const double initial_state[RX_STATE_MAX],
+                             double state_out[RX_STATE_MAX]);
+int solve_receiver_epoch_wls(int n_svs, const double ecefs[][3], const double pseudoranges[],
+                             const uint8_t systems[], const rx_wls_opts_t *opts,
+                             const double initial_state[RX_STATE_MAX], double state_out[RX_STATE_MAX],
+                             rx_wls_quality_t *quality);
+int solve_receiver_epoch_from(int n_svs, const double ecefs[][3], const double pseudoranges[],
+                              const double initial_state[4], double pos[3], double *clock_bias_out);
+int solve_receiver_velocity(int n_svs, const double ecefs[][3], const double sat_vels[][3],
+                            const double range_rates[], const double var_factor[], const double pos[3],
+                            double vel_out[3], double *clock_drift_out);
+
+/// Method of ecef_to_geodetic_batch()
+typedef enum
+{
+    GEODETIC_EXACT, ///< Vermeille's closed form, exact to rounding (ecef_to_geodetic())
+    GEODETIC_FAST   ///< One trig-free Bowring step, sub-millimetre near the surface
+} geodetic_precision_t;
 
 void ecef_to_geodetic(double x, double y, double z,
                       double *lat_deg, double *lon_deg, double *alt_m);
+void ecef_to_geodetic_batch(size_t n, const double *restrict x, const double *restrict y, const double *restrict z,
+                            geodetic_precision_t precision,
+                            double *restrict lat_deg, double *restrict lon_deg, double *restrict alt_m);
+void geodetic_to_ecef(double lat_deg, double lon_deg, double alt_m, double ecef[3]);
+void geodetic_to_ecef_batch(size_t n, const double *restrict lat_deg, const double *restrict lon_deg,
+                            const double *restrict alt_m,
+                            double *restrict x, double *restrict y, double *restrict z);
 typedef struct
 {
-    double lat[MAX_EPOCHS];
-    double lon[MAX_EPOCHS];
-    double alt[MAX_EPOCHS];
+    double *lat;
+    double *lon;
+    double *alt;
 } latlonalt_position_t;
 
-extern latlonalt_position_t latlonalt_positions;
-
-extern int n_times;
-
 #endif // RECEIVER_H
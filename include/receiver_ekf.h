@@ -0,0 +1,48 @@
+#ifndef RECEIVER_EKF_H
+#define RECEIVER_EKF_H
+
+#include "../include/algo.h"
+#include "../include/receiver.h"
+
+/// State layout of rx_ekf_t: position, velocity, one clock bias per gnss_sys_t, shared clock drift
+#define EKF_POS 0
+#define EKF_VEL 3
+#define EKF_CLK 6
+#define EKF_DRIFT (EKF_CLK + GNSS_SYS_COUNT)
+#define EKF_N_STATE (EKF_DRIFT + 1)
+
+// ========================= TUNABLES =========================
+#define EKF_ACCEL_PSD 1.0             // white acceleration noise per axis (m^2/s^3)
+#define EKF_CLK_BIAS_PSD 0.1          // clock bias random walk (m^2/s)
+#define EKF_CLK_DRIFT_PSD 0.1         // clock drift random walk (m^2/s^3)
+#define EKF_INIT_POS_SIGMA_M 30.0     // position sigma of a snapshot seed (m)
+#define EKF_INIT_VEL_SIGMA_MS 100.0   // velocity and drift sigma of a seed (m/s)
+#define EKF_INIT_CLK_SIGMA_M 1000.0   // sigma of a clock bias set from the first satellites of a system (m)
+#define EKF_MAX_GAP_MS 30000u         // a longer gap between epochs reseeds the filter
+#define EKF_MAX_OUTAGE_MS 10000u      // fixes with fewer than MIN_SATS satellites only this long after a full one
+// ============================================================
+
+/**
+ * @brief Recursive position / velocity / clock filter over consecutive epochs.
+ *
+ * The first epoch with enough satellites seeds the state from a snapshot
+ * solve_receiver_epoch_wls(); each later epoch is one prediction to its time
+ * plus one sequential measurement update of its pseudoranges, so it needs no
+ * Newton iterations and can carry a fix through short stretches with fewer than
+ * MIN_SATS satellites. Initialize with rx_ekf_init().
+ */
+typedef struct
+{
+    bool initialized;                   ///< True once seeded
+    uint32_t t_ms;                      ///< Time of the state (GPS ms of week)
+    uint32_t last_full_ms;              ///< Last epoch with at least MIN_SATS satellites
+    bool clk_valid[GNSS_SYS_COUNT];     ///< True once the clock bias of the system is set
+    double x[EKF_N_STATE];              ///< State (m, m/s)
+    double P[EKF_N_STATE][EKF_N_STATE]; ///< State covariance
+} rx_ekf_t;
+
+void rx_ekf_init(rx_ekf_t *f);
+int rx_ekf_step(rx_ekf_t *f, uint32_t t_ms, int n_svs, const double ecefs[][3], const double pseudoranges[],
+                const uint8_t systems[], const double var_factor[], double state_out[RX_STATE_MAX]);
+
+#endif // RECEIVER_EKF_H
@@ -0,0 +1,38 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include "../include/algo.h"
+
+#include <stdatomic.h>
+
+/**
+ * @brief Lock-free single-producer / single-consumer byte ring.
+ *
+ * The capacity is a power of two and head/tail are free-running counters, so
+ * the fill level is simply head - tail. The producer only writes head and the
+ * consumer only writes tail; each publishes with release and observes the
+ * other with acquire, which is all the synchronization two threads need.
+ *
+ * Both sides work in place on contiguous regions (ring_buffer_write_region() /
+ * ring_buffer_read_region()) so a reader can read() straight into the ring and a
+ * decoder can frame straight out of it.
+ */
+typedef struct
+{
+    uint8_t *data;           ///< Storage, cap bytes
+    size_t cap;              ///< Capacity in bytes (power of two)
+    size_t mask;             ///< cap - 1
+    atomic_size_t head;      ///< Total bytes written (producer)
+    atomic_size_t tail;      ///< Total bytes read (consumer)
+    atomic_ulong n_overruns; ///< Times the producer found the ring full
+} ring_buffer_t;
+
+int ring_buffer_init(ring_buffer_t *rb, size_t min_capacity);
+void ring_buffer_free(ring_buffer_t *rb);
+
+size_t ring_buffer_write_region(ring_buffer_t *rb, uint8_t **region);
+void ring_buffer_commit_write(ring_buffer_t *rb, size_t n);
+size_t ring_buffer_read_region(ring_buffer_t *rb, const uint8_t **region);
+void ring_buffer_commit_read(ring_buffer_t *rb, size_t n);
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,57 @@
+#ifndef RTCM3_DECODER_H
+#define RTCM3_DECODER_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+
+/// RTCM3 frame preamble byte
+#define RTCM3_PREAMBLE 0xD3
+
+/// Maximum RTCM3 payload length (10-bit length field)
+#define RTCM3_MAX_PAYLOAD 1023
+
+/// Maximum RTCM3 frame size: 3 header bytes + payload + 3 CRC-24Q bytes
+#define RTCM3_MAX_FRAME (3 + RTCM3_MAX_PAYLOAD + 3)
+
+/**
+ * @brief Incremental RTCM3 frame synchronizer.
+ *
+ * Bytes are pushed in arbitrary chunks (file reads, serial reads); the framer
+ * hunts for the 0xD3 preamble, reads the 10-bit length, waits for the full
+ * frame and validates its CRC-24Q. On a bad header or CRC it resynchronizes on
+ * the next preamble already buffered, so no input byte is lost.
+ */
+typedef struct
+{
+    uint8_t buf[RTCM3_MAX_FRAME]; ///< Frame being assembled (header + payload + CRC)
+    size_t len;                   ///< Bytes currently in buf
+    bool ready;                   ///< True while buf holds a complete, CRC-valid frame
+    unsigned long n_frames;       ///< Frames delivered
+    unsigned long n_crc_errors;   ///< Frames rejected by CRC-24Q
+    unsigned long n_skipped;      ///< Bytes discarded while hunting for a preamble
+} rtcm3_framer_t;
+
+uint32_t rtcm3_crc24q(const uint8_t *buf, size_t len);
+uint32_t rtcm3_getbitu(const uint8_t *buf, size_t pos, unsigned len);
+int32_t rtcm3_getbits(const uint8_t *buf, size_t pos, unsigned len);
+
+void rtcm3_framer_init(rtcm3_framer_t *framer);
+int rtcm3_framer_next(rtcm3_framer_t *framer, const uint8_t *data, size_t len, size_t *consumed);
+
+/// Payload of the frame currently held by a ready framer
+#define RTCM3_FRAME_PAYLOAD(framer) ((framer)->buf + 3)
+
+/// Payload length of the frame currently held by a ready framer
+#define RTCM3_FRAME_PAYLOAD_LEN(framer) ((size_t)(((framer)->buf[1] & 0x03u) << 8 | (framer)->buf[2]))
+
+int rtcm3_decode_1019(const uint8_t *payload, size_t len, rtcm_1019_ephemeris_t *eph);
+int rtcm3_decode_1042(const uint8_t *payload, size_t len, rtcm_1019_ephemeris_t *eph);
+int rtcm3_decode_1045(const uint8_t *payload, size_t len, rtcm_1019_ephemeris_t *eph);
+int rtcm3_decode_1074(const uint8_t *payload, size_t len, rtcm_1074_msm4_t *msm4);
+int rtcm3_decode_1002(const uint8_t *payload, size_t len, rtcm_1002_msm1_t *msm1);
+int rtcm3_decode_msm_header(const uint8_t *payload, size_t len, rtcm_msm_header_t *hdr);
+int rtcm3_decode_payload(const uint8_t *payload, size_t len, rtcm_message_t *msg);
+
+int rtcm3_read_stream(FILE *fp, rtcm_message_handler_t on_message, void *ctx);
+
+#endif // RTCM3_DECODER_H
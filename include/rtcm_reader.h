@@ -5,6 +5,11 @@
 #include <stdlib.h>
 #include <string.h>
 
-int read_next_rtcm_message(FILE *fp);
+#include "../include/df_parser.h"
+
+int parse_rtcm_line(const char *line, rtcm_message_t *msg);
+int parse_rtcm_span(const char *line, size_t len, rtcm_message_t *msg);
+int read_rtcm_text_buffer(const char *data, size_t len, rtcm_message_handler_t on_message, void *ctx);
+int read_next_rtcm_message(FILE *fp, rtcm_message_handler_t on_message, void *ctx);
 
 #endif // RTCM_READER_H
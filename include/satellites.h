@@ -3,78 +3,92 @@
 
 #include "../include/df_parser.h"
 #include "../include/algo.h"
+#include "../include/obs_store.h"
 
-// Function to sort satellites based on their ephemeris and MSM4 data
-int sort_satellites(eph_history_t *eph_history, rtcm_1074_msm4_t msm4_history[MAX_SAT][MAX_EPOCHS], rtcm_1002_msm1_t msm1_history[MAX_SAT][MAX_EPOCHS]);
+// Function to sort satellites based on their ephemeris and stored observations
+int sort_satellites(gnss_context_t *ctx);
+// Longest gap between two carrier samples that are differenced into a range rate (ms)
+#define RANGE_RATE_MAX_GAP_MS 10000u
 // Structure to hold GPS satellite data for each satellite available in the system
+// (heap arrays of n_pseudoranges / n_ephemerides entries, see gnss_context_alloc_series())
 typedef struct
 {
     double prn;
-    double pseudoranges[MAX_EPOCHS];
-    uint32_t times_of_pseudorange[MAX_EPOCHS];
-    double eccentricities[MAX_EPOCHS];
-    double inclinations[MAX_EPOCHS];
-    double mean_anomalies[MAX_EPOCHS];
-    double semi_major_axes[MAX_EPOCHS];
-    double right_ascension_of_ascending_node[MAX_EPOCHS];
-    double argument_of_periapsis[MAX_EPOCHS];
-    double times_of_ephemeris[MAX_EPOCHS];
+    size_t n_pseudoranges; // samples in pseudoranges/times_of_pseudorange
+    double *pseudoranges;
+    double *pseudoranges_l5; // L5-band pseudorange per sample, -1 if not observed
+    uint8_t *cnrs;           // C/N0 of the primary signal per sample (dBHz), 0 if not reported
+    double *range_rates;     // Carrier-phase range rate per sample (m/s), NAN without a clean neighbour
+    uint32_t *times_of_pseudorange;
+    size_t n_ephemerides; // unique TOEs in the ephemeris series below
+    double *eccentricities;
+    double *inclinations;
+    double *mean_anomalies;
+    double *semi_major_axes;
+    double *right_ascension_of_ascending_node;
+    double *argument_of_periapsis;
+    double *times_of_ephemeris;
 } gps_satellite_data_t;
 
-extern gps_satellite_data_t gps_list[MAX_SAT + 1];
-void print_gps_list(void);
+void print_gps_list(const gnss_context_t *ctx);
 
 // ECI satellite position calculation
 #define EARTH_MASS 5.9722e24               // kg
 #define GRAVITATIONAL_CONSTANT 6.67430e-11 // m^3 kg^-1 s^-2
 #define OMEGA_EARTH 7.2921151467e-5        // rad/s, Earth's rotation rate
 
-// Earth's standard gravitational parameter (mu = GM), in m^3/s^2
-#define MU (EARTH_MASS * GRAVITATIONAL_CONSTANT)
+// Earth's gravitational parameter (mu = GM) of the broadcast orbit model, in m^3/s^2
+// (IS-GPS-200; EARTH_MASS * GRAVITATIONAL_CONSTANT is 4e-6 off, tens of metres after two hours)
+#define MU 3.986005e14
 
-int satellite_position_eci(const gps_satellite_data_t gps_lists[]);
+int satellite_position_eci(gnss_context_t *ctx);
+int satellite_eci_position(const rtcm_1019_ephemeris_t *eph, double t_obs, double eci[3]);
 
+// Per-PRN position series, one entry per gps_list sample (see gnss_context_alloc_sat_positions())
 typedef struct
 {
-    double x[MAX_EPOCHS];
-    double y[MAX_EPOCHS];
-    double z[MAX_EPOCHS];
+    double *x;
+    double *y;
+    double *z;
 } sat_eci_history_t;
 
-extern sat_eci_history_t sat_eci_positions[MAX_SAT + 1];
-
 void mat3x3_vec3_mult(const double mat[3][3], const double vec[3], double out[3]);
 
 typedef struct
 {
-    double x[MAX_EPOCHS];
-    double y[MAX_EPOCHS];
-    double z[MAX_EPOCHS];
-    double t_ms[MAX_EPOCHS];
+    double *x;
+    double *y;
+    double *z;
+    double *vx; // ECEF velocity (m/s)
+    double *vy;
+    double *vz;
+    double *clk; // Satellite clock offset (s): broadcast polynomial + relativistic term - TGD
+    double *t_ms;
 } sat_ecef_history_t;
 
-extern sat_ecef_history_t sat_ecef_positions[MAX_SAT + 1];
-
-typedef struct
-{
-    double p[MAX_EPOCHS];
-    double q[MAX_EPOCHS];
-    double w[MAX_EPOCHS];
-} sat_orbit_pqw_history_t;
-
-extern sat_orbit_pqw_history_t sat_orbit_pqw_positions[MAX_SAT + 1];
+// Step of the true-anomaly orbit sweep (rad) and its points over 0..2*pi (last point clamped to 2*pi)
+#define ORBIT_SWEEP_STEP_RAD 0.01
+#define ORBIT_SWEEP_POINTS ((size_t)(2.0 * M_PI / ORBIT_SWEEP_STEP_RAD) + 2)
 
+// Full orbit of one satellite's first ephemeris, swept in true anomaly (see satellite_orbit_sweep()).
+// Keyed by the (TOE, IODE) it was swept from; n_points entries per column.
 typedef struct
 {
-    double x[MAX_EPOCHS];
-    double y[MAX_EPOCHS];
-    double z[MAX_EPOCHS];
-} sat_orbit_eci_history_t;
-
-extern sat_orbit_eci_history_t sat_orbit_eci_positions[MAX_SAT + 1];
-
-int satellite_position_ecef(const gps_satellite_data_t gps_lists[MAX_SAT + 1]);
-
-int satellite_orbit_eci(const gps_satellite_data_t gps_lists[]);
+    bool valid;
+    uint32_t toe; // DF093 of the swept ephemeris
+    uint16_t iode; // DF071 of the swept ephemeris
+    size_t n_points;
+    double *p; // perifocal frame (m)
+    double *q;
+    double *w;
+    double *x; // ECI (m)
+    double *y;
+    double *z;
+} sat_orbit_sweep_t;
+
+void satellite_eci_to_ecef(const double eci[3], double t_sec, double ecef[3]);
+
+const sat_orbit_sweep_t *satellite_orbit_sweep(gnss_context_t *ctx, int prn);
+int satellite_orbit_eci(gnss_context_t *ctx);
 
 #endif
@@ -0,0 +1,62 @@
+#ifndef STREAM_SOLVER_H
+#define STREAM_SOLVER_H
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/orbit_cache.h"
+#include "../include/epoch_assembler.h"
+
+/**
+ * @brief Position solution of one streamed epoch.
+ */
+typedef struct
+{
+    unsigned long epoch; ///< Running epoch index (0-based, includes unsolved epochs)
+    uint32_t time_ms;    ///< DF004: Epoch time in milliseconds of the week
+    int n_svs;           ///< Satellites used in the solution
+    double ecef[3];      ///< Receiver ECEF position (m)
+    double clock_bias;   ///< Receiver clock bias (m)
+    double lat_deg;      ///< Geodetic latitude (deg)
+    double lon_deg;      ///< Geodetic longitude (deg)
+    double alt_m;        ///< Ellipsoidal height (m)
+    bool has_velocity;   ///< vel / clock_drift are set
+    double vel[3];       ///< Receiver ECEF velocity (m/s)
+    double clock_drift;  ///< Receiver clock drift (m/s)
+} stream_fix_t;
+
+/**
+ * @brief Consumer of streamed fixes, called once per solved epoch.
+ *
+ * @param fix Solution, only valid for the duration of the call.
+ * @param ctx Caller-supplied context pointer.
+ */
+typedef void (*stream_fix_handler_t)(const stream_fix_t *fix, void *ctx);
+
+/**
+ * @brief Epoch-by-epoch solver state.
+ *
+ * Holds one open epoch, the current ephemeris per satellite (highest TOE received
+ * so far) and its orbit cache, so memory does not grow with the length of the
+ * input. Release with stream_solver_free().
+ */
+typedef struct
+{
+    epoch_assembler_t assembler;            ///< Groups the observation messages into epochs
+    rtcm_1019_ephemeris_t eph[MAX_SAT + 1]; ///< Current ephemeris per satellite
+    bool eph_valid[MAX_SAT + 1];            ///< True if eph[prn] is set
+    orbit_cache_t orbit[MAX_SAT + 1];       ///< Interpolation nodes of eph[prn]
+    double state[3 + GNSS_SYS_COUNT];       ///< Last fix {x, y, z, clock bias per gnss_sys_t} (m), start of the next solve
+    bool have_state;                        ///< True if state is set
+    gnss_signal_mode_t signal_mode;         ///< Observables of the solve (configured_signal_mode() at init)
+    stream_fix_handler_t on_fix;            ///< Called for every solved epoch (may be NULL)
+    void *ctx;                              ///< Passed through to on_fix
+    unsigned long n_epochs;                 ///< Epochs solved or skipped
+    unsigned long n_fixes;                  ///< Epochs solved
+} stream_solver_t;
+
+void stream_solver_init(stream_solver_t *solver, stream_fix_handler_t on_fix, void *ctx);
+void stream_solver_push(stream_solver_t *solver, const rtcm_message_t *msg);
+void stream_solver_flush(stream_solver_t *solver);
+void stream_solver_free(stream_solver_t *solver);
+
+#endif // STREAM_SOLVER_H
@@ -0,0 +1,38 @@
+#ifndef TEXT_WRITER_H
+#define TEXT_WRITER_H
+
+#include "../include/algo.h"
+
+/// Buffered bytes that trigger a write to the file
+#define TEXT_WRITER_FLUSH_BYTES ((size_t)1 << 18)
+/// Most decimals text_writer_fixed() formats itself
+#define TEXT_WRITER_MAX_DECIMALS 9
+
+/**
+ * @brief Output file that formats rows into a large in-memory buffer.
+ *
+ * Rows are appended with the text_writer_*() helpers and reach the file in
+ * TEXT_WRITER_FLUSH_BYTES blocks, so writing a long track costs a handful of
+ * fwrite() calls instead of one fprintf() per row. Doubles are formatted by
+ * text_writer_fixed(), which gives exactly the text of printf("%.*f").
+ *
+ * An I/O error is remembered in @c status and reported by text_writer_close().
+ */
+typedef struct
+{
+    FILE *fp;   ///< Destination file
+    char *data; ///< Pending bytes
+    size_t len; ///< Bytes in data
+    int status; ///< 0, or -1 after an I/O or allocation error
+} text_writer_t;
+
+int text_writer_open(text_writer_t *w, const char *path);
+int text_writer_close(text_writer_t *w);
+void text_writer_flush(text_writer_t *w);
+
+void text_writer_fixed(text_writer_t *w, double v, int decimals);
+void text_writer_int(text_writer_t *w, int v);
+void text_writer_str(text_writer_t *w, const char *s);
+void text_writer_char(text_writer_t *w, char c);
+
+#endif // TEXT_WRITER_H
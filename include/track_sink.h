@@ -0,0 +1,58 @@
+#ifndef TRACK_SINK_H
+#define TRACK_SINK_H
+
+#include "../include/algo.h"
+#include "../include/stream_solver.h"
+#include "../include/text_writer.h"
+
+/// Outputs of a track sink (combine with |)
+#define TRACK_SINK_DAT 0x01u  ///< receiver_track_ecef.dat / receiver_track_geo.dat (plot formats)
+#define TRACK_SINK_CSV 0x02u  ///< receiver_track.csv
+#define TRACK_SINK_NMEA 0x04u ///< receiver_track.nmea (GGA sentences)
+#define TRACK_SINK_KML 0x08u  ///< receiver_track.kml, plus the rolling live KML and its NetworkLink
+#define TRACK_SINK_ALL (TRACK_SINK_DAT | TRACK_SINK_CSV | TRACK_SINK_NMEA | TRACK_SINK_KML)
+
+/// Longest time fixes stay buffered (ms)
+#define TRACK_SINK_FLUSH_MS 1000
+/// Buffered bytes (all outputs together) that force a flush
+#define TRACK_SINK_FLUSH_BYTES ((size_t)64 << 10)
+/// Fixes kept in the rolling live KML
+#define TRACK_SINK_KML_WINDOW 600
+/// Refresh interval written into the NetworkLink (s)
+#define TRACK_SINK_KML_REFRESH_S 2
+
+/**
+ * @brief Incremental receiver track output, fed one fix at a time.
+ *
+ * Every fix is formatted into the buffered writers of the enabled outputs
+ * right away; the files are brought up to date on a time / size budget
+ * (TRACK_SINK_FLUSH_MS, TRACK_SINK_FLUSH_BYTES) rather than per fix. Each
+ * flush also rewrites the rolling live KML (the last TRACK_SINK_KML_WINDOW
+ * fixes), which Google Earth reloads through the NetworkLink file.
+ *
+ * Not thread-safe: feed a sink from one thread at a time.
+ */
+typedef struct
+{
+    unsigned outputs;                         ///< TRACK_SINK_* flags that opened successfully
+    char dir[200];                            ///< Output directory
+    text_writer_t ecef;                       ///< receiver_track_ecef.dat
+    text_writer_t geo;                        ///< receiver_track_geo.dat
+    text_writer_t csv;                        ///< receiver_track.csv
+    text_writer_t nmea;                       ///< receiver_track.nmea
+    text_writer_t kml;                        ///< receiver_track.kml (completed by track_sink_close())
+    double window_lat[TRACK_SINK_KML_WINDOW]; ///< Rolling window latitudes (deg), oldest at window_head
+    double window_lon[TRACK_SINK_KML_WINDOW]; ///< Rolling window longitudes (deg)
+    int window_head;                          ///< Oldest entry once the window is full
+    int window_len;                           ///< Entries in the window
+    bool window_dirty;                        ///< Fixes added since the live KML was written
+    int64_t last_flush_ms;                    ///< Time of the last flush (ms, monotonic clock)
+    unsigned long n_fixes;                    ///< Fixes written
+} track_sink_t;
+
+int track_sink_open(track_sink_t *sink, const char *dir, unsigned outputs);
+void track_sink_add(track_sink_t *sink, const stream_fix_t *fix);
+void track_sink_flush(track_sink_t *sink);
+int track_sink_close(track_sink_t *sink);
+
+#endif // TRACK_SINK_H
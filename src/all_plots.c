@@ -10,9 +10,15 @@
  *  - Satellite orbits / ECEF samples (meters)
  *  - Satellite XYZ (kilometers)
  *  - (Optional) Pseudorange vs. time (kilometers)
+ *  - Receiver ECEF velocity with epoch index (meters per second)
+ *  - Satellite ECEF velocities (meters per second)
+ *  - Full satellite orbits swept in true anomaly, ECI (meters)
  *
  * The routines are intentionally minimal and perform basic validation to avoid
- * writing all-zero or non-finite rows.
+ * writing all-zero or non-finite rows. Rows are formatted through a
+ * text_writer_t (large buffered blocks, fast fixed-point formatting) and only
+ * the populated samples of each satellite are visited. write_all_plots() runs
+ * the nine writers concurrently.
  */
 
 #include "../include/algo.h"
@@ -20,24 +26,29 @@
 #include "../include/rtcm_reader.h"
 #include "../include/satellites.h"
 #include "../include/receiver.h"
+#include "../include/text_writer.h"
+#include "../include/plots.h"
+#include "../include/gnss_context.h"
 
-extern latlonalt_position_t latlonalt_positions;           /**< LLA results per epoch */
-extern sat_ecef_history_t sat_ecef_positions[MAX_SAT + 1]; /**< Satellite ECEF histories */
-extern estimated_position_t estimated_positions_ecef;      /**< Receiver ECEF track */
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 /**
  * @brief Write receiver ECEF track (meters) to a file.
  *
  * Output format (per line): `X Y Z`
  *
- * @param path     Destination file path.
- * @param n_epochs Number of epochs to write.
+ * @param ctx  Solved session (ctx->n_times epochs are written).
+ * @param path Destination file path.
  * @return 0 on success, -1 on failure (open error or no lines written).
  */
-int write_receiver_track_ecef(const char *path, int n_epochs)
+int write_receiver_track_ecef(const gnss_context_t *ctx, const char *path)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp)
+    const estimated_position_t *estimated_positions_ecef = &ctx->estimated_positions_ecef;
+    const int n_epochs = ctx->n_times;
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
     {
         perror("[ERR] fopen(receiver_track)");
         return -1;
@@ -46,9 +57,9 @@ int write_receiver_track_ecef(const char *path, int n_epochs)
     int lines = 0;
     for (int i = 0; i < n_epochs; ++i)
     {
-        double x = estimated_positions_ecef.x[i];
-        double y = estimated_positions_ecef.y[i];
-        double z = estimated_positions_ecef.z[i];
+        double x = estimated_positions_ecef->x[i];
+        double y = estimated_positions_ecef->y[i];
+        double z = estimated_positions_ecef->z[i];
 
         /* Optional debug:
          * printf("[DBG] epoch %d -> ECEF=(%.6f, %.6f, %.6f)\n", i, x, y, z);
@@ -57,12 +68,18 @@ int write_receiver_track_ecef(const char *path, int n_epochs)
         /* Only write if not all zeros (safeguard) */
         if (!(x == 0.0 && y == 0.0 && z == 0.0))
         {
-            fprintf(fp, "%.8f %.8f %.8f\n", x, y, z);
+            text_writer_fixed(&w, x, 8);
+            text_writer_char(&w, ' ');
+            text_writer_fixed(&w, y, 8);
+            text_writer_char(&w, ' ');
+            text_writer_fixed(&w, z, 8);
+            text_writer_char(&w, '\n');
             lines++;
         }
     }
 
-    fclose(fp);
+    if (text_writer_close(&w) != 0)
+        return -1;
 
     if (lines == 0)
     {
@@ -73,42 +90,56 @@ int write_receiver_track_ecef(const char *path, int n_epochs)
     return 0;
 }
 
+/**
+ * @brief Appends one `PRN X Y Z` row with six decimals.
+ */
+static void put_prn_xyz(text_writer_t *w, int prn, double x, double y, double z)
+{
+    text_writer_int(w, prn);
+    text_writer_char(w, ' ');
+    text_writer_fixed(w, x, 6);
+    text_writer_char(w, ' ');
+    text_writer_fixed(w, y, 6);
+    text_writer_char(w, ' ');
+    text_writer_fixed(w, z, 6);
+    text_writer_char(w, '\n');
+}
+
 /**
  * @brief Write satellite ECEF samples (meters) as one big file.
  *
  * Output format (per line): `PRN X Y Z`
  * Sats are separated by blank lines.
  *
+ * @param ctx  Session with the satellite positions.
  * @param path Destination file path.
- * @return 0 on success, -1 on failure to open.
+ * @return 0 on success, -1 on failure to open or write.
  */
-int write_sat_orbits(const char *path)
+int write_sat_orbits(const gnss_context_t *ctx, const char *path)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp)
+    const gps_satellite_data_t *gps_list = ctx->gps_list;
+    const sat_ecef_history_t *sat_ecef_positions = ctx->sat_ecef_positions;
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
         return -1;
 
     for (int prn = 1; prn <= MAX_SAT; ++prn)
     {
         int wrote_any = 0;
-        for (int k = 0; k < MAX_EPOCHS; ++k)
+        for (size_t k = 0; k < gps_list[prn].n_pseudoranges; ++k)
         {
             if (sat_ecef_positions[prn].t_ms[k] == 0.0)
                 continue;
 
-            double x = sat_ecef_positions[prn].x[k];
-            double y = sat_ecef_positions[prn].y[k];
-            double z = sat_ecef_positions[prn].z[k];
-
-            fprintf(fp, "%d %.6f %.6f %.6f\n", prn, x, y, z);
+            put_prn_xyz(&w, prn, sat_ecef_positions[prn].x[k], sat_ecef_positions[prn].y[k],
+                        sat_ecef_positions[prn].z[k]);
             wrote_any = 1;
         }
         if (wrote_any)
-            fprintf(fp, "\n\n");
+            text_writer_str(&w, "\n\n");
     }
 
-    fclose(fp);
-    return 0;
+    return text_writer_close(&w);
 }
 
 /**
@@ -116,14 +147,16 @@ int write_sat_orbits(const char *path)
  *
  * Output format (per line): `lat lon`
  *
- * @param path     Destination file path.
- * @param n_epochs Number of epochs to write.
+ * @param ctx  Solved session (ctx->n_times epochs are written).
+ * @param path Destination file path.
  * @return 0 on success, -1 if file open failed or no finite rows written.
  */
-int write_receiver_track_geo(const char *path, int n_epochs)
+int write_receiver_track_geo(const gnss_context_t *ctx, const char *path)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp)
+    const latlonalt_position_t *latlonalt_positions = &ctx->latlonalt_positions;
+    const int n_epochs = ctx->n_times;
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
     {
         perror("[ERR] fopen(receiver_track_geo)");
         return -1;
@@ -132,8 +165,8 @@ int write_receiver_track_geo(const char *path, int n_epochs)
     int lines = 0;
     for (int i = 0; i < n_epochs; ++i)
     {
-        double lat = latlonalt_positions.lat[i];
-        double lon = latlonalt_positions.lon[i];
+        double lat = latlonalt_positions->lat[i];
+        double lon = latlonalt_positions->lon[i];
 
         /* Optional debug:
          * printf("[DBG] epoch %d -> LLA=(lat=%.8f, lon=%.8f)\n", i, lat, lon);
@@ -141,12 +174,16 @@ int write_receiver_track_geo(const char *path, int n_epochs)
 
         if (isfinite(lat) && isfinite(lon))
         {
-            fprintf(fp, "%.8f %.8f\n", lat, lon);
+            text_writer_fixed(&w, lat, 8);
+            text_writer_char(&w, ' ');
+            text_writer_fixed(&w, lon, 8);
+            text_writer_char(&w, '\n');
             lines++;
         }
     }
 
-    fclose(fp);
+    if (text_writer_close(&w) != 0)
+        return -1;
 
     if (lines == 0)
     {
@@ -165,30 +202,31 @@ static inline double m_to_km(double v_m) { return v_m * 1e-3; }
  *
  * Output format (per line): `epoch_index X_km Y_km Z_km`
  *
- * @param path     Destination file path.
- * @param n_epochs Number of epochs to write.
- * @return 0 on success, -1 if file open failed.
+ * @param ctx  Solved session (ctx->n_times epochs are written).
+ * @param path Destination file path.
+ * @return 0 on success, -1 if file open or write failed.
  */
-int write_receiver_ecef_epoch_km(const char *path, int n_epochs)
+int write_receiver_ecef_epoch_km(const gnss_context_t *ctx, const char *path)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp)
+    const estimated_position_t *estimated_positions_ecef = &ctx->estimated_positions_ecef;
+    const int n_epochs = ctx->n_times;
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
         return -1;
 
     for (int i = 0; i < n_epochs; ++i)
     {
-        double xk = m_to_km(estimated_positions_ecef.x[i]);
-        double yk = m_to_km(estimated_positions_ecef.y[i]);
-        double zk = m_to_km(estimated_positions_ecef.z[i]);
+        double xk = m_to_km(estimated_positions_ecef->x[i]);
+        double yk = m_to_km(estimated_positions_ecef->y[i]);
+        double zk = m_to_km(estimated_positions_ecef->z[i]);
 
         if (!isfinite(xk) || !isfinite(yk) || !isfinite(zk))
             continue;
 
-        fprintf(fp, "%d %.6f %.6f %.6f\n", i, xk, yk, zk);
+        put_prn_xyz(&w, i, xk, yk, zk);
     }
 
-    fclose(fp);
-    return 0;
+    return text_writer_close(&w);
 }
 
 /**
@@ -197,19 +235,22 @@ int write_receiver_ecef_epoch_km(const char *path, int n_epochs)
  * Output format (per line): `PRN X_km Y_km Z_km`
  * Sats are separated by blank lines.
  *
+ * @param ctx  Session with the satellite positions.
  * @param path Destination file path.
- * @return 0 on success, -1 if file open failed.
+ * @return 0 on success, -1 if file open or write failed.
  */
-int write_sat_xyz_km(const char *path)
+int write_sat_xyz_km(const gnss_context_t *ctx, const char *path)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp)
+    const gps_satellite_data_t *gps_list = ctx->gps_list;
+    const sat_ecef_history_t *sat_ecef_positions = ctx->sat_ecef_positions;
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
         return -1;
 
     for (int prn = 1; prn <= MAX_SAT; ++prn)
     {
         int wrote_any = 0;
-        for (int k = 0; k < MAX_EPOCHS; ++k)
+        for (size_t k = 0; k < gps_list[prn].n_pseudoranges; ++k)
         {
             if (sat_ecef_positions[prn].t_ms[k] == 0.0)
                 continue;
@@ -221,15 +262,14 @@ int write_sat_xyz_km(const char *path)
             if (!isfinite(xk) || !isfinite(yk) || !isfinite(zk))
                 continue;
 
-            fprintf(fp, "%d %.6f %.6f %.6f\n", prn, xk, yk, zk);
+            put_prn_xyz(&w, prn, xk, yk, zk);
             wrote_any = 1;
         }
         if (wrote_any)
-            fputs("\n\n", fp);
+            text_writer_str(&w, "\n\n");
     }
 
-    fclose(fp);
-    return 0;
+    return text_writer_close(&w);
 }
 
 /**
@@ -238,21 +278,23 @@ int write_sat_xyz_km(const char *path)
  * Output format (per line): `PRN t(s) PR_km`
  * Blocks are separated by blank lines.
  *
+ * @param ctx  Session with the sorted series.
  * @param path Destination file path.
- * @return 0 on success, -1 if file open failed.
+ * @return 0 on success, -1 if file open or write failed.
  *
  * @note Time units: currently writes DF004/collected time as seconds if `t`
  *       is already in seconds. If your timestamps are in milliseconds, scale accordingly.
  */
-int write_pseudorange_time_km(const char *path)
+int write_pseudorange_time_km(const gnss_context_t *ctx, const char *path)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp)
+    const gps_satellite_data_t *gps_list = ctx->gps_list;
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
         return -1;
 
     for (int prn = 1; prn <= MAX_SAT; ++prn)
     {
-        for (int k = 0; k < MAX_EPOCHS; ++k)
+        for (size_t k = 0; k < gps_list[prn].n_pseudoranges; ++k)
         {
             uint32_t t = gps_list[prn].times_of_pseudorange[k];
             double pr = gps_list[prn].pseudoranges[k]; /* meters */
@@ -263,11 +305,224 @@ int write_pseudorange_time_km(const char *path)
             /* Adjust if your t is milliseconds: use (double)t * 1e-3 */
             double tow_s = (double)t;
 
-            fprintf(fp, "%d %.3f %.6f\n", prn, tow_s, pr * 1e-3);
+            text_writer_int(&w, prn);
+            text_writer_char(&w, ' ');
+            text_writer_fixed(&w, tow_s, 3);
+            text_writer_char(&w, ' ');
+            text_writer_fixed(&w, pr * 1e-3, 6);
+            text_writer_char(&w, '\n');
         }
-        fputs("\n\n", fp);
+        text_writer_str(&w, "\n\n");
     }
 
-    fclose(fp);
-    return 0;
+    return text_writer_close(&w);
+}
+
+/**
+ * @brief Write receiver ECEF velocity (m/s) with epoch index prefix.
+ *
+ * Output format (per line): `epoch_index VX VY VZ`
+ * Epochs without a velocity solution are skipped.
+ *
+ * @param ctx  Solved session (ctx->n_times epochs are written).
+ * @param path Destination file path.
+ * @return 0 on success, -1 if file open or write failed.
+ */
+int write_receiver_velocity_ecef(const gnss_context_t *ctx, const char *path)
+{
+    const estimated_position_t *estimated_positions_ecef = &ctx->estimated_positions_ecef;
+    const int n_epochs = ctx->n_times;
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
+        return -1;
+
+    for (int i = 0; i < n_epochs; ++i)
+    {
+        double vx = estimated_positions_ecef->vx[i];
+        double vy = estimated_positions_ecef->vy[i];
+        double vz = estimated_positions_ecef->vz[i];
+
+        if (!isfinite(vx) || !isfinite(vy) || !isfinite(vz))
+            continue;
+
+        put_prn_xyz(&w, i, vx, vy, vz);
+    }
+
+    return text_writer_close(&w);
+}
+
+/**
+ * @brief Write satellite ECEF velocities (m/s).
+ *
+ * Output format (per line): `PRN VX VY VZ`
+ * Sats are separated by blank lines.
+ *
+ * @param ctx  Session with the satellite positions.
+ * @param path Destination file path.
+ * @return 0 on success, -1 if file open or write failed.
+ */
+int write_sat_velocity_ecef(const gnss_context_t *ctx, const char *path)
+{
+    const gps_satellite_data_t *gps_list = ctx->gps_list;
+    const sat_ecef_history_t *sat_ecef_positions = ctx->sat_ecef_positions;
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
+        return -1;
+
+    for (int prn = 1; prn <= MAX_SAT; ++prn)
+    {
+        int wrote_any = 0;
+        for (size_t k = 0; k < gps_list[prn].n_pseudoranges; ++k)
+        {
+            if (sat_ecef_positions[prn].t_ms[k] == 0.0)
+                continue;
+
+            put_prn_xyz(&w, prn, sat_ecef_positions[prn].vx[k], sat_ecef_positions[prn].vy[k],
+                        sat_ecef_positions[prn].vz[k]);
+            wrote_any = 1;
+        }
+        if (wrote_any)
+            text_writer_str(&w, "\n\n");
+    }
+
+    return text_writer_close(&w);
+}
+
+/**
+ * @brief Write the full orbit of each satellite (ECI, meters).
+ *
+ * Output format (per line): `PRN X Y Z`
+ * Sats are separated by blank lines. Only the sweeps already in
+ * ctx->orbit_sweep are written (see satellite_orbit_eci()).
+ *
+ * @param ctx  Session with the orbit sweeps.
+ * @param path Destination file path.
+ * @return 0 on success, -1 if file open or write failed.
+ */
+int write_sat_orbit_eci(const gnss_context_t *ctx, const char *path)
+{
+    text_writer_t w;
+    if (text_writer_open(&w, path) != 0)
+        return -1;
+
+    for (int prn = 1; prn <= MAX_SAT; ++prn)
+    {
+        const sat_orbit_sweep_t *sweep = &ctx->orbit_sweep[prn];
+        if (!sweep->valid)
+            continue;
+
+        int wrote_any = 0;
+        for (size_t k = 0; k < sweep->n_points; ++k)
+        {
+            if (sweep->x[k] == 0.0 && sweep->y[k] == 0.0 && sweep->z[k] == 0.0)
+                continue;
+
+            put_prn_xyz(&w, prn, sweep->x[k], sweep->y[k], sweep->z[k]);
+            wrote_any = 1;
+        }
+        if (wrote_any)
+            text_writer_str(&w, "\n\n");
+    }
+
+    return text_writer_close(&w);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/// One output file of write_all_plots()
+typedef struct
+{
+    const char *name;                                   ///< File name inside the output directory
+    int (*write)(const gnss_context_t *, const char *); ///< Writer
+    const char *ok_msg;                                 ///< Printed on success
+    const char *err_msg;                                ///< Printed on failure
+    char path[256];                                     ///< Full output path
+    const gnss_context_t *ctx;                          ///< Solved session
+    int status;                                         ///< Writer result
+} plot_job_t;
+
+/** @brief Runs one plot writer (thread entry point). */
+static void *plot_job_run(void *arg)
+{
+    plot_job_t *job = (plot_job_t *)arg;
+    job->status = job->write(job->ctx, job->path);
+    return NULL;
+}
+
+/**
+ * @brief Writes every plot data file of a batch run into @p dir.
+ *
+ * The writers only read the solved tables and each owns its file, so with
+ * more than one configured thread they run concurrently. Status lines are
+ * printed afterwards in a fixed order.
+ *
+ * @param ctx Solved session.
+ * @param dir Output directory (e.g. "plots").
+ * @return 0 if every file was written, -1 otherwise.
+ */
+int write_all_plots(const gnss_context_t *ctx, const char *dir)
+{
+    plot_job_t jobs[] = {
+        {"receiver_track_ecef.dat", write_receiver_track_ecef,
+         "[OK] Receiver track written successfully.\n", "[ERR] Failed to write receiver track data.\n", "", NULL, 0},
+        {"sat_track_ecef.dat", write_sat_orbits,
+         "[OK] Satellite orbits written successfully.\n", "[ERR] Failed to write satellite orbits data.\n", "", NULL, 0},
+        {"receiver_track_geo.dat", write_receiver_track_geo,
+         "[OK] Receiver Geo positions written successfully.\n", "[ERR] Failed to write receiver geo position data.\n", "", NULL, 0},
+        {"receiver_ecef_epoch.dat", write_receiver_ecef_epoch_km,
+         "[OK] Receiver ECEF (km) vs epoch written successfully.\n", "[ERR] Failed to write receiver ECEF (km) vs epoch.\n", "", NULL, 0},
+        {"sat_xyz_km.dat", write_sat_xyz_km,
+         "[OK] Satellite XY (km) written successfully.\n", "[ERR] Failed to write satellite XY (km).\n", "", NULL, 0},
+        {"pseudorange_time_km.dat", write_pseudorange_time_km,
+         "[OK] Pseudorange vs epoch (km) written successfully.\n", "[ERR] Failed to write pseudorange vs epoch (km).\n", "", NULL, 0},
+        {"receiver_velocity_ecef.dat", write_receiver_velocity_ecef,
+         "[OK] Receiver velocity vs epoch written successfully.\n", "[ERR] Failed to write receiver velocity vs epoch.\n", "", NULL, 0},
+        {"sat_velocity_ecef.dat", write_sat_velocity_ecef,
+         "[OK] Satellite velocities written successfully.\n", "[ERR] Failed to write satellite velocities.\n", "", NULL, 0},
+        {"sat_orbit_eci.dat", write_sat_orbit_eci,
+         "[OK] Satellite orbit sweeps written successfully.\n", "[ERR] Failed to write satellite orbit sweeps.\n", "", NULL, 0},
+    };
+    const int n_jobs = (int)(sizeof(jobs) / sizeof(jobs[0]));
+
+    for (int i = 0; i < n_jobs; i++)
+    {
+        snprintf(jobs[i].path, sizeof(jobs[i].path), "%s/%s", dir, jobs[i].name);
+        jobs[i].ctx = ctx;
+    }
+
+    int n_started = 0;
+#ifndef _WIN32
+    pthread_t threads[sizeof(jobs) / sizeof(jobs[0])];
+    if (configured_thread_count() > 1)
+    {
+        for (int i = 1; i < n_jobs; i++)
+        {
+            if (pthread_create(&threads[i], NULL, plot_job_run, &jobs[i]) != 0)
+                break;
+            n_started = i;
+        }
+    }
+#endif
+    plot_job_run(&jobs[0]);
+    for (int i = n_started + 1; i < n_jobs; i++)
+        plot_job_run(&jobs[i]); // Serial, or threads that could not be started
+#ifndef _WIN32
+    for (int i = 1; i <= n_started; i++)
+        pthread_join(threads[i], NULL);
+#endif
+
+    int status = 0;
+    for (int i = 0; i < n_jobs; i++)
+    {
+        if (jobs[i].status == 0)
+        {
+            printf("%s", jobs[i].ok_msg);
+        }
+        else
+        {
+            fprintf(stderr, "%s", jobs[i].err_msg);
+            status = -1;
+        }
+    }
+    return status;
 }
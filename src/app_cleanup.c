@@ -13,17 +13,13 @@
  * @brief Perform cleanup operations before application exit.
  *
  * This function should be called at the end of the application's lifecycle.
- * Currently, it only prints a confirmation message, but in a full deployment
- * it can be expanded to include:
- *  - Memory deallocation
+ * The stored messages and solver tables of each run are owned and released by
+ * its gnss_context_t; in a full deployment it can be expanded to include:
  *  - File handle closure
  *  - Hardware resource shutdown
  *  - Logging or telemetry flushing
- *
- * @todo Add actual resource cleanup when dynamic allocations or handles are introduced.
  */
 void app_cleanup(void)
 {
-    /* Placeholder: no dynamic resources to release yet */
     printf(COLOR_GREEN "Cleanup completed. Exiting the application.\n" COLOR_RESET);
 }
@@ -3,9 +3,8 @@
  * @brief Menu interface for selecting RTCM input source in the GNSS application.
  *
  * Provides a terminal-driven menu for choosing how RTCM data is fed into the
- * GNSS L1 positioning resolver. At present, only the "Pre-recorded File" modes
- * are functional. Serial input (Option 1) and live parsed input (Option 2) are
- * defined in the menu but not yet implemented.
+ * GNSS L1 positioning resolver: a live serial port, a pre-recorded file or
+ * live network streams.
  *
  * Usage flow:
  *  - Displays a banner and usage notice
@@ -14,9 +13,11 @@
  *  - Dispatches to the appropriate handler function
  *
  * @note
- *   - Option 1 (Serial Port Input) is not implemented yet.
- *   - Option 2 (Pre-recorded File Input, text format) is placeholder-only.
+ *   - Option 1 (Serial Port Input, live raw binary RTCM3, macOS/Linux) is supported.
+ *   - Option 2 (Pre-recorded File Input, raw binary RTCM3) is supported.
  *   - Option 3 (Pre-recorded File Input, parsed with PyRTCM) is supported.
+ *   - Option 4 (Pre-recorded File Input, streamed epoch by epoch) is supported.
+ *   - Option 5 (Network Input, NTRIP casters / TCP streams, macOS/Linux) is supported.
  */
 
 #include "../include/algo.h" // assumes color macros, serial_connect(), file_input_mode()
@@ -40,12 +41,12 @@ static void print_menu(void)
 {
     printf(COLOR_GREEN
            "********** RTCM Input Source Menu **********\n"
-           "* 1. Serial Port  (Raw Binary)             *\n"
-           "*    [Not yet implemented]                 *\n"
-           "* 2. Pre-recorded File (Text format)        *\n"
-           "*    [Placeholder only, not functional]    *\n"
+           "* 1. Serial Port  (Live raw binary RTCM3)  *\n"
+           "* 2. Pre-recorded File (Raw binary RTCM3)  *\n"
            "* 3. Pre-recorded File (Parsed with PyRTCM)*\n"
-           "* 4. Exit                                  *\n"
+           "* 4. Pre-recorded File (Streaming solve)   *\n"
+           "* 5. Network Stream (NTRIP / TCP, live)    *\n"
+           "* 6. Exit                                  *\n"
            "********************************************\n" COLOR_RESET);
 }
 
@@ -55,20 +56,20 @@ static void print_menu(void)
  * Reads from stdin and validates the entered choice. Handles whitespace,
  * newline, and EOF gracefully.
  *
- * @return Parsed menu option in [1..4], or 4 if input is closed (EOF).
+ * @return Parsed menu option in [1..6], or 6 if input is closed (EOF).
  */
 static int prompt_choice(void)
 {
     char buf[INPUT_BUF_SZ];
 
-    printf(COLOR_BLUE "\nEnter your choice (1-4): " COLOR_RESET);
+    printf(COLOR_BLUE "\nEnter your choice (1-6): " COLOR_RESET);
     fflush(stdout);
 
     if (!fgets(buf, sizeof(buf), stdin))
     {
         // EOF or error -> treat as "Exit"
         puts(COLOR_RED "Input closed. Exiting..." COLOR_RESET);
-        return 4;
+        return 6;
     }
 
     // Trim leading/trailing whitespace
@@ -86,12 +87,12 @@ static int prompt_choice(void)
     long v = strtol(p, &conv_end, 10);
     if (conv_end == p || *conv_end != '\0')
     {
-        printf(COLOR_RED "Invalid input. Please enter a number 1-4.\n" COLOR_RESET);
+        printf(COLOR_RED "Invalid input. Please enter a number 1-6.\n" COLOR_RESET);
         return -1;
     }
-    if (v < 1 || v > 4)
+    if (v < 1 || v > 6)
     {
-        printf(COLOR_RED "Choice out of range. Please enter 1-4.\n" COLOR_RESET);
+        printf(COLOR_RED "Choice out of range. Please enter 1-6.\n" COLOR_RESET);
         return -1;
     }
     return (int)v;
@@ -103,9 +104,6 @@ static int prompt_choice(void)
  * Prints a banner and menu, then repeatedly prompts the user until
  * a valid choice is entered. Dispatches to the respective handler for
  * each menu option.
- *
- * @todo Implement Option 1 (Serial Port Input).
- * @todo Implement Option 2 (Pre-recorded File Input, Raw Binary).
  */
 void app_menu(void)
 {
@@ -124,16 +122,12 @@ void app_menu(void)
         {
         case 1:
             printf(COLOR_GREEN "You selected Serial Port Input (Raw binary message).\n" COLOR_RESET);
-            printf(COLOR_YELLOW "Note: This mode is not implemented yet.\n" COLOR_RESET);
-            // @todo Implement serial input mode
-            // serial_connect(NULL, 0);
+            serial_input_mode();
             break;
 
         case 2:
-            printf(COLOR_GREEN "You selected Pre-recorded File Input (Parsed text format).\n" COLOR_RESET);
-            printf(COLOR_YELLOW "Note: This mode is placeholder-only and not functional yet.\n" COLOR_RESET);
-            // @todo Implement raw binary file input mode
-            // file_input_mode(false);
+            printf(COLOR_GREEN "You selected Pre-recorded File Input (Raw binary RTCM3).\n" COLOR_RESET);
+            file_input_mode(false);
             break;
 
         case 3:
@@ -142,6 +136,16 @@ void app_menu(void)
             break;
 
         case 4:
+            printf(COLOR_GREEN "You selected Pre-recorded File Input (Streaming solve).\n" COLOR_RESET);
+            stream_input_mode();
+            break;
+
+        case 5:
+            printf(COLOR_GREEN "You selected Network Stream Input (NTRIP / TCP).\n" COLOR_RESET);
+            net_input_mode();
+            break;
+
+        case 6:
         default:
             printf(COLOR_RED "Exiting the application...\n" COLOR_RESET);
             return;
@@ -0,0 +1,526 @@
+/**
+ * @file batch_cli.c
+ * @brief Command line mode: processes many recorded logs without prompting.
+ *
+ *     gps_resolver [options] LOG...
+ *
+ * Every log runs through the same pipeline as menu options 2 / 3
+ * (batch_process_file()) in its own child process. A log that crashes the
+ * pipeline then fails alone, with its own exit status, and the state that is
+ * still process-wide (the perf_stats.c counters behind each run_stats.json,
+ * stdout / stderr redirected to the log file) stays separate per log. At most
+ * `--jobs` children run at a time and each uses
+ * `--threads` worker threads, so a node can be filled without oversubscribing
+ * it. A child's console output goes to BATCH_LOG_NAME in its output directory
+ * unless `--verbose` is given; the parent prints one status line per log.
+ *
+ * The exit code is 0 if every log was processed, 1 if any failed and 2 for
+ * invalid arguments. Without POSIX processes (Windows) the logs run one after
+ * the other in this process.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/rtcm3_decoder.h"
+#include "../include/perf_stats.h"
+#include "../include/batch_cli.h"
+#include "../include/log_input.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/wait.h>
+#endif
+
+#define BATCH_PATH_MAX 256
+
+/// Input format selected with --format
+typedef enum
+{
+    BATCH_FORMAT_AUTO,
+    BATCH_FORMAT_TEXT,
+    BATCH_FORMAT_BINARY
+} batch_format_t;
+
+/// Command line settings
+typedef struct
+{
+    const char **inputs;
+    int n_inputs;
+    batch_format_t format;
+    const char *out_dir;
+    int jobs;     ///< Concurrent logs (0: automatic)
+    int threads;  ///< Worker threads per log (0: automatic)
+    unsigned outputs;
+    const char *signals; ///< GPS_RESOLVER_SIGNALS value, or NULL to keep the environment
+    const char *solver;  ///< GPS_RESOLVER_SOLVER value, or NULL to keep the environment
+    bool no_cache;
+    bool verbose;
+} batch_opts_t;
+
+/// One log of the run
+typedef struct
+{
+    const char *path;
+    char out_dir[BATCH_PATH_MAX];
+    int64_t start_ns;
+    int status; ///< Exit status once finished
+#ifndef _WIN32
+    pid_t pid;
+#endif
+} batch_job_t;
+
+/// Names accepted by --emit
+static const struct
+{
+    const char *name;
+    unsigned flags;
+} emit_names[] = {
+    {"csv", TRACK_SINK_CSV}, {"nmea", TRACK_SINK_NMEA}, {"kml", TRACK_SINK_KML},
+    {"plots", BATCH_OUTPUT_PLOTS}, {"stats", BATCH_OUTPUT_STATS}, {"all", BATCH_OUTPUT_ALL}};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Prints the command line help. */
+static void print_usage(FILE *fp)
+{
+    fprintf(fp,
+            "Usage: gps_resolver [options] LOG...\n"
+            "       gps_resolver                 (interactive menu)\n"
+            "\n"
+            "  -f, --format auto|text|binary  input format (default auto: binary if a log starts with 0xD3)\n"
+            "  -o, --output-dir DIR           output directory (default plots); with several logs each\n"
+            "                                 gets DIR/<log name>\n"
+            "  -j, --jobs N                   logs processed concurrently (default: CPUs, at most the log count)\n"
+            "  -t, --threads N                worker threads per log (default: CPUs / jobs)\n"
+            "  -e, --emit LIST                comma list of csv,nmea,kml,plots,stats or all (default all)\n"
+            "  -s, --signals l1|iflc          solve with primary-signal pseudoranges (default) or the\n"
+            "                                 ionosphere-free L1/L5 combination\n"
+            "  -m, --solver lsq|ekf           per-epoch weighted least squares with RAIM (default) or the\n"
+            "                                 recursive position / clock filter\n"
+            "      --no-cache                 do not read or write .obscache files\n"
+            "  -v, --verbose                  print each log's progress instead of writing DIR/" BATCH_LOG_NAME "\n"
+            "  -h, --help                     show this help\n");
+}
+
+/** @brief Parses a positive integer option value. @return 0, or -1 if invalid. */
+static int parse_count(const char *s, int *out)
+{
+    char *end = NULL;
+    long v = strtol(s, &end, 10);
+    if (!s[0] || *end != '\0' || v < 1 || v > 4096)
+        return -1;
+    *out = (int)v;
+    return 0;
+}
+
+/** @brief Parses an --emit list into output flags. @return 0, or -1 on an unknown name. */
+static int parse_emit(const char *s, unsigned *out)
+{
+    *out = 0;
+    while (*s)
+    {
+        size_t len = strcspn(s, ",");
+        bool known = false;
+        for (size_t i = 0; i < sizeof(emit_names) / sizeof(emit_names[0]); i++)
+        {
+            if (strlen(emit_names[i].name) == len && strncmp(s, emit_names[i].name, len) == 0)
+            {
+                *out |= emit_names[i].flags;
+                known = true;
+            }
+        }
+        if (!known)
+            return -1;
+        s += len;
+        if (*s == ',')
+            s++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses the command line into @p o.
+ *
+ * @return 0 to run, 1 if help was printed, -1 on invalid arguments.
+ */
+static int parse_args(int argc, char **argv, batch_opts_t *o)
+{
+    *o = (batch_opts_t){.format = BATCH_FORMAT_AUTO, .out_dir = "plots", .outputs = BATCH_OUTPUT_ALL};
+    o->inputs = calloc((size_t)argc, sizeof(*o->inputs));
+    if (!o->inputs)
+        return -1;
+
+    bool only_inputs = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        if (only_inputs || a[0] != '-' || a[1] == '\0')
+        {
+            o->inputs[o->n_inputs++] = a;
+            continue;
+        }
+        if (strcmp(a, "--") == 0)
+        {
+            only_inputs = true;
+            continue;
+        }
+        if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0)
+        {
+            print_usage(stdout);
+            return 1;
+        }
+        if (strcmp(a, "--no-cache") == 0)
+        {
+            o->no_cache = true;
+            continue;
+        }
+        if (strcmp(a, "-v") == 0 || strcmp(a, "--verbose") == 0)
+        {
+            o->verbose = true;
+            continue;
+        }
+
+        // Options with a value
+        static const char *const value_opts[] = {"-f", "--format", "-o", "--output-dir", "-j", "--jobs",
+                                                 "-t", "--threads", "-e", "--emit", "-s", "--signals",
+                                                 "-m", "--solver"};
+        bool known = false;
+        for (size_t k = 0; k < sizeof(value_opts) / sizeof(value_opts[0]); k++)
+            known |= strcmp(a, value_opts[k]) == 0;
+        if (!known)
+        {
+            fprintf(stderr, COLOR_RED "Error: Unknown option %s\n" COLOR_RESET, a);
+            return -1;
+        }
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, COLOR_RED "Error: %s needs a value.\n" COLOR_RESET, a);
+            return -1;
+        }
+        const char *val = argv[++i];
+        int status = 0;
+        if (strcmp(a, "-f") == 0 || strcmp(a, "--format") == 0)
+        {
+            if (strcmp(val, "auto") == 0)
+                o->format = BATCH_FORMAT_AUTO;
+            else if (strcmp(val, "text") == 0)
+                o->format = BATCH_FORMAT_TEXT;
+            else if (strcmp(val, "binary") == 0)
+                o->format = BATCH_FORMAT_BINARY;
+            else
+                status = -1;
+        }
+        else if (strcmp(a, "-o") == 0 || strcmp(a, "--output-dir") == 0)
+            o->out_dir = val;
+        else if (strcmp(a, "-j") == 0 || strcmp(a, "--jobs") == 0)
+            status = parse_count(val, &o->jobs);
+        else if (strcmp(a, "-t") == 0 || strcmp(a, "--threads") == 0)
+            status = parse_count(val, &o->threads);
+        else if (strcmp(a, "-s") == 0 || strcmp(a, "--signals") == 0)
+        {
+            o->signals = val;
+            status = (strcmp(val, "l1") == 0 || strcmp(val, "iflc") == 0) ? 0 : -1;
+        }
+        else if (strcmp(a, "-m") == 0 || strcmp(a, "--solver") == 0)
+        {
+            o->solver = val;
+            status = (strcmp(val, "lsq") == 0 || strcmp(val, "ekf") == 0) ? 0 : -1;
+        }
+        else
+            status = parse_emit(val, &o->outputs);
+        if (status != 0)
+        {
+            fprintf(stderr, COLOR_RED "Error: Invalid value '%s' for %s\n" COLOR_RESET, val, a);
+            return -1;
+        }
+    }
+
+    if (o->n_inputs == 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: No input log given.\n" COLOR_RESET);
+        return -1;
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Creates @p path and its missing parents. @return 0, or -1 on failure. */
+static int make_dirs(const char *path)
+{
+    char buf[BATCH_PATH_MAX];
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(buf))
+        return -1;
+    memcpy(buf, path, len + 1);
+
+    for (size_t i = 1; i <= len; i++)
+    {
+        if (buf[i] != '/' && buf[i] != '\0')
+            continue;
+        char saved = buf[i];
+        buf[i] = '\0';
+#ifdef _WIN32
+        int rc = _mkdir(buf);
+#else
+        int rc = mkdir(buf, 0777);
+#endif
+        if (rc != 0 && errno != EEXIST)
+            return -1;
+        buf[i] = saved;
+    }
+    struct stat st;
+    return (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) ? 0 : -1;
+}
+
+/** @brief File name of @p path without directory and last extension (ignoring a .gz / .zst suffix). */
+static void log_stem(const char *path, char *out, size_t size)
+{
+    const char *slash = strrchr(path, '/');
+    snprintf(out, size, "%s", slash ? slash + 1 : path);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        char *dot = strrchr(out, '.');
+        if (!dot || dot == out)
+            break;
+        bool compressed = strcmp(dot, ".gz") == 0 || strcmp(dot, ".zst") == 0;
+        *dot = '\0';
+        if (!compressed)
+            break;
+    }
+}
+
+/**
+ * @brief Output directory of input @p index: the output directory itself for a
+ *        single log, else `<out_dir>/<log name without extension>`, made unique
+ *        with the log's position when two logs share a name.
+ *
+ * @return 0, or -1 if the path does not fit in @p size.
+ */
+static int job_out_dir(const batch_opts_t *o, int index, char *out, size_t size)
+{
+    int n;
+    if (o->n_inputs == 1)
+    {
+        n = snprintf(out, size, "%s", o->out_dir);
+        return (n < 0 || (size_t)n >= size) ? -1 : 0;
+    }
+
+    char stem[BATCH_PATH_MAX], other[BATCH_PATH_MAX];
+    log_stem(o->inputs[index], stem, sizeof(stem));
+    bool duplicate = false;
+    for (int i = 0; i < o->n_inputs && !duplicate; i++)
+    {
+        log_stem(o->inputs[i], other, sizeof(other));
+        duplicate = i != index && strcmp(stem, other) == 0;
+    }
+    if (duplicate)
+        n = snprintf(out, size, "%s/%s-%d", o->out_dir, stem, index + 1);
+    else
+        n = snprintf(out, size, "%s/%s", o->out_dir, stem);
+    return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+/**
+ * @brief Decides whether @p path is a PyRTCM text log.
+ *
+ * @return 1 for text, 0 for binary RTCM3, -1 if the file cannot be read.
+ */
+static int input_is_parsed(const char *path, batch_format_t format)
+{
+    if (format != BATCH_FORMAT_AUTO)
+        return format == BATCH_FORMAT_TEXT;
+
+    FILE *fp = log_open(path, true); // First decompressed byte for a gzip / zstd log
+    if (!fp)
+        return -1;
+    int first = fgetc(fp);
+    fclose(fp);
+    return first != RTCM3_PREAMBLE;
+}
+
+/**
+ * @brief Processes one log in the current process (the body of a child).
+ *
+ * @return Exit status: 0 on success, 1 on failure.
+ */
+static int run_job(const batch_opts_t *o, batch_job_t *job)
+{
+    if (make_dirs(job->out_dir) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Cannot create output directory %s\n" COLOR_RESET, job->out_dir);
+        return 1;
+    }
+
+    if (!o->verbose)
+    {
+        char log_path[BATCH_PATH_MAX + 32];
+        snprintf(log_path, sizeof(log_path), "%s/%s", job->out_dir, BATCH_LOG_NAME);
+        fflush(stdout);
+        fflush(stderr);
+        if (!freopen(log_path, "w", stdout))
+            return 1;
+#ifndef _WIN32
+        dup2(fileno(stdout), fileno(stderr));
+#endif
+    }
+
+    int is_parsed = input_is_parsed(job->path, o->format);
+    int status = 1;
+    if (is_parsed < 0)
+        fprintf(stderr, COLOR_RED "Error: Could not open %s: %s\n" COLOR_RESET, job->path, strerror(errno));
+    else
+        status = batch_process_file(job->path, is_parsed == 1, job->out_dir, o->outputs);
+
+    fflush(stdout);
+    fflush(stderr);
+    return status == 0 ? 0 : 1;
+}
+
+/** @brief Prints the status line of a finished log. */
+static void report_job(const batch_opts_t *o, const batch_job_t *job)
+{
+    double seconds = (double)(perf_now_ns() - job->start_ns) * 1e-9;
+    if (job->status == 0)
+    {
+        printf(COLOR_GREEN "[OK]" COLOR_RESET " %s -> %s (%.2f s)\n", job->path, job->out_dir, seconds);
+    }
+    else if (o->verbose)
+    {
+        fprintf(stderr, COLOR_RED "[ERR]" COLOR_RESET " %s (exit status %d, %.2f s)\n", job->path, job->status, seconds);
+    }
+    else
+    {
+        fprintf(stderr, COLOR_RED "[ERR]" COLOR_RESET " %s (exit status %d, %.2f s, see %s/%s)\n", job->path,
+                job->status, seconds, job->out_dir, BATCH_LOG_NAME);
+    }
+    fflush(stdout);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Entry point of the command line mode (any program argument selects it).
+ *
+ * @param argc Argument count from main().
+ * @param argv Arguments from main().
+ * @return Process exit code: 0 if every log succeeded, 1 if any failed, 2 on usage errors.
+ */
+int batch_cli(int argc, char **argv)
+{
+    batch_opts_t o;
+    int parsed = parse_args(argc, argv, &o);
+    if (parsed != 0)
+    {
+        if (parsed < 0)
+            print_usage(stderr);
+        free(o.inputs);
+        return parsed < 0 ? 2 : 0;
+    }
+
+    // Split the CPUs between concurrent logs
+    int cpus = configured_thread_count();
+    int jobs = o.jobs > 0 ? o.jobs : cpus;
+    if (jobs > o.n_inputs)
+        jobs = o.n_inputs;
+    int threads = o.threads > 0 ? o.threads : (cpus / jobs > 0 ? cpus / jobs : 1);
+#ifndef _WIN32
+    char threads_env[16];
+    snprintf(threads_env, sizeof(threads_env), "%d", threads);
+    setenv("GPS_RESOLVER_THREADS", threads_env, 1);
+    if (o.no_cache)
+        setenv("GPS_RESOLVER_NO_CACHE", "1", 1);
+    if (o.signals)
+        setenv("GPS_RESOLVER_SIGNALS", o.signals, 1);
+    if (o.solver)
+        setenv("GPS_RESOLVER_SOLVER", o.solver, 1);
+#endif
+
+    batch_job_t *job_list = calloc((size_t)o.n_inputs, sizeof(*job_list));
+    if (!job_list)
+    {
+        free(o.inputs);
+        return 1;
+    }
+    for (int i = 0; i < o.n_inputs; i++)
+    {
+        job_list[i].path = o.inputs[i];
+        if (job_out_dir(&o, i, job_list[i].out_dir, sizeof(job_list[i].out_dir)) != 0)
+        {
+            fprintf(stderr, COLOR_RED "Error: Output path for %s is too long.\n" COLOR_RESET, o.inputs[i]);
+            free(job_list);
+            free(o.inputs);
+            return 2;
+        }
+    }
+
+    printf(COLOR_BLUE "Processing %d log(s), %d at a time with %d thread(s) each.\n" COLOR_RESET, o.n_inputs, jobs,
+           threads);
+    fflush(stdout);
+
+    int n_failed = 0;
+#ifdef _WIN32
+    for (int i = 0; i < o.n_inputs; i++)
+    {
+        job_list[i].start_ns = perf_now_ns();
+        job_list[i].status = run_job(&o, &job_list[i]);
+        n_failed += job_list[i].status != 0;
+        report_job(&o, &job_list[i]);
+    }
+#else
+    // Bounded pool of child processes: start up to `jobs`, then one per finished child
+    int next = 0, running = 0;
+    while (next < o.n_inputs || running > 0)
+    {
+        while (running < jobs && next < o.n_inputs)
+        {
+            batch_job_t *job = &job_list[next++];
+            job->start_ns = perf_now_ns();
+            fflush(stdout);
+            fflush(stderr);
+            job->pid = fork();
+            if (job->pid == 0)
+            {
+                int status = run_job(&o, job);
+                _exit(status);
+            }
+            if (job->pid < 0)
+            {
+                fprintf(stderr, COLOR_RED "Error: Cannot start a worker for %s: %s\n" COLOR_RESET, job->path,
+                        strerror(errno));
+                job->status = 1;
+                n_failed++;
+                continue;
+            }
+            running++;
+        }
+        if (running == 0)
+            break;
+
+        int wstatus = 0;
+        pid_t pid = wait(&wstatus);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (int i = 0; i < o.n_inputs; i++)
+        {
+            if (job_list[i].pid != pid)
+                continue;
+            job_list[i].status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+            n_failed += job_list[i].status != 0;
+            report_job(&o, &job_list[i]);
+            running--;
+        }
+    }
+#endif
+
+    printf("%d of %d log(s) processed successfully.\n", o.n_inputs - n_failed, o.n_inputs);
+    free(job_list);
+    free(o.inputs);
+    return n_failed == 0 ? 0 : 1;
+}
@@ -4,8 +4,10 @@
  *
  * This module provides parsing logic for the following specific RTCM message types:
  * - RTCM 1019: Broadcast ephemeris messages (used for GPS satellite position)
+ * - RTCM 1042 / 1045 / 1046: BeiDou and Galileo broadcast ephemerides
  * - RTCM 1002: Legacy observation messages (used for GPS L1 pseudorange and phase)
  * - RTCM 1074: MSM4 observation messages (used for GPS L1 pseudorange and phase)
+ * - RTCM 1084 / 1094 / 1124: GLONASS, Galileo and BeiDou MSM4 (first-frequency code)
  *
  * The input is assumed to be text-format (e.g., exported from parsed binary logs),
  * and each line contains a full RTCM message with labeled fields (DFxxx).
@@ -15,17 +17,348 @@
 
 #include "../include/algo.h"
 #include "../include/df_parser.h"
+#include "../include/obs_store.h"
+#include "../include/eph_index.h"
+#include "../include/orbit_cache.h"
+#include "../include/gnss_context.h"
+
+/*
+ * Single-pass DF tokenizer
+ * ------------------------
+ * Every `<RTCM(...)>` line is a flat list of `KEY=VALUE` pairs separated by ", ".
+ * Instead of searching the whole line once per field, each parser walks the line
+ * exactly once and dispatches every pair through a per-message field table that
+ * records where (offsetof) and how (storage kind) the value lands in the output
+ * structure. Indexed labels such as `PRN_03` or `DF400_12` are split into their
+ * base label and 1-based index, so one table row covers a whole per-satellite
+ * or per-cell array.
+ */
+
+/// Storage kind of a DF value inside its destination structure
+typedef enum
+{
+    DF_U8,    ///< uint8_t, decimal text
+    DF_U16,   ///< uint16_t, decimal text
+    DF_U32,   ///< uint32_t, decimal text
+    DF_F64,   ///< double, decimal/exponent text
+    DF_SIG_BAND ///< MSM cell signal label, stored as its MSM_BAND_* value
+} df_kind_t;
+
+/// One row of a per-message field table
+typedef struct
+{
+    const char *key;  ///< Field label without index suffix (e.g. "DF004", "PRN", "DF400")
+    size_t key_len;   ///< Precomputed strlen(key)
+    df_kind_t kind;   ///< Storage kind of the destination member
+    size_t offset;    ///< offsetof() of the destination member
+    size_t max_index; ///< 0 for scalar fields, array length for indexed ("_NN") fields
+} df_field_t;
+
+#define DF_MEMBER_LEN(type, member) (sizeof(((type *)0)->member) / sizeof(((type *)0)->member[0]))
+#define DF_SCALAR(key, type, member, kind) {key, sizeof(key) - 1, kind, offsetof(type, member), 0}
+#define DF_INDEXED(key, type, member, kind) {key, sizeof(key) - 1, kind, offsetof(type, member), DF_MEMBER_LEN(type, member)}
+#define DF_TABLE_LEN(table) (sizeof(table) / sizeof((table)[0]))
+
+/// Longest value text converted by df_store() (longer values are truncated)
+#define DF_VALUE_MAX 63
+
+static const df_field_t df_fields_1002[] = {
+    DF_SCALAR("DF002", rtcm_1002_msm1_t, msg_type, DF_U16),
+    DF_SCALAR("DF003", rtcm_1002_msm1_t, station_id, DF_U16),
+    DF_SCALAR("DF004", rtcm_1002_msm1_t, time_of_week, DF_U32),
+    DF_SCALAR("DF005", rtcm_1002_msm1_t, sync_gps_message_flag, DF_U8),
+    DF_SCALAR("DF006", rtcm_1002_msm1_t, num_satellites, DF_U8),
+    DF_SCALAR("DF007", rtcm_1002_msm1_t, smooth_interval_flag, DF_U8),
+    DF_SCALAR("DF008", rtcm_1002_msm1_t, smooth_interval, DF_U8),
+    DF_INDEXED("DF009", rtcm_1002_msm1_t, svs, DF_U8),
+    DF_INDEXED("DF010", rtcm_1002_msm1_t, sig_id, DF_U8),
+    DF_INDEXED("DF011", rtcm_1002_msm1_t, remainders, DF_F64),
+    DF_INDEXED("DF012", rtcm_1002_msm1_t, phase_pr_diff, DF_F64),
+    DF_INDEXED("DF013", rtcm_1002_msm1_t, lock_time, DF_U8),
+    DF_INDEXED("DF014", rtcm_1002_msm1_t, ambiguities, DF_U8),
+    DF_INDEXED("DF015", rtcm_1002_msm1_t, cnr, DF_U8),
+};
+
+static const df_field_t df_fields_1074[] = {
+    DF_SCALAR("DF002", rtcm_1074_msm4_t, msg_type, DF_U16),
+    DF_SCALAR("DF003", rtcm_1074_msm4_t, station_id, DF_U16),
+    DF_SCALAR("DF004", rtcm_1074_msm4_t, gps_epoch_time, DF_U32),
+    DF_SCALAR("DF034", rtcm_1074_msm4_t, gps_epoch_time, DF_U32),
+    DF_SCALAR("DF248", rtcm_1074_msm4_t, gps_epoch_time, DF_U32),
+    DF_SCALAR("DF427", rtcm_1074_msm4_t, gps_epoch_time, DF_U32),
+    DF_SCALAR("DF416", rtcm_1074_msm4_t, glo_day_of_week, DF_U8),
+    DF_SCALAR("DF393", rtcm_1074_msm4_t, msm_sync_flag, DF_U8),
+    DF_SCALAR("DF409", rtcm_1074_msm4_t, iods_reserved, DF_U8),
+    DF_SCALAR("DF001_7", rtcm_1074_msm4_t, reserved_DF001_07, DF_U8),
+    DF_SCALAR("DF411", rtcm_1074_msm4_t, clk_steering_flag, DF_U8),
+    DF_SCALAR("DF412", rtcm_1074_msm4_t, external_clk_flag, DF_U8),
+    DF_SCALAR("DF417", rtcm_1074_msm4_t, smooth_interval_flag, DF_U8),
+    DF_SCALAR("NSat", rtcm_1074_msm4_t, n_sat, DF_U8),
+    DF_SCALAR("NSig", rtcm_1074_msm4_t, n_sig, DF_U8),
+    DF_SCALAR("NCell", rtcm_1074_msm4_t, n_cell, DF_U8),
+    DF_INDEXED("PRN", rtcm_1074_msm4_t, prn, DF_U8),
+    DF_INDEXED("DF397", rtcm_1074_msm4_t, pseudorange_integer, DF_U8),
+    DF_INDEXED("DF398", rtcm_1074_msm4_t, pseudorange_mod_1s, DF_F64),
+    DF_INDEXED("CELLPRN", rtcm_1074_msm4_t, cell_prn, DF_U8),
+    DF_INDEXED("CELLSIG", rtcm_1074_msm4_t, cell_sig, DF_SIG_BAND),
+    DF_INDEXED("DF400", rtcm_1074_msm4_t, pseudorange_fine, DF_F64),
+    DF_INDEXED("DF401", rtcm_1074_msm4_t, phase_range, DF_F64),
+    DF_INDEXED("DF402", rtcm_1074_msm4_t, lock_time, DF_U8),
+    DF_INDEXED("DF420", rtcm_1074_msm4_t, half_cycle_amb, DF_U8),
+    DF_INDEXED("DF403", rtcm_1074_msm4_t, cnr, DF_U8),
+};
+
+static const df_field_t df_fields_1019[] = {
+    DF_SCALAR("DF002", rtcm_1019_ephemeris_t, msg_type, DF_U16),
+    DF_SCALAR("DF009", rtcm_1019_ephemeris_t, satellite_id, DF_U8),
+    DF_SCALAR("DF076", rtcm_1019_ephemeris_t, gps_wn, DF_U16),
+    DF_SCALAR("DF077", rtcm_1019_ephemeris_t, gps_sv_acc, DF_U8),
+    DF_SCALAR("DF078", rtcm_1019_ephemeris_t, gps_code_l2, DF_U8),
+    DF_SCALAR("DF079", rtcm_1019_ephemeris_t, gps_idot, DF_F64),
+    DF_SCALAR("DF071", rtcm_1019_ephemeris_t, gps_iode, DF_U16),
+    DF_SCALAR("DF081", rtcm_1019_ephemeris_t, gps_toc, DF_U32),
+    DF_SCALAR("DF082", rtcm_1019_ephemeris_t, gps_af2, DF_F64),
+    DF_SCALAR("DF083", rtcm_1019_ephemeris_t, gps_af1, DF_F64),
+    DF_SCALAR("DF084", rtcm_1019_ephemeris_t, gps_af0, DF_F64),
+    DF_SCALAR("DF085", rtcm_1019_ephemeris_t, gps_iodc, DF_U16),
+    DF_SCALAR("DF086", rtcm_1019_ephemeris_t, gps_crs, DF_F64),
+    DF_SCALAR("DF087", rtcm_1019_ephemeris_t, gps_delta_n, DF_F64),
+    DF_SCALAR("DF088", rtcm_1019_ephemeris_t, gps_m0, DF_F64),
+    DF_SCALAR("DF089", rtcm_1019_ephemeris_t, gps_cuc, DF_F64),
+    DF_SCALAR("DF090", rtcm_1019_ephemeris_t, gps_eccentricity, DF_F64),
+    DF_SCALAR("DF091", rtcm_1019_ephemeris_t, gps_cus, DF_F64),
+    DF_SCALAR("DF092", rtcm_1019_ephemeris_t, gps_sqrt_a, DF_F64),
+    DF_SCALAR("DF093", rtcm_1019_ephemeris_t, gps_toe, DF_U32),
+    DF_SCALAR("DF094", rtcm_1019_ephemeris_t, gps_cic, DF_F64),
+    DF_SCALAR("DF095", rtcm_1019_ephemeris_t, gps_omega0, DF_F64),
+    DF_SCALAR("DF096", rtcm_1019_ephemeris_t, gps_cis, DF_F64),
+    DF_SCALAR("DF097", rtcm_1019_ephemeris_t, gps_i0, DF_F64),
+    DF_SCALAR("DF098", rtcm_1019_ephemeris_t, gps_crc, DF_F64),
+    DF_SCALAR("DF099", rtcm_1019_ephemeris_t, gps_omega, DF_F64),
+    DF_SCALAR("DF100", rtcm_1019_ephemeris_t, gps_omega_dot, DF_F64),
+    DF_SCALAR("DF101", rtcm_1019_ephemeris_t, gps_tgd, DF_F64),
+    DF_SCALAR("DF102", rtcm_1019_ephemeris_t, gps_sv_health, DF_U8),
+    DF_SCALAR("DF103", rtcm_1019_ephemeris_t, gps_l2p_data_flag, DF_U8),
+    DF_SCALAR("DF137", rtcm_1019_ephemeris_t, gps_fit_interval, DF_U16),
+};
+
+/// Galileo F/NAV (1045) and I/NAV (1046); of the per-signal health fields the last one listed wins (E5a, E1-B)
+static const df_field_t df_fields_1045[] = {
+    DF_SCALAR("DF002", rtcm_1019_ephemeris_t, msg_type, DF_U16),
+    DF_SCALAR("DF252", rtcm_1019_ephemeris_t, satellite_id, DF_U8),
+    DF_SCALAR("DF289", rtcm_1019_ephemeris_t, gps_wn, DF_U16),
+    DF_SCALAR("DF290", rtcm_1019_ephemeris_t, gps_iode, DF_U16),
+    DF_SCALAR("DF291", rtcm_1019_ephemeris_t, gps_sv_acc, DF_U8),
+    DF_SCALAR("DF292", rtcm_1019_ephemeris_t, gps_idot, DF_F64),
+    DF_SCALAR("DF293", rtcm_1019_ephemeris_t, gps_toc, DF_U32),
+    DF_SCALAR("DF294", rtcm_1019_ephemeris_t, gps_af2, DF_F64),
+    DF_SCALAR("DF295", rtcm_1019_ephemeris_t, gps_af1, DF_F64),
+    DF_SCALAR("DF296", rtcm_1019_ephemeris_t, gps_af0, DF_F64),
+    DF_SCALAR("DF297", rtcm_1019_ephemeris_t, gps_crs, DF_F64),
+    DF_SCALAR("DF298", rtcm_1019_ephemeris_t, gps_delta_n, DF_F64),
+    DF_SCALAR("DF299", rtcm_1019_ephemeris_t, gps_m0, DF_F64),
+    DF_SCALAR("DF300", rtcm_1019_ephemeris_t, gps_cuc, DF_F64),
+    DF_SCALAR("DF301", rtcm_1019_ephemeris_t, gps_eccentricity, DF_F64),
+    DF_SCALAR("DF302", rtcm_1019_ephemeris_t, gps_cus, DF_F64),
+    DF_SCALAR("DF303", rtcm_1019_ephemeris_t, gps_sqrt_a, DF_F64),
+    DF_SCALAR("DF304", rtcm_1019_ephemeris_t, gps_toe, DF_U32),
+    DF_SCALAR("DF305", rtcm_1019_ephemeris_t, gps_cic, DF_F64),
+    DF_SCALAR("DF306", rtcm_1019_ephemeris_t, gps_omega0, DF_F64),
+    DF_SCALAR("DF307", rtcm_1019_ephemeris_t, gps_cis, DF_F64),
+    DF_SCALAR("DF308", rtcm_1019_ephemeris_t, gps_i0, DF_F64),
+    DF_SCALAR("DF309", rtcm_1019_ephemeris_t, gps_crc, DF_F64),
+    DF_SCALAR("DF310", rtcm_1019_ephemeris_t, gps_omega, DF_F64),
+    DF_SCALAR("DF311", rtcm_1019_ephemeris_t, gps_omega_dot, DF_F64),
+    DF_SCALAR("DF312", rtcm_1019_ephemeris_t, gps_tgd, DF_F64),
+    DF_SCALAR("DF314", rtcm_1019_ephemeris_t, gps_sv_health, DF_U8),
+    DF_SCALAR("DF315", rtcm_1019_ephemeris_t, data_validity, DF_U8),
+    DF_SCALAR("DF287", rtcm_1019_ephemeris_t, gps_sv_health, DF_U8),
+    DF_SCALAR("DF288", rtcm_1019_ephemeris_t, data_validity, DF_U8),
+};
+
+/// BeiDou D1/D2 ephemeris (1042); DF513 TGD1 is given in ns
+static const df_field_t df_fields_1042[] = {
+    DF_SCALAR("DF002", rtcm_1019_ephemeris_t, msg_type, DF_U16),
+    DF_SCALAR("DF488", rtcm_1019_ephemeris_t, satellite_id, DF_U8),
+    DF_SCALAR("DF489", rtcm_1019_ephemeris_t, gps_wn, DF_U16),
+    DF_SCALAR("DF490", rtcm_1019_ephemeris_t, gps_sv_acc, DF_U8),
+    DF_SCALAR("DF491", rtcm_1019_ephemeris_t, gps_idot, DF_F64),
+    DF_SCALAR("DF492", rtcm_1019_ephemeris_t, gps_iode, DF_U16),
+    DF_SCALAR("DF493", rtcm_1019_ephemeris_t, gps_toc, DF_U32),
+    DF_SCALAR("DF494", rtcm_1019_ephemeris_t, gps_af2, DF_F64),
+    DF_SCALAR("DF495", rtcm_1019_ephemeris_t, gps_af1, DF_F64),
+    DF_SCALAR("DF496", rtcm_1019_ephemeris_t, gps_af0, DF_F64),
+    DF_SCALAR("DF497", rtcm_1019_ephemeris_t, gps_iodc, DF_U16),
+    DF_SCALAR("DF498", rtcm_1019_ephemeris_t, gps_crs, DF_F64),
+    DF_SCALAR("DF499", rtcm_1019_ephemeris_t, gps_delta_n, DF_F64),
+    DF_SCALAR("DF500", rtcm_1019_ephemeris_t, gps_m0, DF_F64),
+    DF_SCALAR("DF501", rtcm_1019_ephemeris_t, gps_cuc, DF_F64),
+    DF_SCALAR("DF502", rtcm_1019_ephemeris_t, gps_eccentricity, DF_F64),
+    DF_SCALAR("DF503", rtcm_1019_ephemeris_t, gps_cus, DF_F64),
+    DF_SCALAR("DF504", rtcm_1019_ephemeris_t, gps_sqrt_a, DF_F64),
+    DF_SCALAR("DF505", rtcm_1019_ephemeris_t, gps_toe, DF_U32),
+    DF_SCALAR("DF506", rtcm_1019_ephemeris_t, gps_cic, DF_F64),
+    DF_SCALAR("DF507", rtcm_1019_ephemeris_t, gps_omega0, DF_F64),
+    DF_SCALAR("DF508", rtcm_1019_ephemeris_t, gps_cis, DF_F64),
+    DF_SCALAR("DF509", rtcm_1019_ephemeris_t, gps_i0, DF_F64),
+    DF_SCALAR("DF510", rtcm_1019_ephemeris_t, gps_crc, DF_F64),
+    DF_SCALAR("DF511", rtcm_1019_ephemeris_t, gps_omega, DF_F64),
+    DF_SCALAR("DF512", rtcm_1019_ephemeris_t, gps_omega_dot, DF_F64),
+    DF_SCALAR("DF513", rtcm_1019_ephemeris_t, gps_tgd, DF_F64),
+    DF_SCALAR("DF515", rtcm_1019_ephemeris_t, gps_sv_health, DF_U8),
+};
+
+static const df_field_t df_fields_msm_header[] = {
+    DF_SCALAR("DF002", rtcm_msm_header_t, msg_type, DF_U16),
+    DF_SCALAR("DF003", rtcm_msm_header_t, station_id, DF_U16),
+    DF_SCALAR("DF393", rtcm_msm_header_t, msm_sync_flag, DF_U8),
+};
+
+/**
+ * @brief Finds the table row for a field label.
+ *
+ * @param table   Field table to search.
+ * @param n       Number of rows in @p table.
+ * @param key     Label text (not NUL-terminated).
+ * @param key_len Length of @p key.
+ * @param indexed True to match indexed rows only, false to match scalar rows only.
+ * @return Pointer to the matching row, or NULL if the label is not in the table.
+ */
+static const df_field_t *df_lookup(const df_field_t *table, size_t n,
+                                   const char *key, size_t key_len, bool indexed)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (table[i].key_len == key_len &&
+            (table[i].max_index != 0) == indexed &&
+            memcmp(table[i].key, key, key_len) == 0)
+            return &table[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief MSM_BAND_* of a PyRTCM cell signal label ("1C", "5Q", ...).
+ *
+ * Matches the signal IDs rtcm3_decode_1074() classifies: "1C" / "2I" are
+ * signal ID 2, the L5-band labels signal IDs 22-24.
+ */
+static uint8_t signal_label_band(const char *val, size_t val_len)
+{
+    if (val_len != 2)
+        return MSM_BAND_OTHER;
+    if ((val[0] == '1' && val[1] == 'C') || (val[0] == '2' && val[1] == 'I'))
+        return MSM_BAND_PRIMARY;
+    if (val[0] == '5' && strchr("IQXDP", val[1]))
+        return MSM_BAND_L5;
+    return MSM_BAND_OTHER;
+}
+
+/**
+ * @brief Converts one value text and writes it to its destination member.
+ *
+ * @param field Table row describing the destination.
+ * @param msg   Base address of the destination message structure.
+ * @param index   0-based array slot (0 for scalar fields).
+ * @param val     Value text (not NUL-terminated).
+ * @param val_len Length of @p val.
+ */
+static void df_store(const df_field_t *field, void *msg, size_t index, const char *val, size_t val_len)
+{
+    char *dst = (char *)msg + field->offset;
+
+    // strto*() need a terminator; values are short numbers, so a small copy suffices
+    char num[DF_VALUE_MAX + 1];
+    if (val_len > DF_VALUE_MAX)
+        val_len = DF_VALUE_MAX;
+    memcpy(num, val, val_len);
+    num[val_len] = '\0';
+    val = num;
+
+    switch (field->kind)
+    {
+    case DF_U8:
+        ((uint8_t *)dst)[index] = (uint8_t)strtoul(val, NULL, 10);
+        break;
+    case DF_U16:
+        ((uint16_t *)dst)[index] = (uint16_t)strtoul(val, NULL, 10);
+        break;
+    case DF_U32:
+        ((uint32_t *)dst)[index] = (uint32_t)strtoul(val, NULL, 10);
+        break;
+    case DF_F64:
+        ((double *)dst)[index] = strtod(val, NULL);
+        break;
+    case DF_SIG_BAND:
+        ((uint8_t *)dst)[index] = signal_label_band(val, val_len);
+        break;
+    }
+}
+
+/**
+ * @brief Walks a text-formatted RTCM line once and dispatches every KEY=VALUE pair.
+ *
+ * Tokens without '=' (such as the leading message number) and labels that are not
+ * in @p table are skipped. Indexed labels whose index falls outside the destination
+ * array are ignored. The scan never reads past @p len, so the line may be a span
+ * of a larger buffer (e.g. a memory-mapped file) without a terminator.
+ *
+ * @param line  Input line (`<RTCM(nnnn, KEY=VALUE, ...)>`).
+ * @param len   Length of @p line in bytes.
+ * @param table Field table of the message type.
+ * @param n     Number of rows in @p table.
+ * @param msg   Destination message structure.
+ */
+static void df_scan_line(const char *line, size_t len, const df_field_t *table, size_t n, void *msg)
+{
+    const char *end = line + len;
+    const char *p = memchr(line, '(', len);
+    p = p ? p + 1 : line;
+
+    for (;;)
+    {
+        while (p < end && (*p == ' ' || *p == ','))
+            p++;
+        if (p >= end || *p == '\0' || *p == ')' || *p == '\n')
+            return;
+
+        // Key runs up to '='; a token without '=' is skipped entirely
+        const char *key = p;
+        while (p < end && *p != '=' && *p != ',' && *p != ')' && *p != '\0')
+            p++;
+        if (p >= end || *p != '=')
+            continue;
+        size_t key_len = (size_t)(p - key);
+        const char *val = ++p;
+        while (p < end && *p != ',' && *p != ')' && *p != '\0')
+            p++;
+        size_t val_len = (size_t)(p - val);
+
+        // Split an "_NN" suffix off indexed labels (e.g. DF400_12 -> DF400, 12)
+        const df_field_t *field = NULL;
+        size_t index = 0;
+        const char *us = key + key_len;
+        while (us > key && us[-1] >= '0' && us[-1] <= '9')
+            us--;
+        if (us > key + 1 && us < key + key_len && us[-1] == '_')
+        {
+            field = df_lookup(table, n, key, (size_t)(us - 1 - key), true);
+            if (field)
+            {
+                for (const char *d = us; d < key + key_len; d++)
+                    index = index * 10 + (size_t)(*d - '0');
+                if (index < 1 || index > field->max_index)
+                    continue;
+                index--;
+            }
+        }
+        if (!field)
+            field = df_lookup(table, n, key, key_len, false);
+        if (field)
+            df_store(field, msg, index, val, val_len);
+    }
+}
 
-//////////////////////////////////////////////////////////////////////////////////////////////
-bool eph_available[MAX_SAT + 1] = {0};
-size_t msm4_count[MAX_SAT + 1] = {0};
-size_t msm1_count[MAX_SAT + 1] = {0};
-double pseudorange_history[MAX_SAT + 1][MAX_EPOCHS] = {{0}};
-size_t pseudorange_count[MAX_SAT + 1] = {0};
-rtcm_1002_msm1_t msm1_history[MAX_SAT + 1][MAX_EPOCHS] = {{{0}}};
-rtcm_1074_msm4_t msm4_history[MAX_SAT + 1][MAX_EPOCHS] = {{{0}}};
-rtcm_1019_ephemeris_t eph_table[MAX_SAT + 1] = {{0}};
-uint8_t observation_type = 0;
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -33,257 +366,144 @@ uint8_t observation_type = 0;
  *
  * This function extracts the MSM1 header and all per-satellite fields
  * (PRN, signal ID, pseudorange remainder, phase range difference, lock time,
- * ambiguity, and CNR) from the provided text-formatted RTCM message.
+ * ambiguity, and CNR) from the provided text-formatted RTCM message in a single
+ * pass over the line.
  *
  * @param line Input string containing the RTCM 1002 MSM1 message.
+ * @param len  Length of @p line in bytes (the line need not be NUL-terminated).
  * @param msm1 Pointer to the MSM1 observation structure to populate.
  * @return 0 on success, non-zero on failure.
  */
-int parse_rtcm_1002(const char *line, rtcm_1002_msm1_t *msm1)
+int parse_rtcm_1002(const char *line, size_t len, rtcm_1002_msm1_t *msm1)
 {
     if (!line || !msm1)
         return -1;
 
-    EXTRACT("DF002", "%hu", &msm1->msg_type);
-    EXTRACT("DF003", "%hu", &msm1->station_id);
-    EXTRACT("DF004", "%u", &msm1->time_of_week);
-    msm1->time_of_week = msm1->time_of_week;
-    EXTRACT("DF005", "%hhu", &msm1->sync_gps_message_flag);
-    EXTRACT("DF006", "%hhu", &msm1->num_satellites);
-    EXTRACT("DF007", "%hhu", &msm1->smooth_interval_flag);
-    EXTRACT("DF008", "%hhu", &msm1->smooth_interval);
-
-    // Step X: Extract DF009_xx .. DF015_xx using strstr + sscanf
-    for (int i = 0; i < msm1->num_satellites; i++)
-    {
-        char key[16];
-        const char *ptr;
-
-        // DF009_xx: Satellite PRN
-        sprintf(key, "DF009_%02d", i + 1);
-        ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%hhu", &msm1->svs[i]);
-
-        // DF010_xx: Signal ID
-        sprintf(key, "DF010_%02d", i + 1);
-        ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%hhu", &msm1->sig_id[i]);
-
-        // DF011_xx: Pseudorange remainder (m)
-        sprintf(key, "DF011_%02d", i + 1);
-        ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%lf", &msm1->remainders[i]);
-
-        // DF012_xx: Carrier phase range minus pseudorange (m)
-        sprintf(key, "DF012_%02d", i + 1);
-        ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%lf", &msm1->phase_pr_diff[i]);
-
-        // DF013_xx: Lock time indicator
-        sprintf(key, "DF013_%02d", i + 1);
-        ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%hhu", &msm1->lock_time[i]);
-
-        // DF014_xx: Pseudorange modulus ambiguity
-        sprintf(key, "DF014_%02d", i + 1);
-        ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%hhu", &msm1->ambiguities[i]);
-
-        // DF015_xx: Carrier-to-noise ratio (dB-Hz)
-        sprintf(key, "DF015_%02d", i + 1);
-        ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%hhu", &msm1->cnr[i]);
-
-        // Calculate full pseudorange
-        msm1->pseudoranges[i] = compute_pseudorange_msm1(msm1->ambiguities[i], msm1->remainders[i]);
-    }
+    df_scan_line(line, len, df_fields_1002, DF_TABLE_LEN(df_fields_1002), msm1);
+
+    finalize_msm1(msm1);
+
     // print_msm1(msm1); // quick debug print
     return 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief Parses the common header of a text-formatted MSM message of any constellation.
+ *
+ * Only DF002, DF003 and DF393 are kept; they are enough to detect epoch boundaries
+ * across multi-constellation MSM bursts.
+ *
+ * @param line Input string containing the MSM message.
+ * @param len  Length of @p line in bytes (the line need not be NUL-terminated).
+ * @param hdr  Pointer to the header structure to populate.
+ * @return 0 on success, non-zero on failure.
+ */
+int parse_rtcm_msm_header(const char *line, size_t len, rtcm_msm_header_t *hdr)
+{
+    if (!line || !hdr)
+        return -1;
+
+    df_scan_line(line, len, df_fields_msm_header, DF_TABLE_LEN(df_fields_msm_header), hdr);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Computes the full pseudorange of every satellite in a decoded MSM1 message.
+ *
+ * Shared by the text parser and the binary RTCM3 decoder.
+ *
+ * @param msm1 MSM1 structure whose DF fields are already populated.
+ */
+void finalize_msm1(rtcm_1002_msm1_t *msm1)
+{
+    int n_sat = msm1->num_satellites < MAX_PRN_GPS ? msm1->num_satellites : MAX_PRN_GPS;
+    for (int i = 0; i < n_sat; i++)
+        msm1->pseudoranges[i] = compute_pseudorange_msm1(msm1->ambiguities[i], msm1->remainders[i]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
 /**
  * @brief Parses a single RTCM 1074 MSM4 line into a structured observation object.
  *
  * This function extracts the MSM4 header and all per-cell data (pseudorange,
- * carrier phase, lock time, CNR, etc.) for each satellite-signal combination.
+ * carrier phase, lock time, CNR, etc.) for each satellite-signal combination
+ * in a single pass over the line. Every cell is kept, tagged with its band:
+ * the primary signal ("1C", BeiDou B1I "2I"), the L5 band ("5I" / "5Q" / "5X",
+ * BeiDou B2a "5D" / "5P") or another signal. The GLONASS, Galileo and BeiDou
+ * MSM4 (1084, 1094, 1124) parse alike.
  *
  * @param line Input string with the RTCM message content.
+ * @param len  Length of @p line in bytes (the line need not be NUL-terminated).
  * @param msm4 Pointer to output structure to populate.
  * @return 0 on success, non-zero on failure.
  */
-int parse_rtcm_1074(const char *line, rtcm_1074_msm4_t *msm4)
+int parse_rtcm_1074(const char *line, size_t len, rtcm_1074_msm4_t *msm4)
 {
     if (!line || !msm4)
         return -1;
 
-    // Step 1: Extract MSM4 header fields using the EXTRACT macro
-    EXTRACT("DF002", "%hu", &msm4->msg_type);
-    EXTRACT("DF003", "%hu", &msm4->station_id);
-    EXTRACT("DF004", "%u", &msm4->gps_epoch_time);
-    msm4->time_of_pseudorange = msm4->gps_epoch_time;
-    EXTRACT("DF393", "%hhu", &msm4->msm_sync_flag);
-    EXTRACT("DF409", "%hhu", &msm4->iods_reserved);
-    EXTRACT("DF001_7", "%hhu", &msm4->reserved_DF001_07);
-    EXTRACT("DF411", "%hhu", &msm4->clk_steering_flag);
-    EXTRACT("DF412", "%hhu", &msm4->external_clk_flag);
-
-    // Step 2: Extract counts
-    EXTRACT("NSat", "%hhu", &msm4->n_sat);
-    EXTRACT("NSig", "%hhu", &msm4->n_sig);
-    EXTRACT("NCell", "%hhu", &msm4->n_cell);
-
-    // Step 3: Extract satellite PRNs (PRN_01, PRN_02, ...)
-    for (int i = 0; i < msm4->n_sat; i++)
-    {
-        char key[16];
-        sprintf(key, "PRN_%02d", i + 1);
-        const char *ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%hhu", &msm4->prn[i]);
-    }
-
-    // Step 4: Extract Pseudorange values
-    for (int i = 0; i < msm4->n_sat; i++)
-    {
-        char key[16];
-        sprintf(key, "DF397_%02d", i + 1);
-        const char *ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%hhu", &msm4->pseudorange_integer[i]);
-    }
-
-    for (int i = 0; i < msm4->n_sat; i++)
-    {
-        char key[16];
-        sprintf(key, "DF398_%02d", i + 1);
-        const char *ptr = strstr(line, key);
-        if (ptr)
-            sscanf(ptr + strlen(key) + 1, "%lf", &msm4->pseudorange_mod_1s[i]);
-    }
+    // Step 1: Scan header, satellite and cell fields (cells land at their raw cell index)
+    df_scan_line(line, len, df_fields_1074, DF_TABLE_LEN(df_fields_1074), msm4);
 
-    // Step 5: Extract Cell PRN and Signal ID mappings (CELLPRN_xx, CELLSIG_xx). Note: Store only L1 (1C) cells
-    uint8_t l1_cell_index = 0;
-
-    for (int i = 0; i < msm4->n_cell; i++)
-    {
-        char prn_key[24], sig_key[24], sig_val[8];
-        const char *ptr;
+    // Step 2: Pair satellites with their cells, compute pseudoranges and the GPS epoch time
+    finalize_msm4_cells(msm4);
 
-        uint8_t prn_val = 0;
-
-        // Get CELLPRN
-        sprintf(prn_key, "CELLPRN_%02d", i + 1);
-        ptr = strstr(line, prn_key);
-        if (ptr)
-            sscanf(ptr + strlen(prn_key) + 1, "%hhu", &prn_val);
+    // print_msm4(msm4); // quick debug print
 
-        // Get CELLSIG
-        sprintf(sig_key, "CELLSIG_%02d", i + 1);
-        ptr = strstr(line, sig_key);
-        if (ptr)
-        {
-            sscanf(ptr + strlen(sig_key) + 1, "%2s", sig_val);
+    return 0;
+}
 
-            if (strcmp(sig_val, "1C") == 0)
-            {
-                // Keep only if signal is 1C
-                msm4->cell_prn[l1_cell_index] = prn_val;
-                msm4->cell_sig[l1_cell_index] = 1; // 1 = 1C in your system
-                l1_cell_index++;
-            }
-        }
-    }
+//////////////////////////////////////////////////////////////////////////////////////////////
 
-    // Step 6: Extract DF400 (pseudorange), DF401 (carrier phase), DF402 (lock), DF403 (CNR)
-    l1_cell_index = 0;
+/**
+ * @brief Pairs every satellite of a freshly decoded MSM4 message with its cells.
+ *
+ * Expects every cell array to be filled at its raw cell index, with `cell_sig[i]`
+ * set to the cell's MSM_BAND_* value. Cells are satellite-major in ascending PRN
+ * order, like the satellite list, so one cursor walks both. For each satellite
+ * the first primary and the first L5-band cell are recorded in `primary_cell[]`
+ * / `l5_cell[]`, `pseudorange[]` and `pseudorange_l5[]` are computed from them
+ * (-1 for a missing band), and `time_of_pseudorange` is set to the epoch in GPS
+ * time. Shared by the text parser and the binary RTCM3 decoder so both produce
+ * identical structures.
+ *
+ * @param msm4 MSM4 structure to finalize in place.
+ */
+void finalize_msm4_cells(rtcm_1074_msm4_t *msm4)
+{
+    uint8_t n_cell = msm4->n_cell < MAX_CELL ? msm4->n_cell : MAX_CELL;
+    uint8_t n_sat = msm4->n_sat < MSM_MAX_SAT ? msm4->n_sat : MSM_MAX_SAT;
+    msm4->n_cell = n_cell;
 
-    for (int i = 0; i < msm4->n_cell; i++)
+    uint8_t c = 0;
+    for (uint8_t s = 0; s < n_sat; s++)
     {
-        char prn_key[24], sig_key[24], sig_val[8];
-        const char *ptr;
-        uint8_t prn_val = 0;
-
-        int cell_number = i + 1;
-
-        // CELLPRN_XX
-        sprintf(prn_key, "CELLPRN_%02d", cell_number);
-        ptr = strstr(line, prn_key);
-        if (ptr)
-            sscanf(ptr + strlen(prn_key) + 1, "%hhu", &prn_val);
-
-        // CELLSIG_XX
-        sprintf(sig_key, "CELLSIG_%02d", cell_number);
-        ptr = strstr(line, sig_key);
-        if (ptr)
+        msm4->primary_cell[s] = MSM_NO_CELL;
+        msm4->l5_cell[s] = MSM_NO_CELL;
+        while (c < n_cell && msm4->cell_prn[c] < msm4->prn[s])
+            c++;
+        for (; c < n_cell && msm4->cell_prn[c] == msm4->prn[s] && msm4->prn[s] > 0; c++)
         {
-            sscanf(ptr + strlen(sig_key) + 1, "%2s", sig_val);
-
-            if (strcmp(sig_val, "1C") == 0)
-            {
-                // Store PRN and signal
-                msm4->cell_prn[l1_cell_index] = prn_val;
-                msm4->cell_sig[l1_cell_index] = 1; // L1C
-
-                // Extract corresponding DF400_XX to DF403_XX
-                char key[32];
-
-                sprintf(key, "DF400_%02d", cell_number);
-                ptr = strstr(line, key);
-                if (ptr)
-                    sscanf(ptr + strlen(key) + 1, "%lf", &msm4->pseudorange_fine[l1_cell_index]);
-
-                sprintf(key, "DF401_%02d", cell_number);
-                ptr = strstr(line, key);
-                if (ptr)
-                    sscanf(ptr + strlen(key) + 1, "%lf", &msm4->phase_range[l1_cell_index]);
-
-                sprintf(key, "DF402_%02d", cell_number);
-                ptr = strstr(line, key);
-                if (ptr)
-                    sscanf(ptr + strlen(key) + 1, "%hhu", &msm4->lock_time[l1_cell_index]);
-
-                sprintf(key, "DF403_%02d", cell_number);
-                ptr = strstr(line, key);
-                if (ptr)
-                    sscanf(ptr + strlen(key) + 1, "%hhu", &msm4->cnr[l1_cell_index]);
-
-                l1_cell_index++;
-            }
+            if (msm4->cell_sig[c] == MSM_BAND_PRIMARY && msm4->primary_cell[s] == MSM_NO_CELL)
+                msm4->primary_cell[s] = c;
+            else if (msm4->cell_sig[c] == MSM_BAND_L5 && msm4->l5_cell[s] == MSM_NO_CELL)
+                msm4->l5_cell[s] = c;
         }
-    }
 
-    // Finalize the number of cells to the actual count of L1C cells
-    msm4->n_cell = l1_cell_index;
-
-    // Step 7: Calculate pseudorange array
-    for (int i = 0; i < msm4->n_cell; i++)
-    {
-        // Check if the cell is valid (has a PRN and signal)
-        if (msm4->cell_prn[i] > 0 && msm4->cell_sig[i] == 1) // Only L1C cells
-        {
-            msm4->pseudorange[i] = compute_pseudorange(
-                msm4->pseudorange_integer[i],
-                msm4->pseudorange_mod_1s[i],
-                msm4->pseudorange_fine[i]);
-        }
-        else
-        {
-            msm4->pseudorange[i] = -1.0; // mark as invalid
-        }
+        // Rough range of satellite s plus the fine range of its cell; -1 marks a missing band
+        msm4->pseudorange[s] = msm4->primary_cell[s] == MSM_NO_CELL ? -1.0 : compute_pseudorange(
+            msm4->pseudorange_integer[s], msm4->pseudorange_mod_1s[s], msm4->pseudorange_fine[msm4->primary_cell[s]]);
+        msm4->pseudorange_l5[s] = msm4->l5_cell[s] == MSM_NO_CELL ? -1.0 : compute_pseudorange(
+            msm4->pseudorange_integer[s], msm4->pseudorange_mod_1s[s], msm4->pseudorange_fine[msm4->l5_cell[s]]);
     }
 
-    // print_msm4(msm4); // quick debug print
-
-    return 0;
+    msm4->time_of_pseudorange = gnss_epoch_to_gps_ms(gnss_msg_sys(msm4->msg_type), msm4->gps_epoch_time,
+                                                     msm4->glo_day_of_week);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -292,79 +512,125 @@ int parse_rtcm_1074(const char *line, rtcm_1074_msm4_t *msm4)
  * @brief Parses a single RTCM 1019 line into a structured ephemeris object.
  *
  * This function extracts all defined DF fields from a line containing a text-formatted
- * RTCM 1019 message and fills the provided structure accordingly.
+ * RTCM 1019 message in a single pass and fills the provided structure accordingly.
+ *
+ * @param line Input string with the RTCM message content.
+ * @param len  Length of @p line in bytes (the line need not be NUL-terminated).
+ * @param eph Pointer to output structure to populate.
+ * @return 0 on success, non-zero on failure.
+ */
+int parse_rtcm_1019(const char *line, size_t len, rtcm_1019_ephemeris_t *eph)
+{
+    if (!line || !eph)
+        return -1;
+
+    df_scan_line(line, len, df_fields_1019, DF_TABLE_LEN(df_fields_1019), eph);
+
+    finalize_ephemeris(eph);
+    // print_ephemeris(eph); // quick debug print
+
+    return 0;
+}
+
+/**
+ * @brief Parses a single RTCM 1045 / 1046 line into a structured ephemeris object.
+ *
+ * @param line Input string with the RTCM message content.
+ * @param len  Length of @p line in bytes (the line need not be NUL-terminated).
+ * @param eph Pointer to output structure to populate.
+ * @return 0 on success, non-zero on failure.
+ */
+int parse_rtcm_1045(const char *line, size_t len, rtcm_1019_ephemeris_t *eph)
+{
+    if (!line || !eph)
+        return -1;
+
+    df_scan_line(line, len, df_fields_1045, DF_TABLE_LEN(df_fields_1045), eph);
+
+    finalize_ephemeris(eph);
+    return 0;
+}
+
+/**
+ * @brief Parses a single RTCM 1042 line into a structured ephemeris object.
  *
  * @param line Input string with the RTCM message content.
+ * @param len  Length of @p line in bytes (the line need not be NUL-terminated).
  * @param eph Pointer to output structure to populate.
  * @return 0 on success, non-zero on failure.
  */
-int parse_rtcm_1019(const char *line, rtcm_1019_ephemeris_t *eph)
+int parse_rtcm_1042(const char *line, size_t len, rtcm_1019_ephemeris_t *eph)
 {
     if (!line || !eph)
         return -1;
 
-    EXTRACT("DF002", "%hu", &eph->msg_type);
-    EXTRACT("DF009", "%hhu", &eph->satellite_id);
+    df_scan_line(line, len, df_fields_1042, DF_TABLE_LEN(df_fields_1042), eph);
+    eph->gps_tgd *= 1e-9; // DF513: ns
+
+    finalize_ephemeris(eph);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Fills the derived (unscaled) ephemeris fields from the broadcast DF values.
+ *
+ * BeiDou TOE / TOC are moved from BDT to GPS seconds of week and Galileo /
+ * BeiDou weeks to GPS weeks modulo 1024 first, so every system's ephemeris is
+ * selected and propagated on the GPS time scale of the observations.
+ * Shared by the text parser and the binary RTCM3 decoder.
+ *
+ * @param eph Ephemeris structure whose DF fields are already populated.
+ */
+void finalize_ephemeris(rtcm_1019_ephemeris_t *eph)
+{
+    gnss_sys_t sys = gnss_msg_sys(eph->msg_type);
+    if (sys == GNSS_BDS)
+    {
+        // One week wrap at most: the offset is GNSS_BDT_OFFSET_S
+        uint32_t toe = eph->gps_toe + GNSS_BDT_OFFSET_S;
+        uint32_t wn = eph->gps_wn + GNSS_BDT_WEEK_OFFSET + (toe >= 604800u ? 1u : 0u);
+        eph->gps_toe = toe % 604800u;
+        eph->gps_toc = (eph->gps_toc + GNSS_BDT_OFFSET_S) % 604800u;
+        eph->gps_wn = (uint16_t)(wn % 1024u);
+    }
+    else if (sys == GNSS_GAL)
+    {
+        eph->gps_wn = (uint16_t)((eph->gps_wn + GNSS_GST_WEEK_OFFSET) % 1024u);
+    }
+
     eph->sv = eph->satellite_id;
-    EXTRACT("DF076", "%hu", &eph->gps_wn);
     eph->week_number = eph->gps_wn;
-    EXTRACT("DF077", "%hhu", &eph->gps_sv_acc);
-    EXTRACT("DF078", "%hhu", &eph->gps_code_l2);
-    EXTRACT("DF079", "%lf", &eph->gps_idot);
-    EXTRACT("DF071", "%hu", &eph->gps_iode);
-    EXTRACT("DF081", "%u", &eph->gps_toc);
-    EXTRACT("DF082", "%lf", &eph->gps_af2);
-    EXTRACT("DF083", "%lf", &eph->gps_af1);
-    EXTRACT("DF084", "%lf", &eph->gps_af0);
-    EXTRACT("DF085", "%hu", &eph->gps_iodc);
-    EXTRACT("DF086", "%lf", &eph->gps_crs);
-    EXTRACT("DF087", "%lf", &eph->gps_delta_n);
-    EXTRACT("DF088", "%lf", &eph->gps_m0);
     eph->mean_anomaly = eph->gps_m0 * PI;
-    EXTRACT("DF089", "%lf", &eph->gps_cuc);
-    EXTRACT("DF090", "%lf", &eph->gps_eccentricity);
-    eph->eccentricity = eph->gps_eccentricity * pow(2, -33);
-    EXTRACT("DF091", "%lf", &eph->gps_cus);
-    EXTRACT("DF092", "%lf", &eph->gps_sqrt_a);
+    eph->eccentricity = eph->gps_eccentricity; // DF090 is stored already scaled by 2^-33
     eph->semi_major_axis = eph->gps_sqrt_a * eph->gps_sqrt_a;
-    EXTRACT("DF093", "%u", &eph->gps_toe);
     eph->time_of_week = eph->gps_toe;
-    EXTRACT("DF094", "%lf", &eph->gps_cic);
-    EXTRACT("DF095", "%lf", &eph->gps_omega0);
     eph->right_ascension_of_ascending_node = eph->gps_omega0 * PI;
-    EXTRACT("DF096", "%lf", &eph->gps_cis);
-    EXTRACT("DF097", "%lf", &eph->gps_i0);
     eph->inclination = eph->gps_i0 * PI;
-    EXTRACT("DF098", "%lf", &eph->gps_crc);
-    EXTRACT("DF099", "%lf", &eph->gps_omega);
     eph->argument_of_periapsis = eph->gps_omega * PI;
-    EXTRACT("DF100", "%lf", &eph->gps_omega_dot);
-    EXTRACT("DF101", "%lf", &eph->gps_tgd);
-    EXTRACT("DF102", "%hhu", &eph->gps_sv_health);
-    EXTRACT("DF103", "%hhu", &eph->gps_l2p_data_flag);
-    EXTRACT("DF137", "%hu", &eph->gps_wn);
-    eph->time_since_epoch = (eph->week_number * 604800) + eph->time_of_week;
-    // print_ephemeris(eph); // quick debug print
-
-    return 0;
+    eph->time_since_epoch = (uint32_t)(eph->week_number * 604800) + eph->time_of_week;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Computes the pseudorange from the given parameters.
+ * @brief Computes the pseudorange of an MSM4 cell from the given parameters.
  *
  * This function calculates the pseudorange using the formula:
- * Pseudorange = c * (integer_ms * 1e-3 + mod1s_sec + fine_sec)
+ * Pseudorange = c * 1e-3 * (integer_ms + mod1s_ms + fine_ms)
+ *
+ * All three fields are in milliseconds of light travel time, so the
+ * sub-millisecond terms are scaled by the speed of light like the integer.
  *
- * @param integer_ms Rough range integer in milliseconds.
- * @param mod1s_sec Pseudorange modulo 1 second.
- * @param fine_sec Pseudorange residuals in seconds scaled by speed of light.
+ * @param integer_ms DF397: Rough range integer (ms).
+ * @param mod1s_ms   DF398: Rough range modulo 1 ms (ms).
+ * @param fine_ms    DF400: Fine pseudorange (ms).
  * @return The computed pseudorange in meters.
  */
-double compute_pseudorange(uint32_t integer_ms, double mod1s_sec, double fine_sec)
+double compute_pseudorange(uint32_t integer_ms, double mod1s_ms, double fine_ms)
 {
-    return SPEED_OF_LIGHT * (integer_ms * 1e-3) + mod1s_sec + fine_sec;
+    return SPEED_OF_LIGHT * 1e-3 * ((double)integer_ms + mod1s_ms + fine_ms);
 }
 
 /**
@@ -390,115 +656,92 @@ double compute_pseudorange_msm1(double amb, double rem)
     return (double)(amb_meters + rem);
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////
-
 /**
- * @brief Stores or updates the ephemeris data for a given satellite.
+ * @brief Computes the full carrier-phase range of an MSM4 cell.
  *
- * This function always updates the ephemeris for the specified satellite,
- * regardless of IODE/IODC. It ensures the latest data is always stored.
+ * Unlike compute_pseudorange(), every term is in milliseconds and scaled by
+ * the speed of light, so the result keeps the millimetre resolution of DF401
+ * and can be differenced over time for range rates.
  *
- * @param new_eph Pointer to the new ephemeris data to store.
- * @return 0 on success, -1 if input is NULL, -2 if PRN is out of range (1-32).
+ * @param integer_ms     DF397: Rough range integer (ms).
+ * @param mod1s_ms       DF398: Rough range modulo 1 ms (ms).
+ * @param phase_range_ms DF401: Fine phase range (ms).
+ * @return Carrier range in meters, 0 if DF401 carries the invalid marker.
  */
-int store_ephemeris(const rtcm_1019_ephemeris_t *new_eph)
+double compute_carrier_range(uint32_t integer_ms, double mod1s_ms, double phase_range_ms)
 {
-    if (!new_eph)
-        return -1;
-
-    uint8_t prn = new_eph->satellite_id;
-    if (prn < 1 || prn > MAX_SAT)
-        return -2;
-
-    size_t idx = eph_history[prn].count++;
-    if (idx < MAX_EPH_HISTORY)
-    {
-        eph_history[prn].eph[idx] = *new_eph;
-        // printf(COLOR_GREEN "Stored ephemeris for PRN %u at idx %zu\n" COLOR_RESET, prn, idx);
-    }
-    else
-    {
-        // printf(COLOR_RED "Warning: Ephemeris history for PRN %u exceeded max entries (%d). Data may be lost.\n" COLOR_RESET, prn, MAX_EPH_HISTORY);
-    }
-
-    // Optionally update eph_table[prn] and eph_available[prn] for legacy code
-    eph_table[prn] = *new_eph;
-    eph_available[prn] = true;
+    if (phase_range_ms == MSM_PHASE_RANGE_INVALID)
+        return 0.0;
+    return SPEED_OF_LIGHT * 1e-3 * ((double)integer_ms + mod1s_ms + phase_range_ms);
+}
 
-    return 0;
+/**
+ * @brief Computes the full carrier-phase range of an RTCM 1002 (MSM1) observation.
+ *
+ * @param pseudorange   Full L1 pseudorange (m, see compute_pseudorange_msm1()).
+ * @param phase_pr_diff DF012: L1 phase range minus L1 pseudorange (m).
+ * @return Carrier range in meters, 0 if DF012 carries the invalid marker.
+ */
+double compute_carrier_range_msm1(double pseudorange, double phase_pr_diff)
+{
+    if (phase_pr_diff == MSM1_PHASE_PR_DIFF_INVALID)
+        return 0.0;
+    return pseudorange + phase_pr_diff;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Stores the entire MSM4 struct for each PRN at the current epoch.
- *
- * This function appends the full MSM4 struct for each PRN in the message to a history array,
- * so you can later access all MSM4 fields for every satellite and epoch.
+ * @brief Satellite index (see gnss_sat.h) of an ephemeris: its constellation from
+ *        `msg_type`, its PRN from `satellite_id`.
  *
- * @param new_msm4 Pointer to the new MSM4 observation data to store.
- * @return 0 on success, -1 if input is NULL.
+ * @param eph Decoded 1019 / 1042 / 1045 / 1046 ephemeris.
+ * @return 1..MAX_SAT, or 0 if the message type or PRN is out of range.
  */
-int store_msm4(const rtcm_1074_msm4_t *new_msm4)
+int ephemeris_sat_index(const rtcm_1019_ephemeris_t *eph)
 {
-    if (!new_msm4)
-        return -1;
-
-    for (int i = 0; i < new_msm4->n_sat; i++)
-    {
-        uint8_t prn = new_msm4->prn[i];
-        if (prn < 1 || prn > MAX_SAT)
-            continue;
-        size_t epoch_idx = msm4_count[prn]++;
-        if (epoch_idx < MAX_EPOCHS)
-        {
-            msm4_history[prn][epoch_idx] = *new_msm4;
-        }
-        else
-        {
-            // printf(COLOR_RED "Warning: MSM4 history for PRN %u exceeded max epochs (%d). Data may be lost.\n" COLOR_RESET, prn, MAX_EPOCHS);
-        }
-        // printf(COLOR_GREEN "Stored MSM4 for PRN %u at epoch %zu\n" COLOR_RESET, prn, epoch_idx);
-    }
-    return 0;
+    return eph && RTCM_IS_EPHEMERIS(eph->msg_type) ? gnss_sat_index(gnss_msg_sys(eph->msg_type), eph->satellite_id) : 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Stores the entire MSM1 struct for each PRN at the current epoch.
+ * @brief Stores or updates the ephemeris data for a given satellite.
  *
- * This function appends the full MSM1 struct for each PRN in the message to a history array,
- * so you can later access all MSM1 fields for every satellite and epoch.
+ * The ephemeris is inserted into the satellite's TOE-sorted history (see eph_index.c):
+ * repeats of a stored TOE/IODE are dropped, a new IODE for a stored TOE replaces it.
+ * Storing new data invalidates the satellite's orbit cache (see orbit_cache.c).
+ * ctx->eph_table[sat] always holds the last one received.
  *
- * @param new_msm1 Pointer to the new MSM1 observation data to store.
- * @return 0 on success, -1 if input is NULL.
+ * @param ctx     Session state receiving the ephemeris.
+ * @param new_eph Pointer to the new ephemeris data to store.
+ * @return 0 on success, -1 if input is NULL or the history cannot grow, -2 if the
+ *         message type or PRN is out of range (see ephemeris_sat_index()).
  */
-int store_msm1(const rtcm_1002_msm1_t *new_msm1)
+int store_ephemeris(gnss_context_t *ctx, const rtcm_1019_ephemeris_t *new_eph)
 {
-    if (!new_msm1)
+    if (!ctx || !new_eph)
         return -1;
 
-    for (int i = 0; i < new_msm1->num_satellites; i++)
+    int prn = ephemeris_sat_index(new_eph);
+    if (prn == 0)
+        return -2;
+
+    // Sorted by TOE, one entry per TOE (repeated broadcasts are dropped here)
+    int inserted = eph_history_insert(&ctx->eph_history[prn], new_eph);
+    if (inserted < 0)
     {
-        uint8_t prn = new_msm1->svs[i];
-        if (prn < 1 || prn > MAX_SAT)
-            continue;
+        fprintf(stderr, COLOR_RED "Error: Out of memory while storing ephemeris for satellite %d.\n" COLOR_RESET, prn);
+        return -1;
+    }
 
-        size_t epoch_idx = msm1_count[prn]++;
-        if (epoch_idx < MAX_EPOCHS)
-        {
-            msm1_history[prn][epoch_idx] = *new_msm1;
-        }
-        else
-        {
-            // printf(COLOR_RED
-            //        "Warning: MSM1 history for PRN %u exceeded max epochs (%d). Data may be lost.\n" COLOR_RESET,
-            //        prn, MAX_EPOCHS);
-        }
+    // New data (new TOE or new IODE): positions cached from the old entries may be stale
+    if (inserted == 0)
+        orbit_cache_invalidate(&ctx->orbit_cache[prn]);
 
-        // printf(COLOR_GREEN "Stored MSM1 for PRN %u at epoch %zu\n" COLOR_RESET, prn, epoch_idx);
-    }
+    // Optionally update eph_table[prn] and eph_available[prn] for legacy code
+    ctx->eph_table[prn] = *new_eph;
+    ctx->eph_available[prn] = true;
 
     return 0;
 }
@@ -506,78 +749,64 @@ int store_msm1(const rtcm_1002_msm1_t *new_msm1)
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Stores pseudorange for all satellites in the MSM4 message at the current epoch.
+ * @brief Stores the observations of an MSM4 message as one compact epoch record.
  *
- * This function appends the pseudorange for each PRN in the message to a history array,
- * so you can later plot the time series for each satellite.
+ * One obs_record_t per satellite with a primary signal, with all its signal
+ * cells, is appended to the observation store (see obs_store_add_msm4()).
  *
+ * @param ctx      Session state receiving the observations.
  * @param new_msm4 Pointer to the new MSM4 observation data to store.
- * @return 0 on success, -1 if input is NULL.
+ * @return 0 on success, -1 if input is NULL or the store cannot grow.
  */
-int store_pseudorange(const rtcm_1074_msm4_t *new_msm4)
+int store_msm4(gnss_context_t *ctx, const rtcm_1074_msm4_t *new_msm4)
 {
-    if (!new_msm4)
-        return -1;
+    return ctx ? obs_store_add_msm4(&ctx->obs_store, new_msm4) : -1;
+}
 
-    for (int i = 0; i < new_msm4->n_sat; i++)
-    {
-        uint8_t prn = new_msm4->prn[i];
-        if (prn < 1 || prn > MAX_SAT)
-            continue;
-        size_t epoch_idx = pseudorange_count[prn]++;
-        if (epoch_idx < MAX_EPOCHS)
-        {
-            pseudorange_history[prn][epoch_idx] = new_msm4->pseudorange[i];
-        }
-        else
-        {
-            // printf(COLOR_RED "Warning: Pseudorange history for PRN %u exceeded max epochs (%d). Data may be lost.\n" COLOR_RESET, prn, MAX_EPOCHS);
-        }
-        // printf(COLOR_GREEN "Stored pseudorange for PRN %u at epoch %zu : %.12f\n" COLOR_RESET, prn, epoch_idx, new_msm4->pseudorange[i]);
-    }
-    return 0;
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Stores the observations of an MSM1 (1002) message as one compact epoch record.
+ *
+ * @param ctx      Session state receiving the observations.
+ * @param new_msm1 Pointer to the new MSM1 observation data to store.
+ * @return 0 on success, -1 if input is NULL or the store cannot grow.
+ */
+int store_msm1(gnss_context_t *ctx, const rtcm_1002_msm1_t *new_msm1)
+{
+    return ctx ? obs_store_add_msm1(&ctx->obs_store, new_msm1) : -1;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Stores pseudorange for all satellites in the MSM1 message at the current epoch.
+ * @brief Stores one decoded RTCM message in the matching history table.
  *
- * Computes pseudorange from MSM1 rough-range ambiguity (ms) and remainder, then appends
- * the value for each PRN to a per-PRN history buffer for later plotting.
+ * Dispatches on `msg->msg_type` to store_ephemeris() (any RTCM_IS_EPHEMERIS() type),
+ * store_msm4() (any RTCM_IS_MSM4_OBS() type) or store_msm1() and records the
+ * observation type for the satellite sorter.
  *
- * @param new_msm1 Pointer to the new MSM1 observation data to store.
- * @return 0 on success, -1 if input is NULL.
+ * @param ctx Session state receiving the message.
+ * @param msg Decoded message (from the text parser or the binary decoder).
+ * @return Result of the underlying store function, -1 if input is NULL,
+ *         -3 if the message type is not stored (e.g. MSM headers of other constellations).
  */
-int store_pseudorange_msm1(const rtcm_1002_msm1_t *new_msm1)
+int store_rtcm_message(gnss_context_t *ctx, const rtcm_message_t *msg)
 {
-    if (!new_msm1)
+    if (!ctx || !msg)
         return -1;
 
-    for (int i = 0; i < new_msm1->num_satellites; i++)
+    if (msg->msg_type == 1002)
     {
-        uint8_t prn = new_msm1->svs[i]; //
-        if (prn < 1 || prn > MAX_SAT)
-            continue;
-
-        double pr = compute_pseudorange_msm1(
-            new_msm1->ambiguities[i],
-            new_msm1->remainders[i]);
-
-        size_t epoch_idx = pseudorange_count[prn]++;
-        if (epoch_idx < MAX_EPOCHS)
-        {
-            pseudorange_history[prn][epoch_idx] = pr;
-        }
-        else
-        {
-            // printf(COLOR_RED
-            //        "Warning: Pseudorange history for PRN %u exceeded max epochs (%d). Data may be lost.\n" COLOR_RESET,
-            //        prn, MAX_EPOCHS);
-        }
-
-        // printf(COLOR_GREEN "Stored MSM1 pseudorange for PRN %u at epoch %zu : %.12f\n" COLOR_RESET, prn, epoch_idx, pr);
+        ctx->observation_type = 1; // MSM1
+        return store_msm1(ctx, &msg->data.msm1);
     }
-
-    return 0;
+    if (RTCM_IS_EPHEMERIS(msg->msg_type))
+        return store_ephemeris(ctx, &msg->data.eph);
+    if (RTCM_IS_MSM4_OBS(msg->msg_type))
+    {
+        ctx->observation_type = 4; // MSM4
+        return store_msm4(ctx, &msg->data.msm4);
+    }
+    return -3;
 }
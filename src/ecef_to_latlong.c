@@ -1,73 +1,207 @@
 /**
- * @file ecef_to_geodetic.c
- * @brief Convert ECEF (Earth-Centered, Earth-Fixed) coordinates to geodetic coordinates (WGS-84).
+ * @file ecef_to_latlong.c
+ * @brief Convert between ECEF (Earth-Centered, Earth-Fixed) and geodetic coordinates (WGS-84).
  *
- * This function converts Earth-Centered Earth-Fixed (ECEF) Cartesian coordinates
- * (X, Y, Z in meters) into geodetic latitude, longitude, and altitude above the WGS-84 ellipsoid.
+ * ECEF Cartesian coordinates (X, Y, Z in meters) are converted into geodetic
+ * latitude, longitude, and altitude above the WGS-84 ellipsoid, one point at a
+ * time or over whole arrays, and back.
  *
  * Implementation details:
  *  - Uses WGS-84 constants (semi-major axis and flattening).
- *  - Applies Bowring’s formula for latitude computation.
- *  - Computes ellipsoidal height (altitude) relative to the WGS-84 reference ellipsoid.
- *
- * @param[in]  x        ECEF X coordinate (meters).
- * @param[in]  y        ECEF Y coordinate (meters).
- * @param[in]  z        ECEF Z coordinate (meters).
- * @param[out] lat_deg  Geodetic latitude in degrees.
- * @param[out] lon_deg  Geodetic longitude in degrees.
- * @param[out] alt_m    Altitude above WGS-84 ellipsoid (meters).
- *
- * @note If all inputs (x, y, z) are zero, the function returns lat=0, lon=0, alt=-a (arbitrary).
+ *  - GEODETIC_EXACT applies Vermeille's closed form (J. Geodesy 2004): one
+ *    cube root and square roots, no iteration, exact to rounding for every
+ *    point more than ~43 km from the Earth's centre.
+ *  - GEODETIC_FAST applies one step of Bowring's formula, with the sine and
+ *    cosine of the auxiliary angles taken algebraically (sub-millimetre near
+ *    the surface).
+ *  - Both compute the ellipsoidal height as p*cos(lat) + z*sin(lat) - a*W
+ *    instead of p / cos(lat) - N, so it stays accurate at the poles.
+ *  - The batch loops have no data-dependent calls besides atan2/cbrt/sqrt, so
+ *    long tracks convert in one tight pass after solving.
  */
 
 #include "../include/df_parser.h"
+#include "../include/receiver.h"
 
-void ecef_to_geodetic(double x, double y, double z,
-                      double *lat_deg, double *lon_deg, double *alt_m)
+// WGS-84 constants
+#define WGS84_A 6378137.0                               // semi-major axis (m)
+#define WGS84_F (1.0 / 298.257223563)                   // flattening
+#define WGS84_B (WGS84_A * (1.0 - WGS84_F))             // semi-minor axis (m)
+#define WGS84_E2 (WGS84_F * (2.0 - WGS84_F))            // first eccentricity^2
+#define WGS84_EP2 (WGS84_E2 / (1.0 - WGS84_E2))         // second eccentricity^2
+
+/**
+ * @brief Height above the ellipsoid of a point at distance @p p from the Z
+ *        axis and height @p z, given the sine and cosine of its latitude.
+ */
+static inline double ellipsoid_height(double p, double z, double sin_lat, double cos_lat)
 {
-    // WGS-84 constants
-    const double a = 6378137.0;                   // semi-major axis (m)
-    const double f = 1.0 / 298.257223563;         // flattening
-    const double b = a * (1.0 - f);               // semi-minor axis (m)
-    const double e2 = 2.0 * f - f * f;            // first eccentricity^2
-    const double ep2 = (a * a - b * b) / (b * b); // second eccentricity^2
-    const double rad2deg = 180.0 / PI;
+    return p * cos_lat + z * sin_lat - WGS84_A * sqrt(1.0 - WGS84_E2 * sin_lat * sin_lat);
+}
+
+/**
+ * @brief One Bowring step from the parametric latitude (GEODETIC_FAST).
+ *
+ * @param p   Distance from the Z axis (m), with p and z not both zero.
+ * @param z   ECEF Z coordinate (m).
+ * @param lat Geodetic latitude (rad).
+ * @param alt Height above the ellipsoid (m).
+ */
+static inline void geodetic_bowring(double p, double z, double *lat, double *alt)
+{
+    // sin / cos of the parametric latitude, tan(theta) = z a / (p b)
+    double za = z * WGS84_A, pb = p * WGS84_B;
+    double r = sqrt(za * za + pb * pb);
+    double st = za / r, ct = pb / r;
 
-    // Longitude
-    double lon = atan2(y, x);
+    double num = z + WGS84_EP2 * WGS84_B * st * st * st;
+    double den = p - WGS84_E2 * WGS84_A * ct * ct * ct;
+    double hyp = sqrt(num * num + den * den);
 
-    // Distance from Z axis
-    double p = sqrt(x * x + y * y);
+    *lat = atan2(num, den);
+    *alt = ellipsoid_height(p, z, num / hyp, den / hyp);
+}
 
-    // Guard against origin
-    if (p == 0.0 && z == 0.0)
+/**
+ * @brief Vermeille's closed form (GEODETIC_EXACT).
+ *
+ * Falls back to geodetic_bowring() inside the evolute of the ellipsoid (within
+ * ~43 km of the centre), where the closed form has no real solution.
+ *
+ * @param p   Distance from the Z axis (m), with p and z not both zero.
+ * @param z   ECEF Z coordinate (m).
+ * @param lat Geodetic latitude (rad).
+ * @param alt Height above the ellipsoid (m).
+ */
+static inline void geodetic_vermeille(double p, double z, double *lat, double *alt)
+{
+    const double e4 = WGS84_E2 * WGS84_E2;
+    double pp = (p * p) / (WGS84_A * WGS84_A);
+    double q = (1.0 - WGS84_E2) * (z * z) / (WGS84_A * WGS84_A);
+    double r = (pp + q - e4) / 6.0;
+    if (r <= 0.0)
     {
-        if (lat_deg)
-            *lat_deg = 0.0;
-        if (lon_deg)
-            *lon_deg = 0.0;
-        if (alt_m)
-            *alt_m = -a; // arbitrary
+        geodetic_bowring(p, z, lat, alt);
         return;
     }
 
-    // Bowring’s formula for latitude
-    double theta = atan2(z * a, p * b);
-    double st = sin(theta), ct = cos(theta);
-    double lat = atan2(z + ep2 * b * st * st * st,
-                       p - e2 * a * ct * ct * ct);
+    double s = e4 * pp * q / (4.0 * r * r * r);
+    double t = cbrt(1.0 + s + sqrt(s * (2.0 + s)));
+    double u = r * (1.0 + t + 1.0 / t);
+    double v = sqrt(u * u + e4 * q);
+    double w = WGS84_E2 * (u + v - q) / (2.0 * v);
+    double k = sqrt(u + v + w * w) - w;
+    double d = k * p / (k + WGS84_E2);
+    double dz = sqrt(d * d + z * z);
 
-    // Radius of curvature in the prime vertical
-    double sl = sin(lat);
-    double N = a / sqrt(1.0 - e2 * sl * sl);
+    *lat = 2.0 * atan2(z, d + dz);
+    *alt = (k + WGS84_E2 - 1.0) / k * dz;
+}
 
-    // Altitude
-    double alt = (p / cos(lat)) - N;
+/**
+ * @brief Converts ECEF coordinates to geodetic coordinates (GEODETIC_EXACT).
+ *
+ * @param[in]  x        ECEF X coordinate (meters).
+ * @param[in]  y        ECEF Y coordinate (meters).
+ * @param[in]  z        ECEF Z coordinate (meters).
+ * @param[out] lat_deg  Geodetic latitude in degrees (may be NULL).
+ * @param[out] lon_deg  Geodetic longitude in degrees (may be NULL).
+ * @param[out] alt_m    Altitude above WGS-84 ellipsoid in meters (may be NULL).
+ *
+ * @note If all inputs (x, y, z) are zero, the function returns lat=0, lon=0, alt=-a (arbitrary).
+ */
+void ecef_to_geodetic(double x, double y, double z,
+                      double *lat_deg, double *lon_deg, double *alt_m)
+{
+    double lat, lon, alt;
+    ecef_to_geodetic_batch(1, &x, &y, &z, GEODETIC_EXACT, &lat, &lon, &alt);
 
     if (lat_deg)
-        *lat_deg = lat * rad2deg;
+        *lat_deg = lat;
     if (lon_deg)
-        *lon_deg = lon * rad2deg;
+        *lon_deg = lon;
     if (alt_m)
         *alt_m = alt;
 }
+
+/**
+ * @brief Converts @p n ECEF points to geodetic coordinates.
+ *
+ * The outputs must not overlap the inputs.
+ *
+ * @param[in]  n         Number of points.
+ * @param[in]  x         ECEF X coordinates (meters).
+ * @param[in]  y         ECEF Y coordinates (meters).
+ * @param[in]  z         ECEF Z coordinates (meters).
+ * @param[in]  precision GEODETIC_EXACT or GEODETIC_FAST.
+ * @param[out] lat_deg   Geodetic latitudes in degrees.
+ * @param[out] lon_deg   Geodetic longitudes in degrees.
+ * @param[out] alt_m     Altitudes above the WGS-84 ellipsoid (meters); -a at the origin.
+ */
+void ecef_to_geodetic_batch(size_t n, const double *restrict x, const double *restrict y, const double *restrict z,
+                            geodetic_precision_t precision,
+                            double *restrict lat_deg, double *restrict lon_deg, double *restrict alt_m)
+{
+    const double rad2deg = 180.0 / PI;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double p = sqrt(x[i] * x[i] + y[i] * y[i]);
+        double lat = 0.0, alt = -WGS84_A; // Guard against origin
+        if (p != 0.0 || z[i] != 0.0)
+        {
+            if (precision == GEODETIC_FAST)
+                geodetic_bowring(p, z[i], &lat, &alt);
+            else
+                geodetic_vermeille(p, z[i], &lat, &alt);
+        }
+
+        lat_deg[i] = lat * rad2deg;
+        lon_deg[i] = atan2(y[i], x[i]) * rad2deg;
+        alt_m[i] = alt;
+    }
+}
+
+/**
+ * @brief Converts geodetic coordinates to ECEF coordinates (WGS-84).
+ *
+ * @param[in]  lat_deg Geodetic latitude in degrees.
+ * @param[in]  lon_deg Geodetic longitude in degrees.
+ * @param[in]  alt_m   Altitude above the WGS-84 ellipsoid (meters).
+ * @param[out] ecef    ECEF X, Y, Z (meters).
+ */
+void geodetic_to_ecef(double lat_deg, double lon_deg, double alt_m, double ecef[3])
+{
+    geodetic_to_ecef_batch(1, &lat_deg, &lon_deg, &alt_m, &ecef[0], &ecef[1], &ecef[2]);
+}
+
+/**
+ * @brief Converts @p n geodetic points to ECEF coordinates (WGS-84).
+ *
+ * The outputs must not overlap the inputs.
+ *
+ * @param[in]  n       Number of points.
+ * @param[in]  lat_deg Geodetic latitudes in degrees.
+ * @param[in]  lon_deg Geodetic longitudes in degrees.
+ * @param[in]  alt_m   Altitudes above the WGS-84 ellipsoid (meters).
+ * @param[out] x       ECEF X coordinates (meters).
+ * @param[out] y       ECEF Y coordinates (meters).
+ * @param[out] z       ECEF Z coordinates (meters).
+ */
+void geodetic_to_ecef_batch(size_t n, const double *restrict lat_deg, const double *restrict lon_deg,
+                            const double *restrict alt_m,
+                            double *restrict x, double *restrict y, double *restrict z)
+{
+    const double deg2rad = PI / 180.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double lat = lat_deg[i] * deg2rad, lon = lon_deg[i] * deg2rad;
+        double sl = sin(lat), cl = cos(lat);
+
+        // Radius of curvature in the prime vertical
+        double nr = WGS84_A / sqrt(1.0 - WGS84_E2 * sl * sl);
+
+        x[i] = (nr + alt_m[i]) * cl * cos(lon);
+        y[i] = (nr + alt_m[i]) * cl * sin(lon);
+        z[i] = (nr * (1.0 - WGS84_E2) + alt_m[i]) * sl;
+    }
+}
@@ -0,0 +1,178 @@
+/**
+ * @file eph_index.c
+ * @brief Per-PRN ephemeris index: deduplicated, sorted by week + TOE, queried by time.
+ *
+ * Every PRN's eph_history is kept sorted by week + TOE (eph_toe_diff()) with one
+ * entry per week + TOE: repeated broadcasts of the same IODE are dropped at
+ * insertion and a new IODE for an existing week + TOE replaces the old one. The
+ * valid ephemeris at time t is the one with the TOE closest to t, not older or
+ * newer than EPH_MAX_AGE_S. Observation times are seconds of week without a week
+ * number, so t - TOE is wrapped into +-EPH_HALF_WEEK_S: an ephemeris from the end
+ * of the previous week stays valid for the first epochs of the next.
+ *
+ * Lookups are a binary search, or a cursor walk for callers that query with
+ * (mostly) monotonic time, which is O(1) amortized.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/obs_store.h"
+#include "../include/eph_index.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Time from the TOE of @p b to the TOE of @p a (s), weeks included.
+ *
+ * Week numbers are modulo 1024, so their difference is wrapped into [-512, 512)
+ * weeks; the order is then that of week * 604800 + TOE across the rollover too.
+ *
+ * @param a Ephemeris.
+ * @param b Ephemeris to compare with.
+ * @return (week_a * 604800 + TOE_a) - (week_b * 604800 + TOE_b).
+ */
+double eph_toe_diff(const rtcm_1019_ephemeris_t *a, const rtcm_1019_ephemeris_t *b)
+{
+    int dw = ((int)a->gps_wn - (int)b->gps_wn) & 1023;
+    if (dw >= 512)
+        dw -= 1024;
+    return (double)dw * 604800.0 + ((double)a->gps_toe - (double)b->gps_toe);
+}
+
+/**
+ * @brief Time from the TOE of @p eph to an observation time (s), across a week crossover.
+ *
+ * @param eph   Ephemeris.
+ * @param t_sec Observation time in seconds of the GPS week.
+ * @return t - TOE wrapped into [-EPH_HALF_WEEK_S, EPH_HALF_WEEK_S].
+ */
+double eph_time_from_toe(const rtcm_1019_ephemeris_t *eph, double t_sec)
+{
+    double dt = t_sec - (double)eph->gps_toe;
+    if (dt > EPH_HALF_WEEK_S)
+        dt -= 2.0 * EPH_HALF_WEEK_S;
+    else if (dt < -EPH_HALF_WEEK_S)
+        dt += 2.0 * EPH_HALF_WEEK_S;
+    return dt;
+}
+
+/**
+ * @brief Inserts an ephemeris into a PRN history, keeping it sorted and unique by week + TOE.
+ *
+ * @param hist History of the ephemeris' PRN.
+ * @param eph  Finalized ephemeris to insert.
+ * @return 0 if inserted or replaced, 1 if it was a repeat of a stored entry,
+ *         -1 on invalid input or allocation failure.
+ */
+int eph_history_insert(eph_history_t *hist, const rtcm_1019_ephemeris_t *eph)
+{
+    if (!hist || !eph)
+        return -1;
+
+    // Lower bound: first entry with week + TOE >= that of eph
+    size_t lo = 0, hi = hist->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (eph_toe_diff(&hist->eph[mid], eph) < 0.0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < hist->count && eph_toe_diff(&hist->eph[lo], eph) == 0.0)
+    {
+        if (hist->eph[lo].gps_iode == eph->gps_iode)
+            return 1; // Same upload broadcast again
+
+        hist->eph[lo] = *eph; // New upload for the same TOE
+        return 0;
+    }
+
+    if (grow_array((void **)&hist->eph, &hist->cap, hist->count + 1, sizeof(rtcm_1019_ephemeris_t)) != 0)
+        return -1;
+
+    memmove(&hist->eph[lo + 1], &hist->eph[lo], (hist->count - lo) * sizeof(rtcm_1019_ephemeris_t));
+    hist->eph[lo] = *eph;
+    hist->count++;
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Tells whether an ephemeris may be used at a given time.
+ *
+ * @param eph   Ephemeris to check.
+ * @param t_sec Observation time in seconds of the GPS week.
+ * @return true if |t - TOE| <= EPH_MAX_AGE_S (see eph_time_from_toe()).
+ */
+bool eph_is_valid_at(const rtcm_1019_ephemeris_t *eph, double t_sec)
+{
+    return eph && fabs(eph_time_from_toe(eph, t_sec)) <= EPH_MAX_AGE_S;
+}
+
+/// |t - TOE| of history entry @p i, across a week crossover
+static inline double toe_distance(const eph_history_t *hist, size_t i, double t_sec)
+{
+    return fabs(eph_time_from_toe(&hist->eph[i], t_sec));
+}
+
+/**
+ * @brief Returns the valid ephemeris closest in TOE to @p t_sec (binary search).
+ *
+ * @param hist  PRN history.
+ * @param t_sec Observation time in seconds of the GPS week.
+ * @return Selected ephemeris, or NULL if none is within EPH_MAX_AGE_S.
+ */
+const rtcm_1019_ephemeris_t *eph_select(const eph_history_t *hist, double t_sec)
+{
+    size_t cursor = 0;
+    if (!hist || hist->count == 0)
+        return NULL;
+
+    // Lower bound: first entry with TOE >= t, then compare with its left neighbour.
+    // t is placed within half a week of the newest entry, whose week it takes.
+    const rtcm_1019_ephemeris_t *newest = &hist->eph[hist->count - 1];
+    const double t_rel = eph_time_from_toe(newest, t_sec);
+    size_t lo = 0, hi = hist->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (eph_toe_diff(&hist->eph[mid], newest) < t_rel)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    cursor = (lo < hist->count) ? lo : hist->count - 1;
+    return eph_select_cursor(hist, t_sec, &cursor);
+}
+
+/**
+ * @brief Returns the valid ephemeris closest in TOE to @p t_sec, starting at a cursor.
+ *
+ * |t - TOE| is V-shaped over a history sorted by week + TOE that spans less than
+ * half a week around t, so walking from the previous answer towards smaller
+ * distances finds the optimum; with monotonic query times the walk is O(1)
+ * amortized. Ties keep the earlier TOE.
+ *
+ * @param hist   PRN history.
+ * @param t_sec  Observation time in seconds of the GPS week.
+ * @param cursor In: index of the previous answer (any value is accepted).
+ *               Out: index of the closest entry, even if it is not valid.
+ * @return Selected ephemeris, or NULL if none is within EPH_MAX_AGE_S.
+ */
+const rtcm_1019_ephemeris_t *eph_select_cursor(const eph_history_t *hist, double t_sec, size_t *cursor)
+{
+    if (!hist || !cursor || hist->count == 0)
+        return NULL;
+
+    size_t i = (*cursor < hist->count) ? *cursor : hist->count - 1;
+    while (i > 0 && toe_distance(hist, i - 1, t_sec) <= toe_distance(hist, i, t_sec))
+        i--;
+    while (i + 1 < hist->count && toe_distance(hist, i + 1, t_sec) < toe_distance(hist, i, t_sec))
+        i++;
+
+    *cursor = i;
+    return eph_is_valid_at(&hist->eph[i], t_sec) ? &hist->eph[i] : NULL;
+}
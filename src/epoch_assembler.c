@@ -0,0 +1,184 @@
+/**
+ * @file epoch_assembler.c
+ * @brief Groups observation messages into complete epochs as they arrive.
+ *
+ * A receiver sends one epoch as a burst of observation messages (one per
+ * constellation, MSM4 or 1002) sharing the DF004 time, with the multiple
+ * message bit (DF393 / DF005) set on all but the last one. The assembler
+ * collects the burst into one gnss_epoch_t and hands it to its consumer
+ * exactly once:
+ *  - as soon as the last message of the burst arrives (no waiting for the
+ *    next epoch, which matters for live input);
+ *  - when a message with another time shows up (missing end-of-epoch flag);
+ *  - or on epoch_assembler_flush() at end of input.
+ *
+ * The streaming solver (stream_solver.c) solves each epoch in its handler; the
+ * batch solver replays the stored messages, with their stored DF393 / DF005
+ * flags, in arrival order to build its epoch index (receiver_position.c), so
+ * both group epochs the same way and neither sorts.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/obs_store.h"
+#include "../include/epoch_assembler.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Resets an assembler to an empty state.
+ *
+ * @param assembler Assembler to initialize.
+ * @param on_epoch  Called once per complete epoch (may be NULL).
+ * @param ctx       Passed through to @p on_epoch.
+ */
+void epoch_assembler_init(epoch_assembler_t *assembler, epoch_handler_t on_epoch, void *ctx)
+{
+    memset(assembler, 0, sizeof(*assembler));
+    assembler->on_epoch = on_epoch;
+    assembler->ctx = ctx;
+}
+
+/**
+ * @brief Emits the open epoch, if any, and starts an empty one.
+ */
+static void close_epoch(epoch_assembler_t *assembler)
+{
+    gnss_epoch_t *ep = &assembler->epoch;
+    if (!assembler->open)
+        return;
+
+    assembler->open = false;
+    assembler->have_last = true;
+    assembler->last_time_ms = ep->time_ms;
+    assembler->n_epochs++;
+    if (assembler->on_epoch)
+        assembler->on_epoch(ep, assembler->ctx);
+
+    // Only the satellites set need clearing; obs[] and tag[] are read through have[]
+    for (int sat = 1; sat <= MAX_SAT; sat++)
+        ep->have[sat] = false;
+    ep->n_sats = 0;
+    ep->n_msgs = 0;
+    ep->n_duplicates = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief True if @p rec can enter an epoch: valid satellite index and primary pseudorange. */
+static inline bool usable_record(const obs_record_t *rec)
+{
+    return rec->prn >= 1 && rec->prn <= MAX_SAT && rec->pseudorange >= 0.0;
+}
+
+/**
+ * @brief Adds the records of one observation message.
+ *
+ * A message with another time than the open epoch closes it first; a message
+ * for the epoch emitted last is dropped (counted in n_late). Records without a
+ * primary pseudorange (negative) or with a satellite index outside 1–MAX_SAT
+ * are ignored; a message with no other records is handled like a header-only
+ * MSM message, so its time does not split an epoch.
+ *
+ * @param assembler Assembler state.
+ * @param time_ms   DF004 time of the message (GPS milliseconds of the week).
+ * @param recs      Observation records of the message.
+ * @param tags      Caller tag per record, kept in gnss_epoch_t::tag (may be NULL for 0).
+ * @param n_recs    Number of records.
+ * @param more      DF393 / DF005: more messages follow for the same epoch.
+ */
+void epoch_assembler_add(epoch_assembler_t *assembler, uint32_t time_ms, const obs_record_t *recs,
+                         const uint32_t *tags, int n_recs, bool more)
+{
+    gnss_epoch_t *ep = &assembler->epoch;
+    int n_usable = 0;
+    for (int i = 0; i < n_recs; i++)
+        n_usable += usable_record(&recs[i]);
+    if (n_usable == 0)
+    {
+        if (!more)
+            close_epoch(assembler);
+        return;
+    }
+
+    if (assembler->have_last && time_ms == assembler->last_time_ms)
+    {
+        assembler->n_late++;
+        return;
+    }
+    if (assembler->open && ep->time_ms != time_ms)
+        close_epoch(assembler);
+
+    assembler->open = true;
+    ep->time_ms = time_ms;
+    ep->n_msgs++;
+    for (int i = 0; i < n_recs; i++)
+    {
+        int sat = recs[i].prn;
+        if (!usable_record(&recs[i]))
+            continue;
+        if (ep->have[sat])
+        {
+            ep->n_duplicates++;
+            continue;
+        }
+
+        ep->have[sat] = true;
+        ep->obs[sat] = recs[i];
+        ep->tag[sat] = tags ? tags[i] : 0;
+        ep->n_sats++;
+    }
+
+    if (!more)
+        close_epoch(assembler);
+}
+
+/**
+ * @brief Feeds one decoded message to the assembler.
+ *
+ * MSM4 and 1002 messages add their observations (see obs_records_from_msm4()
+ * and obs_records_from_msm1()); other MSM messages only close the open epoch
+ * when their DF393 flag says they are the last of the burst. Everything else
+ * is ignored.
+ *
+ * @param assembler Assembler state.
+ * @param msg       Decoded message from the text parser or the binary decoder.
+ */
+void epoch_assembler_push(epoch_assembler_t *assembler, const rtcm_message_t *msg)
+{
+    if (!assembler || !msg)
+        return;
+
+    if (RTCM_IS_MSM4_OBS(msg->msg_type))
+    {
+        obs_record_t recs[MSM_MAX_SAT];
+        uint8_t n = obs_records_from_msm4(&msg->data.msm4, recs, NULL);
+        epoch_assembler_add(assembler, msg->data.msm4.time_of_pseudorange, recs, NULL, n,
+                            msg->data.msm4.msm_sync_flag != 0);
+        return;
+    }
+
+    if (msg->msg_type == 1002)
+    {
+        obs_record_t recs[MAX_PRN_GPS];
+        uint8_t n = obs_records_from_msm1(&msg->data.msm1, recs);
+        epoch_assembler_add(assembler, msg->data.msm1.time_of_week, recs, NULL, n,
+                            msg->data.msm1.sync_gps_message_flag != 0);
+        return;
+    }
+
+    // Other MSM messages: only the end-of-epoch flag matters here
+    if (RTCM_IS_MSM(msg->msg_type) && msg->data.msm_header.msm_sync_flag == 0)
+        close_epoch(assembler);
+}
+
+/**
+ * @brief Emits the epoch still open at end of input, if any.
+ *
+ * @param assembler Assembler state.
+ */
+void epoch_assembler_flush(epoch_assembler_t *assembler)
+{
+    if (assembler)
+        close_epoch(assembler);
+}
@@ -8,10 +8,14 @@
  */
 
 #include "../include/algo.h"
+#include "../include/log_input.h"
 
 /// Default file path used when user provides no input
 #define DEFAULT_FILE_PATH "example/parsed_log.txt"
 
+/// Default raw binary RTCM3 file path used when user provides no input
+#define DEFAULT_RAW_FILE_PATH "example/raw_log.rtcm3"
+
 /// Maximum number of retry attempts for file input
 #define MAX_RETRIES 3
 
@@ -25,21 +29,22 @@
  *   - Raw mode (`is_parsed = false`): opens the file in binary mode (`"rb"`).
  *
  * @param[in]  is_parsed  True to open a parsed text log file, false for raw binary.
+ * @param[out] path       If non-NULL, receives the path that was opened.
+ * @param[in]  size       Size of @p path.
  * @return FILE* Pointer to the opened file, or NULL on failure after all retries.
- *
- * @todo Implement raw binary RTCM parsing when `is_parsed = false`.
  */
-FILE *file_connect(bool is_parsed)
+FILE *file_connect_path(bool is_parsed, char *path, size_t size)
 {
     char file_path[256];
     FILE *fp = NULL;
+    const char *default_path = is_parsed ? DEFAULT_FILE_PATH : DEFAULT_RAW_FILE_PATH;
 
     for (int attempt = 1; attempt <= MAX_RETRIES; ++attempt)
     {
         printf(COLOR_BLUE "\nEnter the path to the %s RTCM file,\n"
                           "or press Enter to use the default (%s):\n> " COLOR_RESET,
                is_parsed ? "parsed text" : "raw binary",
-               DEFAULT_FILE_PATH);
+               default_path);
 
         // Get user input
         if (fgets(file_path, sizeof(file_path), stdin) == NULL)
@@ -56,23 +61,18 @@ FILE *file_connect(bool is_parsed)
         // If blank, use default path
         if (strlen(file_path) == 0)
         {
-            snprintf(file_path, sizeof(file_path), "%s", DEFAULT_FILE_PATH);
+            snprintf(file_path, sizeof(file_path), "%s", default_path);
         }
 
         // Attempt to open file
-        if (is_parsed)
-        {
-            fp = fopen(file_path, "r"); ///< Parsed text log
-        }
-        else
-        {
-            fp = fopen(file_path, "rb"); ///< Raw binary log
-            // @todo Add logic for parsing raw RTCM binary streams
-        }
+        // Parsed text or raw binary log; gzip / zstd logs are decompressed on the fly
+        fp = log_open(file_path, !is_parsed);
 
         if (fp != NULL)
         {
             printf(COLOR_GREEN "Successfully opened file: %s\n" COLOR_RESET, file_path);
+            if (path && size > 0)
+                snprintf(path, size, "%s", file_path);
             return fp;
         }
 
@@ -85,3 +85,14 @@ FILE *file_connect(bool is_parsed)
     fprintf(stderr, COLOR_RED "Failed to open file after %d attempts. Exiting.\n" COLOR_RESET, MAX_RETRIES);
     return NULL;
 }
+
+/**
+ * @brief Open an RTCM log file for reading (see file_connect_path()).
+ *
+ * @param[in] is_parsed True to open a parsed text log file, false for raw binary.
+ * @return FILE* Pointer to the opened file, or NULL on failure after all retries.
+ */
+FILE *file_connect(bool is_parsed)
+{
+    return file_connect_path(is_parsed, NULL, 0);
+}
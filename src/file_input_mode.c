@@ -17,163 +17,218 @@
 #include "../include/algo.h"
 #include "../include/df_parser.h"
 #include "../include/rtcm_reader.h"
+#include "../include/rtcm3_decoder.h"
+#include "../include/obs_store.h"
 #include "../include/satellites.h"
 #include "../include/receiver.h"
 #include "../include/plots.h"
-
-extern int n_times; // total epochs found during position estimation
+#include "../include/obs_cache.h"
+#include "../include/perf_stats.h"
+#include "../include/batch_cli.h"
+#include "../include/gnss_context.h"
+#include "../include/log_input.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Main loop for processing a recorded RTCM input file.
+ * @brief Runs the batch stages on an opened RTCM log and writes the selected outputs.
  *
- * This function opens the specified RTCM file and iteratively processes epochs
- * by reading and parsing supported RTCM messages (e.g., MSM4). It prepares the
- * observation data and then runs the solver and coordinate conversions.
+ * Reads every supported message (or loads the parsed log's cache) into @p ctx,
+ * sorts the observations per satellite, positions the satellites, solves every
+ * epoch and writes the requested tracks, plot files and run statistics into @p out_dir.
  *
- * @param is_parsed Set to true if the file is in pre-parsed (text) format.
- * @return 0 on success, 1 on error (open, read, sort, position, etc.).
+ * @param ctx       Empty session.
+ * @param fp        Log opened for reading.
+ * @param path      Path of the log (cache key and run statistics label).
+ * @param is_parsed True for a PyRTCM text log, false for raw binary RTCM3.
+ * @param out_dir   Existing output directory.
+ * @param outputs   BATCH_OUTPUT_* / TRACK_SINK_* flags.
+ * @return 0 on success, 1 on error (read, sort, position, etc.).
  */
-
-int file_input_mode(bool is_parsed)
+static int run_batch_stages(gnss_context_t *ctx, FILE *fp, const char *path, bool is_parsed,
+                            const char *out_dir, unsigned outputs)
 {
-    // Step 1: Attempt to open the RTCM file
-    FILE *fp = file_connect(is_parsed);
-    if (fp == NULL)
+    // Step 2: Loop through each epoch in the file and parse teh pseudorange and eph data
+    // At the end of this loop, all observations and ephemerides are in the session's observation store and eph_history, ready for processing
+    // A parsed log that was read before is loaded from its binary cache instead
+    perf_stage_begin(PERF_STAGE_INGEST);
+    if (is_parsed && obs_cache_load(ctx, path) == 0)
     {
-        return 1; // Failed to open file
+        printf(COLOR_GREEN "Loaded observations and ephemerides from cache: %s%s\n" COLOR_RESET, path, OBS_CACHE_SUFFIX);
     }
-
-    // Step 2: Loop through each epoch in the file and parse teh pseudorange and eph data
-    // At the end of this loop, all MSM4 and ephemeris data will be stored in global tables, ready for processing
-    int status = read_next_rtcm_message(fp);
-    if (status != 0)
+    else
     {
-        fprintf(stderr, COLOR_YELLOW "Warning: Error while reading RTCM message.\n" COLOR_RESET);
-        fclose(fp);
-        return 1; // Error reading message
+        int status = is_parsed ? read_next_rtcm_message(fp, NULL, ctx) : rtcm3_read_stream(fp, NULL, ctx);
+        if (status != 0)
+        {
+            fprintf(stderr, COLOR_YELLOW "Warning: Error while reading RTCM message.\n" COLOR_RESET);
+            fclose(fp);
+            return 1; // Error reading message
+        }
+        if (is_parsed && obs_cache_save(ctx, path) == -1)
+            fprintf(stderr, COLOR_YELLOW "Warning: Could not write the observation cache for %s.\n" COLOR_RESET, path);
     }
+    perf_stage_end(PERF_STAGE_INGEST);
 
     // Step 3: Sort through the stored ephemeris and MSM4 data to prepare for position solving
-    int sat_sorter_status = sort_satellites(eph_history, msm4_history, msm1_history);
+    perf_stage_begin(PERF_STAGE_SORT);
+    int sat_sorter_status = sort_satellites(ctx);
+    perf_stage_end(PERF_STAGE_SORT);
     if (sat_sorter_status != 0)
     {
         fprintf(stderr, COLOR_RED "Error: Failed to sort satellites.\n" COLOR_RESET);
-        fclose(fp);
         return 1; // Error sorting satellites
     }
     else
     {
         printf(COLOR_GREEN "Successfully sorted satellites.\n" COLOR_RESET);
-        // print_gps_list(); // Print the sorted satellite data for debugging
+        // print_gps_list(ctx); // Print the sorted satellite data for debugging
     }
 
-    // Step 4: Find satellite positions in ECI coordinates and convert to ECEF
-    int eci_status = satellite_position_eci(gps_list);
+    // Step 4: Find satellite positions in ECI coordinates and ECEF (one batched pass)
+    perf_stage_begin(PERF_STAGE_SATELLITE_ECI_ECEF);
+    int eci_status = satellite_position_eci(ctx);
+    perf_stage_end(PERF_STAGE_SATELLITE_ECI_ECEF);
     if (eci_status != 0)
     {
-        fprintf(stderr, COLOR_RED "Error: Failed to find satellite positions in ECI.\n" COLOR_RESET);
-        fclose(fp);
+        fprintf(stderr, COLOR_RED "Error: Failed to find satellite positions in ECI/ECEF.\n" COLOR_RESET);
         return 1; // Error finding satellite positions
     }
     else
     {
-        printf(COLOR_GREEN "Successfully found satellite positions in ECI.\n" COLOR_RESET);
+        printf(COLOR_GREEN "Successfully found satellite positions in ECI and ECEF.\n" COLOR_RESET);
     }
 
-    int ecef_status = satellite_position_ecef(gps_list);
-    if (ecef_status != 0)
+    // Step 5: Estimate receiver position in ECEF coordinates using least squares then convert to geodetic coordinates
+    // Fixes are streamed to the CSV / NMEA / KML tracks while the epochs are being solved
+    perf_stage_begin(PERF_STAGE_RECEIVER);
+    track_sink_t sink;
+    track_sink_open(&sink, out_dir, outputs & (TRACK_SINK_CSV | TRACK_SINK_NMEA | TRACK_SINK_KML));
+    ctx->track_sink = &sink;
+    int position_status = estimate_receiver_positions(ctx);
+    ctx->track_sink = NULL;
+    if (track_sink_close(&sink) != 0)
+        fprintf(stderr, "[ERR] Failed to write the receiver CSV / NMEA / KML tracks.\n");
+    perf_stage_end(PERF_STAGE_RECEIVER);
+    if (position_status != 0)
     {
-        fprintf(stderr, COLOR_RED "Error: Failed to convert satellite positions to ECEF.\n" COLOR_RESET);
-        fclose(fp);
-        return 1; // Error converting satellite positions
+        fprintf(stderr, COLOR_RED "Error: Failed to estimate receiver position.\n" COLOR_RESET);
+        return 1; // Error estimating receiver position
     }
     else
     {
-        printf(COLOR_GREEN "Successfully converted satellite positions to ECEF.\n" COLOR_RESET);
+        printf(COLOR_GREEN "Successfully estimated receiver position.\n" COLOR_RESET);
     }
 
-    // Step 5: Estimate full orbit for each satellite
-    int orbit_status = satellite_orbit_eci(gps_list);
+    // Step 6: Sweep the full orbit of each satellite, only when it is plotted (cached per ephemeris)
+    perf_stage_begin(PERF_STAGE_ORBIT);
+    int orbit_status = (outputs & BATCH_OUTPUT_PLOTS) ? satellite_orbit_eci(ctx) : 0;
+    perf_stage_end(PERF_STAGE_ORBIT);
     if (orbit_status != 0)
     {
         fprintf(stderr, COLOR_RED "Error: Failed to estimate satellite orbits in ECI.\n" COLOR_RESET);
-        fclose(fp);
         return 1; // Error estimating satellite orbits
     }
-    else
+    else if (outputs & BATCH_OUTPUT_PLOTS)
     {
         printf(COLOR_GREEN "Successfully estimated satellite orbits in ECI.\n" COLOR_RESET);
     }
 
-    // Step 6: Estimate receiver position in ECEF coordinates using least squares then convert to geodetic coordinates
-    int position_status = estimate_receiver_positions();
-    if (position_status != 0)
-    {
-        fprintf(stderr, COLOR_RED "Error: Failed to estimate receiver position.\n" COLOR_RESET);
-        fclose(fp);
-        return 1; // Error estimating receiver position
-    }
-    else
-    {
-        printf(COLOR_GREEN "Successfully estimated receiver position.\n" COLOR_RESET);
-    }
+    // Step 7: Write the receiver and satellite tracks for gnuplot (concurrently)
+    int output_status = 0;
+    perf_stage_begin(PERF_STAGE_OUTPUT);
+    if ((outputs & BATCH_OUTPUT_PLOTS) && write_all_plots(ctx, out_dir) != 0)
+        output_status = 1;
+    perf_stage_end(PERF_STAGE_OUTPUT);
 
-    // Step 7: Plot all satellite positions and receiver position on a gnuplot
-    if (write_receiver_track_ecef("plots/receiver_track_ecef.dat", n_times) == 0)
+    // Step 8: Stage timings and counters of this run as JSON
+    if (outputs & BATCH_OUTPUT_STATS)
     {
-        printf("[OK] Receiver track written successfully.\n");
-    }
-    else
-    {
-        fprintf(stderr, "[ERR] Failed to write receiver track data.\n");
+        char stats_path[256];
+        snprintf(stats_path, sizeof(stats_path), "%s/run_stats.json", out_dir);
+        if (perf_write_json(stats_path, path) == 0)
+        {
+            printf("[OK] Run statistics written successfully.\n");
+        }
+        else
+        {
+            fprintf(stderr, "[ERR] Failed to write run statistics.\n");
+            output_status = 1;
+        }
     }
 
-    if (write_sat_orbits("plots/sat_track_ecef.dat") == 0)
-    {
-        printf("[OK] Satellite orbits written successfully.\n");
-    }
-    else
-    {
-        fprintf(stderr, "[ERR] Failed to write satellite orbits data.\n");
-    }
+    return output_status;
+}
 
-    if (write_receiver_track_geo("plots/receiver_track_geo.dat", n_times) == 0)
-    {
-        printf("[OK] Receiver Geo positions written successfully.\n");
-    }
-    else
-    {
-        fprintf(stderr, "[ERR] Failed to write receiver geo position data.\n");
-    }
-    if (write_receiver_ecef_epoch_km("plots/receiver_ecef_epoch.dat", n_times) == 0)
-    {
-        printf("[OK] Receiver ECEF (km) vs epoch written successfully.\n");
-    }
-    else
-    {
-        fprintf(stderr, "[ERR] Failed to write receiver ECEF (km) vs epoch.\n");
-    }
+/**
+ * @brief Runs the batch pipeline on an opened RTCM log in a session of its own.
+ *
+ * See run_batch_stages(); the session is released before returning.
+ *
+ * @param fp        Log opened for reading; closed before returning.
+ * @param path      Path of the log (cache key and run statistics label).
+ * @param is_parsed True for a PyRTCM text log, false for raw binary RTCM3.
+ * @param out_dir   Existing output directory.
+ * @param outputs   BATCH_OUTPUT_* / TRACK_SINK_* flags.
+ * @return 0 on success, 1 on error (read, sort, position, etc.).
+ */
+static int run_batch_pipeline(FILE *fp, const char *path, bool is_parsed, const char *out_dir, unsigned outputs)
+{
+    gnss_context_t ctx;
+    gnss_context_init(&ctx);
+    int status = run_batch_stages(&ctx, fp, path, is_parsed, out_dir, outputs);
+    gnss_context_free(&ctx);
+    fclose(fp);
+    return status;
+}
 
-    if (write_sat_xyz_km("plots/sat_xyz_km.dat") == 0)
-    {
-        printf("[OK] Satellite XY (km) written successfully.\n");
-    }
-    else
-    {
-        fprintf(stderr, "[ERR] Failed to write satellite XY (km).\n");
-    }
+//////////////////////////////////////////////////////////////////////////////////////////////
 
-    if (write_pseudorange_time_km("plots/pseudorange_time_km.dat") == 0)
+/**
+ * @brief Main loop for processing a recorded RTCM input file.
+ *
+ * This function opens the specified RTCM file and iteratively processes epochs
+ * by reading and parsing supported RTCM messages (e.g., MSM4). It prepares the
+ * observation data and then runs the solver and coordinate conversions.
+ *
+ * @param is_parsed Set to true if the file is in pre-parsed (text) format,
+ *                  false for a raw binary RTCM3 stream.
+ * @return 0 on success, 1 on error (open, read, sort, position, etc.).
+ */
+
+int file_input_mode(bool is_parsed)
+{
+    // Step 1: Attempt to open the RTCM file
+    perf_reset();
+    char path[256];
+    FILE *fp = file_connect_path(is_parsed, path, sizeof(path));
+    if (fp == NULL)
     {
-        printf("[OK] Pseudorange vs epoch (km) written successfully.\n");
+        return 1; // Failed to open file
     }
-    else
+
+    return run_batch_pipeline(fp, path, is_parsed, "plots", BATCH_OUTPUT_ALL);
+}
+
+/**
+ * @brief Processes one RTCM log without prompting (command line batch mode).
+ *
+ * @param path      Log to process.
+ * @param is_parsed True for a PyRTCM text log, false for raw binary RTCM3.
+ * @param out_dir   Existing output directory.
+ * @param outputs   BATCH_OUTPUT_* / TRACK_SINK_* flags of the files to write.
+ * @return 0 on success, 1 if the log could not be opened or processed or an
+ *         output could not be written.
+ */
+int batch_process_file(const char *path, bool is_parsed, const char *out_dir, unsigned outputs)
+{
+    perf_reset();
+    FILE *fp = log_open(path, !is_parsed);
+    if (fp == NULL)
     {
-        fprintf(stderr, "[ERR] Failed to write pseudorange vs epoch (km).\n");
+        fprintf(stderr, COLOR_RED "Error: Could not open %s: %s\n" COLOR_RESET, path, strerror(errno));
+        return 1;
     }
-
-    fclose(fp);
-    return 0;
+    printf(COLOR_GREEN "Opened %s (%s).\n" COLOR_RESET, path, is_parsed ? "PyRTCM text" : "binary RTCM3");
+    return run_batch_pipeline(fp, path, is_parsed, out_dir, outputs);
 }
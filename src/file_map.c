@@ -0,0 +1,82 @@
+/**
+ * @file file_map.c
+ * @brief Memory-maps regular input files for the zero-copy text and binary readers.
+ *
+ * read_next_rtcm_message() and rtcm3_read_stream() first try to map their input:
+ * a mapped log is scanned in place (one line / frame span at a time) with a
+ * sequential-access hint, so the kernel reads ahead and drops pages behind the
+ * scan. Inputs that cannot be mapped (pipes, terminals, empty files, Windows)
+ * make file_map_open() fail and the readers fall back to stdio.
+ */
+
+#include "../include/algo.h"
+#include "../include/file_map.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Maps the rest of @p fp (from its current position to the end) read-only.
+ *
+ * Bytes already consumed through @p fp (including an ungetc()'d byte, which
+ * rewinds the reported position) are not part of the span.
+ *
+ * @param fp  Open regular file.
+ * @param map Output mapping; release with file_map_close().
+ * @return 0 on success, -1 if the input cannot be mapped (caller should use stdio).
+ */
+int file_map_open(FILE *fp, file_map_t *map)
+{
+    memset(map, 0, sizeof(*map));
+
+#ifdef _WIN32
+    (void)fp;
+    return -1;
+#else
+    if (!fp)
+        return -1;
+
+    int fd = fileno(fp);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return -1;
+
+    off_t pos = ftello(fp);
+    if (pos < 0 || st.st_size <= pos || (uintmax_t)st.st_size > SIZE_MAX)
+        return -1;
+
+    size_t map_len = (size_t)st.st_size;
+    void *base = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+        return -1;
+
+    // Readers walk the file once, front to back
+    madvise(base, map_len, MADV_SEQUENTIAL);
+
+    map->base = base;
+    map->map_len = map_len;
+    map->data = (const uint8_t *)base + pos;
+    map->len = map_len - (size_t)pos;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Unmaps a mapping made by file_map_open() (no-op on an empty one).
+ *
+ * @param map Mapping to release.
+ */
+void file_map_close(file_map_t *map)
+{
+    if (!map || !map->base)
+        return;
+
+#ifndef _WIN32
+    munmap(map->base, map->map_len);
+#endif
+    memset(map, 0, sizeof(*map));
+}
@@ -0,0 +1,279 @@
+/**
+ * @file gnss_context.c
+ * @brief Session state of the resolver: stored messages and solver tables.
+ *
+ * A gnss_context_t replaces the file-scope tables the modules used to share
+ * (observation store, ephemeris histories, orbit caches, per-satellite series,
+ * satellite and receiver positions). Every stage takes the context it works
+ * on, so several logs can be processed at once in one process.
+ *
+ * The solver tables are heap arrays sized to the session's data: the
+ * per-satellite series to the satellite's sample and TOE counts, the receiver fixes
+ * to the epoch count. This module owns their allocation; each stage calls the
+ * matching gnss_context_alloc_* function before filling its tables.
+ */
+
+#include "../include/algo.h"
+#include "../include/gnss_context.h"
+
+#include <limits.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Frees @p n_cols heap columns and resets them to NULL. */
+static void free_columns(double **const cols[], size_t n_cols)
+{
+    for (size_t i = 0; i < n_cols; i++)
+    {
+        free(*cols[i]);
+        *cols[i] = NULL;
+    }
+}
+
+/**
+ * @brief Replaces @p n_cols heap columns with zeroed arrays of @p n doubles.
+ *
+ * @return 0 on success (all columns NULL if @p n is 0), -1 on allocation
+ *         failure (all columns NULL).
+ */
+static int alloc_columns(double **const cols[], size_t n_cols, size_t n)
+{
+    free_columns(cols, n_cols);
+    if (n == 0)
+        return 0;
+
+    for (size_t i = 0; i < n_cols; i++)
+    {
+        *cols[i] = calloc(n, sizeof(double));
+        if (!*cols[i])
+        {
+            free_columns(cols, n_cols);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// Ephemeris series columns of a gps_satellite_data_t
+#define SERIES_EPH_COLUMNS(sat) {&(sat)->eccentricities, &(sat)->inclinations, &(sat)->mean_anomalies, \
+                                 &(sat)->semi_major_axes, &(sat)->right_ascension_of_ascending_node,   \
+                                 &(sat)->argument_of_periapsis, &(sat)->times_of_ephemeris}
+
+/** @brief Releases the series of one satellite (counts back to 0). */
+static void free_series(gps_satellite_data_t *sat)
+{
+    double **const cols[] = SERIES_EPH_COLUMNS(sat);
+    free_columns(cols, sizeof(cols) / sizeof(cols[0]));
+    free(sat->pseudoranges);
+    free(sat->pseudoranges_l5);
+    free(sat->cnrs);
+    free(sat->range_rates);
+    free(sat->times_of_pseudorange);
+    memset(sat, 0, sizeof(*sat));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Initializes an empty context with default settings.
+ *
+ * @param ctx Context to initialize.
+ */
+void gnss_context_init(gnss_context_t *ctx)
+{
+    if (ctx)
+        memset(ctx, 0, sizeof(*ctx));
+}
+
+/** @brief Releases the orbit sweep of one satellite. */
+static void free_orbit_sweep(sat_orbit_sweep_t *sweep)
+{
+    double **const cols[] = {&sweep->p, &sweep->q, &sweep->w, &sweep->x, &sweep->y, &sweep->z};
+    free_columns(cols, sizeof(cols) / sizeof(cols[0]));
+    memset(sweep, 0, sizeof(*sweep));
+}
+
+/**
+ * @brief Releases every solver table filled by sort_satellites() and the later stages.
+ *
+ * The stored messages are kept, so the solve can be run again. The orbit
+ * sweeps only depend on the ephemerides and are kept too.
+ *
+ * @param ctx Session state.
+ */
+void gnss_context_free_solution(gnss_context_t *ctx)
+{
+    if (!ctx)
+        return;
+
+    for (int prn = 0; prn <= MAX_SAT; prn++)
+    {
+        free_series(&ctx->gps_list[prn]);
+
+        sat_eci_history_t *eci = &ctx->sat_eci_positions[prn];
+        sat_ecef_history_t *ecef = &ctx->sat_ecef_positions[prn];
+        double **const cols[] = {&eci->x, &eci->y, &eci->z, &ecef->x, &ecef->y, &ecef->z,
+                                 &ecef->vx, &ecef->vy, &ecef->vz, &ecef->clk, &ecef->t_ms};
+        free_columns(cols, sizeof(cols) / sizeof(cols[0]));
+    }
+
+    estimated_position_t *pos = &ctx->estimated_positions_ecef;
+    latlonalt_position_t *lla = &ctx->latlonalt_positions;
+    double **const cols[] = {&pos->x, &pos->y, &pos->z, &pos->vx, &pos->vy, &pos->vz, &pos->clock_drift,
+                             &lla->lat, &lla->lon, &lla->alt};
+    free_columns(cols, sizeof(cols) / sizeof(cols[0]));
+    ctx->n_times = 0;
+}
+
+/**
+ * @brief Releases every table of a context; it is empty and reusable afterwards.
+ *
+ * The settings (n_threads, signal_mode, solver_mode, track_sink) are kept.
+ *
+ * @param ctx Session state.
+ */
+void gnss_context_free(gnss_context_t *ctx)
+{
+    if (!ctx)
+        return;
+
+    gnss_context_free_solution(ctx);
+    obs_store_free(&ctx->obs_store);
+    for (int prn = 0; prn <= MAX_SAT; prn++)
+    {
+        free(ctx->eph_history[prn].eph);
+        orbit_cache_free(&ctx->orbit_cache[prn]);
+        free_orbit_sweep(&ctx->orbit_sweep[prn]);
+    }
+
+    int n_threads = ctx->n_threads;
+    gnss_signal_mode_t signal_mode = ctx->signal_mode;
+    rx_solver_mode_t solver_mode = ctx->solver_mode;
+    track_sink_t *track_sink = ctx->track_sink;
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->n_threads = n_threads;
+    ctx->signal_mode = signal_mode;
+    ctx->solver_mode = solver_mode;
+    ctx->track_sink = track_sink;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Sizes the series of satellite @p prn, zeroed.
+ *
+ * @param ctx            Session state.
+ * @param prn            Satellite index (1..MAX_SAT, see gnss_sat_index()).
+ * @param n_pseudoranges Observation samples.
+ * @param n_ephemerides  Unique TOEs of the ephemeris series.
+ * @return 0 on success, -1 on a bad satellite index or allocation failure (series left empty).
+ */
+int gnss_context_alloc_series(gnss_context_t *ctx, int prn, size_t n_pseudoranges, size_t n_ephemerides)
+{
+    if (!ctx || prn < 1 || prn > MAX_SAT)
+        return -1;
+
+    gps_satellite_data_t *sat = &ctx->gps_list[prn];
+    free_series(sat);
+    sat->prn = prn;
+
+    double **const cols[] = SERIES_EPH_COLUMNS(sat);
+    if (alloc_columns(cols, sizeof(cols) / sizeof(cols[0]), n_ephemerides) != 0)
+        return -1;
+    if (n_pseudoranges > 0)
+    {
+        sat->pseudoranges = calloc(n_pseudoranges, sizeof(double));
+        sat->pseudoranges_l5 = calloc(n_pseudoranges, sizeof(double));
+        sat->cnrs = calloc(n_pseudoranges, sizeof(uint8_t));
+        sat->range_rates = calloc(n_pseudoranges, sizeof(double));
+        sat->times_of_pseudorange = calloc(n_pseudoranges, sizeof(uint32_t));
+        if (!sat->pseudoranges || !sat->pseudoranges_l5 || !sat->cnrs || !sat->range_rates ||
+            !sat->times_of_pseudorange)
+        {
+            free_series(sat);
+            sat->prn = prn;
+            return -1;
+        }
+    }
+    sat->n_pseudoranges = n_pseudoranges;
+    sat->n_ephemerides = n_ephemerides;
+    return 0;
+}
+
+/**
+ * @brief Sizes the satellite ECI / ECEF tables to the gps_list series, zeroed.
+ *
+ * @param ctx Session state (series already sorted).
+ * @return 0 on success, -1 on allocation failure.
+ */
+int gnss_context_alloc_sat_positions(gnss_context_t *ctx)
+{
+    if (!ctx)
+        return -1;
+
+    for (int prn = 0; prn <= MAX_SAT; prn++)
+    {
+        sat_eci_history_t *eci = &ctx->sat_eci_positions[prn];
+        sat_ecef_history_t *ecef = &ctx->sat_ecef_positions[prn];
+        double **const cols[] = {&eci->x, &eci->y, &eci->z, &ecef->x, &ecef->y, &ecef->z,
+                                 &ecef->vx, &ecef->vy, &ecef->vz, &ecef->clk, &ecef->t_ms};
+        if (alloc_columns(cols, sizeof(cols) / sizeof(cols[0]), ctx->gps_list[prn].n_pseudoranges) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sizes the orbit sweep of satellite @p prn to @p n_points, zeroed and not valid.
+ *
+ * Buffers that already have that size are reused.
+ *
+ * @param ctx      Session state.
+ * @param prn      Satellite index.
+ * @param n_points Points of the sweep.
+ * @return 0 on success, -1 on a bad satellite index or allocation failure (sweep left empty).
+ */
+int gnss_context_alloc_orbit_sweep(gnss_context_t *ctx, int prn, size_t n_points)
+{
+    if (!ctx || prn < 1 || prn > MAX_SAT)
+        return -1;
+
+    sat_orbit_sweep_t *sweep = &ctx->orbit_sweep[prn];
+    sweep->valid = false;
+    double **const cols[] = {&sweep->p, &sweep->q, &sweep->w, &sweep->x, &sweep->y, &sweep->z};
+    if (sweep->n_points == n_points && sweep->p)
+    {
+        for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+            memset(*cols[i], 0, n_points * sizeof(double));
+        return 0;
+    }
+
+    sweep->n_points = 0;
+    if (alloc_columns(cols, sizeof(cols) / sizeof(cols[0]), n_points) != 0)
+        return -1;
+    sweep->n_points = n_points;
+    return 0;
+}
+
+/**
+ * @brief Sizes the receiver ECEF and geodetic tables to @p n_epochs, zeroed.
+ *
+ * @param ctx      Session state.
+ * @param n_epochs Epochs to solve; stored as ctx->n_times.
+ * @return 0 on success, -1 on allocation failure (n_times left at 0).
+ */
+int gnss_context_alloc_fixes(gnss_context_t *ctx, size_t n_epochs)
+{
+    if (!ctx || n_epochs > INT_MAX)
+        return -1;
+
+    estimated_position_t *pos = &ctx->estimated_positions_ecef;
+    latlonalt_position_t *lla = &ctx->latlonalt_positions;
+    double **const cols[] = {&pos->x, &pos->y, &pos->z, &pos->vx, &pos->vy, &pos->vz, &pos->clock_drift,
+                             &lla->lat, &lla->lon, &lla->alt};
+    ctx->n_times = 0;
+    if (alloc_columns(cols, sizeof(cols) / sizeof(cols[0]), n_epochs) != 0)
+        return -1;
+    ctx->n_times = (int)n_epochs;
+    return 0;
+}
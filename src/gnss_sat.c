@@ -0,0 +1,206 @@
+/**
+ * @file gnss_sat.c
+ * @brief Satellite keys of the multi-constellation pipeline: (system, PRN) <-> satellite index.
+ *
+ * The stores, orbit tables and solvers index their per-satellite tables with one
+ * compact 1-based satellite index (1..MAX_SAT) instead of a [system][PRN] grid,
+ * so a table costs one slot per satellite that can exist, not four times the
+ * largest PRN range. GPS comes first, so GPS PRN n is satellite index n.
+ *
+ * Also maps RTCM message numbers to their constellation, converts the MSM
+ * epoch times of every constellation to GPS milliseconds of week, the time
+ * scale all stored observations share, and forms the pseudorange the solver
+ * uses in each signal mode.
+ */
+
+#include "../include/algo.h"
+#include "../include/gnss_sat.h"
+
+/// Highest PRN of each constellation, in gnss_sys_t order
+static const int sys_max_prn[GNSS_SYS_COUNT] = {MAX_PRN_GPS, MAX_PRN_GLO, MAX_PRN_GAL, MAX_PRN_BDS};
+
+/// RINEX system letter of each constellation, in gnss_sys_t order
+static const char sys_letter[GNSS_SYS_COUNT] = {'G', 'R', 'E', 'C'};
+
+#define MS_PER_DAY 86400000u
+#define MS_PER_WEEK (7u * MS_PER_DAY)
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Satellite index of the first PRN of @p sys minus one. */
+static int sys_base(gnss_sys_t sys)
+{
+    int base = 0;
+    for (int s = 0; s < (int)sys; s++)
+        base += sys_max_prn[s];
+    return base;
+}
+
+/**
+ * @brief Satellite index of PRN @p prn of constellation @p sys.
+ *
+ * @return 1..MAX_SAT, or 0 if the system or PRN is out of range.
+ */
+int gnss_sat_index(gnss_sys_t sys, int prn)
+{
+    if (sys < 0 || sys >= GNSS_SYS_COUNT || prn < 1 || prn > sys_max_prn[sys])
+        return 0;
+    return sys_base(sys) + prn;
+}
+
+/** @brief Constellation of satellite index @p sat, or GNSS_SYS_NONE if out of range. */
+gnss_sys_t gnss_sat_sys(int sat)
+{
+    if (sat < 1)
+        return GNSS_SYS_NONE;
+    for (int s = 0; s < GNSS_SYS_COUNT; s++)
+    {
+        if (sat <= sys_max_prn[s])
+            return (gnss_sys_t)s;
+        sat -= sys_max_prn[s];
+    }
+    return GNSS_SYS_NONE;
+}
+
+/** @brief PRN (slot number for GLONASS) of satellite index @p sat, or 0 if out of range. */
+int gnss_sat_prn(int sat)
+{
+    gnss_sys_t sys = gnss_sat_sys(sat);
+    return sys == GNSS_SYS_NONE ? 0 : sat - sys_base(sys);
+}
+
+/**
+ * @brief Formats satellite index @p sat as a RINEX satellite name ("G05", "R12", "E11", "C23").
+ *
+ * @param sat  Satellite index.
+ * @param name Output buffer.
+ * @return @p name ("???" if @p sat is out of range).
+ */
+const char *gnss_sat_name(int sat, char name[GNSS_SAT_NAME_LEN])
+{
+    gnss_sys_t sys = gnss_sat_sys(sat);
+    if (sys == GNSS_SYS_NONE)
+        snprintf(name, GNSS_SAT_NAME_LEN, "???");
+    else
+    {
+        int prn = gnss_sat_prn(sat);
+        name[0] = sys_letter[sys];
+        name[1] = (char)('0' + prn / 10);
+        name[2] = (char)('0' + prn % 10);
+        name[3] = '\0';
+    }
+    return name;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Constellation of an RTCM observation or ephemeris message number.
+ *
+ * @return The system of 1001–1004 / 1019 / 107x (GPS), 1009–1012 / 1020 / 108x
+ *         (GLONASS), 1045 / 1046 / 109x (Galileo) and 1042 / 112x (BeiDou),
+ *         GNSS_SYS_NONE for anything else.
+ */
+gnss_sys_t gnss_msg_sys(unsigned msg_type)
+{
+    if ((msg_type >= 1001 && msg_type <= 1004) || msg_type == 1019 || (msg_type >= 1071 && msg_type <= 1077))
+        return GNSS_GPS;
+    if ((msg_type >= 1009 && msg_type <= 1012) || msg_type == 1020 || (msg_type >= 1081 && msg_type <= 1087))
+        return GNSS_GLO;
+    if (msg_type == 1045 || msg_type == 1046 || (msg_type >= 1091 && msg_type <= 1097))
+        return GNSS_GAL;
+    if (msg_type == 1042 || (msg_type >= 1121 && msg_type <= 1127))
+        return GNSS_BDS;
+    return GNSS_SYS_NONE;
+}
+
+/**
+ * @brief Converts an MSM epoch time to GPS milliseconds of week.
+ *
+ * GPS (DF004) and Galileo (DF248) already count GPS-aligned milliseconds of
+ * week; BeiDou (DF427) runs GNSS_BDT_OFFSET_S behind. GLONASS (DF034) counts
+ * milliseconds of the Moscow day (UTC + 3 h) and needs the day of week (DF416).
+ *
+ * @param sys        Constellation of the MSM message.
+ * @param epoch_time DF004 / DF034 / DF248 / DF427 epoch time (ms).
+ * @param glo_day    DF416 day of week (GLONASS only, 0 = Sunday).
+ * @return Epoch time in GPS milliseconds of week.
+ */
+uint32_t gnss_epoch_to_gps_ms(gnss_sys_t sys, uint32_t epoch_time, uint8_t glo_day)
+{
+    switch (sys)
+    {
+    case GNSS_BDS:
+        return (epoch_time + GNSS_BDT_OFFSET_S * 1000u) % MS_PER_WEEK;
+    case GNSS_GLO:
+    {
+        uint64_t t = (uint64_t)(glo_day % 7u) * MS_PER_DAY + epoch_time + MS_PER_WEEK - 3u * 3600000u +
+                     GNSS_GPS_UTC_LEAP_S * 1000u;
+        return (uint32_t)(t % MS_PER_WEEK);
+    }
+    default:
+        return epoch_time;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Signal mode requested by the GPS_RESOLVER_SIGNALS environment variable.
+ *
+ * @return GNSS_SIGNALS_IFLC for "iflc", else GNSS_SIGNALS_L1.
+ */
+gnss_signal_mode_t configured_signal_mode(void)
+{
+    const char *env = getenv("GPS_RESOLVER_SIGNALS");
+    return (env && strcmp(env, "iflc") == 0) ? GNSS_SIGNALS_IFLC : GNSS_SIGNALS_L1;
+}
+
+/**
+ * @brief Ionosphere-free combination of a primary and an L5-band pseudorange.
+ *
+ * (f1^2 P1 - f5^2 P5) / (f1^2 - f5^2): removes the first-order ionospheric
+ * delay at about three times the noise of P1.
+ *
+ * @param sys        Constellation (sets f1: B1I for BeiDou, L1 / E1 otherwise).
+ * @param pr_primary Primary-signal pseudorange (m), < 0 if missing.
+ * @param pr_l5      L5 / E5a / B2a pseudorange (m), < 0 if missing.
+ * @return The combination (m), or -1 if a pseudorange is missing or @p sys has no L5 band.
+ */
+double gnss_iono_free(gnss_sys_t sys, double pr_primary, double pr_l5)
+{
+    if (pr_primary < 0.0 || pr_l5 < 0.0 || (sys != GNSS_GPS && sys != GNSS_GAL && sys != GNSS_BDS))
+        return -1.0;
+
+    const double f1 = sys == GNSS_BDS ? GNSS_FREQ_B1I : GNSS_FREQ_L1;
+    const double g1 = f1 * f1, g5 = GNSS_FREQ_L5 * GNSS_FREQ_L5;
+    return (g1 * pr_primary - g5 * pr_l5) / (g1 - g5);
+}
+
+/**
+ * @brief Pseudorange the solver uses for one satellite in signal mode @p mode.
+ *
+ * @return @p pr_primary in GNSS_SIGNALS_L1 (and GNSS_SIGNALS_DEFAULT), the
+ *         gnss_iono_free() combination in GNSS_SIGNALS_IFLC; < 0 if the
+ *         satellite cannot be used.
+ */
+double gnss_solve_pseudorange(gnss_signal_mode_t mode, gnss_sys_t sys, double pr_primary, double pr_l5)
+{
+    return mode == GNSS_SIGNALS_IFLC ? gnss_iono_free(sys, pr_primary, pr_l5) : pr_primary;
+}
+
+/**
+ * @brief Noise variance of the gnss_solve_pseudorange() observable relative to the primary code.
+ *
+ * @return 1 in GNSS_SIGNALS_L1; (f1^4 + f5^4) / (f1^2 - f5^2)^2 in
+ *         GNSS_SIGNALS_IFLC (about 6.7 for L1 / L5), assuming equal noise on both codes.
+ */
+double gnss_solve_variance_factor(gnss_signal_mode_t mode, gnss_sys_t sys)
+{
+    if (mode != GNSS_SIGNALS_IFLC)
+        return 1.0;
+
+    const double f1 = sys == GNSS_BDS ? GNSS_FREQ_B1I : GNSS_FREQ_L1;
+    const double g1 = f1 * f1, g5 = GNSS_FREQ_L5 * GNSS_FREQ_L5;
+    return (g1 * g1 + g5 * g5) / ((g1 - g5) * (g1 - g5));
+}
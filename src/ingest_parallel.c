@@ -0,0 +1,207 @@
+/**
+ * @file ingest_parallel.c
+ * @brief Multi-threaded ingestion of parsed (PyRTCM text) logs held in memory.
+ *
+ * Every `<RTCM(...)>` line parses independently, so a mapped log is split at
+ * line boundaries into one contiguous chunk per thread. Each worker parses its
+ * chunk into thread-local buffers: an obs_store_t for the MSM4/MSM1
+ * observations and an array of ephemerides. The session (gnss_context_t) is
+ * not touched until all workers are done.
+ *
+ * The chunks are then merged in file order: observations with
+ * obs_store_merge(), ephemerides with store_ephemeris(). The session ends up
+ * exactly as a serial read_next_rtcm_message() would leave it, so the epoch
+ * index and sort_satellites() see the same (time-ordered) input as before.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/obs_store.h"
+#include "../include/rtcm_reader.h"
+#include "../include/ingest_parallel.h"
+#include "../include/perf_stats.h"
+#include "../include/gnss_context.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+/// Parse results of one chunk of the log
+typedef struct
+{
+    const char *begin;          ///< First byte of the chunk (start of a line)
+    const char *end;            ///< One past the last byte (after a '\n' or end of input)
+    obs_store_t obs;            ///< Observations, in chunk order
+    rtcm_1019_ephemeris_t *eph; ///< Ephemerides, in chunk order
+    size_t n_eph;               ///< Ephemerides in use
+    size_t cap_eph;             ///< Ephemerides allocated
+    uint8_t observation_type;   ///< Last observation type seen (1 = MSM1, 4 = MSM4, 0 = none)
+    int status;                 ///< 0, or -1 on allocation failure
+} ingest_chunk_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Threads worth using for @p len bytes of text: the configured count,
+ *        but no more than one per INGEST_MIN_CHUNK_BYTES.
+ */
+int ingest_thread_count(size_t len)
+{
+    size_t max_useful = len / INGEST_MIN_CHUNK_BYTES;
+    int n = configured_thread_count();
+    if ((size_t)n > max_useful)
+        n = (int)max_useful;
+    return n < 1 ? 1 : n;
+}
+
+/**
+ * @brief Parses every line of a chunk into its thread-local buffers.
+ */
+static void *ingest_worker(void *arg)
+{
+    ingest_chunk_t *chunk = (ingest_chunk_t *)arg;
+    rtcm_message_t msg;
+    perf_tally_t tally = {{0}};
+    const char *p = chunk->begin;
+
+    while (p < chunk->end && chunk->status == 0)
+    {
+        const char *nl = memchr(p, '\n', (size_t)(chunk->end - p));
+        const char *line_end = nl ? nl : chunk->end;
+        int status = parse_rtcm_span(p, (size_t)(line_end - p), &msg);
+        p = nl ? nl + 1 : chunk->end;
+
+        tally.n[PERF_LINES_READ]++;
+        if (status > 0)
+            continue; // Not a supported RTCM message
+        perf_tally_message(&tally, status, msg.msg_type);
+        if (status < 0)
+        {
+            fprintf(stderr, COLOR_YELLOW "Warning: Failed to parse RTCM %u message. Skipping.\n" COLOR_RESET, msg.msg_type);
+            continue;
+        }
+
+        if (msg.msg_type == 1002)
+        {
+            chunk->observation_type = 1; // MSM1
+            chunk->status = obs_store_add_msm1(&chunk->obs, &msg.data.msm1);
+        }
+        else if (RTCM_IS_MSM4_OBS(msg.msg_type))
+        {
+            chunk->observation_type = 4; // MSM4
+            chunk->status = obs_store_add_msm4(&chunk->obs, &msg.data.msm4);
+        }
+        else if (RTCM_IS_EPHEMERIS(msg.msg_type))
+        {
+            if (grow_array((void **)&chunk->eph, &chunk->cap_eph, chunk->n_eph + 1, sizeof(chunk->eph[0])) != 0)
+            {
+                fprintf(stderr, COLOR_RED "Error: Out of memory while storing ephemerides.\n" COLOR_RESET);
+                chunk->status = -1;
+                continue;
+            }
+            chunk->eph[chunk->n_eph++] = msg.data.eph;
+        }
+        // Other MSM headers are not stored
+    }
+    perf_add_tally(&tally);
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Parses a whole text log on @p n_threads threads into @p ctx.
+ *
+ * Equivalent to read_rtcm_text_buffer(data, len, NULL, ctx). On failure
+ * nothing has been stored yet, so the caller can retry serially.
+ *
+ * @param ctx       Session receiving the messages.
+ * @param data      Text log (need not be NUL-terminated).
+ * @param len       Length of @p data.
+ * @param n_threads Worker threads (including the caller), >= 1.
+ * @return 0 on success, -1 on allocation failure before merging (nothing stored),
+ *         -2 if merging into the session failed.
+ */
+int ingest_text_parallel(gnss_context_t *ctx, const char *data, size_t len, int n_threads)
+{
+#ifdef _WIN32
+    (void)ctx;
+    (void)data;
+    (void)len;
+    (void)n_threads;
+    return -1;
+#else
+    if (!ctx || !data || n_threads < 1)
+        return -1;
+    if (n_threads > MAX_WORKER_THREADS)
+        n_threads = MAX_WORKER_THREADS;
+
+    ingest_chunk_t *chunks = calloc((size_t)n_threads, sizeof(*chunks));
+    if (!chunks)
+        return -1;
+
+    // Split at the first line boundary after each even share
+    const char *end = data + len;
+    const char *begin = data;
+    int n_chunks = 0;
+    for (int i = 0; i < n_threads && begin < end; i++)
+    {
+        const char *cut = (i == n_threads - 1) ? end : data + len / (size_t)n_threads * (size_t)(i + 1);
+        if (cut < begin)
+            cut = begin;
+        if (cut < end)
+        {
+            const char *nl = memchr(cut, '\n', (size_t)(end - cut));
+            cut = nl ? nl + 1 : end;
+        }
+        chunks[n_chunks].begin = begin;
+        chunks[n_chunks].end = cut;
+        n_chunks++;
+        begin = cut;
+    }
+
+    // Parse: chunks 1.. on new threads, chunk 0 on the caller
+    pthread_t threads[MAX_WORKER_THREADS];
+    int n_started = 0, status = 0;
+    for (int i = 1; i < n_chunks; i++)
+    {
+        if (pthread_create(&threads[i], NULL, ingest_worker, &chunks[i]) != 0)
+            break;
+        n_started = i;
+    }
+    if (n_chunks > 0)
+        ingest_worker(&chunks[0]);
+    for (int i = n_started + 1; i < n_chunks; i++)
+        ingest_worker(&chunks[i]); // Threads that could not be started
+    for (int i = 1; i <= n_started; i++)
+        pthread_join(threads[i], NULL);
+
+    for (int i = 0; i < n_chunks && status == 0; i++)
+    {
+        if (chunks[i].status != 0)
+            status = -1;
+    }
+
+    // Merge in file order
+    for (int i = 0; i < n_chunks && status == 0; i++)
+    {
+        if (obs_store_merge(&ctx->obs_store, &chunks[i].obs) != 0)
+            status = -2;
+        for (size_t k = 0; k < chunks[i].n_eph && status == 0; k++)
+        {
+            if (store_ephemeris(ctx, &chunks[i].eph[k]) == -1)
+                status = -2;
+        }
+        if (chunks[i].observation_type != 0)
+            ctx->observation_type = chunks[i].observation_type;
+    }
+
+    for (int i = 0; i < n_chunks; i++)
+    {
+        obs_store_free(&chunks[i].obs);
+        free(chunks[i].eph);
+    }
+    free(chunks);
+    return status;
+#endif
+}
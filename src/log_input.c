@@ -0,0 +1,359 @@
+/**
+ * @file log_input.c
+ * @brief Opens recorded logs, decompressing gzip / Zstandard logs on the fly.
+ *
+ * Archived logs are often stored compressed. log_open() detects the format
+ * from the magic bytes (gzip 1F 8B, Zstandard 28 B5 2F FD) rather than the
+ * file name, and for a compressed log returns the read end of a pipe instead
+ * of the file:
+ *  - A detached thread reads the compressed file LOG_INPUT_CHUNK bytes at a
+ *    time, decompresses with zlib (gzip, several members allowed) or libzstd
+ *    (several frames allowed) and writes the output into the pipe.
+ *  - The readers see an ordinary stream: the memory-mapped paths (file_map.c)
+ *    decline it and the stdio paths read it, so parsing overlaps decompression
+ *    and the uncompressed log is never written to disk.
+ *  - Closing the stream early (fclose()) makes the thread's next write fail
+ *    with EPIPE, and the thread stops.
+ *
+ * Support is chosen at build time (WITH_ZLIB / WITH_ZSTD in the Makefile); a
+ * log in a format the build lacks is reported and not opened. Compressed logs
+ * are not supported on Windows.
+ */
+
+#include "../include/algo.h"
+#include "../include/log_input.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/// Decompressed bytes written to the pipe per step
+#define LOG_INPUT_OUT_CHUNK ((size_t)1 << 18)
+
+/// Set when this build can decompress at least one format
+#if !defined(_WIN32) && (defined(HAVE_ZLIB) || defined(HAVE_ZSTD))
+#define LOG_INPUT_DECOMPRESS 1
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Detects the compression of a log from its first bytes.
+ *
+ * The stream position is left unchanged.
+ *
+ * @param fp Log opened for reading, at its start.
+ * @return LOG_GZIP, LOG_ZSTD, or LOG_PLAIN for anything else (including short files).
+ */
+log_compression_t log_compression_of(FILE *fp)
+{
+    uint8_t magic[4] = {0};
+    long pos = ftell(fp);
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    if (pos < 0 || fseek(fp, pos, SEEK_SET) != 0)
+        return LOG_PLAIN;
+
+    if (n >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+        return LOG_GZIP;
+    if (n == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+        return LOG_ZSTD;
+    return LOG_PLAIN;
+}
+
+/**
+ * @brief Short name of a compression format, for messages.
+ */
+const char *log_compression_name(log_compression_t kind)
+{
+    switch (kind)
+    {
+    case LOG_GZIP:
+        return "gzip";
+    case LOG_ZSTD:
+        return "zstd";
+    default:
+        return "plain";
+    }
+}
+
+#ifdef LOG_INPUT_DECOMPRESS
+
+/** One running decompression: compressed source in, pipe out (owned by the thread). */
+typedef struct
+{
+    FILE *src;              ///< Compressed log
+    int fd;                 ///< Write end of the pipe
+    log_compression_t kind; ///< LOG_GZIP or LOG_ZSTD
+    char path[256];         ///< Log path, for messages
+} log_decompress_job_t;
+
+/**
+ * @brief Writes all of @p buf to the pipe.
+ *
+ * @return 0 on success, -1 if the reader closed its end (EPIPE) or on an error.
+ */
+static int write_all(int fd, const uint8_t *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+#ifdef HAVE_ZLIB
+/**
+ * @brief Inflates a gzip log into the pipe.
+ *
+ * Concatenated members (as written by `cat a.gz b.gz` or parallel gzip
+ * tools) are decoded one after the other.
+ *
+ * @return 0 at the end of the last member, 1 if the reader went away, -1 on corrupt or truncated data.
+ */
+static int inflate_gzip(log_decompress_job_t *job, uint8_t *in, uint8_t *out)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK)
+        return -1;
+
+    int status = 0;
+    bool member_done = false;
+    for (;;)
+    {
+        if (zs.avail_in == 0)
+        {
+            size_t n = fread(in, 1, LOG_INPUT_CHUNK, job->src);
+            if (n == 0)
+            {
+                status = member_done ? 0 : -1; // EOF inside a member is a truncated log
+                break;
+            }
+            zs.next_in = in;
+            zs.avail_in = (uInt)n;
+        }
+        if (member_done)
+        {
+            inflateReset(&zs); // Next member
+            member_done = false;
+        }
+
+        zs.next_out = out;
+        zs.avail_out = (uInt)LOG_INPUT_OUT_CHUNK;
+        int rc = inflate(&zs, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR)
+        {
+            status = -1;
+            break;
+        }
+        if (write_all(job->fd, out, LOG_INPUT_OUT_CHUNK - zs.avail_out) != 0)
+        {
+            status = 1;
+            break;
+        }
+        member_done = (rc == Z_STREAM_END);
+    }
+
+    inflateEnd(&zs);
+    return status;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/**
+ * @brief Decompresses a Zstandard log into the pipe.
+ *
+ * @return 0 at the end of the last frame, 1 if the reader went away, -1 on corrupt or truncated data.
+ */
+static int decompress_zstd(log_decompress_job_t *job, uint8_t *in, uint8_t *out)
+{
+    ZSTD_DStream *zds = ZSTD_createDStream();
+    if (!zds || ZSTD_isError(ZSTD_initDStream(zds)))
+    {
+        ZSTD_freeDStream(zds);
+        return -1;
+    }
+
+    int status = 0;
+    size_t pending = 0; // Non-zero while a frame is incomplete
+    for (;;)
+    {
+        size_t n = fread(in, 1, LOG_INPUT_CHUNK, job->src);
+        if (n == 0)
+        {
+            status = pending == 0 ? 0 : -1;
+            break;
+        }
+
+        ZSTD_inBuffer ib = {in, n, 0};
+        while (ib.pos < ib.size && status == 0)
+        {
+            ZSTD_outBuffer ob = {out, LOG_INPUT_OUT_CHUNK, 0};
+            pending = ZSTD_decompressStream(zds, &ob, &ib);
+            if (ZSTD_isError(pending))
+                status = -1;
+            else if (write_all(job->fd, out, ob.pos) != 0)
+                status = 1;
+        }
+        if (status != 0)
+            break;
+    }
+
+    ZSTD_freeDStream(zds);
+    return status;
+}
+#endif
+
+/**
+ * @brief Decompression thread: streams job->src into the pipe, then releases the job.
+ */
+static void *decompress_worker(void *arg)
+{
+    log_decompress_job_t *job = (log_decompress_job_t *)arg;
+
+    // A reader that stops early must not kill the process: its EPIPE ends this thread
+    sigset_t block;
+    sigemptyset(&block);
+    sigaddset(&block, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &block, NULL);
+
+    uint8_t *in = (uint8_t *)malloc(LOG_INPUT_CHUNK);
+    uint8_t *out = (uint8_t *)malloc(LOG_INPUT_OUT_CHUNK);
+    int status = -1;
+    if (in && out)
+    {
+#ifdef HAVE_ZLIB
+        if (job->kind == LOG_GZIP)
+            status = inflate_gzip(job, in, out);
+#endif
+#ifdef HAVE_ZSTD
+        if (job->kind == LOG_ZSTD)
+            status = decompress_zstd(job, in, out);
+#endif
+    }
+    if (status < 0)
+        fprintf(stderr, COLOR_RED "Error: %s: corrupt or truncated %s data; the log is read up to there.\n" COLOR_RESET,
+                job->path, log_compression_name(job->kind));
+
+    free(in);
+    free(out);
+    close(job->fd);
+    fclose(job->src);
+    free(job);
+    return NULL;
+}
+
+/**
+ * @brief Starts a decompression thread for @p src and returns the stream it feeds.
+ *
+ * @return Read end of the pipe, or NULL (src is then still open).
+ */
+static FILE *start_decompression(FILE *src, log_compression_t kind, const char *path, bool binary)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        return NULL;
+
+    FILE *fp = fdopen(fds[0], binary ? "rb" : "r");
+    log_decompress_job_t *job = (log_decompress_job_t *)calloc(1, sizeof(*job));
+    if (!fp || !job)
+    {
+        free(job);
+        if (fp)
+            fclose(fp);
+        else
+            close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+    job->src = src;
+    job->fd = fds[1];
+    job->kind = kind;
+    snprintf(job->path, sizeof(job->path), "%s", path);
+
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&thread, &attr, decompress_worker, job);
+    pthread_attr_destroy(&attr);
+    if (rc != 0)
+    {
+        free(job);
+        fclose(fp);
+        close(fds[1]);
+        return NULL;
+    }
+    return fp;
+}
+
+#endif // LOG_INPUT_DECOMPRESS
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Opens a recorded log for reading, decompressing it on a separate thread if needed.
+ *
+ * A plain log is returned as the opened file itself. A gzip or Zstandard log
+ * (see log_compression_of()) is returned as a stream of its decompressed
+ * bytes; fclose() it as usual.
+ *
+ * @param path   Log to open.
+ * @param binary True for a raw binary log ("rb"), false for a text log ("r").
+ * @return The stream, or NULL with errno set (ENOTSUP if the build cannot
+ *         decompress the log's format).
+ */
+FILE *log_open(const char *path, bool binary)
+{
+    FILE *fp = fopen(path, binary ? "rb" : "r");
+    if (!fp)
+        return NULL;
+
+    log_compression_t kind = log_compression_of(fp);
+    if (kind == LOG_PLAIN)
+        return fp;
+
+    bool supported = false;
+#ifndef _WIN32
+#ifdef HAVE_ZLIB
+    supported |= (kind == LOG_GZIP);
+#endif
+#ifdef HAVE_ZSTD
+    supported |= (kind == LOG_ZSTD);
+#endif
+#endif
+    if (!supported)
+    {
+        fprintf(stderr, COLOR_RED "Error: %s is %s-compressed, and this build cannot decompress it "
+                                  "(rebuild with WITH_ZLIB=1 / WITH_ZSTD=1).\n" COLOR_RESET,
+                path, log_compression_name(kind));
+        fclose(fp);
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+#ifdef LOG_INPUT_DECOMPRESS
+    FILE *stream = start_decompression(fp, kind, path, binary);
+    if (stream)
+        return stream;
+    int err = errno;
+    fclose(fp);
+    errno = err;
+#endif
+    return NULL;
+}
@@ -9,6 +9,9 @@
  * 1) Invoke the application menu to select/process the RTCM source.
  * 2) Clean up any allocated resources before exit.
  *
+ * Given any argument, the program instead runs the non-interactive batch mode
+ * (see batch_cli.c), e.g. `gps_resolver -j 4 -o out day1.txt day2.bin`.
+ *
  * @author
  *   Ade (Adedolapo Adegboye)
  *
@@ -17,17 +20,25 @@
  */
 
 #include "../include/algo.h"
+#include "../include/batch_cli.h"
 
 /**
  * @brief Program entry point.
  *
  * Runs the application menu for RTCM input selection and processing, then
- * performs final cleanup before exiting.
+ * performs final cleanup before exiting. Command line arguments select the
+ * batch mode instead.
  *
+ * @param argc Argument count.
+ * @param argv Arguments (options and input logs, see batch_cli()).
  * @return int 0 on success, non-zero on failure.
  */
-int main(void)
+int main(int argc, char **argv)
 {
+    /* Headless batch run over the logs given on the command line */
+    if (argc > 1)
+        return batch_cli(argc, argv);
+
     /* Launch the application menu (RTCM source selection & processing) */
     app_menu();
 
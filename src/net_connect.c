@@ -0,0 +1,402 @@
+/**
+ * @file net_connect.c
+ * @brief Network RTCM sources: stream URLs, non-blocking TCP connect and the NTRIP handshake.
+ *
+ * A source is given as a URL:
+ *  - `tcp://host:port` (or just `host:port`): the socket carries raw RTCM3, as
+ *    published by receivers and serial-to-TCP bridges;
+ *  - `ntrip://[user[:password]@]host[:port]/MOUNTPOINT`: an NTRIP caster
+ *    (default port 2101). The client sends an NTRIP 1.0 style request
+ *    (`GET /MOUNTPOINT HTTP/1.0`, Basic authorization) and the RTCM3 data
+ *    follows the caster's `ICY 200 OK` / `HTTP/1.x 200` header. Asking with
+ *    HTTP/1.0 keeps NTRIP 2.0 casters from switching to chunked transfer
+ *    encoding, so the body is always the bare RTCM3 stream.
+ *
+ * Only the pieces are here; the event loop that drives many sources at once
+ * is in net_input_mode.c. Sockets are non-blocking: net_connect_start() only
+ * begins the connection and net_connect_finish() collects its result once the
+ * socket turns writable.
+ *
+ * Network input is not available on Windows.
+ */
+
+#include "../include/algo.h"
+#include "../include/net_connect.h"
+
+#include <ctype.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Copies [@p begin, @p end) into @p out as a C string.
+ *
+ * @return 0, or -1 if it is empty or does not fit.
+ */
+static int copy_span(const char *begin, const char *end, char *out, size_t size)
+{
+    size_t n = (size_t)(end - begin);
+    if (n == 0 || n >= size)
+        return -1;
+    memcpy(out, begin, n);
+    out[n] = '\0';
+    return 0;
+}
+
+/** @brief Builds the label of @p ep: the mountpoint, else `host_port`, cut to fit and with only [A-Za-z0-9._-] kept. */
+static void endpoint_name(net_endpoint_t *ep)
+{
+    if (ep->kind == NET_SOURCE_NTRIP)
+        snprintf(ep->name, sizeof(ep->name), "%.63s", ep->mount);
+    else
+        snprintf(ep->name, sizeof(ep->name), "%.55s_%.7s", ep->host, ep->port);
+
+    for (char *c = ep->name; *c; c++)
+    {
+        if (!isalnum((unsigned char)*c) && *c != '.' && *c != '-' && *c != '_')
+            *c = '_';
+    }
+}
+
+/**
+ * @brief Parses a stream URL (see the file comment for the accepted forms).
+ *
+ * Leading and trailing whitespace is ignored. IPv6 addresses go in brackets
+ * (`tcp://[::1]:5000`).
+ *
+ * @param url Stream URL.
+ * @param ep  Parsed source.
+ * @return 0 on success, -1 if the URL is malformed (a message says why).
+ */
+int net_parse_endpoint(const char *url, net_endpoint_t *ep)
+{
+    memset(ep, 0, sizeof(*ep));
+    while (*url == ' ' || *url == '\t')
+        url++;
+    const char *end = url + strlen(url);
+    while (end > url && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+        end--;
+
+    const char *p = url;
+    ep->kind = NET_SOURCE_TCP;
+    if ((size_t)(end - p) > 8 && strncmp(p, "ntrip://", 8) == 0)
+    {
+        ep->kind = NET_SOURCE_NTRIP;
+        p += 8;
+    }
+    else if ((size_t)(end - p) > 6 && strncmp(p, "tcp://", 6) == 0)
+    {
+        p += 6;
+    }
+
+    // Authority ends at the path; credentials end at the last '@' before it
+    const char *slash = memchr(p, '/', (size_t)(end - p));
+    const char *auth_end = slash ? slash : end;
+    const char *at = NULL;
+    for (const char *c = p; c < auth_end; c++)
+    {
+        if (*c == '@')
+            at = c;
+    }
+    if (at)
+    {
+        if (ep->kind != NET_SOURCE_NTRIP)
+        {
+            fprintf(stderr, COLOR_RED "Error: Credentials are only used with ntrip:// sources.\n" COLOR_RESET);
+            return -1;
+        }
+        const char *colon = memchr(p, ':', (size_t)(at - p));
+        if (copy_span(p, colon ? colon : at, ep->user, sizeof(ep->user)) != 0 ||
+            (colon && colon + 1 < at && copy_span(colon + 1, at, ep->password, sizeof(ep->password)) != 0))
+        {
+            fprintf(stderr, COLOR_RED "Error: Invalid user name or password in %.*s\n" COLOR_RESET, (int)(end - url), url);
+            return -1;
+        }
+        p = at + 1;
+    }
+
+    // Host (bracketed for IPv6) and optional port
+    const char *host_end;
+    const char *port = NULL;
+    if (*p == '[')
+    {
+        const char *close = memchr(p, ']', (size_t)(auth_end - p));
+        if (!close || copy_span(p + 1, close, ep->host, sizeof(ep->host)) != 0)
+            goto bad;
+        host_end = close + 1;
+        if (host_end < auth_end && *host_end != ':')
+            goto bad;
+    }
+    else
+    {
+        host_end = memchr(p, ':', (size_t)(auth_end - p));
+        if (!host_end)
+            host_end = auth_end;
+        if (copy_span(p, host_end, ep->host, sizeof(ep->host)) != 0)
+            goto bad;
+    }
+    if (host_end < auth_end)
+        port = host_end + 1;
+
+    if (port)
+    {
+        if (copy_span(port, auth_end, ep->port, sizeof(ep->port)) != 0)
+            goto bad;
+        for (const char *c = ep->port; *c; c++)
+        {
+            if (!isdigit((unsigned char)*c))
+                goto bad;
+        }
+    }
+    else if (ep->kind == NET_SOURCE_NTRIP)
+    {
+        snprintf(ep->port, sizeof(ep->port), "%s", NTRIP_DEFAULT_PORT);
+    }
+    else
+    {
+        fprintf(stderr, COLOR_RED "Error: TCP sources need a port (host:port).\n" COLOR_RESET);
+        return -1;
+    }
+
+    if (ep->kind == NET_SOURCE_NTRIP)
+    {
+        if (!slash || copy_span(slash + 1, end, ep->mount, sizeof(ep->mount)) != 0)
+        {
+            fprintf(stderr, COLOR_RED "Error: NTRIP sources need a mountpoint (ntrip://host/MOUNT).\n" COLOR_RESET);
+            return -1;
+        }
+    }
+    else if (slash && slash + 1 < end)
+    {
+        goto bad; // A path means nothing to a raw TCP source
+    }
+
+    endpoint_name(ep);
+    return 0;
+
+bad:
+    fprintf(stderr, COLOR_RED "Error: Invalid stream URL %.*s\n" COLOR_RESET, (int)(end - url), url);
+    return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Base64 of @p len bytes into @p out (NUL-terminated).
+ *
+ * @return 0, or -1 if @p out is too small.
+ */
+static int base64_encode(const uint8_t *in, size_t len, char *out, size_t size)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    if (size < (len + 2) / 3 * 4 + 1)
+        return -1;
+
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3)
+    {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < len)
+            v |= (uint32_t)in[i + 1] << 8;
+        if (i + 2 < len)
+            v |= in[i + 2];
+
+        out[o++] = alphabet[(v >> 18) & 0x3F];
+        out[o++] = alphabet[(v >> 12) & 0x3F];
+        out[o++] = (i + 1 < len) ? alphabet[(v >> 6) & 0x3F] : '=';
+        out[o++] = (i + 2 < len) ? alphabet[v & 0x3F] : '=';
+    }
+    out[o] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Formats the NTRIP request for @p ep.
+ *
+ * @param ep   NTRIP source.
+ * @param buf  Request text (NUL-terminated).
+ * @param size Size of @p buf.
+ * @return Request length, or 0 if it does not fit.
+ */
+size_t net_ntrip_request(const net_endpoint_t *ep, char *buf, size_t size)
+{
+    char auth[256] = "";
+    if (ep->user[0])
+    {
+        char plain[sizeof(ep->user) + sizeof(ep->password)];
+        char b64[(sizeof(plain) + 2) / 3 * 4 + 1];
+        int n = snprintf(plain, sizeof(plain), "%s:%s", ep->user, ep->password);
+        if (n < 0 || base64_encode((const uint8_t *)plain, (size_t)n, b64, sizeof(b64)) != 0)
+            return 0;
+        snprintf(auth, sizeof(auth), "Authorization: Basic %s\r\n", b64);
+    }
+
+    int n = snprintf(buf, size,
+                     "GET /%s HTTP/1.0\r\n"
+                     "Host: %s:%s\r\n"
+                     "User-Agent: NTRIP gps_resolver/1.0\r\n"
+                     "Accept: */*\r\n"
+                     "%s"
+                     "Connection: close\r\n"
+                     "\r\n",
+                     ep->mount, ep->host, ep->port, auth);
+    return (n < 0 || (size_t)n >= size) ? 0 : (size_t)n;
+}
+
+/** @brief First occurrence of @p needle in @p buf, or NULL. */
+static const char *find_bytes(const char *buf, size_t len, const char *needle)
+{
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; i++)
+    {
+        if (memcmp(buf + i, needle, n) == 0)
+            return buf + i;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks the caster's response header collected so far.
+ *
+ * `ICY 200 OK` (NTRIP 1.0) ends with its status line; an HTTP status ends with
+ * the blank line after the header fields. A source table (`SOURCETABLE 200 OK`
+ * or `Content-Type: gnss/sourcetable`) means the mountpoint does not exist.
+ *
+ * @param buf        Bytes received since the request was sent.
+ * @param len        Number of bytes in @p buf.
+ * @param header_len Header length, set on NTRIP_RESPONSE_OK; the RTCM data starts there.
+ * @return See ntrip_response_t.
+ */
+ntrip_response_t net_ntrip_response(const char *buf, size_t len, size_t *header_len)
+{
+    const char *eol = memchr(buf, '\n', len);
+    if (!eol)
+        return len >= NTRIP_HEADER_MAX ? NTRIP_RESPONSE_RETRY : NTRIP_RESPONSE_PARTIAL;
+
+    if (len >= 7 && strncmp(buf, "ICY 200", 7) == 0)
+    {
+        *header_len = (size_t)(eol - buf) + 1;
+        return NTRIP_RESPONSE_OK;
+    }
+    if (len >= 11 && strncmp(buf, "SOURCETABLE", 11) == 0)
+        return NTRIP_RESPONSE_REJECTED;
+    if (len < 12 || strncmp(buf, "HTTP/1.", 7) != 0)
+        return NTRIP_RESPONSE_RETRY;
+
+    int status = atoi(buf + 9);
+    if (status == 401 || status == 403 || status == 404)
+        return NTRIP_RESPONSE_REJECTED;
+    if (status != 200)
+        return NTRIP_RESPONSE_RETRY;
+
+    const char *blank = find_bytes(buf, len, "\r\n\r\n");
+    size_t blank_len = 4;
+    if (!blank)
+    {
+        blank = find_bytes(buf, len, "\n\n");
+        blank_len = 2;
+    }
+    if (!blank)
+        return len >= NTRIP_HEADER_MAX ? NTRIP_RESPONSE_RETRY : NTRIP_RESPONSE_PARTIAL;
+
+    *header_len = (size_t)(blank - buf) + blank_len;
+    if (find_bytes(buf, *header_len, "gnss/sourcetable"))
+        return NTRIP_RESPONSE_REJECTED;
+    return NTRIP_RESPONSE_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+/**
+ * @brief Resolves @p ep and starts a non-blocking connection to its first usable address.
+ *
+ * The name lookup itself blocks (getaddrinfo()); the TCP handshake does not.
+ * Wait for the socket to become writable, then call net_connect_finish().
+ *
+ * @param ep Source to connect to.
+ * @return Non-blocking socket (connecting or connected), or -1 with errno set
+ *         (EHOSTUNREACH if the name did not resolve).
+ */
+int net_connect_start(const net_endpoint_t *ep)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *list = NULL;
+    if (getaddrinfo(ep->host, ep->port, &hints, &list) != 0 || !list)
+    {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+
+    int fd = -1, err = ECONNREFUSED;
+    for (struct addrinfo *ai = list; ai; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+        {
+            err = errno;
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0 &&
+            (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 || errno == EINPROGRESS))
+            break;
+
+        err = errno;
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(list);
+    if (fd < 0)
+        errno = err;
+    return fd;
+}
+
+/**
+ * @brief Result of a connection started by net_connect_start(), once its socket is writable.
+ *
+ * @param fd Socket from net_connect_start().
+ * @return 0 if connected, else the errno of the failed connection.
+ */
+int net_connect_finish(int fd)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
+        return errno;
+    return err;
+}
+
+#else
+
+int net_connect_start(const net_endpoint_t *ep)
+{
+    (void)ep;
+    errno = ENOSYS;
+    return -1;
+}
+
+int net_connect_finish(int fd)
+{
+    (void)fd;
+    return ENOSYS;
+}
+
+#endif // _WIN32
@@ -0,0 +1,657 @@
+/**
+ * @file net_input_mode.c
+ * @brief Live mode: RTCM3 from NTRIP casters and TCP sockets, several streams solved side by side.
+ *
+ * One event loop thread serves every stream:
+ *  - all sockets are non-blocking and registered with one epoll (Linux) or
+ *    kqueue (macOS / BSD) instance, so a single wait covers connects, the
+ *    NTRIP request and incoming data of any number of streams;
+ *  - each stream owns its framer, stream solver and track sink, so the
+ *    streams never share solver state; a readable socket is drained (up to
+ *    NET_READS_PER_EVENT reads per wake-up, so one busy stream cannot starve
+ *    the others) and its frames are decoded and solved right away;
+ *  - a stream that fails, closes or stays silent for NET_STALL_MS is
+ *    reconnected after NET_RECONNECT_MS; a caster that rejects the
+ *    mountpoint or the credentials ends that stream only.
+ *
+ * The main thread only waits for the user to press Enter (or for every stream
+ * to end) and then stops the loop, as in serial_input_mode(). Sources are
+ * parsed and connected by net_connect.c. With one stream the track files go to
+ * plots/ like the other live modes; with several, each stream writes to
+ * plots/<mountpoint or host_port>/.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/rtcm3_decoder.h"
+#include "../include/stream_solver.h"
+#include "../include/track_sink.h"
+#include "../include/net_connect.h"
+
+#ifndef _WIN32
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define NET_USE_EPOLL 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#include <sys/event.h>
+#define NET_USE_KQUEUE 1
+#endif
+#endif
+
+#if !defined(_WIN32) && (defined(NET_USE_EPOLL) || defined(NET_USE_KQUEUE))
+#define NET_INPUT_SUPPORTED 1
+#endif
+
+/// Streams served by one event loop
+#define NET_MAX_STREAMS 16
+/// Longest the loop waits for events before rechecking the stop flag and the timers (ms)
+#define NET_POLL_MS 100
+/// Delay before a dropped stream is connected again (ms)
+#define NET_RECONNECT_MS 5000
+/// A stream without a byte for this long (including the connect) is dropped (ms)
+#define NET_STALL_MS 30000
+/// Bytes per socket read
+#define NET_READ_BYTES ((size_t)1 << 16)
+/// Socket reads per readiness event before the loop moves on to other streams
+#define NET_READS_PER_EVENT 4
+/// Events taken per wait
+#define NET_MAX_EVENTS 32
+
+#ifdef NET_INPUT_SUPPORTED
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SO_NOSIGPIPE is set on the socket instead (net_connect_start())
+#endif
+
+/// Connection state of one stream
+typedef enum
+{
+    NET_IDLE,       ///< Not connected; connects at retry_at_ms
+    NET_CONNECTING, ///< TCP handshake in progress (waiting for writable)
+    NET_REQUEST,    ///< Sending the NTRIP request
+    NET_HEADER,     ///< Reading the caster's response header
+    NET_STREAMING,  ///< Receiving RTCM3
+    NET_FAILED      ///< Given up (rejected by the caster)
+} net_state_t;
+
+/// One network stream and its own solver context
+typedef struct
+{
+    net_endpoint_t ep;                ///< Source
+    char dir[200];                    ///< Track output directory
+    int fd;                           ///< Socket, -1 when not connected
+    net_state_t state;                ///< Connection state
+    char request[1024];               ///< NTRIP request
+    size_t request_len;               ///< Bytes in request
+    size_t request_sent;              ///< Bytes of request sent so far
+    char header[NTRIP_HEADER_MAX];    ///< Caster response header collected so far
+    size_t header_len;                ///< Bytes in header
+    int64_t retry_at_ms;              ///< Next connect attempt (NET_IDLE)
+    int64_t last_rx_ms;               ///< Last received byte, or the connect start
+    unsigned long long n_bytes;       ///< Bytes received
+    unsigned long n_failed;           ///< Frames that did not decode
+    unsigned long n_connects;         ///< Successful connections
+    rtcm3_framer_t framer;            ///< RTCM3 framing state
+    stream_solver_t solver;           ///< Epoch-by-epoch solver of this stream
+    track_sink_t sink;                ///< Track files of this stream
+} net_stream_t;
+
+/// State shared by the main thread and the event loop
+typedef struct
+{
+    int poller;                              ///< epoll / kqueue descriptor
+    net_stream_t *streams[NET_MAX_STREAMS];  ///< Streams (event loop only while it runs)
+    int n_streams;                           ///< Number of streams
+    atomic_bool stop;                        ///< Set by the main thread to end the loop
+    atomic_bool loop_done;                   ///< Set by the loop once it returned
+    int loop_errno;                          ///< errno of a failed event wait (0 if none)
+    uint8_t rx[NET_READ_BYTES];              ///< Socket read buffer (event loop only)
+} net_live_t;
+
+/// Readiness of one socket, as reported by poller_wait()
+typedef struct
+{
+    net_stream_t *stream; ///< Stream registered with the socket
+    int fd;               ///< Socket the event is for (stale if the stream reconnected since)
+    bool readable;        ///< Data, end of stream or an error to read
+    bool writable;        ///< Connect finished or send space available
+} net_event_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Milliseconds on the monotonic clock. */
+static int64_t clock_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/** @brief Opens the epoll / kqueue instance; -1 on failure. */
+static int poller_open(void)
+{
+#ifdef NET_USE_EPOLL
+    return epoll_create1(EPOLL_CLOEXEC);
+#else
+    return kqueue();
+#endif
+}
+
+/**
+ * @brief Registers @p fd for reading, and for writing if @p want_write, or updates its registration.
+ *
+ * @return 0, or -1 with errno set.
+ */
+static int poller_watch(int poller, int fd, net_stream_t *stream, bool want_write)
+{
+#ifdef NET_USE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | (want_write ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.ptr = stream;
+    if (epoll_ctl(poller, EPOLL_CTL_MOD, fd, &ev) == 0)
+        return 0;
+    return errno == ENOENT ? epoll_ctl(poller, EPOLL_CTL_ADD, fd, &ev) : -1;
+#else
+    struct kevent changes[2];
+    EV_SET(&changes[0], (uintptr_t)fd, EVFILT_READ, EV_ADD, 0, 0, stream);
+    EV_SET(&changes[1], (uintptr_t)fd, EVFILT_WRITE, EV_ADD | (want_write ? EV_ENABLE : EV_DISABLE), 0, 0, stream);
+    return kevent(poller, changes, 2, NULL, 0, NULL) < 0 ? -1 : 0;
+#endif
+}
+
+/** @brief Unregisters and closes @p fd. */
+static void poller_close(int poller, int fd)
+{
+#ifdef NET_USE_EPOLL
+    epoll_ctl(poller, EPOLL_CTL_DEL, fd, NULL);
+#else
+    (void)poller; // Closing the descriptor removes its kevents
+#endif
+    close(fd);
+}
+
+/**
+ * @brief Waits up to @p timeout_ms for socket events.
+ *
+ * @return Number of events in @p out (0 on timeout or signal), -1 on error.
+ */
+static int poller_wait(int poller, net_event_t *out, int max, int timeout_ms)
+{
+#ifdef NET_USE_EPOLL
+    struct epoll_event evs[NET_MAX_EVENTS];
+    int n = epoll_wait(poller, evs, max < NET_MAX_EVENTS ? max : NET_MAX_EVENTS, timeout_ms);
+    for (int i = 0; i < n; i++)
+    {
+        out[i].stream = (net_stream_t *)evs[i].data.ptr;
+        out[i].fd = out[i].stream->fd;
+        out[i].readable = (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+        out[i].writable = (evs[i].events & (EPOLLOUT | EPOLLERR)) != 0;
+    }
+#else
+    struct kevent evs[NET_MAX_EVENTS];
+    struct timespec ts = {timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L};
+    int n = kevent(poller, NULL, 0, evs, max < NET_MAX_EVENTS ? max : NET_MAX_EVENTS, &ts);
+    for (int i = 0; i < n; i++)
+    {
+        out[i].stream = (net_stream_t *)evs[i].udata;
+        out[i].fd = (int)evs[i].ident;
+        out[i].readable = evs[i].filter == EVFILT_READ;
+        out[i].writable = evs[i].filter == EVFILT_WRITE;
+    }
+#endif
+    if (n < 0 && errno == EINTR)
+        return 0;
+    return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Closes the stream's socket and schedules a reconnect (or gives up).
+ *
+ * @param reason Printed with the stream name.
+ * @param retry  False to end the stream for good.
+ */
+static void stream_drop(net_live_t *live, net_stream_t *s, const char *reason, bool retry)
+{
+    if (s->fd >= 0)
+        poller_close(live->poller, s->fd);
+    s->fd = -1;
+    s->header_len = 0;
+    s->framer.len = 0; // A partial frame does not continue on the next connection; the counters do
+    s->framer.ready = false;
+
+    if (retry)
+    {
+        s->state = NET_IDLE;
+        s->retry_at_ms = clock_ms() + NET_RECONNECT_MS;
+        fprintf(stderr, COLOR_YELLOW "[N:%s] %s; reconnecting in %d s.\n" COLOR_RESET,
+                s->ep.name, reason, NET_RECONNECT_MS / 1000);
+    }
+    else
+    {
+        s->state = NET_FAILED;
+        fprintf(stderr, COLOR_RED "[N:%s] %s; stream stopped.\n" COLOR_RESET, s->ep.name, reason);
+    }
+}
+
+/** @brief Starts a non-blocking connect for an idle stream. */
+static void stream_connect(net_live_t *live, net_stream_t *s, int64_t now)
+{
+    s->last_rx_ms = now;
+    s->fd = net_connect_start(&s->ep);
+    if (s->fd < 0)
+    {
+        stream_drop(live, s, strerror(errno), true);
+        return;
+    }
+
+    s->state = NET_CONNECTING;
+    if (poller_watch(live->poller, s->fd, s, true) != 0)
+        stream_drop(live, s, strerror(errno), true);
+}
+
+/** @brief Sends what is left of the NTRIP request; moves on to NET_HEADER once it is out. */
+static void stream_send_request(net_live_t *live, net_stream_t *s)
+{
+    while (s->request_sent < s->request_len)
+    {
+        ssize_t n = send(s->fd, s->request + s->request_sent, s->request_len - s->request_sent, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                stream_drop(live, s, strerror(errno), true);
+            return; // Rest goes out on the next writable event
+        }
+        s->request_sent += (size_t)n;
+    }
+
+    s->state = NET_HEADER;
+    if (poller_watch(live->poller, s->fd, s, false) != 0)
+        stream_drop(live, s, strerror(errno), true);
+}
+
+/** @brief Writable socket: completes the connect, or continues the NTRIP request. */
+static void stream_writable(net_live_t *live, net_stream_t *s)
+{
+    if (s->state == NET_CONNECTING)
+    {
+        int err = net_connect_finish(s->fd);
+        if (err != 0)
+        {
+            stream_drop(live, s, strerror(err), true);
+            return;
+        }
+
+        s->n_connects++;
+        printf(COLOR_GREEN "[N:%s] Connected to %s:%s.\n" COLOR_RESET, s->ep.name, s->ep.host, s->ep.port);
+        fflush(stdout);
+        if (s->ep.kind == NET_SOURCE_TCP)
+        {
+            s->state = NET_STREAMING;
+            if (poller_watch(live->poller, s->fd, s, false) != 0)
+                stream_drop(live, s, strerror(errno), true);
+            return;
+        }
+
+        s->request_len = net_ntrip_request(&s->ep, s->request, sizeof(s->request));
+        s->request_sent = 0;
+        if (s->request_len == 0)
+        {
+            stream_drop(live, s, "NTRIP request too long", false);
+            return;
+        }
+        s->state = NET_REQUEST;
+    }
+
+    if (s->state == NET_REQUEST)
+        stream_send_request(live, s);
+}
+
+/**
+ * @brief Frames, decodes and solves every complete RTCM3 frame in @p data.
+ */
+static void decode_bytes(net_stream_t *s, const uint8_t *data, size_t len)
+{
+    rtcm_message_t msg;
+    size_t off = 0;
+    while (off < len)
+    {
+        size_t used = 0;
+        int ready = rtcm3_framer_next(&s->framer, data + off, len - off, &used);
+        off += used;
+        if (!ready)
+            break;
+
+        int status = rtcm3_decode_payload(RTCM3_FRAME_PAYLOAD(&s->framer),
+                                          RTCM3_FRAME_PAYLOAD_LEN(&s->framer), &msg);
+        if (status < 0)
+            s->n_failed++;
+        else if (status == 0)
+            stream_solver_push(&s->solver, &msg);
+    }
+}
+
+/**
+ * @brief Collects the caster's response header from @p data; decodes what follows it.
+ */
+static void stream_header_bytes(net_live_t *live, net_stream_t *s, const uint8_t *data, size_t len)
+{
+    size_t take = sizeof(s->header) - s->header_len;
+    if (take > len)
+        take = len;
+    memcpy(s->header + s->header_len, data, take);
+    s->header_len += take;
+
+    size_t header_len = 0;
+    switch (net_ntrip_response(s->header, s->header_len, &header_len))
+    {
+    case NTRIP_RESPONSE_PARTIAL:
+        return;
+    case NTRIP_RESPONSE_REJECTED:
+        stream_drop(live, s, "Caster rejected the mountpoint or the credentials", false);
+        return;
+    case NTRIP_RESPONSE_RETRY:
+        stream_drop(live, s, "Unexpected caster response", true);
+        return;
+    case NTRIP_RESPONSE_OK:
+        break;
+    }
+
+    printf(COLOR_GREEN "[N:%s] Mountpoint %s accepted.\n" COLOR_RESET, s->ep.name, s->ep.mount);
+    fflush(stdout);
+    s->state = NET_STREAMING;
+    decode_bytes(s, (const uint8_t *)s->header + header_len, s->header_len - header_len);
+    decode_bytes(s, data + take, len - take);
+}
+
+/** @brief Readable socket: drains up to NET_READS_PER_EVENT reads into the header or the decoder. */
+static void stream_readable(net_live_t *live, net_stream_t *s)
+{
+    for (int i = 0; i < NET_READS_PER_EVENT && s->fd >= 0; i++)
+    {
+        ssize_t n = recv(s->fd, live->rx, sizeof(live->rx), 0);
+        if (n > 0)
+        {
+            s->last_rx_ms = clock_ms();
+            s->n_bytes += (unsigned long long)n;
+            if (s->state == NET_STREAMING)
+                decode_bytes(s, live->rx, (size_t)n);
+            else
+                stream_header_bytes(live, s, live->rx, (size_t)n);
+        }
+        else if (n == 0)
+        {
+            stream_drop(live, s, "Connection closed by the server", true);
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                stream_drop(live, s, strerror(errno), true);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Event loop thread: connects, reads, decodes and solves every stream until stopped.
+ *
+ * Returns on the stop flag, when every stream has given up or if waiting for
+ * events fails; then flushes the open epoch of every solver.
+ */
+static void *net_event_loop(void *arg)
+{
+    net_live_t *live = (net_live_t *)arg;
+    net_event_t events[NET_MAX_EVENTS];
+
+    while (!atomic_load(&live->stop))
+    {
+        // Timers: connect idle streams, drop stalled ones
+        int64_t now = clock_ms();
+        int n_active = 0;
+        for (int i = 0; i < live->n_streams; i++)
+        {
+            net_stream_t *s = live->streams[i];
+            if (s->state == NET_FAILED)
+                continue;
+            n_active++;
+            if (s->state == NET_IDLE && now >= s->retry_at_ms)
+                stream_connect(live, s, now);
+            else if (s->state != NET_IDLE && now - s->last_rx_ms > NET_STALL_MS)
+                stream_drop(live, s, s->state == NET_STREAMING ? "No data" : "Timed out", true);
+        }
+        if (n_active == 0)
+            break;
+
+        int n = poller_wait(live->poller, events, NET_MAX_EVENTS, NET_POLL_MS);
+        if (n < 0)
+        {
+            live->loop_errno = errno;
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            net_stream_t *s = events[i].stream;
+            if (s->fd < 0 || s->fd != events[i].fd)
+                continue; // Dropped earlier in this batch
+
+            if (events[i].writable)
+                stream_writable(live, s);
+            if (events[i].readable && s->fd >= 0 && s->state >= NET_REQUEST)
+                stream_readable(live, s);
+        }
+    }
+
+    for (int i = 0; i < live->n_streams; i++)
+    {
+        net_stream_t *s = live->streams[i];
+        if (s->fd >= 0)
+            poller_close(live->poller, s->fd);
+        s->fd = -1;
+        stream_solver_flush(&s->solver);
+    }
+    atomic_store(&live->loop_done, true);
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief stream_fix_handler_t: prints the fix with its stream name and hands it to the stream's track sink. */
+static void on_net_fix(const stream_fix_t *fix, void *ctx)
+{
+    net_stream_t *s = (net_stream_t *)ctx;
+
+    printf("[N:%s][epoch %lu] t=%u ms, %d SVs, LLA = (lat=%.8f deg, lon=%.8f deg, alt=%.3f m)\n",
+           s->ep.name, fix->epoch, fix->time_ms, fix->n_svs, fix->lat_deg, fix->lon_deg, fix->alt_m);
+    fflush(stdout);
+
+    track_sink_add(&s->sink, fix);
+}
+
+/**
+ * @brief Blocks until the user presses Enter (or stdin closes) or the event loop finished.
+ */
+static void wait_for_stop(net_live_t *live)
+{
+    char line[16];
+    while (!atomic_load(&live->loop_done))
+    {
+        struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        int rc = poll(&pfd, 1, NET_POLL_MS);
+        if (rc > 0)
+        {
+            if (!fgets(line, sizeof(line), stdin))
+                clearerr(stdin); // EOF also stops; keep stdin usable for the menu
+            return;
+        }
+        if (rc < 0 && errno != EINTR)
+            return;
+    }
+}
+
+/**
+ * @brief Reads the stream URLs, one per line, until an empty line, EOF or NET_MAX_STREAMS.
+ *
+ * @return Number of sources in @p eps.
+ */
+static int prompt_endpoints(net_endpoint_t *eps)
+{
+    printf("Enter up to %d stream URLs, one per line, then an empty line:\n"
+           "  tcp://host:port   or   ntrip://[user:password@]host[:port]/MOUNTPOINT\n",
+           NET_MAX_STREAMS);
+
+    int n = 0;
+    char line[512];
+    while (n < NET_MAX_STREAMS)
+    {
+        printf("Stream %d: ", n + 1);
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), stdin))
+        {
+            clearerr(stdin);
+            break;
+        }
+        if (line[strspn(line, " \t\r\n")] == '\0')
+            break;
+        if (net_parse_endpoint(line, &eps[n]) == 0)
+            n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Output directory of stream @p index: plots/ for a single stream, else
+ *        plots/<name>, made unique with the stream's position when two names match.
+ */
+static void stream_dir(const net_endpoint_t *eps, int n, int index, char *out, size_t size)
+{
+    if (n == 1)
+    {
+        snprintf(out, size, "plots");
+        return;
+    }
+
+    bool duplicate = false;
+    for (int i = 0; i < n; i++)
+        duplicate |= (i != index && strcmp(eps[i].name, eps[index].name) == 0);
+    if (duplicate)
+        snprintf(out, size, "plots/%s-%d", eps[index].name, index + 1);
+    else
+        snprintf(out, size, "plots/%s", eps[index].name);
+
+    mkdir("plots", 0755);
+    if (mkdir(out, 0755) != 0 && errno != EEXIST)
+        fprintf(stderr, COLOR_YELLOW "Warning: Could not create %s: %s\n" COLOR_RESET, out, strerror(errno));
+}
+
+#endif // NET_INPUT_SUPPORTED
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Live RTCM3 input from NTRIP casters and TCP sockets, one solver per stream.
+ *
+ * Prompts for the stream URLs, then streams until Enter is pressed or every
+ * stream has been rejected. Fixes go to stdout (tagged with the stream name)
+ * and to the receiver track files of each stream.
+ *
+ * @return 0 on success, 1 on error (no valid source, allocation, event loop).
+ */
+int net_input_mode(void)
+{
+#ifndef NET_INPUT_SUPPORTED
+    printf(COLOR_YELLOW "Note: Network input is only implemented for Linux, macOS and the BSDs so far.\n" COLOR_RESET);
+    return 1;
+#else
+    net_endpoint_t eps[NET_MAX_STREAMS];
+    int n_eps = prompt_endpoints(eps);
+    if (n_eps == 0)
+    {
+        printf(COLOR_RED "No stream given.\n" COLOR_RESET);
+        return 1;
+    }
+
+    static net_live_t live; // holds the read buffer; too large for the stack
+    memset(&live, 0, sizeof(live));
+    atomic_init(&live.stop, false);
+    atomic_init(&live.loop_done, false);
+    live.poller = poller_open();
+    if (live.poller < 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Could not create the event loop: %s\n" COLOR_RESET, strerror(errno));
+        return 1;
+    }
+
+    int status = 0;
+    for (int i = 0; i < n_eps; i++)
+    {
+        net_stream_t *s = (net_stream_t *)calloc(1, sizeof(*s)); // Holds a stream solver each
+        if (!s)
+        {
+            fprintf(stderr, COLOR_RED "Error: Out of memory for stream %s.\n" COLOR_RESET, eps[i].name);
+            status = 1;
+            break;
+        }
+        s->ep = eps[i];
+        s->fd = -1;
+        s->state = NET_IDLE;
+        rtcm3_framer_init(&s->framer);
+        stream_solver_init(&s->solver, on_net_fix, s);
+        stream_dir(eps, n_eps, i, s->dir, sizeof(s->dir));
+        track_sink_open(&s->sink, s->dir, TRACK_SINK_ALL);
+        live.streams[live.n_streams++] = s;
+    }
+
+    pthread_t loop;
+    if (status == 0)
+    {
+        printf(COLOR_GREEN "Streaming %d network source(s). Press Enter to stop.\n" COLOR_RESET, live.n_streams);
+        fflush(stdout);
+    }
+    if (status == 0 && pthread_create(&loop, NULL, net_event_loop, &live) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Could not start the network thread.\n" COLOR_RESET);
+        status = 1;
+    }
+    else if (status == 0)
+    {
+        wait_for_stop(&live);
+        atomic_store(&live.stop, true);
+        pthread_join(loop, NULL);
+    }
+
+    if (live.loop_errno != 0)
+    {
+        fprintf(stderr, COLOR_YELLOW "Warning: Waiting for network events failed: %s\n" COLOR_RESET, strerror(live.loop_errno));
+        status = 1;
+    }
+
+    for (int i = 0; i < live.n_streams; i++)
+    {
+        net_stream_t *s = live.streams[i];
+        printf(COLOR_GREEN "[N:%s] %llu bytes, %lu connection(s), %lu frames, %lu CRC errors, %lu undecodable; "
+                           "%lu epochs, %lu solved.\n" COLOR_RESET,
+               s->ep.name, s->n_bytes, s->n_connects, s->framer.n_frames, s->framer.n_crc_errors, s->n_failed,
+               s->solver.n_epochs, s->solver.n_fixes);
+
+        stream_solver_free(&s->solver);
+        if (track_sink_close(&s->sink) != 0)
+            fprintf(stderr, COLOR_YELLOW "Warning: Failed to write the receiver track files in %s.\n" COLOR_RESET, s->dir);
+        free(s);
+    }
+    close(live.poller);
+    return status;
+#endif
+}
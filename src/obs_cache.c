@@ -0,0 +1,483 @@
+/**
+ * @file obs_cache.c
+ * @brief Binary cache of a parsed log's observations and ephemerides, for fast re-runs.
+ *
+ * Parsing a PyRTCM text log is by far the slowest step of file_input_mode(), and
+ * its result only depends on the log. After a successful parse the observation
+ * store and the ephemeris histories of the session (gnss_context_t) are written
+ * next to the log (`<log>` OBS_CACHE_SUFFIX); the next run with an unchanged log
+ * (same size and modification time) maps the cache and fills the same tables
+ * from it instead.
+ *
+ * Layout (native byte order, every section padded to 8 bytes):
+ *  - obs_cache_header_t
+ *  - epoch table: one obs_cache_epoch_t per observation message, in arrival order
+ *  - record columns, in arena order: pseudorange (f64), L5 pseudorange (f64),
+ *    phase range (f64), carrier range (f64), time (u32), satellite index (u8), CNR (u8),
+ *    lock time (u8), cell count (u8)
+ *  - cell columns, in cell arena order: pseudorange (f64), phase range (f64), band (u8),
+ *    CNR (u8), lock time (u8), half-cycle indicator (u8)
+ *  - ephemeris count per satellite (u32 x (MAX_SAT + 1)), then every satellite's
+ *    deduplicated TOE-sorted history (rtcm_1019_ephemeris_t)
+ *  - eph_available (u8 x (MAX_SAT + 1)) and eph_table
+ *
+ * The per-satellite record lists are rebuilt from the index column and the
+ * records' first cells from the cell counts in one pass. A cache
+ * from another version, byte order or structure layout is ignored and rewritten.
+ * Set GPS_RESOLVER_NO_CACHE=1 to neither read nor write caches.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/obs_store.h"
+#include "../include/orbit_cache.h"
+#include "../include/file_map.h"
+#include "../include/obs_cache.h"
+#include "../include/gnss_context.h"
+
+#include <sys/stat.h>
+
+/// File signature
+#define OBS_CACHE_MAGIC "GPSOBSC"
+/// Written as is; reads back differently on a machine of the other endianness
+#define OBS_CACHE_BYTE_ORDER 0x01020304u
+/// Section alignment (bytes)
+#define OBS_CACHE_ALIGN 8u
+
+/// Fixed-size file header
+typedef struct
+{
+    char magic[8];             ///< OBS_CACHE_MAGIC, NUL-padded
+    uint32_t version;          ///< OBS_CACHE_VERSION
+    uint32_t byte_order;       ///< OBS_CACHE_BYTE_ORDER
+    uint64_t src_size;         ///< Size of the source log (bytes)
+    int64_t src_mtime;         ///< Modification time of the source log (s since the epoch)
+    uint32_t eph_size;         ///< sizeof(rtcm_1019_ephemeris_t) of the writer
+    uint32_t observation_type; ///< observation_type after parsing (1 = MSM1, 4 = MSM4)
+    uint64_t n_epochs;         ///< Observation messages
+    uint64_t n_obs;            ///< Observation records
+    uint64_t n_cells;          ///< Signal cells over all records
+    uint64_t n_eph;            ///< Ephemerides over all PRN histories
+} obs_cache_header_t;
+
+/// One observation message (its records follow those of the previous one)
+typedef struct
+{
+    uint32_t time_ms;  ///< DF004: Epoch time in milliseconds of the week
+    uint16_t msg_type; ///< MSM4 message number or 1002
+    uint8_t n_obs;     ///< Number of records
+    uint8_t more;      ///< obs_epoch_t::more (DF393 / DF005) as 0 / 1
+} obs_cache_epoch_t;
+
+_Static_assert(sizeof(obs_cache_header_t) % OBS_CACHE_ALIGN == 0, "header must keep sections aligned");
+_Static_assert(sizeof(obs_cache_epoch_t) == 8, "epoch entries are 8 bytes");
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief True if GPS_RESOLVER_NO_CACHE disables caching. */
+static bool cache_disabled(void)
+{
+    const char *env = getenv("GPS_RESOLVER_NO_CACHE");
+    return env && env[0] != '\0' && env[0] != '0';
+}
+
+/** @brief Builds `<src_path>` OBS_CACHE_SUFFIX; returns -1 if it does not fit. */
+static int cache_path(const char *src_path, char *out, size_t size)
+{
+    int n = snprintf(out, size, "%s%s", src_path, OBS_CACHE_SUFFIX);
+    return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+/** @brief Size and modification time of the source log. */
+static int source_key(const char *src_path, uint64_t *size, int64_t *mtime)
+{
+    struct stat st;
+    if (stat(src_path, &st) != 0)
+        return -1;
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return 0;
+}
+
+/** @brief @p n rounded up to OBS_CACHE_ALIGN. */
+static size_t align_up(size_t n)
+{
+    return (n + OBS_CACHE_ALIGN - 1) & ~(size_t)(OBS_CACHE_ALIGN - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Writes @p bytes from @p data followed by zero padding to OBS_CACHE_ALIGN. */
+static int write_section(FILE *fp, const void *data, size_t bytes)
+{
+    static const uint8_t zeros[OBS_CACHE_ALIGN] = {0};
+    if (bytes > 0 && fwrite(data, 1, bytes, fp) != bytes)
+        return -1;
+    size_t pad = align_up(bytes) - bytes;
+    return (pad > 0 && fwrite(zeros, 1, pad, fp) != pad) ? -1 : 0;
+}
+
+/**
+ * @brief Writes one member of every element of a record or cell arena as a column.
+ *
+ * @param fp        Output file.
+ * @param arena     First element (obs_record_t or obs_cell_t).
+ * @param n         Elements in the arena.
+ * @param elem_size sizeof() one element.
+ * @param col       Scratch buffer of at least @p n * @p size bytes.
+ * @param offset    offsetof() the member in the element.
+ * @param size      sizeof() the member.
+ */
+static int write_column(FILE *fp, const void *arena, size_t n, size_t elem_size, void *col, size_t offset, size_t size)
+{
+    uint8_t *dst = (uint8_t *)col;
+    for (size_t i = 0; i < n; i++)
+        memcpy(dst + i * size, (const uint8_t *)arena + i * elem_size + offset, size);
+    return write_section(fp, col, n * size);
+}
+
+/// write_column() for member @p m of obs_record_t
+#define RECORD_COLUMN(fp, col, m) write_column(fp, store->obs, store->n_obs, sizeof(obs_record_t), col, \
+                                               offsetof(obs_record_t, m), sizeof(((obs_record_t *)0)->m))
+/// write_column() for member @p m of obs_cell_t
+#define CELL_COLUMN(fp, col, m) write_column(fp, store->cells, store->n_cells, sizeof(obs_cell_t), col, \
+                                             offsetof(obs_cell_t, m), sizeof(((obs_cell_t *)0)->m))
+
+/**
+ * @brief Writes every cache section after @p hdr to @p fp.
+ *
+ * @param fp        Output file.
+ * @param ctx       Session whose tables are written.
+ * @param hdr       Filled header.
+ * @param col       Scratch buffer large enough for any one column or the epoch table.
+ * @param eph_count Ephemerides per PRN.
+ * @param available eph_available as bytes.
+ * @return 0 on success, -1 on a write error.
+ */
+static int write_cache_sections(FILE *fp, const gnss_context_t *ctx, const obs_cache_header_t *hdr, void *col,
+                                const uint32_t *eph_count, const uint8_t *available)
+{
+    const obs_store_t *store = &ctx->obs_store;
+    if (write_section(fp, hdr, sizeof(*hdr)) != 0)
+        return -1;
+
+    obs_cache_epoch_t *eps = (obs_cache_epoch_t *)col;
+    for (size_t e = 0; e < store->n_epochs; e++)
+    {
+        eps[e].time_ms = store->epochs[e].time_ms;
+        eps[e].msg_type = store->epochs[e].msg_type;
+        eps[e].n_obs = store->epochs[e].n_obs;
+        eps[e].more = store->epochs[e].more ? 1 : 0;
+    }
+    if (write_section(fp, eps, store->n_epochs * sizeof(obs_cache_epoch_t)) != 0)
+        return -1;
+
+    if (RECORD_COLUMN(fp, col, pseudorange) != 0 || RECORD_COLUMN(fp, col, pseudorange_l5) != 0 ||
+        RECORD_COLUMN(fp, col, phase_range) != 0 || RECORD_COLUMN(fp, col, carrier_range) != 0 ||
+        RECORD_COLUMN(fp, col, time_ms) != 0 || RECORD_COLUMN(fp, col, prn) != 0 ||
+        RECORD_COLUMN(fp, col, cnr) != 0 || RECORD_COLUMN(fp, col, lock_time) != 0 ||
+        RECORD_COLUMN(fp, col, n_cells) != 0)
+        return -1;
+    if (CELL_COLUMN(fp, col, pseudorange) != 0 || CELL_COLUMN(fp, col, phase_range) != 0 ||
+        CELL_COLUMN(fp, col, band) != 0 || CELL_COLUMN(fp, col, cnr) != 0 ||
+        CELL_COLUMN(fp, col, lock_time) != 0 || CELL_COLUMN(fp, col, half_cycle) != 0)
+        return -1;
+
+    if (write_section(fp, eph_count, (MAX_SAT + 1) * sizeof(eph_count[0])) != 0)
+        return -1;
+    size_t eph_bytes = 0;
+    for (int prn = 0; prn <= MAX_SAT; prn++)
+    {
+        size_t bytes = ctx->eph_history[prn].count * sizeof(rtcm_1019_ephemeris_t);
+        if (bytes > 0 && fwrite(ctx->eph_history[prn].eph, 1, bytes, fp) != bytes)
+            return -1;
+        eph_bytes += bytes;
+    }
+    static const uint8_t zeros[OBS_CACHE_ALIGN] = {0};
+    size_t pad = align_up(eph_bytes) - eph_bytes;
+    if (pad > 0 && fwrite(zeros, 1, pad, fp) != pad)
+        return -1;
+    if (write_section(fp, available, (MAX_SAT + 1) * sizeof(available[0])) != 0 ||
+        write_section(fp, ctx->eph_table, sizeof(ctx->eph_table)) != 0)
+        return -1;
+    return 0;
+}
+
+/**
+ * @brief Writes the observation store and ephemeris tables of @p ctx as the cache of @p src_path.
+ *
+ * Written to a temporary file first and renamed, so a crash never leaves a
+ * truncated cache behind.
+ *
+ * @param ctx      Session the log was read into.
+ * @param src_path Path of the parsed log the tables were read from.
+ * @return 0 on success, 1 if caching is disabled, -1 on error (no cache left behind).
+ */
+int obs_cache_save(const gnss_context_t *ctx, const char *src_path)
+{
+    const obs_store_t *store = &ctx->obs_store;
+    if (!src_path || cache_disabled())
+        return 1;
+
+    char path[512], tmp_path[520];
+    obs_cache_header_t hdr = {0};
+    if (cache_path(src_path, path, sizeof(path)) != 0 ||
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path) ||
+        source_key(src_path, &hdr.src_size, &hdr.src_mtime) != 0)
+        return -1;
+
+    memcpy(hdr.magic, OBS_CACHE_MAGIC, sizeof(OBS_CACHE_MAGIC));
+    hdr.version = OBS_CACHE_VERSION;
+    hdr.byte_order = OBS_CACHE_BYTE_ORDER;
+    hdr.eph_size = (uint32_t)sizeof(rtcm_1019_ephemeris_t);
+    hdr.observation_type = ctx->observation_type;
+    hdr.n_epochs = store->n_epochs;
+    hdr.n_obs = store->n_obs;
+    hdr.n_cells = store->n_cells;
+
+    uint32_t eph_count[MAX_SAT + 1] = {0};
+    uint8_t available[MAX_SAT + 1] = {0};
+    for (int prn = 0; prn <= MAX_SAT; prn++)
+    {
+        eph_count[prn] = (uint32_t)ctx->eph_history[prn].count;
+        available[prn] = ctx->eph_available[prn] ? 1 : 0;
+        hdr.n_eph += ctx->eph_history[prn].count;
+    }
+
+    // One scratch column, reused for every section (epoch table included)
+    size_t n_col = store->n_obs > store->n_epochs ? store->n_obs : store->n_epochs;
+    n_col = store->n_cells > n_col ? store->n_cells : n_col;
+    void *col = malloc((n_col ? n_col : 1) * sizeof(double));
+    FILE *fp = col ? fopen(tmp_path, "wb") : NULL;
+    if (!fp)
+    {
+        free(col);
+        return -1;
+    }
+
+    int status = write_cache_sections(fp, ctx, &hdr, col, eph_count, available);
+    free(col);
+    if (fclose(fp) != 0)
+        status = -1;
+    if (status == 0 && rename(tmp_path, path) != 0)
+        status = -1;
+    if (status != 0)
+        remove(tmp_path);
+    return status;
+}
+
+#undef RECORD_COLUMN
+#undef CELL_COLUMN
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Bounds-checked walk over the mapped cache sections
+typedef struct
+{
+    const uint8_t *data; ///< Mapped cache
+    size_t len;          ///< Mapped length
+    size_t off;          ///< Start of the next section
+} cache_cursor_t;
+
+/** @brief Next section of @p bytes (multiplied from @p n * @p size), or NULL if truncated. */
+static const void *take_section(cache_cursor_t *cur, uint64_t n, size_t size)
+{
+    if (size != 0 && n > (SIZE_MAX - OBS_CACHE_ALIGN) / size)
+        return NULL;
+    size_t bytes = align_up((size_t)n * size);
+    if (bytes > cur->len - cur->off)
+        return NULL;
+    const void *p = cur->data + cur->off;
+    cur->off += bytes;
+    return p;
+}
+
+/**
+ * @brief Fills the (empty) tables of @p ctx from a validated cache.
+ *
+ * @return 0 on success, -1 on inconsistent content or allocation failure.
+ */
+static int load_tables(gnss_context_t *ctx, const obs_cache_header_t *hdr, cache_cursor_t *cur)
+{
+    const size_t n_obs = (size_t)hdr->n_obs, n_epochs = (size_t)hdr->n_epochs, n_cells = (size_t)hdr->n_cells;
+    const obs_cache_epoch_t *eps = take_section(cur, hdr->n_epochs, sizeof(obs_cache_epoch_t));
+    const double *pr = take_section(cur, hdr->n_obs, sizeof(double));
+    const double *pr_l5 = take_section(cur, hdr->n_obs, sizeof(double));
+    const double *ph = take_section(cur, hdr->n_obs, sizeof(double));
+    const double *cr = take_section(cur, hdr->n_obs, sizeof(double));
+    const uint32_t *tm = take_section(cur, hdr->n_obs, sizeof(uint32_t));
+    const uint8_t *prn = take_section(cur, hdr->n_obs, sizeof(uint8_t));
+    const uint8_t *cnr = take_section(cur, hdr->n_obs, sizeof(uint8_t));
+    const uint8_t *lock = take_section(cur, hdr->n_obs, sizeof(uint8_t));
+    const uint8_t *rec_cells = take_section(cur, hdr->n_obs, sizeof(uint8_t));
+    const double *cell_pr = take_section(cur, hdr->n_cells, sizeof(double));
+    const double *cell_ph = take_section(cur, hdr->n_cells, sizeof(double));
+    const uint8_t *cell_band = take_section(cur, hdr->n_cells, sizeof(uint8_t));
+    const uint8_t *cell_cnr = take_section(cur, hdr->n_cells, sizeof(uint8_t));
+    const uint8_t *cell_lock = take_section(cur, hdr->n_cells, sizeof(uint8_t));
+    const uint8_t *cell_half = take_section(cur, hdr->n_cells, sizeof(uint8_t));
+    const uint32_t *eph_count = take_section(cur, MAX_SAT + 1, sizeof(uint32_t));
+    const uint8_t *ephs = take_section(cur, hdr->n_eph, sizeof(rtcm_1019_ephemeris_t));
+    const uint8_t *available = take_section(cur, MAX_SAT + 1, sizeof(uint8_t));
+    const uint8_t *table = take_section(cur, MAX_SAT + 1, sizeof(rtcm_1019_ephemeris_t));
+    if (!eps || !pr || !pr_l5 || !ph || !cr || !tm || !prn || !cnr || !lock || !rec_cells || !cell_pr || !cell_ph ||
+        !cell_band || !cell_cnr || !cell_lock || !cell_half || !eph_count || !ephs || !available || !table)
+        return -1;
+
+    // Consistency: the epoch table covers every record, the records every cell, the PRN counts every ephemeris
+    size_t total = 0, prn_total[MAX_SAT + 1] = {0};
+    for (size_t e = 0; e < n_epochs; e++)
+        total += eps[e].n_obs;
+    uint64_t eph_total = 0;
+    for (int p = 0; p <= MAX_SAT; p++)
+        eph_total += eph_count[p];
+    size_t cell_total = 0;
+    for (size_t i = 0; i < n_obs; i++)
+        cell_total += rec_cells[i];
+    if (total != n_obs || cell_total != n_cells || eph_total != hdr->n_eph)
+        return -1;
+    for (size_t i = 0; i < n_obs; i++)
+    {
+        if (prn[i] < 1 || prn[i] > MAX_SAT)
+            return -1;
+        prn_total[prn[i]]++;
+    }
+
+    // Observation store: arenas (columns -> records, cells), epochs, exact-size per-PRN lists
+    obs_store_t *st = &ctx->obs_store;
+    if (grow_array((void **)&st->obs, &st->cap_obs, n_obs, sizeof(obs_record_t)) != 0 ||
+        grow_array((void **)&st->cells, &st->cap_cells, n_cells, sizeof(obs_cell_t)) != 0 ||
+        grow_array((void **)&st->epochs, &st->cap_epochs, n_epochs, sizeof(obs_epoch_t)) != 0)
+        return -1;
+    for (int p = 1; p <= MAX_SAT; p++)
+    {
+        if (grow_array((void **)&st->prn_obs[p], &st->prn_cap[p], prn_total[p], sizeof(size_t)) != 0)
+            return -1;
+    }
+
+    size_t first = 0;
+    for (size_t e = 0; e < n_epochs; e++)
+    {
+        st->epochs[e].time_ms = eps[e].time_ms;
+        st->epochs[e].msg_type = eps[e].msg_type;
+        st->epochs[e].n_obs = eps[e].n_obs;
+        st->epochs[e].more = eps[e].more != 0;
+        st->epochs[e].first = first;
+        first += eps[e].n_obs;
+    }
+    size_t first_cell = 0;
+    for (size_t i = 0; i < n_obs; i++)
+    {
+        obs_record_t *r = &st->obs[i];
+        r->time_ms = tm[i];
+        r->prn = prn[i];
+        r->cnr = cnr[i];
+        r->lock_time = lock[i];
+        r->pseudorange = pr[i];
+        r->pseudorange_l5 = pr_l5[i];
+        r->phase_range = ph[i];
+        r->carrier_range = cr[i];
+        r->n_cells = rec_cells[i];
+        r->first_cell = first_cell;
+        first_cell += rec_cells[i];
+        st->prn_obs[prn[i]][st->prn_count[prn[i]]++] = i;
+    }
+    for (size_t i = 0; i < n_cells; i++)
+    {
+        obs_cell_t *cell = &st->cells[i];
+        cell->pseudorange = cell_pr[i];
+        cell->phase_range = cell_ph[i];
+        cell->band = cell_band[i];
+        cell->cnr = cell_cnr[i];
+        cell->lock_time = cell_lock[i];
+        cell->half_cycle = cell_half[i];
+    }
+    st->n_obs = n_obs;
+    st->n_cells = n_cells;
+    st->n_epochs = n_epochs;
+
+    // Ephemerides: histories as stored (already sorted and deduplicated)
+    for (int p = 0; p <= MAX_SAT; p++)
+    {
+        size_t n = eph_count[p];
+        eph_history_t *hist = &ctx->eph_history[p];
+        if (n > 0)
+        {
+            if (grow_array((void **)&hist->eph, &hist->cap, n, sizeof(rtcm_1019_ephemeris_t)) != 0)
+                return -1;
+            memcpy(hist->eph, ephs, n * sizeof(rtcm_1019_ephemeris_t));
+            ephs += n * sizeof(rtcm_1019_ephemeris_t);
+        }
+        hist->count = n;
+        ctx->eph_available[p] = available[p] != 0;
+        memcpy(&ctx->eph_table[p], table + (size_t)p * sizeof(rtcm_1019_ephemeris_t), sizeof(rtcm_1019_ephemeris_t));
+        orbit_cache_invalidate(&ctx->orbit_cache[p]);
+    }
+
+    ctx->observation_type = (uint8_t)hdr->observation_type;
+    return 0;
+}
+
+/**
+ * @brief Loads the observation store and ephemeris tables of @p ctx from the cache of @p src_path.
+ *
+ * Only used while the tables are still empty. A missing, stale (source size or
+ * modification time changed), foreign or damaged cache is a miss.
+ *
+ * @param ctx      Session to fill.
+ * @param src_path Path of the parsed log.
+ * @return 0 if the tables were loaded, 1 on a miss (tables left empty).
+ */
+int obs_cache_load(gnss_context_t *ctx, const char *src_path)
+{
+    if (!src_path || cache_disabled() || ctx->obs_store.n_epochs != 0 || ctx->obs_store.n_obs != 0)
+        return 1;
+    for (int prn = 0; prn <= MAX_SAT; prn++)
+    {
+        if (ctx->eph_history[prn].count != 0)
+            return 1;
+    }
+
+    char path[512];
+    uint64_t src_size;
+    int64_t src_mtime;
+    if (cache_path(src_path, path, sizeof(path)) != 0 || source_key(src_path, &src_size, &src_mtime) != 0)
+        return 1;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return 1;
+
+    file_map_t map;
+    int status = file_map_open(fp, &map) == 0 ? 0 : 1;
+    fclose(fp); // The mapping stays valid without the stream
+
+    obs_cache_header_t hdr;
+    cache_cursor_t cur = {map.data, map.len, 0};
+    const obs_cache_header_t *h = status == 0 ? take_section(&cur, 1, sizeof(hdr)) : NULL;
+    if (!h)
+    {
+        file_map_close(&map);
+        return 1;
+    }
+    memcpy(&hdr, h, sizeof(hdr));
+
+    if (memcmp(hdr.magic, OBS_CACHE_MAGIC, sizeof(OBS_CACHE_MAGIC)) != 0 ||
+        hdr.version != OBS_CACHE_VERSION || hdr.byte_order != OBS_CACHE_BYTE_ORDER ||
+        hdr.eph_size != sizeof(rtcm_1019_ephemeris_t) ||
+        hdr.src_size != src_size || hdr.src_mtime != src_mtime)
+    {
+        file_map_close(&map);
+        return 1;
+    }
+
+    status = load_tables(ctx, &hdr, &cur);
+    file_map_close(&map);
+
+    if (status != 0)
+    {
+        gnss_context_free(ctx); // Back to empty; the caller parses the log instead
+        return 1;
+    }
+    return 0;
+}
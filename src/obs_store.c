@@ -0,0 +1,311 @@
+/**
+ * @file obs_store.c
+ * @brief Compact, growable storage for decoded observations.
+ *
+ * Replaces the fixed `[MAX_SAT + 1][MAX_EPOCHS]` tables of full MSM structures:
+ * every observation message is reduced to one small record per satellite and
+ * appended once to a shared arena, with a per-satellite index list on top. The
+ * MSM4 signal cells of the records go to a second arena, so every signal of
+ * the message is kept without a fixed per-record cell count. Buffers start
+ * empty and double when full.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/obs_store.h"
+
+/// Initial element count of a buffer on its first allocation
+#define GROW_MIN_CAPACITY 64
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Ensures a heap array can hold at least @p need elements.
+ *
+ * The capacity doubles (starting at GROW_MIN_CAPACITY) until it fits. On failure
+ * the buffer and its capacity are left untouched.
+ *
+ * @param buf       Address of the array pointer (may point to NULL).
+ * @param cap       Address of the current capacity, in elements.
+ * @param need      Required capacity, in elements.
+ * @param elem_size Size of one element in bytes.
+ * @return 0 on success, -1 on allocation failure or size overflow.
+ */
+int grow_array(void **buf, size_t *cap, size_t need, size_t elem_size)
+{
+    if (need <= *cap)
+        return 0;
+
+    size_t new_cap = *cap ? *cap : GROW_MIN_CAPACITY;
+    while (new_cap < need)
+    {
+        if (new_cap > SIZE_MAX / 2)
+            return -1;
+        new_cap *= 2;
+    }
+    if (new_cap > SIZE_MAX / elem_size)
+        return -1;
+
+    void *p = realloc(*buf, new_cap * elem_size);
+    if (!p)
+        return -1;
+
+    *buf = p;
+    *cap = new_cap;
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Appends the records of one observation message.
+ *
+ * Records with a satellite index outside 1–MAX_SAT are dropped. The cells of
+ * every record are copied to the end of the store's cell arena and its
+ * first_cell rebased on it.
+ *
+ * @param store    Store to append to.
+ * @param msg_type Source message number (1074 or 1002).
+ * @param time_ms  DF004 epoch time of the message.
+ * @param more     DF393 / DF005 of the message: more messages of the epoch follow.
+ * @param recs     Records to copy.
+ * @param n_recs   Number of records.
+ * @param cells    Cell arena the first_cell of @p recs index (may be NULL if no record has cells).
+ * @return 0 on success, -1 on invalid input or allocation failure.
+ */
+int obs_store_append(obs_store_t *store, uint16_t msg_type, uint32_t time_ms, bool more,
+                     const obs_record_t *recs, uint8_t n_recs, const obs_cell_t *cells)
+{
+    if (!store || (!recs && n_recs > 0))
+        return -1;
+
+    if (grow_array((void **)&store->obs, &store->cap_obs, store->n_obs + n_recs, sizeof(obs_record_t)) != 0 ||
+        grow_array((void **)&store->epochs, &store->cap_epochs, store->n_epochs + 1, sizeof(obs_epoch_t)) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory while storing observations.\n" COLOR_RESET);
+        return -1;
+    }
+
+    obs_epoch_t *ep = &store->epochs[store->n_epochs];
+    ep->time_ms = time_ms;
+    ep->msg_type = msg_type;
+    ep->n_obs = 0;
+    ep->more = more;
+    ep->first = store->n_obs;
+
+    for (uint8_t i = 0; i < n_recs; i++)
+    {
+        uint8_t prn = recs[i].prn;
+        if (prn < 1 || prn > MAX_SAT)
+            continue;
+
+        if (grow_array((void **)&store->prn_obs[prn], &store->prn_cap[prn],
+                       store->prn_count[prn] + 1, sizeof(size_t)) != 0)
+        {
+            fprintf(stderr, COLOR_RED "Error: Out of memory while indexing satellite %u.\n" COLOR_RESET, prn);
+            return -1;
+        }
+
+        uint8_t n_cells = cells ? recs[i].n_cells : 0;
+        if (grow_array((void **)&store->cells, &store->cap_cells, store->n_cells + n_cells, sizeof(obs_cell_t)) != 0)
+        {
+            fprintf(stderr, COLOR_RED "Error: Out of memory while storing observations.\n" COLOR_RESET);
+            return -1;
+        }
+        if (n_cells > 0)
+            memcpy(&store->cells[store->n_cells], &cells[recs[i].first_cell], n_cells * sizeof(obs_cell_t));
+
+        store->obs[store->n_obs] = recs[i];
+        store->obs[store->n_obs].n_cells = n_cells;
+        store->obs[store->n_obs].first_cell = store->n_cells;
+        store->n_cells += n_cells;
+        store->prn_obs[prn][store->prn_count[prn]++] = store->n_obs;
+        store->n_obs++;
+        ep->n_obs++;
+    }
+
+    store->n_epochs++;
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Reduces an MSM4 message to its observation records and signal cells.
+ *
+ * One obs_record_t per satellite with a primary-signal cell, keyed by its
+ * satellite index (gnss_sat_index() of the message's constellation); phase,
+ * CNR and lock time are taken from that cell. The L5-band pseudorange rides
+ * along (-1 if the satellite has none). Every cell of the satellite, whatever
+ * its signal, is written to @p cells, indexed by the record's first_cell.
+ *
+ * @param msm4  Finalized MSM4 message.
+ * @param recs  Output records.
+ * @param cells Output cells, or NULL to keep none (n_cells is then 0).
+ * @return Number of records written.
+ */
+uint8_t obs_records_from_msm4(const rtcm_1074_msm4_t *msm4, obs_record_t recs[MSM_MAX_SAT], obs_cell_t cells[MAX_CELL])
+{
+    gnss_sys_t sys = gnss_msg_sys(msm4->msg_type);
+    uint8_t n_sat = msm4->n_sat < MSM_MAX_SAT ? msm4->n_sat : MSM_MAX_SAT;
+    uint8_t n_cell = msm4->n_cell < MAX_CELL ? msm4->n_cell : MAX_CELL;
+    uint8_t n = 0, n_out = 0, cell = 0;
+    for (uint8_t s = 0; s < n_sat; s++)
+    {
+        // Cells are satellite-major, in PRN order (see finalize_msm4_cells())
+        uint8_t first = cell;
+        while (first < n_cell && msm4->cell_prn[first] < msm4->prn[s])
+            first++;
+        cell = first;
+        while (cell < n_cell && msm4->cell_prn[cell] == msm4->prn[s] && msm4->prn[s] > 0)
+            cell++;
+
+        uint8_t c = msm4->primary_cell[s];
+        if (c == MSM_NO_CELL || msm4->pseudorange[s] < 0.0)
+            continue;
+
+        recs[n].n_cells = 0;
+        recs[n].first_cell = n_out;
+        for (uint8_t k = first; cells && k < cell; k++, n_out++)
+        {
+            cells[n_out].pseudorange = compute_pseudorange(msm4->pseudorange_integer[s], msm4->pseudorange_mod_1s[s],
+                                                           msm4->pseudorange_fine[k]);
+            cells[n_out].phase_range = msm4->phase_range[k];
+            cells[n_out].band = msm4->cell_sig[k];
+            cells[n_out].cnr = msm4->cnr[k];
+            cells[n_out].lock_time = msm4->lock_time[k];
+            cells[n_out].half_cycle = msm4->half_cycle_amb[k];
+            recs[n].n_cells++;
+        }
+
+        recs[n].time_ms = msm4->time_of_pseudorange;
+        recs[n].prn = (uint8_t)gnss_sat_index(sys, msm4->prn[s]);
+        recs[n].cnr = msm4->cnr[c];
+        recs[n].lock_time = msm4->lock_time[c];
+        recs[n].pseudorange = msm4->pseudorange[s];
+        recs[n].pseudorange_l5 = msm4->pseudorange_l5[s];
+        recs[n].phase_range = msm4->phase_range[c];
+        recs[n].carrier_range = compute_carrier_range(msm4->pseudorange_integer[s], msm4->pseudorange_mod_1s[s],
+                                                      msm4->phase_range[c]);
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Reduces an MSM1 (1002) message to its observation records.
+ *
+ * @param msm1 Finalized MSM1 message.
+ * @param recs Output records.
+ * @return Number of records written.
+ */
+uint8_t obs_records_from_msm1(const rtcm_1002_msm1_t *msm1, obs_record_t recs[MAX_PRN_GPS])
+{
+    uint8_t n = msm1->num_satellites < MAX_PRN_GPS ? msm1->num_satellites : MAX_PRN_GPS;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        recs[i].time_ms = msm1->time_of_week;
+        recs[i].prn = msm1->svs[i];
+        recs[i].cnr = msm1->cnr[i];
+        recs[i].lock_time = msm1->lock_time[i];
+        recs[i].pseudorange = msm1->pseudoranges[i];
+        recs[i].pseudorange_l5 = -1.0;
+        recs[i].n_cells = 0;
+        recs[i].first_cell = 0;
+        recs[i].phase_range = msm1->phase_pr_diff[i];
+        recs[i].carrier_range = compute_carrier_range_msm1(msm1->pseudoranges[i], msm1->phase_pr_diff[i]);
+    }
+    return n;
+}
+
+/**
+ * @brief Appends the observations and signal cells of an MSM4 message as one epoch record.
+ *
+ * See obs_records_from_msm4().
+ *
+ * @param store Destination store.
+ * @param msm4  Finalized MSM4 message.
+ * @return 0 on success, -1 if input is NULL or the store cannot grow.
+ */
+int obs_store_add_msm4(obs_store_t *store, const rtcm_1074_msm4_t *msm4)
+{
+    if (!store || !msm4)
+        return -1;
+
+    obs_record_t recs[MSM_MAX_SAT];
+    obs_cell_t cells[MAX_CELL];
+    uint8_t n = obs_records_from_msm4(msm4, recs, cells);
+    return obs_store_append(store, msm4->msg_type, msm4->time_of_pseudorange, msm4->msm_sync_flag != 0,
+                            recs, n, cells);
+}
+
+/**
+ * @brief Appends the observations of an MSM1 (1002) message as one epoch record.
+ *
+ * @param store Destination store.
+ * @param msm1  Finalized MSM1 message.
+ * @return 0 on success, -1 if input is NULL or the store cannot grow.
+ */
+int obs_store_add_msm1(obs_store_t *store, const rtcm_1002_msm1_t *msm1)
+{
+    if (!store || !msm1)
+        return -1;
+
+    obs_record_t recs[MAX_PRN_GPS];
+    uint8_t n = obs_records_from_msm1(msm1, recs);
+    return obs_store_append(store, msm1->msg_type, msm1->time_of_week, msm1->sync_gps_message_flag != 0,
+                            recs, n, NULL);
+}
+
+/**
+ * @brief Appends every message of @p src to @p dst, in order.
+ *
+ * The result is the store that appending the messages of both one by one
+ * would have produced; used to join the per-thread stores of a parallel ingest.
+ *
+ * @param dst Destination store.
+ * @param src Store to append (left unchanged).
+ * @return 0 on success, -1 if the store cannot grow (dst then holds a prefix of src).
+ */
+int obs_store_merge(obs_store_t *dst, const obs_store_t *src)
+{
+    if (!dst || !src)
+        return -1;
+
+    if (grow_array((void **)&dst->obs, &dst->cap_obs, dst->n_obs + src->n_obs, sizeof(obs_record_t)) != 0 ||
+        grow_array((void **)&dst->cells, &dst->cap_cells, dst->n_cells + src->n_cells, sizeof(obs_cell_t)) != 0 ||
+        grow_array((void **)&dst->epochs, &dst->cap_epochs, dst->n_epochs + src->n_epochs, sizeof(obs_epoch_t)) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory while storing observations.\n" COLOR_RESET);
+        return -1;
+    }
+
+    for (size_t e = 0; e < src->n_epochs; e++)
+    {
+        const obs_epoch_t *ep = &src->epochs[e];
+        if (obs_store_append(dst, ep->msg_type, ep->time_ms, ep->more, &src->obs[ep->first], ep->n_obs, src->cells) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Releases every buffer of a store and resets it to empty.
+ *
+ * @param store Store to free.
+ */
+void obs_store_free(obs_store_t *store)
+{
+    if (!store)
+        return;
+
+    free(store->obs);
+    free(store->cells);
+    free(store->epochs);
+    for (int prn = 0; prn <= MAX_SAT; prn++)
+        free(store->prn_obs[prn]);
+
+    memset(store, 0, sizeof(*store));
+}
@@ -0,0 +1,463 @@
+/**
+ * @file orbit_batch.c
+ * @brief Batched broadcast-orbit propagation of many (ephemeris, time) jobs in one pass.
+ *
+ * The per-satellite path (satellite_eci_position + satellite_eci_to_ecef) solves
+ * Kepler's equation with an early-exit loop and calls libm for every angle.
+ * This kernel keeps the same orbit model (IS-GPS-200) but works on a structure of arrays:
+ *  - Every stage is a straight loop over all jobs with no data-dependent branches
+ *    (invalid jobs are masked through ok[] instead of skipped)
+ *  - Kepler's equation is solved for x = E - M with a fixed number of Newton steps;
+ *    sin/cos(E) come from sin/cos(M) rotated by x, with x's sin/cos from a short
+ *    series, so each job costs two libm sin/cos pairs instead of ~10 and the
+ *    Kepler and rotation loops contain no calls at all
+ *  - Terms that only depend on the elements (mean motion, sin/cos of the argument of
+ *    perigee, inclination and node) are computed once per ephemeris when the job is
+ *    added, not per job; the harmonic corrections and the drift of the inclination
+ *    and node are small angles, applied with the same series
+ *  - The argument of latitude is taken directly from E (no true anomaly / atan2)
+ *  - The ECI -> ECEF rotation is fused in, optionally with velocities and the
+ *    broadcast clock correction
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/satellites.h"
+#include "../include/orbit_batch.h"
+
+/// Initial job capacity of a batch
+#define ORBIT_BATCH_MIN_CAPACITY 64
+
+/// Relativistic clock correction constant F = -2 sqrt(mu) / c^2 (IS-GPS-200, s/sqrt(m))
+#define GPS_REL_F (-4.442807633e-10)
+
+/// Half a GPS week (s), for week crossover of t - toc
+#define HALF_WEEK_S 302400.0
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Collects the addresses of every double array a batch uses with its flags.
+ *
+ * @return Number of entries written to @p arrays (at most 48).
+ */
+static size_t batch_double_arrays(orbit_batch_t *batch, double **arrays[48])
+{
+    size_t n = 0;
+    double **always[] = {&batch->a, &batch->e, &batch->m0, &batch->tk, &batch->t,
+                         &batch->mean_motion, &batch->sqrt1me2,
+                         &batch->cos_w, &batch->sin_w, &batch->cos_i0, &batch->sin_i0, &batch->cos_node, &batch->sin_node,
+                         &batch->i_dot, &batch->node_dot, &batch->cuc, &batch->cus, &batch->crc, &batch->crs,
+                         &batch->cic, &batch->cis,
+                         &batch->ecc_anom, &batch->sin_E, &batch->cos_E, &batch->eci_x, &batch->eci_y, &batch->eci_z,
+                         &batch->x, &batch->y, &batch->z};
+    for (size_t i = 0; i < sizeof(always) / sizeof(always[0]); i++)
+        arrays[n++] = always[i];
+
+    if (batch->flags & ORBIT_BATCH_VELOCITY)
+    {
+        arrays[n++] = &batch->vx;
+        arrays[n++] = &batch->vy;
+        arrays[n++] = &batch->vz;
+    }
+    if (batch->flags & ORBIT_BATCH_CLOCK)
+    {
+        arrays[n++] = &batch->af0;
+        arrays[n++] = &batch->af1;
+        arrays[n++] = &batch->af2;
+        arrays[n++] = &batch->toc;
+        arrays[n++] = &batch->tgd;
+        arrays[n++] = &batch->clk;
+    }
+    return n;
+}
+
+/**
+ * @brief Resets a batch to empty, with no buffers allocated.
+ *
+ * @param batch Batch to initialize.
+ * @param flags ORBIT_BATCH_VELOCITY and/or ORBIT_BATCH_CLOCK, or 0.
+ */
+void orbit_batch_init(orbit_batch_t *batch, unsigned flags)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->flags = flags;
+}
+
+/**
+ * @brief Ensures a batch can hold at least @p n_jobs jobs.
+ *
+ * The capacity doubles (starting at ORBIT_BATCH_MIN_CAPACITY) until it fits.
+ * On failure the stored jobs are kept and the capacity is unchanged.
+ *
+ * @param batch  Batch to grow.
+ * @param n_jobs Required capacity, in jobs.
+ * @return 0 on success, -1 on allocation failure or size overflow.
+ */
+int orbit_batch_reserve(orbit_batch_t *batch, size_t n_jobs)
+{
+    if (!batch)
+        return -1;
+    if (n_jobs <= batch->cap)
+        return 0;
+
+    size_t new_cap = batch->cap ? batch->cap : ORBIT_BATCH_MIN_CAPACITY;
+    while (new_cap < n_jobs)
+    {
+        if (new_cap > SIZE_MAX / 2)
+            return -1;
+        new_cap *= 2;
+    }
+    if (new_cap > SIZE_MAX / sizeof(double))
+        return -1;
+
+    double **arrays[48];
+    size_t n_arrays = batch_double_arrays(batch, arrays);
+    for (size_t i = 0; i < n_arrays; i++)
+    {
+        double *p = realloc(*arrays[i], new_cap * sizeof(double));
+        if (!p)
+            return -1;
+        *arrays[i] = p;
+    }
+
+    uint8_t *ok = realloc(batch->ok, new_cap * sizeof(uint8_t));
+    if (!ok)
+        return -1;
+    batch->ok = ok;
+
+    batch->cap = new_cap;
+    return 0;
+}
+
+/**
+ * @brief Appends one job: propagate @p eph to @p t_sec.
+ *
+ * Mean motion, sqrt(1 - e^2) and the sin / cos of the argument of perigee,
+ * inclination and node only depend on the elements, so they are copied from the
+ * previous job when its elements match and computed here otherwise.
+ *
+ * The ECI frame is the ECEF frame at the start of the week of @p t_sec, so the
+ * node is the broadcast OMEGA0 (referenced to the start of the ephemeris' week),
+ * moved back by one week of Earth rotation when TOE is in the previous week.
+ *
+ * @param batch Batch to append to.
+ * @param eph   Ephemeris to propagate (copied, need not outlive the call).
+ * @param t_sec Propagation time in seconds of the GPS week.
+ * @return 0 on success, -1 on invalid input or allocation failure.
+ */
+int orbit_batch_add(orbit_batch_t *batch, const rtcm_1019_ephemeris_t *eph, double t_sec)
+{
+    if (!batch || !eph || orbit_batch_reserve(batch, batch->n + 1) != 0)
+        return -1;
+
+    const double a = eph->semi_major_axis;
+    const double e = eph->eccentricity;
+    const double i = eph->inclination;
+    const double omega = eph->argument_of_periapsis;
+
+    double tk = t_sec - (double)eph->gps_toe;
+    tk -= 2.0 * HALF_WEEK_S * (double)((tk > HALF_WEEK_S) - (tk < -HALF_WEEK_S));
+    const double node = eph->right_ascension_of_ascending_node - OMEGA_EARTH * ((double)eph->gps_toe + tk - t_sec);
+
+    size_t j = batch->n++;
+    batch->a[j] = a;
+    batch->e[j] = e;
+    batch->m0[j] = eph->mean_anomaly;
+    batch->tk[j] = tk;
+    batch->t[j] = t_sec;
+    batch->ok[j] = (uint8_t)((a > 0.0) && (e >= 0.0 && e < 1.0) && isfinite(i) && isfinite(eph->mean_anomaly));
+
+    batch->i_dot[j] = eph->gps_idot * PI;
+    batch->node_dot[j] = eph->gps_omega_dot * PI;
+    batch->cuc[j] = eph->gps_cuc;
+    batch->cus[j] = eph->gps_cus;
+    batch->crc[j] = eph->gps_crc;
+    batch->crs[j] = eph->gps_crs;
+    batch->cic[j] = eph->gps_cic;
+    batch->cis[j] = eph->gps_cis;
+
+    if (j > 0 && batch->a[j - 1] == a && batch->e[j - 1] == e && batch->last_inc == i &&
+        batch->last_node == node && batch->last_argp == omega)
+    {
+        batch->mean_motion[j] = batch->mean_motion[j - 1];
+        batch->sqrt1me2[j] = batch->sqrt1me2[j - 1];
+        batch->cos_w[j] = batch->cos_w[j - 1];
+        batch->sin_w[j] = batch->sin_w[j - 1];
+        batch->cos_i0[j] = batch->cos_i0[j - 1];
+        batch->sin_i0[j] = batch->sin_i0[j - 1];
+        batch->cos_node[j] = batch->cos_node[j - 1];
+        batch->sin_node[j] = batch->sin_node[j - 1];
+    }
+    else
+    {
+        batch->mean_motion[j] = sqrt(MU / (a * a * a)) + eph->gps_delta_n * PI;
+        batch->sqrt1me2[j] = sqrt(fmax(0.0, 1.0 - e * e));
+        batch->cos_w[j] = cos(omega);
+        batch->sin_w[j] = sin(omega);
+        batch->cos_i0[j] = cos(i);
+        batch->sin_i0[j] = sin(i);
+        batch->cos_node[j] = cos(node);
+        batch->sin_node[j] = sin(node);
+
+        batch->last_inc = i;
+        batch->last_node = node;
+        batch->last_argp = omega;
+    }
+
+    if (batch->flags & ORBIT_BATCH_CLOCK)
+    {
+        batch->af0[j] = eph->gps_af0;
+        batch->af1[j] = eph->gps_af1;
+        batch->af2[j] = eph->gps_af2;
+        batch->toc[j] = (double)eph->gps_toc;
+        batch->tgd[j] = eph->gps_tgd;
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Mean anomaly of job @p j at its propagation time, normalized into [-pi, pi)
+static inline double mean_anomaly_at(const orbit_batch_t *batch, size_t j)
+{
+    const double M = batch->m0[j] + batch->mean_motion[j] * batch->tk[j] + M_PI;
+    return M - 2.0 * M_PI * floor(M * (0.5 / M_PI)) - M_PI;
+}
+
+/**
+ * @brief sin(x) and cos(x) for |x| <= KEPLER_SERIES_MAX_E by Taylor series.
+ *
+ * Truncated after x^9 / x^10, which is below double rounding in that range.
+ */
+static inline void sincos_small(double x, double *s, double *c)
+{
+    const double x2 = x * x;
+    *s = x * (1.0 - x2 * (1.0 / 6.0) * (1.0 - x2 * (1.0 / 20.0) * (1.0 - x2 * (1.0 / 42.0) * (1.0 - x2 * (1.0 / 72.0)))));
+    *c = 1.0 - x2 * 0.5 * (1.0 - x2 * (1.0 / 12.0) * (1.0 - x2 * (1.0 / 30.0) * (1.0 - x2 * (1.0 / 56.0) * (1.0 - x2 * (1.0 / 90.0)))));
+}
+
+/**
+ * @brief Writes the ECI position (and velocity) of job @p j from sin/cos of its eccentric anomaly.
+ *
+ * IS-GPS-200 table 20-IV: argument of latitude, radius and inclination with their
+ * second-harmonic corrections, then the node drifted by OMEGA dot since TOE.
+ * Also clears ok[j] if the orbital radius is not positive and finite.
+ */
+static inline void store_position(orbit_batch_t *batch, size_t j, double sE, double cE, bool want_vel)
+{
+    const double a = batch->a[j], e = batch->e[j], tk = batch->tk[j];
+    const double one_m_ecE = 1.0 - e * cE;
+    const double r0 = a * one_m_ecE;
+
+    // sin / cos of the argument of latitude phi = v + omega, without going through the true anomaly
+    const double cv = (cE - e) / one_m_ecE;
+    const double sv = batch->sqrt1me2[j] * sE / one_m_ecE;
+    const double cphi = cv * batch->cos_w[j] - sv * batch->sin_w[j];
+    const double sphi = sv * batch->cos_w[j] + cv * batch->sin_w[j];
+    const double s2 = 2.0 * sphi * cphi, c2 = cphi * cphi - sphi * sphi;
+
+    double sdu, cdu, sdi, cdi, sdn, cdn;
+    sincos_small(batch->cus[j] * s2 + batch->cuc[j] * c2, &sdu, &cdu);
+    sincos_small(batch->cis[j] * s2 + batch->cic[j] * c2 + batch->i_dot[j] * tk, &sdi, &cdi);
+    sincos_small(batch->node_dot[j] * tk, &sdn, &cdn);
+
+    const double cu = cphi * cdu - sphi * sdu, su = sphi * cdu + cphi * sdu;
+    const double r = r0 + batch->crs[j] * s2 + batch->crc[j] * c2;
+    const double ci = batch->cos_i0[j] * cdi - batch->sin_i0[j] * sdi;
+    const double si = batch->sin_i0[j] * cdi + batch->cos_i0[j] * sdi;
+    const double cn = batch->cos_node[j] * cdn - batch->sin_node[j] * sdn;
+    const double sn = batch->sin_node[j] * cdn + batch->cos_node[j] * sdn;
+    batch->ok[j] = (uint8_t)(batch->ok[j] & (r > 0.0) & (isfinite(r) != 0));
+
+    // Position in the orbital plane, then rotated by the inclination and the node
+    const double xp = r * cu, yp = r * su;
+    batch->eci_x[j] = xp * cn - yp * ci * sn;
+    batch->eci_y[j] = xp * sn + yp * ci * cn;
+    batch->eci_z[j] = yp * si;
+
+    if (want_vel)
+    {
+        // Rates of E, v and of the corrected u, r, i (the harmonics vary at twice v dot)
+        const double E_dot = batch->mean_motion[j] / one_m_ecE;
+        const double v_dot = E_dot * batch->sqrt1me2[j] / one_m_ecE;
+        const double u_dot = v_dot * (1.0 + 2.0 * (batch->cus[j] * c2 - batch->cuc[j] * s2));
+        const double r_dot = a * e * sE * E_dot + 2.0 * v_dot * (batch->crs[j] * c2 - batch->crc[j] * s2);
+        const double i_dot = batch->i_dot[j] + 2.0 * v_dot * (batch->cis[j] * c2 - batch->cic[j] * s2);
+        const double n_dot = batch->node_dot[j];
+
+        const double xp_dot = r_dot * cu - yp * u_dot;
+        const double yp_dot = r_dot * su + xp * u_dot;
+        batch->vx[j] = xp_dot * cn - yp_dot * ci * sn + yp * si * sn * i_dot - batch->eci_y[j] * n_dot;
+        batch->vy[j] = xp_dot * sn + yp_dot * ci * cn - yp * si * cn * i_dot + batch->eci_x[j] * n_dot;
+        batch->vz[j] = yp_dot * si + yp * ci * i_dot;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Propagates every job of the batch.
+ *
+ * Uses the same orbit model and ECEF rotation as satellite_eci_position() and
+ * satellite_eci_to_ecef(). A job is valid (ok[j] == 1) under the same conditions:
+ * a > 0, 0 <= e < 1, finite inclination and mean anomaly, and a positive finite
+ * radius. Outputs of invalid jobs are unspecified.
+ *
+ * With ORBIT_BATCH_CLOCK, clk[j] is af0 + af1 dt + af2 dt^2 + F e sqrt(a) sin E - TGD
+ * with dt = t - toc (week crossover handled), i.e. the L1 C/A satellite clock offset.
+ *
+ * @param batch Batch to propagate.
+ * @return Number of valid jobs.
+ */
+size_t orbit_batch_propagate(orbit_batch_t *batch)
+{
+    if (!batch || batch->n == 0)
+        return 0;
+
+    const size_t n = batch->n;
+    const bool want_vel = (batch->flags & ORBIT_BATCH_VELOCITY) != 0;
+
+    const double *restrict e = batch->e;
+    const double *restrict t = batch->t;
+    double *restrict E = batch->ecc_anom;
+    double *restrict sin_E = batch->sin_E;
+    double *restrict cos_E = batch->cos_E;
+
+    // --- 1) Mean anomaly and its sin/cos (the only libm calls of the orbit itself) ---
+    for (size_t j = 0; j < n; j++)
+    {
+        E[j] = mean_anomaly_at(batch, j);
+        sin_E[j] = sin(E[j]);
+        cos_E[j] = cos(E[j]);
+    }
+
+    // --- 2) Kepler's equation: Newton on x = E - M from x0 = e sin M, in place ---
+    // sin/cos(E) are sin/cos(M) rotated by x, so the loop body is plain arithmetic.
+    for (size_t j = 0; j < n; j++)
+    {
+        const double sM = sin_E[j], cM = cos_E[j];
+        double x = e[j] * sM, sx, cx;
+        for (int it = 0; it < KEPLER_ITERATIONS; it++)
+        {
+            sincos_small(x, &sx, &cx);
+            const double sE = sM * cx + cM * sx, cE = cM * cx - sM * sx;
+            x -= (x - e[j] * sE) / (1.0 - e[j] * cE);
+        }
+        sincos_small(x, &sx, &cx);
+
+        E[j] += x;
+        sin_E[j] = sM * cx + cM * sx;
+        cos_E[j] = cM * cx - sM * sx;
+    }
+
+    // Rare jobs outside the series range: iterative libm solve as in satellite_eci_position()
+    for (size_t j = 0; j < n; j++)
+    {
+        if (!(e[j] > KEPLER_SERIES_MAX_E))
+            continue;
+
+        const double M = mean_anomaly_at(batch, j);
+        double Ej = M;
+        for (int it = 0; it < 10; ++it)
+        {
+            double dE = -(Ej - e[j] * sin(Ej) - M) / (1.0 - e[j] * cos(Ej));
+            Ej += dE;
+            if (fabs(dE) < 1e-12)
+                break;
+        }
+        E[j] = Ej;
+        sin_E[j] = sin(Ej);
+        cos_E[j] = cos(Ej);
+    }
+
+    // --- 3) Corrected orbit-plane position (and velocity) rotated into ECI ---
+    for (size_t j = 0; j < n; j++)
+        store_position(batch, j, sin_E[j], cos_E[j], want_vel);
+
+    // --- 4) ECI -> ECEF by the Earth rotation since the start of the week, as satellite_eci_to_ecef ---
+    {
+        const double *restrict ex = batch->eci_x;
+        const double *restrict ey = batch->eci_y;
+        const double *restrict ez = batch->eci_z;
+        double *restrict x = batch->x;
+        double *restrict y = batch->y;
+        double *restrict z = batch->z;
+        double *restrict vx = batch->vx;
+        double *restrict vy = batch->vy;
+        for (size_t j = 0; j < n; j++)
+        {
+            const double theta = OMEGA_EARTH * t[j];
+            const double c = cos(theta), s = sin(theta);
+
+            x[j] = c * ex[j] + s * ey[j];
+            y[j] = -s * ex[j] + c * ey[j];
+            z[j] = ez[j];
+
+            if (want_vel)
+            {
+                // d/dt of the rotation adds the frame term (z velocity is unchanged)
+                const double vx_eci = vx[j], vy_eci = vy[j];
+                vx[j] = c * vx_eci + s * vy_eci + OMEGA_EARTH * y[j];
+                vy[j] = -s * vx_eci + c * vy_eci - OMEGA_EARTH * x[j];
+            }
+        }
+    }
+
+    // --- 5) Broadcast clock polynomial + relativistic term - TGD ---
+    if (batch->flags & ORBIT_BATCH_CLOCK)
+    {
+        const double *restrict a = batch->a;
+        const double *restrict af0 = batch->af0;
+        const double *restrict af1 = batch->af1;
+        const double *restrict af2 = batch->af2;
+        const double *restrict toc = batch->toc;
+        const double *restrict tgd = batch->tgd;
+        double *restrict clk = batch->clk;
+        for (size_t j = 0; j < n; j++)
+        {
+            double dt = t[j] - toc[j];
+            dt -= 2.0 * HALF_WEEK_S * (double)((dt > HALF_WEEK_S) - (dt < -HALF_WEEK_S));
+
+            const double rel = GPS_REL_F * e[j] * sqrt(a[j]) * sin_E[j];
+            clk[j] = af0[j] + af1[j] * dt + af2[j] * dt * dt + rel - tgd[j];
+        }
+    }
+
+    size_t n_ok = 0;
+    for (size_t j = 0; j < n; j++)
+        n_ok += batch->ok[j];
+    return n_ok;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Drops all jobs but keeps the buffers for reuse.
+ *
+ * @param batch Batch to clear.
+ */
+void orbit_batch_clear(orbit_batch_t *batch)
+{
+    if (batch)
+        batch->n = 0;
+}
+
+/**
+ * @brief Releases every buffer of a batch and resets it to empty (flags are kept).
+ *
+ * @param batch Batch to free.
+ */
+void orbit_batch_free(orbit_batch_t *batch)
+{
+    if (!batch)
+        return;
+
+    double **arrays[48];
+    size_t n_arrays = batch_double_arrays(batch, arrays);
+    for (size_t i = 0; i < n_arrays; i++)
+        free(*arrays[i]);
+    free(batch->ok);
+
+    orbit_batch_init(batch, batch->flags);
+}
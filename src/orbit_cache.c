@@ -0,0 +1,290 @@
+/**
+ * @file orbit_cache.c
+ * @brief Per-PRN satellite position cache with Lagrange interpolation between nodes.
+ *
+ * Broadcast orbits are smooth over minutes, so at high observation rates most of
+ * the Kepler solutions computed per (PRN, epoch) are redundant. The cache
+ * evaluates an ephemeris only on a fixed ORBIT_CACHE_NODE_S grid (in one orbit
+ * batch, see orbit_batch.c) and answers position queries between the nodes by
+ * ORBIT_CACHE_POINTS-point Lagrange interpolation of the ECI and ECEF nodes.
+ * The nodes also carry the analytic ECEF velocity of the orbit kernel, which is
+ * interpolated with the same weights.
+ *
+ * With 30 s nodes and 6 points the interpolation error stays below 1e-6 m over
+ * the whole ephemeris validity window, far below the broadcast orbit error.
+ *
+ * A cache is keyed by the (TOE, IODE) of its ephemeris: a query with another
+ * ephemeris, or an explicit orbit_cache_invalidate() when store_ephemeris()
+ * stores new data for the PRN, starts it over.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/obs_store.h"
+#include "../include/eph_index.h"
+#include "../include/orbit_batch.h"
+#include "../include/orbit_cache.h"
+
+/// Largest node range kept per cache: the ephemeris validity window plus the query window
+#define ORBIT_CACHE_MAX_NODES ((size_t)(2.0 * EPH_MAX_AGE_S / ORBIT_CACHE_NODE_S) + 2 * ORBIT_CACHE_POINTS)
+
+_Static_assert(ORBIT_CACHE_POINTS == 6, "lagrange_inv_denom[] is tabulated for 6 points");
+
+/// 1 / prod_{m != i} (i - m) for equally spaced nodes 0..5
+static const double lagrange_inv_denom[ORBIT_CACHE_POINTS] = {
+    -1.0 / 120.0, 1.0 / 24.0, -1.0 / 12.0, 1.0 / 12.0, -1.0 / 24.0, 1.0 / 120.0};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Grid index of the first node of the interpolation window for @p t_sec (t lies between its two middle nodes)
+static inline long window_start(double t_sec)
+{
+    return (long)floor(t_sec / ORBIT_CACHE_NODE_S) - (ORBIT_CACHE_POINTS / 2 - 1);
+}
+
+/**
+ * @brief Number of nodes needed to answer every query in [t_from, t_to].
+ *
+ * Lets callers compare the node count against their number of queries before
+ * deciding between the cache and direct propagation.
+ */
+size_t orbit_cache_nodes_for(double t_from, double t_to)
+{
+    if (!(t_from <= t_to))
+        return 0;
+    return (size_t)(window_start(t_to) - window_start(t_from)) + ORBIT_CACHE_POINTS;
+}
+
+/**
+ * @brief Ensures the node buffers of a cache can hold @p n_nodes nodes.
+ *
+ * @return 0 on success, -1 on allocation failure (capacity unchanged).
+ */
+static int reserve_nodes(orbit_cache_t *cache, size_t n_nodes)
+{
+    if (n_nodes <= cache->cap)
+        return 0;
+
+    size_t cap_eci = cache->cap, cap_ecef = cache->cap, cap_vel = cache->cap, cap_clk = cache->cap, cap_ok = cache->cap;
+    if (grow_array((void **)&cache->eci, &cap_eci, n_nodes, sizeof(cache->eci[0])) != 0 ||
+        grow_array((void **)&cache->ecef, &cap_ecef, n_nodes, sizeof(cache->ecef[0])) != 0 ||
+        grow_array((void **)&cache->vel, &cap_vel, n_nodes, sizeof(cache->vel[0])) != 0 ||
+        grow_array((void **)&cache->clk, &cap_clk, n_nodes, sizeof(cache->clk[0])) != 0 ||
+        grow_array((void **)&cache->ok, &cap_ok, n_nodes, sizeof(cache->ok[0])) != 0)
+        return -1;
+
+    cache->cap = cap_eci; // all five grow in the same steps
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Makes a cache able to answer queries for @p eph over [t_from, t_to].
+ *
+ * Nodes already cached for the same ephemeris are kept; only the missing ones
+ * are propagated, all in one orbit batch. A cache holding another ephemeris
+ * is restarted.
+ *
+ * @param cache  Cache of the ephemeris' PRN.
+ * @param eph    Ephemeris the queries will use.
+ * @param t_from First query time (s of week).
+ * @param t_to   Last query time (s of week), >= t_from.
+ * @return 0 on success, -1 on invalid input or allocation failure.
+ */
+int orbit_cache_prepare(orbit_cache_t *cache, const rtcm_1019_ephemeris_t *eph, double t_from, double t_to)
+{
+    if (!cache || !eph || !(t_from <= t_to))
+        return -1;
+
+    if (cache->valid && (cache->toe != eph->gps_toe || cache->iode != eph->gps_iode))
+        orbit_cache_invalidate(cache);
+
+    // Needed node range [lo, hi), merged with the cached one when it stays bounded
+    long lo = window_start(t_from);
+    long hi = window_start(t_to) + ORBIT_CACHE_POINTS;
+    if (cache->valid)
+    {
+        long c_lo = cache->k_first, c_hi = cache->k_first + (long)cache->n_nodes;
+        if (lo >= c_lo && hi <= c_hi)
+            return 0; // Already covered
+
+        long u_lo = lo < c_lo ? lo : c_lo;
+        long u_hi = hi > c_hi ? hi : c_hi;
+        if ((size_t)(u_hi - u_lo) <= ORBIT_CACHE_MAX_NODES)
+        {
+            lo = u_lo;
+            hi = u_hi;
+        }
+        else
+        {
+            orbit_cache_invalidate(cache);
+        }
+    }
+
+    size_t n_new = (size_t)(hi - lo);
+    if (reserve_nodes(cache, n_new) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory while caching orbit nodes.\n" COLOR_RESET);
+        return -1;
+    }
+
+    // Move the kept nodes to their index in the merged range
+    size_t n_old = cache->valid ? cache->n_nodes : 0;
+    size_t shift = cache->valid ? (size_t)(cache->k_first - lo) : 0;
+    if (n_old > 0 && shift > 0)
+    {
+        memmove(&cache->eci[shift], &cache->eci[0], n_old * sizeof(cache->eci[0]));
+        memmove(&cache->ecef[shift], &cache->ecef[0], n_old * sizeof(cache->ecef[0]));
+        memmove(&cache->vel[shift], &cache->vel[0], n_old * sizeof(cache->vel[0]));
+        memmove(&cache->clk[shift], &cache->clk[0], n_old * sizeof(cache->clk[0]));
+        memmove(&cache->ok[shift], &cache->ok[0], n_old * sizeof(cache->ok[0]));
+    }
+
+    // Propagate the missing nodes [0, shift) and [shift + n_old, n_new) in one batch
+    orbit_batch_t batch;
+    orbit_batch_init(&batch, ORBIT_BATCH_VELOCITY | ORBIT_BATCH_CLOCK);
+    if (orbit_batch_reserve(&batch, n_new - n_old) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory while caching orbit nodes.\n" COLOR_RESET);
+        orbit_batch_free(&batch);
+        return -1;
+    }
+
+    for (size_t idx = 0; idx < n_new; idx++)
+    {
+        if (idx >= shift && idx < shift + n_old)
+            continue;
+        orbit_batch_add(&batch, eph, (double)(lo + (long)idx) * ORBIT_CACHE_NODE_S);
+    }
+    orbit_batch_propagate(&batch);
+
+    size_t j = 0;
+    for (size_t idx = 0; idx < n_new; idx++)
+    {
+        if (idx >= shift && idx < shift + n_old)
+            continue;
+        cache->eci[idx][0] = batch.eci_x[j];
+        cache->eci[idx][1] = batch.eci_y[j];
+        cache->eci[idx][2] = batch.eci_z[j];
+        cache->ecef[idx][0] = batch.x[j];
+        cache->ecef[idx][1] = batch.y[j];
+        cache->ecef[idx][2] = batch.z[j];
+        cache->vel[idx][0] = batch.vx[j];
+        cache->vel[idx][1] = batch.vy[j];
+        cache->vel[idx][2] = batch.vz[j];
+        cache->clk[idx] = batch.clk[j];
+        cache->ok[idx] = batch.ok[j];
+        j++;
+    }
+    orbit_batch_free(&batch);
+
+    cache->valid = true;
+    cache->toe = eph->gps_toe;
+    cache->iode = eph->gps_iode;
+    cache->k_first = lo;
+    cache->n_nodes = n_new;
+    return 0;
+}
+
+/**
+ * @brief Interpolates the satellite position (velocity, clock) at @p t_sec from the cached nodes.
+ *
+ * @param cache    Prepared cache (see orbit_cache_prepare()).
+ * @param t_sec    Query time (s of week).
+ * @param eci      Output ECI position (m), may be NULL.
+ * @param ecef     Output ECEF position (m), may be NULL.
+ * @param ecef_vel Output ECEF velocity (m/s), may be NULL.
+ * @param sat_clk  Output satellite clock offset (s), may be NULL.
+ * @return 0 on success, -1 if @p t_sec is not covered or a node in its window is invalid.
+ */
+int orbit_cache_position(const orbit_cache_t *cache, double t_sec, double eci[3], double ecef[3], double ecef_vel[3],
+                         double *sat_clk)
+{
+    if (!cache || !cache->valid)
+        return -1;
+
+    long k0 = window_start(t_sec);
+    if (k0 < cache->k_first || k0 + ORBIT_CACHE_POINTS > cache->k_first + (long)cache->n_nodes)
+        return -1;
+
+    size_t base = (size_t)(k0 - cache->k_first);
+    for (int i = 0; i < ORBIT_CACHE_POINTS; i++)
+    {
+        if (!cache->ok[base + (size_t)i])
+            return -1;
+    }
+
+    // Lagrange weights at u (node units from the window start), via prefix/suffix products
+    const double u = t_sec / ORBIT_CACHE_NODE_S - (double)k0;
+    double left[ORBIT_CACHE_POINTS], right[ORBIT_CACHE_POINTS];
+    left[0] = 1.0;
+    right[ORBIT_CACHE_POINTS - 1] = 1.0;
+    for (int i = 1; i < ORBIT_CACHE_POINTS; i++)
+        left[i] = left[i - 1] * (u - (double)(i - 1));
+    for (int i = ORBIT_CACHE_POINTS - 2; i >= 0; i--)
+        right[i] = right[i + 1] * (u - (double)(i + 1));
+
+    double w[ORBIT_CACHE_POINTS];
+    for (int i = 0; i < ORBIT_CACHE_POINTS; i++)
+        w[i] = left[i] * right[i] * lagrange_inv_denom[i];
+
+    for (int c = 0; c < 3; c++)
+    {
+        double s_eci = 0.0, s_ecef = 0.0, s_vel = 0.0;
+        for (int i = 0; i < ORBIT_CACHE_POINTS; i++)
+        {
+            s_eci += w[i] * cache->eci[base + (size_t)i][c];
+            s_ecef += w[i] * cache->ecef[base + (size_t)i][c];
+            s_vel += w[i] * cache->vel[base + (size_t)i][c];
+        }
+        if (eci)
+            eci[c] = s_eci;
+        if (ecef)
+            ecef[c] = s_ecef;
+        if (ecef_vel)
+            ecef_vel[c] = s_vel;
+    }
+    if (sat_clk)
+    {
+        double s_clk = 0.0;
+        for (int i = 0; i < ORBIT_CACHE_POINTS; i++)
+            s_clk += w[i] * cache->clk[base + (size_t)i];
+        *sat_clk = s_clk;
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Drops the cached nodes (buffers are kept for reuse).
+ *
+ * @param cache Cache to invalidate.
+ */
+void orbit_cache_invalidate(orbit_cache_t *cache)
+{
+    if (!cache)
+        return;
+
+    cache->valid = false;
+    cache->n_nodes = 0;
+}
+
+/**
+ * @brief Releases the node buffers of a cache and resets it to empty.
+ *
+ * @param cache Cache to free.
+ */
+void orbit_cache_free(orbit_cache_t *cache)
+{
+    if (!cache)
+        return;
+
+    free(cache->eci);
+    free(cache->ecef);
+    free(cache->vel);
+    free(cache->clk);
+    free(cache->ok);
+    memset(cache, 0, sizeof(*cache));
+}
@@ -0,0 +1,181 @@
+/**
+ * @file perf_stats.c
+ * @brief Stage timers and run counters of the batch pipeline, reported as JSON.
+ *
+ * file_input_mode() brackets each stage with perf_stage_begin() /
+ * perf_stage_end() (monotonic clock, main thread only) and the readers and
+ * solvers feed the counters. Writing a summary costs one clock read per stage
+ * and one relaxed atomic add per published tally: readers and parse workers
+ * count into a local perf_tally_t and publish it once when they finish, and
+ * the solver adds its Newton iterations once per epoch. That is cheap enough
+ * to stay enabled in every build.
+ *
+ * perf_write_json() writes the timings, counters and peak RSS of the run; the
+ * benchmark harness (bench/gps_bench.c) reads the same figures through the getters.
+ */
+
+#include "../include/algo.h"
+#include "../include/perf_stats.h"
+
+#include <stdatomic.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+/// JSON names of perf_stage_t
+static const char *const stage_names[PERF_STAGE_COUNT] = {
+    "ingest", "sort_satellites", "satellite_position_eci_ecef",
+    "estimate_receiver_positions", "satellite_orbit_eci", "output"};
+
+/// JSON names of perf_counter_t
+static const char *const counter_names[PERF_COUNTER_COUNT] = {
+    "lines_read", "frames_read", "crc_errors",
+    "messages_1002", "messages_1019", "messages_1074", "messages_1042_1045_1046", "messages_1084_1094_1124",
+    "messages_msm_other", "messages_unsupported",
+    "parse_failures", "epochs_solved", "epochs_skipped", "newton_iterations",
+    "newton_unconverged", "raim_exclusions", "raim_alerts", "orbit_sweeps"};
+
+static atomic_uint_fast64_t counters[PERF_COUNTER_COUNT]; ///< Shared counters (relaxed)
+static int64_t stage_start_ns[PERF_STAGE_COUNT];          ///< perf_stage_begin() time
+static int64_t stage_ns[PERF_STAGE_COUNT];                ///< Accumulated stage time
+static int64_t run_start_ns;                              ///< perf_reset() time
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Nanoseconds on the monotonic clock (UTC wall clock without POSIX). */
+int64_t perf_now_ns(void)
+{
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** @brief Zeroes every timer and counter and starts the run clock. */
+void perf_reset(void)
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+        atomic_store_explicit(&counters[i], 0, memory_order_relaxed);
+    memset(stage_start_ns, 0, sizeof(stage_start_ns));
+    memset(stage_ns, 0, sizeof(stage_ns));
+    run_start_ns = perf_now_ns();
+}
+
+/** @brief Starts timing @p stage (call from the main thread). */
+void perf_stage_begin(perf_stage_t stage)
+{
+    stage_start_ns[stage] = perf_now_ns();
+}
+
+/** @brief Stops timing @p stage and adds the elapsed time to it. */
+void perf_stage_end(perf_stage_t stage)
+{
+    stage_ns[stage] += perf_now_ns() - stage_start_ns[stage];
+}
+
+/** @brief Adds @p n to @p counter (any thread). */
+void perf_count(perf_counter_t counter, uint64_t n)
+{
+    atomic_fetch_add_explicit(&counters[counter], n, memory_order_relaxed);
+}
+
+/** @brief Publishes a local tally (any thread). */
+void perf_add_tally(const perf_tally_t *tally)
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (tally->n[i] != 0)
+            atomic_fetch_add_explicit(&counters[i], tally->n[i], memory_order_relaxed);
+    }
+}
+
+/** @brief Current value of @p counter. */
+uint64_t perf_counter_value(perf_counter_t counter)
+{
+    return (uint64_t)atomic_load_explicit(&counters[counter], memory_order_relaxed);
+}
+
+/** @brief Accumulated time of @p stage in nanoseconds. */
+int64_t perf_stage_ns(perf_stage_t stage)
+{
+    return stage_ns[stage];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Peak resident set size of the process in KiB, or -1 if unknown. */
+long perf_peak_rss_kib(void)
+{
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return -1;
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024; // bytes on macOS
+#else
+    return ru.ru_maxrss; // KiB on Linux and the BSDs
+#endif
+#endif
+}
+
+/** @brief Writes @p s as a JSON string literal. */
+static void write_json_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+/**
+ * @brief Writes the run summary (stage times, counters, peak RSS) as JSON.
+ *
+ * @param path  Output file.
+ * @param input Input log path recorded in the summary (may be NULL).
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int perf_write_json(const char *path, const char *input)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return -1;
+
+    fprintf(fp, "{\n  \"input\": ");
+    write_json_string(fp, input ? input : "");
+    fprintf(fp, ",\n  \"threads\": %d,\n", configured_thread_count());
+    fprintf(fp, "  \"total_ms\": %.3f,\n", (double)(perf_now_ns() - run_start_ns) * 1e-6);
+
+    fprintf(fp, "  \"stages_ms\": {\n");
+    for (int i = 0; i < PERF_STAGE_COUNT; i++)
+        fprintf(fp, "    \"%s\": %.3f%s\n", stage_names[i], (double)stage_ns[i] * 1e-6, i + 1 < PERF_STAGE_COUNT ? "," : "");
+    fprintf(fp, "  },\n");
+
+    fprintf(fp, "  \"counters\": {\n");
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+        fprintf(fp, "    \"%s\": %llu%s\n", counter_names[i],
+                (unsigned long long)atomic_load_explicit(&counters[i], memory_order_relaxed),
+                i + 1 < PERF_COUNTER_COUNT ? "," : "");
+    fprintf(fp, "  },\n");
+
+    long rss = perf_peak_rss_kib();
+    if (rss >= 0)
+        fprintf(fp, "  \"peak_rss_kib\": %ld\n}\n", rss);
+    else
+        fprintf(fp, "  \"peak_rss_kib\": null\n}\n");
+
+    return fclose(fp) == 0 ? 0 : -1;
+}
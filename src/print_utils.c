@@ -13,6 +13,7 @@
 
 #include "../include/algo.h"
 #include "../include/df_parser.h"
+#include "../include/gnss_context.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -178,21 +179,22 @@ void print_msm4(const rtcm_1074_msm4_t *msm4)
     printf("\n-- Satellite PRNs --\n");
     for (int i = 0; i < msm4->n_sat; i++)
     {
-        printf("  PRN_%02d: %u  | Integer PR: %u  | Mod PR: %.12f | Fine PR: %.24f | Full PR: %.24f\n",
+        printf("  PRN_%02d: %u  | Integer PR: %u  | Mod PR: %.12f | Full PR: %.24f | Full L5 PR: %.24f\n",
                i + 1,
                msm4->prn[i],
                msm4->pseudorange_integer[i],
                msm4->pseudorange_mod_1s[i],
-               msm4->pseudorange_fine[i],
-               msm4->pseudorange[i]);
+               msm4->pseudorange[i],
+               msm4->pseudorange_l5[i]);
     }
 
-    printf("\n-- L1C Cell Observations --\n");
+    printf("\n-- Cell Observations --\n");
     for (int i = 0; i < msm4->n_cell; i++)
     {
         printf("  Cell %02d:\n", i + 1);
         printf("    PRN             : %u\n", msm4->cell_prn[i]);
-        printf("    Signal ID       : %u (1 = L1C)\n", msm4->cell_sig[i]);
+        printf("    Band            : %u (1 = primary, 2 = L5)\n", msm4->cell_sig[i]);
+        printf("    Fine PR         : %.24f\n", msm4->pseudorange_fine[i]);
         printf("    Lock Time       : %u\n", msm4->lock_time[i]);
         printf("    CNR             : %u dBHz\n", msm4->cnr[i]);
     }
@@ -204,23 +206,27 @@ void print_msm4(const rtcm_1074_msm4_t *msm4)
 
 /**
  * @brief Prints the stored pseudoranges for all satellites.
- * This function iterates through the global pseudorange table
- * and prints the details for each satellite that has valid ephemeris data.
+ * This function walks each PRN's records in the observation store of @p ctx
+ * (arrival order) and prints the details for each satellite that has observations.
+ *
+ * @param ctx Session state.
  */
-void print_all_stored_pseudoranges(void)
+void print_all_stored_pseudoranges(const gnss_context_t *ctx)
 {
+    const obs_store_t *store = &ctx->obs_store;
     for (int prn = 1; prn <= MAX_SAT; prn++)
     {
-        if (pseudorange_count[prn] == 0)
+        if (store->prn_count[prn] == 0)
             continue;
 
-        printf("\n========== PRN %d ==========\n", prn);
+        char name[GNSS_SAT_NAME_LEN];
+        printf("\n========== %s ==========\n", gnss_sat_name(prn, name));
         printf("%-8s | %-18s\n", "Epoch", "Pseudorange (m)");
         printf("---------+--------------------\n");
 
-        for (size_t j = 0; j < pseudorange_count[prn]; j++)
+        for (size_t j = 0; j < store->prn_count[prn]; j++)
         {
-            printf("%-8zu | %-18.3f\n", j, pseudorange_history[prn][j]);
+            printf("%-8zu | %-18.3f\n", j, OBS_STORE_PRN_RECORD(store, prn, j)->pseudorange);
         }
     }
 }
@@ -230,10 +236,14 @@ void print_all_stored_pseudoranges(void)
 /**
  * @brief Prints the full ephemeris history for all PRNs.
  *
- * Iterates over all PRNs and prints every stored ephemeris entry from eph_history[].
+ * Iterates over all PRNs and prints every stored ephemeris entry from ctx->eph_history[].
+ *
+ * @param ctx Session state.
  */
-void print_all_stored_ephemeris(void)
+void print_all_stored_ephemeris(const gnss_context_t *ctx)
 {
+    const eph_history_t *eph_history = ctx->eph_history;
+
     printf("\n========== Stored Ephemeris History ==========\n");
 
     for (int prn = 1; prn <= MAX_SAT; prn++)
@@ -241,7 +251,8 @@ void print_all_stored_ephemeris(void)
         if (eph_history[prn].count == 0)
             continue; // No entries for this PRN
 
-        printf("\nPRN %d: %zu entries stored\n", prn, eph_history[prn].count);
+        char name[GNSS_SAT_NAME_LEN];
+        printf("\n%s: %zu entries stored\n", gnss_sat_name(prn, name), eph_history[prn].count);
 
         for (size_t idx = 0; idx < eph_history[prn].count; idx++)
         {
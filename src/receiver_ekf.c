@@ -0,0 +1,275 @@
+/**
+ * @file receiver_ekf.c
+ * @brief Recursive (extended Kalman) receiver position / velocity / clock filter.
+ *
+ * The snapshot solver (receiver_position.c) solves every epoch on its own and
+ * needs several Newton iterations per epoch. This filter instead carries the
+ * receiver state from epoch to epoch:
+ *  - Prediction with a constant-velocity motion model and a bias / drift clock
+ *    model (one bias per constellation, one shared drift)
+ *  - One measurement update per epoch: the pseudoranges are applied one at a time
+ *    (sequential scalar updates), linearized at the current estimate and weighted
+ *    like the batch solve (see wls_pseudorange_variance())
+ *  - Seeding from a weighted least-squares snapshot, and reseeding after long gaps,
+ *    time jumps or outages longer than EKF_MAX_OUTAGE_MS
+ *
+ * Epochs with fewer than MIN_SATS satellites still get a fix for up to
+ * EKF_MAX_OUTAGE_MS after the last full epoch, since the prediction supplies
+ * the missing geometry.
+ */
+
+#include "../include/algo.h"
+#include "../include/receiver.h"
+#include "../include/receiver_ekf.h"
+
+#define MS_PER_WEEK (7u * 86400000u)
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Resets a filter to the unseeded state.
+ *
+ * @param f Filter to initialize.
+ */
+void rx_ekf_init(rx_ekf_t *f)
+{
+    if (f)
+        memset(f, 0, sizeof(*f));
+}
+
+/**
+ * @brief Seeds the filter from a snapshot solve of the epoch.
+ *
+ * @return 0 on success, -1 if the epoch cannot be solved on its own.
+ */
+static int ekf_seed(rx_ekf_t *f, uint32_t t_ms, int n_svs, const double ecefs[][3], const double pseudoranges[],
+                    const uint8_t systems[], const double var_factor[])
+{
+    const rx_wls_opts_t opts = {.var_factor = var_factor, .raim = true};
+    double state[RX_STATE_MAX];
+    if (solve_receiver_epoch_wls(n_svs, ecefs, pseudoranges, systems, &opts, NULL, state, NULL) != 0)
+        return -1;
+
+    rx_ekf_init(f);
+    for (int j = 0; j < 3; ++j)
+    {
+        f->x[EKF_POS + j] = state[j];
+        f->P[EKF_POS + j][EKF_POS + j] = EKF_INIT_POS_SIGMA_M * EKF_INIT_POS_SIGMA_M;
+        f->P[EKF_VEL + j][EKF_VEL + j] = EKF_INIT_VEL_SIGMA_MS * EKF_INIT_VEL_SIGMA_MS;
+    }
+    for (int i = 0; i < n_svs; ++i)
+        f->clk_valid[systems[i]] = true;
+    for (int sys = 0; sys < GNSS_SYS_COUNT; ++sys)
+    {
+        if (!f->clk_valid[sys])
+            continue;
+        f->x[EKF_CLK + sys] = state[3 + sys];
+        f->P[EKF_CLK + sys][EKF_CLK + sys] = EKF_INIT_POS_SIGMA_M * EKF_INIT_POS_SIGMA_M;
+    }
+    f->P[EKF_DRIFT][EKF_DRIFT] = EKF_INIT_VEL_SIGMA_MS * EKF_INIT_VEL_SIGMA_MS;
+
+    f->initialized = true;
+    f->t_ms = t_ms;
+    f->last_full_ms = t_ms;
+    return 0;
+}
+
+/**
+ * @brief Propagates the state and covariance by @p dt seconds.
+ *
+ * x' = F x with position += velocity dt and every clock bias += drift dt;
+ * P' = F P F^T + Q with white-acceleration (EKF_ACCEL_PSD) and clock
+ * (EKF_CLK_BIAS_PSD, EKF_CLK_DRIFT_PSD) process noise. The drift noise is common
+ * to all clock biases, so their difference (the inter-system bias) stays tight.
+ */
+static void ekf_predict(rx_ekf_t *f, double dt)
+{
+    /* x' = F x */
+    for (int j = 0; j < 3; ++j)
+        f->x[EKF_POS + j] += f->x[EKF_VEL + j] * dt;
+    for (int sys = 0; sys < GNSS_SYS_COUNT; ++sys)
+        f->x[EKF_CLK + sys] += f->x[EKF_DRIFT] * dt;
+
+    /* Source state of every row of F besides the identity (-1 = none) */
+    int rate_of[EKF_N_STATE];
+    for (int i = 0; i < EKF_N_STATE; ++i)
+        rate_of[i] = -1;
+    for (int j = 0; j < 3; ++j)
+        rate_of[EKF_POS + j] = EKF_VEL + j;
+    for (int sys = 0; sys < GNSS_SYS_COUNT; ++sys)
+        rate_of[EKF_CLK + sys] = EKF_DRIFT;
+
+    /* A = F P, then P' = A F^T */
+    double A[EKF_N_STATE][EKF_N_STATE];
+    for (int i = 0; i < EKF_N_STATE; ++i)
+        for (int k = 0; k < EKF_N_STATE; ++k)
+            A[i][k] = f->P[i][k] + (rate_of[i] >= 0 ? f->P[rate_of[i]][k] * dt : 0.0);
+    for (int i = 0; i < EKF_N_STATE; ++i)
+        for (int k = 0; k < EKF_N_STATE; ++k)
+            f->P[i][k] = A[i][k] + (rate_of[k] >= 0 ? A[i][rate_of[k]] * dt : 0.0);
+
+    /* + Q */
+    const double dt2 = dt * dt, dt3 = dt2 * dt;
+    for (int j = 0; j < 3; ++j)
+    {
+        f->P[EKF_POS + j][EKF_POS + j] += EKF_ACCEL_PSD * dt3 / 3.0;
+        f->P[EKF_POS + j][EKF_VEL + j] += EKF_ACCEL_PSD * dt2 / 2.0;
+        f->P[EKF_VEL + j][EKF_POS + j] += EKF_ACCEL_PSD * dt2 / 2.0;
+        f->P[EKF_VEL + j][EKF_VEL + j] += EKF_ACCEL_PSD * dt;
+    }
+    for (int a = 0; a < GNSS_SYS_COUNT; ++a)
+    {
+        for (int b = 0; b < GNSS_SYS_COUNT; ++b)
+            f->P[EKF_CLK + a][EKF_CLK + b] += EKF_CLK_DRIFT_PSD * dt3 / 3.0 + (a == b ? EKF_CLK_BIAS_PSD * dt : 0.0);
+        f->P[EKF_CLK + a][EKF_DRIFT] += EKF_CLK_DRIFT_PSD * dt2 / 2.0;
+        f->P[EKF_DRIFT][EKF_CLK + a] += EKF_CLK_DRIFT_PSD * dt2 / 2.0;
+    }
+    f->P[EKF_DRIFT][EKF_DRIFT] += EKF_CLK_DRIFT_PSD * dt;
+}
+
+/**
+ * @brief Sets the clock bias of every system seen for the first time since the seed.
+ *
+ * The bias becomes the mean of pseudorange minus predicted range over the
+ * system's satellites, uncorrelated with the rest of the state.
+ */
+static void ekf_init_clocks(rx_ekf_t *f, int n_svs, const double ecefs[][3], const double pseudoranges[],
+                            const uint8_t systems[])
+{
+    double sum[GNSS_SYS_COUNT] = {0};
+    int count[GNSS_SYS_COUNT] = {0};
+    for (int i = 0; i < n_svs; ++i)
+    {
+        if (f->clk_valid[systems[i]])
+            continue;
+        double los[3] = {ecefs[i][0] - f->x[EKF_POS], ecefs[i][1] - f->x[EKF_POS + 1], ecefs[i][2] - f->x[EKF_POS + 2]};
+        sum[systems[i]] += pseudoranges[i] - sqrt(los[0] * los[0] + los[1] * los[1] + los[2] * los[2]);
+        count[systems[i]]++;
+    }
+
+    for (int sys = 0; sys < GNSS_SYS_COUNT; ++sys)
+    {
+        if (count[sys] == 0)
+            continue;
+        const int c = EKF_CLK + sys;
+        for (int k = 0; k < EKF_N_STATE; ++k)
+            f->P[c][k] = f->P[k][c] = 0.0;
+        f->x[c] = sum[sys] / count[sys];
+        f->P[c][c] = EKF_INIT_CLK_SIGMA_M * EKF_INIT_CLK_SIGMA_M;
+        f->clk_valid[sys] = true;
+    }
+}
+
+/**
+ * @brief Applies the pseudoranges of one epoch as sequential scalar updates.
+ *
+ * Each row h = [-u, 0, 1 in the clock of the satellite's system] is linearized
+ * at the current estimate; K = P h / (h P h^T + R), x += K (pr - range - bias),
+ * P -= K (P h)^T.
+ */
+static void ekf_update(rx_ekf_t *f, int n_svs, const double ecefs[][3], const double pseudoranges[],
+                       const uint8_t systems[], const double var_factor[])
+{
+    for (int i = 0; i < n_svs; ++i)
+    {
+        const int c = EKF_CLK + systems[i];
+        const double pos[3] = {f->x[EKF_POS], f->x[EKF_POS + 1], f->x[EKF_POS + 2]};
+        const double los[3] = {ecefs[i][0] - pos[0], ecefs[i][1] - pos[1], ecefs[i][2] - pos[2]};
+        const double r = sqrt(los[0] * los[0] + los[1] * los[1] + los[2] * los[2]);
+        if (!(r > 0.0) || !isfinite(r))
+            continue;
+        const double h[3] = {-los[0] / r, -los[1] / r, -los[2] / r};
+
+        /* P h (h is zero outside the position and one clock column) */
+        double ph[EKF_N_STATE];
+        for (int k = 0; k < EKF_N_STATE; ++k)
+            ph[k] = f->P[k][EKF_POS] * h[0] + f->P[k][EKF_POS + 1] * h[1] + f->P[k][EKF_POS + 2] * h[2] + f->P[k][c];
+
+        const double s = ph[EKF_POS] * h[0] + ph[EKF_POS + 1] * h[1] + ph[EKF_POS + 2] * h[2] + ph[c] +
+                         wls_pseudorange_variance(pos, los, r, var_factor ? var_factor[i] : 1.0);
+        if (!(s > 0.0))
+            continue;
+        const double innovation = pseudoranges[i] - r - f->x[c];
+
+        for (int k = 0; k < EKF_N_STATE; ++k)
+            f->x[k] += ph[k] / s * innovation;
+        for (int a = 0; a < EKF_N_STATE; ++a)
+            for (int b = 0; b < EKF_N_STATE; ++b)
+                f->P[a][b] -= ph[a] * ph[b] / s;
+    }
+
+    /* Keep P symmetric against rounding */
+    for (int a = 0; a < EKF_N_STATE; ++a)
+        for (int b = a + 1; b < EKF_N_STATE; ++b)
+            f->P[a][b] = f->P[b][a] = 0.5 * (f->P[a][b] + f->P[b][a]);
+}
+
+/**
+ * @brief Advances the filter to epoch @p t_ms and applies its pseudoranges.
+ *
+ * Seeds (or reseeds) from a snapshot solve when the filter is not seeded yet,
+ * time went backwards, the gap since the last epoch exceeds EKF_MAX_GAP_MS, or
+ * an epoch has fewer than MIN_SATS satellites more than EKF_MAX_OUTAGE_MS after
+ * the last full one. Otherwise predicts to @p t_ms and does one measurement update.
+ *
+ * @param f            Filter state.
+ * @param t_ms         Epoch time (GPS ms of week; week rollovers are handled).
+ * @param n_svs        Number of satellites (may be below MIN_SATS once seeded).
+ * @param ecefs        Satellite ECEF positions (m), one row per satellite.
+ * @param pseudoranges Pseudoranges (m), same order as ecefs.
+ * @param systems      gnss_sys_t of every satellite.
+ * @param var_factor   Per-satellite variance factor, or NULL for 1.
+ * @param state_out    Output {x, y, z, clock bias per gnss_sys_t} (m) if a fix is produced.
+ * @return 0 if the epoch has a fix, -1 otherwise.
+ */
+int rx_ekf_step(rx_ekf_t *f, uint32_t t_ms, int n_svs, const double ecefs[][3], const double pseudoranges[],
+                const uint8_t systems[], const double var_factor[], double state_out[RX_STATE_MAX])
+{
+    if (n_svs < 0 || n_svs > MAX_SAT)
+        return -1;
+
+    bool reseed = !f->initialized;
+    double dt = 0.0;
+    if (!reseed)
+    {
+        uint32_t elapsed = (t_ms + MS_PER_WEEK - f->t_ms) % MS_PER_WEEK;
+        uint32_t outage = (t_ms + MS_PER_WEEK - f->last_full_ms) % MS_PER_WEEK;
+        dt = elapsed * 1e-3;
+        reseed = elapsed > EKF_MAX_GAP_MS || (n_svs < MIN_SATS && outage > EKF_MAX_OUTAGE_MS);
+    }
+
+    if (reseed)
+    {
+        f->initialized = false;
+        if (n_svs < MIN_SATS)
+            return -1;
+        if (ekf_seed(f, t_ms, n_svs, ecefs, pseudoranges, systems, var_factor) != 0)
+            return -1;
+    }
+    else
+    {
+        if (n_svs == 0)
+            return -1;
+        ekf_predict(f, dt);
+        ekf_init_clocks(f, n_svs, ecefs, pseudoranges, systems);
+        ekf_update(f, n_svs, ecefs, pseudoranges, systems, var_factor);
+        f->t_ms = t_ms;
+        if (n_svs >= MIN_SATS)
+            f->last_full_ms = t_ms;
+    }
+
+    for (int k = 0; k < EKF_N_STATE; ++k)
+    {
+        if (!isfinite(f->x[k]))
+        {
+            f->initialized = false; /* diverged: reseed at the next full epoch */
+            return -1;
+        }
+    }
+
+    for (int j = 0; j < 3; ++j)
+        state_out[j] = f->x[EKF_POS + j];
+    for (int sys = 0; sys < GNSS_SYS_COUNT; ++sys)
+        state_out[3 + sys] = f->x[EKF_CLK + sys];
+    return 0;
+}
@@ -4,15 +4,25 @@
  *
  * This module implements the C equivalent of the Python `estimate_positions`
  * function. It:
- *  - Collects unique pseudorange epochs across all satellites
+ *  - Builds a sorted (time, PRN) epoch index over all pseudorange samples once
  *  - Aligns satellite ECEF positions to the pseudorange epochs
- *  - Runs an iterative least-squares solver (Newton method) to estimate
- *    receiver position and clock bias per epoch
+ *  - Runs an iterative weighted least-squares solver (Newton method) to estimate
+ *    receiver position and clock bias per epoch, weighting each satellite by its
+ *    C/N0 and elevation, with RAIM exclusion of one faulty satellite
+ *  - Or runs the recursive filter of receiver_ekf.c over the epochs in time order
+ *  - Solves receiver velocity and clock drift at every fix from the carrier range
+ *    rates and the analytic satellite velocities of the series
+ *  - Spreads the independent snapshot epochs over worker threads (POSIX only); every epoch
+ *    writes only its own output slot, so results match the serial path exactly
+ *  - Hands the fixes to the context's track sink in epoch order as soon as each
+ *    block of epochs is done (see gnss_context_t::track_sink)
  *
- * The output is stored in `estimated_positions_ecef` as ECEF coordinates.
+ * The output is stored in the context's `estimated_positions_ecef` (ECEF, with velocity) and
+ * `latlonalt_positions` (geodetic) tables, one entry per epoch.
  *
- * @note This implementation uses normal equations with a 4x4 matrix inverse
- *       for the pseudoinverse step. It mirrors the Python logic, with optional
+ * @note This implementation uses normal equations solved by Cholesky, with one
+ *       clock column per constellation present in the epoch, for the
+ *       pseudoinverse step. It mirrors the Python logic, with optional
  *       diagnostic prints disabled by default.
  *
  * @author Ade
@@ -24,231 +34,1189 @@
 #include "../include/satellites.h"
 #include "../include/receiver.h"
 #include "../include/algo.h"
+#include "../include/perf_stats.h"
+#include "../include/gnss_context.h"
+#include "../include/receiver_ekf.h"
+#include "../include/epoch_assembler.h"
 
-extern gps_satellite_data_t gps_list[MAX_SAT + 1];
-extern sat_ecef_history_t sat_ecef_positions[MAX_SAT + 1];
-extern size_t pseudorange_count[MAX_SAT + 1];
-estimated_position_t estimated_positions_ecef = {0};
-latlonalt_position_t latlonalt_positions = {0};
-int n_times = 0; // total epochs found during position estimation
+#ifndef _WIN32
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
 
 #define ITERATIONS 10
 
 /* ---------- tiny helpers kept local for clarity ---------- */
 
-static int cmp_u32(const void *a, const void *b)
+/**
+ * One entry of the epoch index: satellite @c prn contributes sample @c k of its
+ * ctx->gps_list / sat_ecef_positions series to the epoch at time @c t.
+ */
+typedef struct
+{
+    uint32_t t;   /* epoch time (ms) */
+    uint32_t prn; /* satellite PRN */
+    uint32_t k;   /* index into the per-PRN series */
+} epoch_ref_t;
+
+/** Epoch index under construction by the epoch assembler (see build_epoch_index()). */
+typedef struct
+{
+    epoch_ref_t *refs;     /* index being filled, room for every stored sample */
+    size_t n;              /* entries in use */
+    unsigned long dropped; /* epochs dropped because they are not newer than the last one kept */
+    unsigned long repeats; /* second observations of a satellite within one kept epoch */
+} epoch_index_build_t;
+
+/**
+ * @brief epoch_handler_t: appends one assembled epoch to the index, in satellite order.
+ *
+ * An epoch whose time is not after the last one appended (a log out of time
+ * order) is dropped and counted, so the index stays sorted by time.
+ */
+static void append_epoch_refs(const gnss_epoch_t *ep, void *ctx)
 {
-    uint32_t A = *(const uint32_t *)a, B = *(const uint32_t *)b;
-    return (A > B) - (A < B);
+    epoch_index_build_t *build = (epoch_index_build_t *)ctx;
+    if (ep->time_ms == 0)
+        return;
+    if (build->n > 0 && ep->time_ms <= build->refs[build->n - 1].t)
+    {
+        build->dropped++;
+        return;
+    }
+
+    build->repeats += (unsigned long)ep->n_duplicates;
+    for (int prn = 1; prn <= MAX_SAT; prn++)
+    {
+        if (!ep->have[prn])
+            continue;
+        epoch_ref_t *ref = &build->refs[build->n++];
+        ref->t = ep->time_ms;
+        ref->prn = (uint32_t)prn;
+        ref->k = ep->tag[prn];
+    }
 }
 
-static inline int pr_count_for_prn(int prn)
+/*
+ * Build the epoch index once: every (time, prn, k) sample in time, then PRN order.
+ * Each run of equal times is one epoch, so gathering an epoch is a walk over its
+ * run instead of a PRN x series scan.
+ *
+ * The stored messages are replayed in arrival order through the epoch assembler,
+ * with their DF393 / DF005 flags, so an epoch closes on the last message of its
+ * burst, exactly as in the stream solver; each epoch is appended already in
+ * satellite order, so no sort is needed. Sample k of a satellite is its k-th
+ * stored record (the order of the sort_satellites() series). Messages repeating
+ * the epoch just closed, second observations of a satellite within one epoch and
+ * epochs that go back in time are dropped, and reported.
+ * Returns the number of entries (0 on empty input or allocation failure).
+ */
+static size_t build_epoch_index(const gnss_context_t *ctx, epoch_ref_t **out_refs)
 {
-    int n_pr = (int)pseudorange_count[prn];
-    if (n_pr > 0 && n_pr <= MAX_EPOCHS)
-        return n_pr;
+    const obs_store_t *store = &ctx->obs_store;
+    *out_refs = NULL;
+    if (store->n_obs == 0)
+        return 0;
+
+    epoch_ref_t *refs = (epoch_ref_t *)malloc(sizeof(epoch_ref_t) * store->n_obs);
+    epoch_assembler_t *assembler = (epoch_assembler_t *)malloc(sizeof(epoch_assembler_t));
+    if (!refs || !assembler)
+    {
+        perror("malloc(epoch_index)");
+        free(refs);
+        free(assembler);
+        return 0;
+    }
 
-    int c = 0;
-    for (int k = 0; k < MAX_EPOCHS; ++k)
-        if (gps_list[prn].times_of_pseudorange[k] != 0)
-            c++;
-    return c;
+    epoch_index_build_t build = {.refs = refs, .n = 0, .dropped = 0, .repeats = 0};
+    epoch_assembler_init(assembler, append_epoch_refs, &build);
+    uint32_t next_k[MAX_SAT + 1] = {0};
+    uint32_t tags[UINT8_MAX];
+    for (size_t e = 0; e < store->n_epochs; e++)
+    {
+        const obs_epoch_t *msg = &store->epochs[e];
+        const obs_record_t *recs = &store->obs[msg->first];
+        for (uint8_t i = 0; i < msg->n_obs; i++)
+            tags[i] = next_k[recs[i].prn]++;
+        epoch_assembler_add(assembler, msg->time_ms, recs, tags, msg->n_obs, msg->more);
+    }
+    epoch_assembler_flush(assembler);
+
+    if (assembler->n_late > 0 || build.repeats > 0 || build.dropped > 0)
+        fprintf(stderr, COLOR_YELLOW "Warning: Log out of epoch order: dropped %lu late messages, %lu repeated "
+                        "observations and %lu epochs going back in time.\n" COLOR_RESET,
+                assembler->n_late, build.repeats, build.dropped);
+    free(assembler);
+    *out_refs = refs;
+    return build.n;
 }
 
-static int collect_unique_pr_times_ms(const gps_satellite_data_t glist[MAX_SAT + 1],
-                                      uint32_t out_times_ms[MAX_UNIQUE_EPOCHS])
+static inline double norm3(const double v[3])
 {
-    size_t n = 0;
+    return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
 
-    for (int prn = 1; prn <= MAX_SAT; prn++)
+/**
+ * @brief Cholesky factor N = L L^T of a symmetric positive definite n x n N (n <= RX_STATE_MAX).
+ *
+ * Only the upper triangle of @p N is read; @p L gets the lower triangle.
+ *
+ * @return 1 on success, 0 if N is not (numerically) positive definite.
+ */
+static int cholesky_factor(int n, const double N[RX_STATE_MAX][RX_STATE_MAX], double L[RX_STATE_MAX][RX_STATE_MAX])
+{
+    for (int j = 0; j < n; ++j)
     {
-        int n_pr = pr_count_for_prn(prn);
-        for (int k = 0; k < n_pr; k++)
+        double d = N[j][j];
+        for (int k = 0; k < j; ++k)
+            d -= L[j][k] * L[j][k];
+        if (!(d > 1e-18))
+            return 0;
+        L[j][j] = sqrt(d);
+
+        for (int i = j + 1; i < n; ++i)
         {
-            uint32_t t = glist[prn].times_of_pseudorange[k];
-            if (t == 0)
-                continue;
-            if (n >= (size_t)MAX_UNIQUE_EPOCHS)
-                goto SORT_AND_DEDUP;
-            out_times_ms[n++] = t;
+            double acc = N[j][i];
+            for (int k = 0; k < j; ++k)
+                acc -= L[i][k] * L[j][k];
+            L[i][j] = acc / L[j][j];
         }
     }
+    return 1;
+}
 
-SORT_AND_DEDUP:
-    if (n == 0)
-        return 0;
+/** @brief Solves L z = b (forward substitution) with a cholesky_factor() result. */
+static void cholesky_forward(int n, const double L[RX_STATE_MAX][RX_STATE_MAX], const double b[], double z[])
+{
+    for (int i = 0; i < n; ++i)
+    {
+        double acc = b[i];
+        for (int k = 0; k < i; ++k)
+            acc -= L[i][k] * z[k];
+        z[i] = acc / L[i][i];
+    }
+}
+
+/** @brief Solves L L^T x = b with a cholesky_factor() result. */
+static void cholesky_solve(int n, const double L[RX_STATE_MAX][RX_STATE_MAX], const double b[], double x[])
+{
+    double z[RX_STATE_MAX];
+    cholesky_forward(n, L, b, z);
+    for (int i = n - 1; i >= 0; --i)
+    {
+        double acc = z[i];
+        for (int k = i + 1; k < n; ++k)
+            acc -= L[k][i] * x[k];
+        x[i] = acc / L[i][i];
+    }
+}
+
+/** Rows of one epoch solve: the measurements, their weighting and the state layout. */
+typedef struct
+{
+    int n_svs;                   /* rows */
+    const double (*ecefs)[3];    /* satellite ECEF positions (m) */
+    const double *pseudoranges;  /* pseudoranges (m) */
+    const uint8_t *systems;      /* gnss_sys_t per row, or NULL if all are GPS */
+    const double *var_factor;    /* per-row variance factor, or NULL */
+    const double *weight;        /* per-row weight 1 / sigma^2, held fixed during a solve, or NULL for unit weights */
+    const uint8_t *use;          /* 0 = row left out (RAIM exclusion), or NULL for all */
+    int column[GNSS_SYS_COUNT];  /* clock column per system present, -1 if absent */
+    int n_state;                 /* 3 + systems present */
+    int n_used;                  /* rows in use */
+} epoch_rows_t;
 
-    qsort(out_times_ms, n, sizeof(uint32_t), cmp_u32);
+/**
+ * @brief Sets the clock columns of the rows in use (see solve_receiver_epoch_sys()).
+ *
+ * @return 0 on success, -1 on a bad system or too few rows for the states.
+ */
+static int assign_columns(epoch_rows_t *rows)
+{
+    if (rows->n_svs < 1 || rows->n_svs > MAX_SAT)
+        return -1;
 
-    size_t w = 1;
-    for (size_t i = 1; i < n; i++)
+    int present[GNSS_SYS_COUNT] = {0};
+    rows->n_used = 0;
+    for (int i = 0; i < rows->n_svs; ++i)
     {
-        if (out_times_ms[i] != out_times_ms[w - 1])
-            out_times_ms[w++] = out_times_ms[i];
+        int sys = rows->systems ? rows->systems[i] : GNSS_GPS;
+        if (sys >= GNSS_SYS_COUNT)
+            return -1;
+        if (rows->use && !rows->use[i])
+            continue;
+        present[sys] = 1;
+        rows->n_used++;
     }
-    return (int)w;
+    rows->n_state = 3;
+    for (int sys = 0; sys < GNSS_SYS_COUNT; ++sys)
+        rows->column[sys] = present[sys] ? rows->n_state++ : -1;
+    return rows->n_used < rows->n_state || rows->n_used < MIN_SATS ? -1 : 0;
 }
 
-static inline double norm3(const double v[3])
+/**
+ * @brief Moves a satellite position from the receive time to the transmit time.
+ *
+ * Positions are computed at the receive time; the signal left the satellite
+ * tau = pseudorange / c earlier (~70 ms), while the Earth kept turning. The
+ * satellite is stepped back along its ECEF velocity by tau, then rotated by
+ * OMEGA_EARTH * tau into the ECEF frame of the receive time (Sagnac correction).
+ * Together they move the modelled range by up to ~60 m.
+ *
+ * @param ecef        Satellite ECEF position at the receive time (m).
+ * @param vel         Satellite ECEF velocity (m/s).
+ * @param pseudorange Clock-corrected pseudorange (m).
+ * @param out         Output position (m); may alias @p ecef.
+ */
+void sat_transmit_position(const double ecef[3], const double vel[3], double pseudorange, double out[3])
 {
-    return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    const double tau = pseudorange / SPEED_OF_LIGHT;
+    const double x = ecef[0] - vel[0] * tau, y = ecef[1] - vel[1] * tau, z = ecef[2] - vel[2] * tau;
+    const double wt = OMEGA_EARTH * tau;
+    const double c = cos(wt), s = sin(wt);
+    out[0] = c * x + s * y;
+    out[1] = -s * x + c * y;
+    out[2] = z;
+}
+
+/**
+ * @brief Pseudorange variance of the weighted solvers for one satellite.
+ *
+ * sigma^2 = var_factor * (WLS_SIGMA_A_M^2 + WLS_SIGMA_B_M^2 / sin^2(el)), with the
+ * elevation above the geocentric horizon of @p pos. Until the estimate has left
+ * the Earth's interior (cold start) the elevation term is taken at zenith.
+ *
+ * @param pos        Receiver ECEF position estimate (m).
+ * @param los        Satellite minus receiver position (m).
+ * @param range      |los| (m).
+ * @param var_factor Variance factor of the observable (C/N0, signal combination).
+ * @return Variance (m^2).
+ */
+double wls_pseudorange_variance(const double pos[3], const double los[3], double range, double var_factor)
+{
+    double sin_el = 1.0;
+    double pos_norm = norm3(pos);
+    if (pos_norm > 0.5 * 6378137.0)
+    {
+        sin_el = (los[0] * pos[0] + los[1] * pos[1] + los[2] * pos[2]) / (range * pos_norm);
+        if (!(sin_el > WLS_MIN_SIN_EL))
+            sin_el = WLS_MIN_SIN_EL;
+    }
+    return var_factor * (WLS_SIGMA_A_M * WLS_SIGMA_A_M + WLS_SIGMA_B_M * WLS_SIGMA_B_M / (sin_el * sin_el));
 }
 
-/* 4x4 inverse (Gauss–Jordan, partial pivoting) */
-static int invert_4x4(const double A[4][4], double inv[4][4])
+/**
+ * @brief Weights 1 / sigma^2 of every row at the position of @p state (see wls_pseudorange_variance()).
+ */
+static void row_weights(const epoch_rows_t *rows, const double state[RX_STATE_MAX], double weight[])
 {
-    double aug[4][8];
-    for (int r = 0; r < 4; ++r)
+    for (int i = 0; i < rows->n_svs; ++i)
     {
-        for (int c = 0; c < 4; ++c)
-            aug[r][c] = A[r][c];
-        for (int c = 0; c < 4; ++c)
-            aug[r][4 + c] = (r == c) ? 1.0 : 0.0;
+        double los[3] = {
+            rows->ecefs[i][0] - state[0],
+            rows->ecefs[i][1] - state[1],
+            rows->ecefs[i][2] - state[2]};
+        double r = norm3(los);
+        if (!(r > 0.0) || !isfinite(r))
+            r = 1.0;
+        weight[i] = 1.0 / wls_pseudorange_variance(state, los, r, rows->var_factor ? rows->var_factor[i] : 1.0);
     }
-    for (int col = 0; col < 4; ++col)
+}
+
+/**
+ * @brief Linearizes the rows in use at @p state.
+ *
+ * Accumulates the normal equations N = G^T W G (upper triangle) and
+ * b = G^T W delta_tau directly from the line-of-sight unit vectors. A G row is
+ * [-u, 1 in the column of the satellite's system]; W is rows->weight, or 1.
+ * Optionally keeps every G row, residual delta_tau and weight (rows left out too).
+ */
+static void linearize(const epoch_rows_t *rows, const double state[RX_STATE_MAX],
+                      double N[RX_STATE_MAX][RX_STATE_MAX], double b[RX_STATE_MAX],
+                      double G[][RX_STATE_MAX], double residual[], double weight[])
+{
+    const int n_state = rows->n_state;
+    memset(N, 0, sizeof(double) * RX_STATE_MAX * RX_STATE_MAX);
+    memset(b, 0, sizeof(double) * RX_STATE_MAX);
+
+    for (int i = 0; i < rows->n_svs; ++i)
     {
-        int piv = col;
-        double maxabs = fabs(aug[piv][col]);
-        for (int r = col + 1; r < 4; ++r)
+        int sys = rows->systems ? rows->systems[i] : GNSS_GPS;
+        int clk = rows->column[sys];
+        if (clk < 0)
+            continue; /* only rows left out can use a system without a column */
+        double los[3] = {
+            rows->ecefs[i][0] - state[0],
+            rows->ecefs[i][1] - state[1],
+            rows->ecefs[i][2] - state[2]};
+        double r = norm3(los);
+        if (!(r > 0.0) || !isfinite(r))
+            r = 1.0;
+
+        double g[RX_STATE_MAX] = {-los[0] / r, -los[1] / r, -los[2] / r};
+        g[clk] = 1.0;
+        const double delta_tau = rows->pseudoranges[i] - r - state[3 + sys];
+        const double w = rows->weight ? rows->weight[i] : 1.0;
+        if (G)
         {
-            double v = fabs(aug[r][col]);
-            if (v > maxabs)
-            {
-                maxabs = v;
-                piv = r;
-            }
+            memcpy(G[i], g, sizeof(g));
+            residual[i] = delta_tau;
+            weight[i] = w;
         }
-        if (maxabs <= 1e-18)
-            return 0;
-        if (piv != col)
+        if (rows->use && !rows->use[i])
+            continue;
+
+        for (int row = 0; row < n_state; ++row)
         {
-            for (int c = 0; c < 8; ++c)
-            {
-                double tmp = aug[col][c];
-                aug[col][c] = aug[piv][c];
-                aug[piv][c] = tmp;
-            }
+            const double gw = g[row] * w;
+            for (int col = row; col < n_state; ++col)
+                N[row][col] += gw * g[col];
+            b[row] += gw * delta_tau;
         }
-        double invpiv = 1.0 / aug[col][col];
-        for (int c = 0; c < 8; ++c)
-            aug[col][c] *= invpiv;
-        for (int r = 0; r < 4; ++r)
+    }
+}
+
+/**
+ * @brief Up to @p max_iter Newton steps of the (weighted) least-squares solve of @p rows from @p state.
+ *
+ * Stops once the position and every clock correction are below CONVERGENCE_M.
+ *
+ * @return 1 if converged, 0 if still moving after @p max_iter steps, -1 if the
+ *         geometry is singular (@p state updated by the steps taken).
+ */
+static int newton_iterate(const epoch_rows_t *rows, double state[RX_STATE_MAX], int max_iter)
+{
+    int n_iter = 0;
+    bool converged = false;
+    for (int it = 0; it < max_iter && !converged; ++it)
+    {
+        n_iter++;
+
+        double N[RX_STATE_MAX][RX_STATE_MAX], b[RX_STATE_MAX];
+        linearize(rows, state, N, b, NULL, NULL, NULL);
+
+        /* delta = (G^T W G)^-1 G^T W delta_tau */
+        double L[RX_STATE_MAX][RX_STATE_MAX] = {{0}};
+        double delta[RX_STATE_MAX];
+        if (!cholesky_factor(rows->n_state, (const double(*)[RX_STATE_MAX])N, L))
+        {
+            perf_count(PERF_NEWTON_ITERATIONS, (uint64_t)n_iter);
+            return -1; /* singular / ill-conditioned */
+        }
+        cholesky_solve(rows->n_state, (const double(*)[RX_STATE_MAX])L, b, delta);
+
+        state[0] += delta[0];
+        state[1] += delta[1];
+        state[2] += delta[2];
+        bool clocks_converged = true;
+        for (int sys = 0; sys < GNSS_SYS_COUNT; ++sys)
         {
-            if (r == col)
+            if (rows->column[sys] < 0)
                 continue;
-            double f = aug[r][col];
-            if (f != 0.0)
-                for (int c = 0; c < 8; ++c)
-                    aug[r][c] -= f * aug[col][c];
+            state[3 + sys] += delta[rows->column[sys]];
+            if (!(fabs(delta[rows->column[sys]]) < CONVERGENCE_M))
+                clocks_converged = false;
         }
+
+        // printf("[C][iter %d] |dpos|=%.6f, clk=%.6f\n", it, norm3(delta), state[3]);
+        converged = norm3(delta) < CONVERGENCE_M && clocks_converged;
     }
-    for (int r = 0; r < 4; ++r)
-        for (int c = 0; c < 4; ++c)
-            inv[r][c] = aug[r][4 + c];
-    return 1;
+    perf_count(PERF_NEWTON_ITERATIONS, (uint64_t)n_iter);
+    return converged ? 1 : 0;
+}
+
+/**
+ * @brief Newton iterations of the (weighted) least-squares solve of @p rows from @p state.
+ *
+ * The weights are held fixed, so this is plain Gauss-Newton and converges in a
+ * few steps; still running after ITERATIONS steps is a failure, not a fix.
+ *
+ * @return 0 on success (@p state updated), -1 if the geometry is singular or
+ *         the iteration did not converge within ITERATIONS steps.
+ */
+static int newton_solve(const epoch_rows_t *rows, double state[RX_STATE_MAX])
+{
+    const int rc = newton_iterate(rows, state, ITERATIONS);
+    if (rc < 0)
+        return -1;
+    if (rc == 0)
+    {
+        perf_count(PERF_NEWTON_UNCONVERGED, 1);
+        return -1;
+    }
+
+    for (int j = 0; j < RX_STATE_MAX; ++j)
+        if (!isfinite(state[j]))
+            return -1;
+    return 0;
+}
+
+/**
+ * @brief Solves one epoch for receiver position and one clock bias per constellation.
+ *
+ * Iterative least-squares (Newton): each step accumulates the normal equations
+ * G^T G and G^T y directly from the line-of-sight unit vectors and solves them
+ * by Cholesky. A G row is [-u, 1 in the column of the satellite's system], and
+ * only the systems present get a clock column, so a GPS-only epoch is the
+ * classic 4-state solve. Stops once the position and every clock correction
+ * are below CONVERGENCE_M; an epoch still moving after ITERATIONS steps fails.
+ *
+ * @param n_svs         Number of satellites (rows), must be >= 3 + the systems present.
+ * @param ecefs         Satellite ECEF positions (m), one row per satellite.
+ * @param pseudoranges  Pseudoranges (m), same order as ecefs.
+ * @param systems       gnss_sys_t of every satellite, or NULL if all are GPS.
+ * @param initial_state Start {x, y, z, clock bias per gnss_sys_t} (m), e.g. the
+ *                      previous epoch's solution; NULL starts from the Earth's centre.
+ * @param state_out     Output {x, y, z, clock bias per gnss_sys_t} (m); the clocks of
+ *                      absent systems keep their initial value. May alias @p initial_state.
+ * @return 0 on success, -1 if there are too few satellites, the geometry is
+ *         singular or the solve does not converge.
+ */
+int solve_receiver_epoch_sys(int n_svs, const double ecefs[][3], const double pseudoranges[],
+                             const uint8_t systems[], const double initial_state[RX_STATE_MAX],
+                             double state_out[RX_STATE_MAX])
+{
+    epoch_rows_t rows = {.n_svs = n_svs, .ecefs = ecefs, .pseudoranges = pseudoranges, .systems = systems};
+    if (assign_columns(&rows) != 0)
+        return -1;
+
+    double state[RX_STATE_MAX] = {0};
+    if (initial_state)
+        memcpy(state, initial_state, sizeof(state));
+    if (newton_solve(&rows, state) != 0)
+        return -1;
+
+    memcpy(state_out, state, sizeof(state));
+    return 0;
+}
+
+/**
+ * @brief Chi-square quantile of @p dof degrees of freedom at the RAIM false-alarm rate.
+ *
+ * Wilson–Hilferty approximation: dof * (1 - 2/(9 dof) + z sqrt(2/(9 dof)))^3.
+ */
+static double raim_threshold(int dof)
+{
+    const double k = 2.0 / (9.0 * dof);
+    const double c = 1.0 - k + RAIM_Z_FA * sqrt(k);
+    return dof * c * c * c;
+}
+
+/**
+ * @brief Weighted least-squares solve of one epoch with RAIM fault detection and exclusion.
+ *
+ * The rows are weighted by 1 / sigma^2, sigma^2 = var_factor * (WLS_SIGMA_A_M^2 +
+ * WLS_SIGMA_B_M^2 / sin^2(elevation)). The elevations come from @p initial_state
+ * (the previous fix, a few metres off) or, on a cold start, from WLS_COLD_STEPS
+ * unit-weight Newton steps, and the weights are then frozen for the weighted
+ * Newton iterations: re-weighting at every step makes the iteration chase a
+ * moving target and converge only linearly. A warm-started epoch is thus a single
+ * Newton solve. With opts->raim the weighted sum of squared residuals of the
+ * converged solution is tested against the chi-square threshold of its redundancy
+ * (1e-3 false alarms). If it fails, the leave-one-out test statistic of every row,
+ * SSE - w v^2 / (1 - w g^T N^-1 g), comes from the one Cholesky factor of the
+ * normal matrix at the solution instead of a solve per candidate. The row whose
+ * removal passes the test with the lowest statistic is excluded: the state gets
+ * the matching rank-one correction and a short Newton polish without that row.
+ * Needs a redundancy of 2 to exclude; if no single exclusion passes, the
+ * all-satellite solution is kept and quality->alert is set.
+ *
+ * @param n_svs         Number of satellites (rows), must be >= 3 + the systems present.
+ * @param ecefs         Satellite ECEF positions (m), one row per satellite.
+ * @param pseudoranges  Pseudoranges (m), same order as ecefs.
+ * @param systems       gnss_sys_t of every satellite, or NULL if all are GPS.
+ * @param opts          Variance factors and RAIM switch, or NULL (unit factors, no RAIM).
+ * @param initial_state Start {x, y, z, clock bias per gnss_sys_t} (m), or NULL for the Earth's centre.
+ * @param state_out     Output state as in solve_receiver_epoch_sys(). May alias @p initial_state.
+ * @param quality       Output integrity result, or NULL.
+ * @return 0 on success, -1 if there are too few satellites, the geometry is
+ *         singular or the solve does not converge.
+ */
+int solve_receiver_epoch_wls(int n_svs, const double ecefs[][3], const double pseudoranges[],
+                             const uint8_t systems[], const rx_wls_opts_t *opts,
+                             const double initial_state[RX_STATE_MAX], double state_out[RX_STATE_MAX],
+                             rx_wls_quality_t *quality)
+{
+    epoch_rows_t rows = {.n_svs = n_svs, .ecefs = ecefs, .pseudoranges = pseudoranges, .systems = systems,
+                         .var_factor = opts ? opts->var_factor : NULL};
+    if (assign_columns(&rows) != 0)
+        return -1;
+
+    /* Elevation weights at the warm start (or after WLS_COLD_STEPS unit-weight steps), held fixed */
+    double state[RX_STATE_MAX] = {0};
+    if (initial_state)
+        memcpy(state, initial_state, sizeof(state));
+    else if (newton_iterate(&rows, state, WLS_COLD_STEPS) < 0)
+        return -1;
+    double weight[MAX_SAT];
+    row_weights(&rows, state, weight);
+    rows.weight = weight;
+    if (newton_solve(&rows, state) != 0)
+        return -1;
+
+    rx_wls_quality_t q = {.n_used = n_svs, .excluded = -1};
+
+    /* Residuals and the factored normal matrix at the solution */
+    double G[MAX_SAT][RX_STATE_MAX], v[MAX_SAT], w[MAX_SAT];
+    double N[RX_STATE_MAX][RX_STATE_MAX], b[RX_STATE_MAX];
+    double L[RX_STATE_MAX][RX_STATE_MAX] = {{0}};
+    linearize(&rows, state, N, b, G, v, w);
+    for (int i = 0; i < n_svs; ++i)
+        q.test_stat += w[i] * v[i] * v[i];
+
+    const int dof = n_svs - rows.n_state;
+    if (opts && opts->raim && dof >= 1 && cholesky_factor(rows.n_state, (const double(*)[RX_STATE_MAX])N, L))
+    {
+        q.threshold = raim_threshold(dof);
+        if (q.test_stat > q.threshold)
+        {
+            int best = -1;
+            double best_stat = 0.0, best_scale = 0.0;
+            for (int i = 0; i < n_svs && dof >= 2; ++i)
+            {
+                /* h = g^T N^-1 g = |L^-1 g|^2; 1 - w h is the redundancy of row i */
+                double z[RX_STATE_MAX];
+                cholesky_forward(rows.n_state, (const double(*)[RX_STATE_MAX])L, G[i], z);
+                double h = 0.0;
+                for (int j = 0; j < rows.n_state; ++j)
+                    h += z[j] * z[j];
+                const double redundancy = 1.0 - w[i] * h;
+                if (!(redundancy > 1e-9))
+                    continue; /* the row cannot be checked by the others (e.g. its system's only satellite) */
+
+                const double stat = q.test_stat - w[i] * v[i] * v[i] / redundancy;
+                if (best < 0 || stat < best_stat)
+                {
+                    best = i;
+                    best_stat = stat;
+                    best_scale = w[i] * v[i] / redundancy;
+                }
+            }
+
+            uint8_t use[MAX_SAT];
+            memset(use, 1, sizeof(use));
+            if (best >= 0 && best_stat <= raim_threshold(dof - 1))
+            {
+                /* x_(i) = x - N^-1 g_i w_i v_i / (1 - w_i h_i), then polish without row i */
+                double dx[RX_STATE_MAX], excluded_state[RX_STATE_MAX];
+                cholesky_solve(rows.n_state, (const double(*)[RX_STATE_MAX])L, G[best], dx);
+                memcpy(excluded_state, state, sizeof(state));
+                for (int j = 0; j < 3; ++j)
+                    excluded_state[j] -= dx[j] * best_scale;
+                for (int sys = 0; sys < GNSS_SYS_COUNT; ++sys)
+                    if (rows.column[sys] >= 0)
+                        excluded_state[3 + sys] -= dx[rows.column[sys]] * best_scale;
+
+                use[best] = 0;
+                rows.use = use;
+                if (assign_columns(&rows) == 0 && newton_solve(&rows, excluded_state) == 0)
+                {
+                    memcpy(state, excluded_state, sizeof(state));
+                    q.n_used = n_svs - 1;
+                    q.excluded = best;
+                    q.test_stat = best_stat;
+                    q.threshold = raim_threshold(dof - 1);
+                }
+                else
+                    q.alert = true;
+            }
+            else
+                q.alert = true;
+        }
+    }
+
+    if (q.excluded >= 0)
+        perf_count(PERF_RAIM_EXCLUSIONS, 1);
+    else if (q.alert)
+        perf_count(PERF_RAIM_ALERTS, 1);
+    if (quality)
+        *quality = q;
+    memcpy(state_out, state, sizeof(state));
+    return 0;
+}
+
+/**
+ * @brief Solves one GPS-only epoch for receiver position and clock bias, from a given start.
+ *
+ * See solve_receiver_epoch_sys().
+ *
+ * @param n_svs          Number of satellites (rows), must be >= 4.
+ * @param ecefs          Satellite ECEF positions (m), one row per satellite.
+ * @param pseudoranges   Pseudoranges (m), same order as ecefs.
+ * @param initial_state  Start {x, y, z, clock bias} (m), e.g. the previous epoch's
+ *                       solution; NULL starts from the Earth's centre.
+ * @param pos            Output receiver ECEF position (m).
+ * @param clock_bias_out Output receiver clock bias (m).
+ * @return 0 on success, -1 if there are too few satellites or the geometry is singular.
+ */
+int solve_receiver_epoch_from(int n_svs, const double ecefs[][3], const double pseudoranges[],
+                              const double initial_state[4], double pos[3], double *clock_bias_out)
+{
+    double state[RX_STATE_MAX] = {0};
+    if (initial_state)
+        memcpy(state, initial_state, 4 * sizeof(double));
+
+    if (solve_receiver_epoch_sys(n_svs, ecefs, pseudoranges, NULL, state, state) != 0)
+        return -1;
+
+    pos[0] = state[0];
+    pos[1] = state[1];
+    pos[2] = state[2];
+    *clock_bias_out = state[3 + GNSS_GPS];
+    return 0;
+}
+
+/**
+ * @brief Solves one GPS-only epoch for receiver position and clock bias from the Earth's centre.
+ *
+ * See solve_receiver_epoch_from().
+ */
+int solve_receiver_epoch(int n_svs, const double ecefs[][3], const double pseudoranges[],
+                         double pos[3], double *clock_bias_out)
+{
+    return solve_receiver_epoch_from(n_svs, ecefs, pseudoranges, NULL, pos, clock_bias_out);
 }
 
-/* delta(4) = pinv(G)(4xm) * y(m) via normal equations */
-static int pinv_normal_eq_apply(int m,           /* rows of G */
-                                double G[][4],   /* m x 4 */
-                                const double *y, /* m x 1 */
-                                double out[4])   /* 4 x 1 */
+/**
+ * @brief Solves receiver ECEF velocity and clock drift from carrier range rates.
+ *
+ * The model rate_i = (v_sat_i - v) . u_i + drift is linear in {v, drift}, with
+ * u_i the unit line of sight from @p pos, so one weighted normal-equation solve
+ * gives the answer. Rows are weighted like the pseudoranges they come from (see
+ * wls_pseudorange_variance()); the satellite clock drifts are not modeled. Rows
+ * whose rate is not finite are skipped.
+ *
+ * @param n_svs           Satellites.
+ * @param ecefs           Satellite ECEF positions (m).
+ * @param sat_vels        Satellite ECEF velocities (m/s).
+ * @param range_rates     Carrier range rates (m/s), NAN if unavailable.
+ * @param var_factor      Per-satellite variance factor, or NULL for 1.
+ * @param pos             Solved receiver ECEF position (m).
+ * @param vel_out         Output receiver ECEF velocity (m/s).
+ * @param clock_drift_out Output receiver clock drift (m/s).
+ * @return 0 on success, -1 with fewer than MIN_SATS usable rates or a singular geometry.
+ */
+int solve_receiver_velocity(int n_svs, const double ecefs[][3], const double sat_vels[][3],
+                            const double range_rates[], const double var_factor[], const double pos[3],
+                            double vel_out[3], double *clock_drift_out)
 {
-    /* Compute AT = G^T (4 x m) and ATA = G^T G (4x4), ATy = G^T y (4) */
-    double AT[4][MAX_SAT];
-    for (int i = 0; i < 4; ++i)
-        for (int j = 0; j < m; ++j)
-            AT[i][j] = G[j][i];
+    double N[RX_STATE_MAX][RX_STATE_MAX] = {{0}}, b[RX_STATE_MAX] = {0};
+    int n_used = 0;
+    for (int i = 0; i < n_svs; ++i)
+    {
+        if (!isfinite(range_rates[i]))
+            continue;
+        double los[3] = {ecefs[i][0] - pos[0], ecefs[i][1] - pos[1], ecefs[i][2] - pos[2]};
+        double r = norm3(los);
+        if (!(r > 0.0) || !isfinite(r))
+            continue;
 
-    double ATA[4][4] = {{0}};
-    for (int r = 0; r < 4; ++r)
-        for (int c = 0; c < 4; ++c)
+        const double u[3] = {los[0] / r, los[1] / r, los[2] / r};
+        const double g[4] = {-u[0], -u[1], -u[2], 1.0};
+        const double y = range_rates[i] - (sat_vels[i][0] * u[0] + sat_vels[i][1] * u[1] + sat_vels[i][2] * u[2]);
+        const double w = 1.0 / wls_pseudorange_variance(pos, los, r, var_factor ? var_factor[i] : 1.0);
+        for (int row = 0; row < 4; ++row)
         {
-            double acc = 0.0;
-            for (int k = 0; k < m; ++k)
-                acc += AT[r][k] * G[k][c];
-            ATA[r][c] = acc;
+            const double gw = g[row] * w;
+            for (int col = row; col < 4; ++col)
+                N[row][col] += gw * g[col];
+            b[row] += gw * y;
         }
+        n_used++;
+    }
+    if (n_used < MIN_SATS)
+        return -1;
+
+    double L[RX_STATE_MAX][RX_STATE_MAX], x[RX_STATE_MAX];
+    if (!cholesky_factor(4, (const double(*)[RX_STATE_MAX])N, L))
+        return -1;
+    cholesky_solve(4, (const double(*)[RX_STATE_MAX])L, b, x);
+    vel_out[0] = x[0];
+    vel_out[1] = x[1];
+    vel_out[2] = x[2];
+    *clock_drift_out = x[3];
+    return 0;
+}
+
+/* ---------- per-epoch solve and worker threads ---------- */
+
+#define RAIM_ALERT 0xFF /* epoch_job_t::raim: the RAIM test failed and nothing was excluded */
+
+/**
+ * @brief Variance factor of a pseudorange with carrier-to-noise ratio @p cnr_dbhz.
+ *
+ * 10^((WLS_CNR_REF_DBHZ - C/N0) / 10) below the reference, 1 at or above it
+ * and when the C/N0 is not reported (0). Shared with the stream solver.
+ *
+ * @param cnr_dbhz DF403 / DF015 C/N0 (dBHz), 0 if not reported.
+ * @return Factor >= 1 on the pseudorange variance.
+ */
+double cnr_variance_factor(uint8_t cnr_dbhz)
+{
+    if (cnr_dbhz == 0 || cnr_dbhz >= WLS_CNR_REF_DBHZ)
+        return 1.0;
+    return pow(10.0, (WLS_CNR_REF_DBHZ - cnr_dbhz) / 10.0);
+}
+
+/** Shared, read-only description of one batch solve plus its per-epoch outputs. */
+typedef struct
+{
+    gnss_context_t *ctx;            /* series in, fixes out (each epoch writes only its own slot) */
+    const epoch_ref_t *refs;        /* sorted epoch index */
+    const size_t *epoch_start;      /* epoch e is refs[epoch_start[e] .. epoch_start[e + 1]) */
+    int n_epochs;                   /* epochs to solve */
+    gnss_signal_mode_t signal_mode; /* observables of the solve (never GNSS_SIGNALS_DEFAULT) */
+    uint8_t *solved;                /* out: 1 if epoch e was solved */
+    uint8_t *raim;                  /* out: satellite index RAIM excluded at epoch e, RAIM_ALERT, or 0 */
+    track_sink_t *sink;             /* receives the fixes in epoch order, or NULL */
+    stream_fix_t *fixes;            /* out: fix of epoch e (only with a sink) */
+    uint8_t *chunk_done;            /* block b is solved (only with a sink, under emit_lock) */
+    int next_emit;                  /* first block not yet handed to the sink (under emit_lock) */
+#ifndef _WIN32
+    atomic_int next_chunk;          /* next RECEIVER_EPOCH_CHUNK-sized block to hand out */
+    pthread_mutex_t emit_lock;      /* serializes the sink */
+#endif
+} epoch_job_t;
+
+/** Measurements of one epoch, gathered from the series (see gather_epoch()). */
+typedef struct
+{
+    int n_svs;                   /* satellites gathered */
+    double ecefs[MAX_SAT][3];    /* satellite ECEF positions (m) */
+    double pseudoranges[MAX_SAT]; /* observable of the signal mode (m) */
+    uint8_t systems[MAX_SAT];    /* gnss_sys_t per satellite */
+    uint8_t sats[MAX_SAT];       /* satellite index per row */
+    double var_factor[MAX_SAT];  /* C/N0 and signal-combination variance factor */
+    double sat_vels[MAX_SAT][3]; /* satellite ECEF velocities (m/s) */
+    double range_rates[MAX_SAT]; /* carrier range rates (m/s), NAN if unavailable */
+} epoch_obs_t;
+
+/**
+ * @brief Gathers the measurements of epoch @p ti.
+ *
+ * Same-time samples, first match per satellite (the run is sorted by satellite,
+ * then k). Samples without a satellite position (no usable ephemeris) or without
+ * the observables of the signal mode are left out. Pseudoranges are corrected for
+ * the satellite clock and satellite positions moved to the transmit time
+ * (sat_transmit_position()).
+ *
+ * @return Satellites gathered (obs->n_svs).
+ */
+static int gather_epoch(const epoch_job_t *job, int ti, epoch_obs_t *obs)
+{
+    const gps_satellite_data_t *gps_list = job->ctx->gps_list;
+    const sat_ecef_history_t *sat_ecef_positions = job->ctx->sat_ecef_positions;
+    int n_svs = 0;
+
+    uint32_t last_prn = 0;
+    for (size_t r = job->epoch_start[ti]; r < job->epoch_start[ti + 1] && n_svs < MAX_SAT; ++r)
+    {
+        uint32_t prn = job->refs[r].prn;
+        uint32_t k = job->refs[r].k;
+        if (prn == last_prn || sat_ecef_positions[prn].t_ms[k] == 0.0)
+            continue;
+        gnss_sys_t sys = gnss_sat_sys((int)prn);
+        double pr = gnss_solve_pseudorange(job->signal_mode, sys, gps_list[prn].pseudoranges[k],
+                                           gps_list[prn].pseudoranges_l5[k]);
+        if (pr < 0.0)
+            continue;
+        last_prn = prn;
+
+        obs->pseudoranges[n_svs] = pr + SPEED_OF_LIGHT * sat_ecef_positions[prn].clk[k]; // Satellite clock corrected
+        obs->sat_vels[n_svs][0] = sat_ecef_positions[prn].vx[k];
+        obs->sat_vels[n_svs][1] = sat_ecef_positions[prn].vy[k];
+        obs->sat_vels[n_svs][2] = sat_ecef_positions[prn].vz[k];
+        const double at_receive[3] = {sat_ecef_positions[prn].x[k], sat_ecef_positions[prn].y[k],
+                                      sat_ecef_positions[prn].z[k]};
+        sat_transmit_position(at_receive, obs->sat_vels[n_svs], obs->pseudoranges[n_svs], obs->ecefs[n_svs]);
+        obs->systems[n_svs] = (uint8_t)sys;
+        obs->sats[n_svs] = (uint8_t)prn;
+        obs->var_factor[n_svs] = gnss_solve_variance_factor(job->signal_mode, sys) * cnr_variance_factor(gps_list[prn].cnrs[k]);
+        obs->range_rates[n_svs] = gps_list[prn].range_rates[k];
+        n_svs++;
+    }
+    obs->n_svs = n_svs;
+    return n_svs;
+}
+
+/**
+ * @brief Stores the fix of epoch @p ti: ECEF table, job->solved and the sink's fix slot.
+ *
+ * The geodetic coordinates are filled in per block by convert_chunk_geodetic().
+ *
+ * The velocity comes from the range rates of the satellites at the solved
+ * position (see solve_receiver_velocity()) and is NAN when they are too few.
+ *
+ * @param job        Batch solve description.
+ * @param ti         Epoch index.
+ * @param obs        Measurements of the epoch (rows RAIM excluded carry a NAN rate).
+ * @param state      Solved {x, y, z, clock bias per gnss_sys_t} (m).
+ * @param n_used     Satellites in the solution.
+ * @param clock_sys  System of the reference clock (the lowest one in use).
+ */
+static void store_fix(const epoch_job_t *job, int ti, const epoch_obs_t *obs, const double state[RX_STATE_MAX],
+                      int n_used, int clock_sys)
+{
+    estimated_position_t *estimated_positions_ecef = &job->ctx->estimated_positions_ecef;
+    const double assumed_pos[3] = {state[0], state[1], state[2]};
+    const double clock_bias = state[3 + clock_sys];
+
+    /* store final ECEF estimate (per epoch index ti) */
+    estimated_positions_ecef->x[ti] = assumed_pos[0];
+    estimated_positions_ecef->y[ti] = assumed_pos[1];
+    estimated_positions_ecef->z[ti] = assumed_pos[2];
 
-    double ATy[4] = {0, 0, 0, 0};
-    for (int r = 0; r < 4; ++r)
+    double vel[3], clock_drift;
+    const bool has_velocity = solve_receiver_velocity(obs->n_svs, (const double(*)[3])obs->ecefs,
+                                                      (const double(*)[3])obs->sat_vels, obs->range_rates,
+                                                      obs->var_factor, assumed_pos, vel, &clock_drift) == 0;
+    estimated_positions_ecef->vx[ti] = has_velocity ? vel[0] : NAN;
+    estimated_positions_ecef->vy[ti] = has_velocity ? vel[1] : NAN;
+    estimated_positions_ecef->vz[ti] = has_velocity ? vel[2] : NAN;
+    estimated_positions_ecef->clock_drift[ti] = has_velocity ? clock_drift : NAN;
+    // printf("[C][epoch %d] FINAL pos ECEF = (%.3f, %.3f, %.3f) m, clock_bias=%.6f m\n",
+    //        ti, estimated_positions_ecef->x[ti], estimated_positions_ecef->y[ti], estimated_positions_ecef->z[ti], clock_bias);
+
+    job->solved[ti] = 1;
+
+    if (job->fixes)
     {
-        double acc = 0.0;
-        for (int k = 0; k < m; ++k)
-            acc += AT[r][k] * y[k];
-        ATy[r] = acc;
+        stream_fix_t *fix = &job->fixes[ti];
+        fix->epoch = (unsigned long)ti;
+        fix->time_ms = job->refs[job->epoch_start[ti]].t;
+        fix->n_svs = n_used;
+        fix->ecef[0] = assumed_pos[0];
+        fix->ecef[1] = assumed_pos[1];
+        fix->ecef[2] = assumed_pos[2];
+        fix->clock_bias = clock_bias;
+        fix->has_velocity = has_velocity;
+        if (has_velocity)
+        {
+            memcpy(fix->vel, vel, sizeof(vel));
+            fix->clock_drift = clock_drift;
+        }
     }
+}
 
-    double invATA[4][4];
-    if (!invert_4x4(ATA, invATA))
+/**
+ * @brief Gathers and solves epoch @p ti, storing the result at index @p ti.
+ *
+ * The epoch is solved by weighted least squares with RAIM (see
+ * solve_receiver_epoch_wls()), weighting each satellite by its C/N0, its
+ * elevation and the noise of the signal mode's observable.
+ *
+ * Writes only the context's estimated_positions_ecef slot @p ti, job->solved[ti] and job->raim[ti], so different epochs can be
+ * solved concurrently.
+ *
+ * @param job           Batch solve description.
+ * @param ti            Epoch index.
+ * @param initial_state Start {x, y, z, clock bias per gnss_sys_t} (m), or NULL for a cold start.
+ * @param solution      Output state if solved (may alias initial_state).
+ * @return 1 if the epoch was solved, 0 otherwise.
+ */
+static int solve_epoch_at(const epoch_job_t *job, int ti, const double *initial_state, double solution[RX_STATE_MAX])
+{
+    epoch_obs_t obs;
+    if (gather_epoch(job, ti, &obs) < MIN_SATS)
         return 0;
 
-    for (int r = 0; r < 4; ++r)
+    /* --- Weighted iterative least-squares (Newton) with RAIM, warm-started when a state is given --- */
+    const rx_wls_opts_t opts = {.var_factor = obs.var_factor, .raim = true};
+    rx_wls_quality_t quality;
+    double state[RX_STATE_MAX];
+    if (solve_receiver_epoch_wls(obs.n_svs, (const double(*)[3])obs.ecefs, obs.pseudoranges, obs.systems, &opts, initial_state, state, &quality) != 0 &&
+        (!initial_state || solve_receiver_epoch_wls(obs.n_svs, (const double(*)[3])obs.ecefs, obs.pseudoranges, obs.systems, &opts, NULL, state, &quality) != 0))
+        return 0; /* singular or unconverged (a failed warm start is retried cold); avoid storing a bogus result */
+    if (quality.excluded >= 0)
     {
-        double acc = 0.0;
-        for (int c = 0; c < 4; ++c)
-            acc += invATA[r][c] * ATy[c];
-        out[r] = acc;
+        job->raim[ti] = obs.sats[quality.excluded];
+        obs.range_rates[quality.excluded] = NAN; /* keep the excluded satellite out of the velocity too */
     }
+    else if (quality.alert)
+        job->raim[ti] = RAIM_ALERT;
+
+    memcpy(solution, state, sizeof(state));
+    const int ref = quality.excluded == 0 ? 1 : 0; /* the first (lowest) system in use is the reference clock */
+    store_fix(job, ti, &obs, state, quality.n_used, obs.systems[ref]);
     return 1;
 }
 
+/**
+ * @brief Solves epochs [first, last) in order, each warm-started from the previous solution.
+ *
+ * The first epoch of every chunk starts cold, so a chunk's results do not depend
+ * on which thread ran it or on the others.
+ */
+static void solve_epoch_chunk(const epoch_job_t *job, int first, int last)
+{
+    double state[RX_STATE_MAX];
+    bool have_state = false; /* unsolved epochs keep the last solution as the start */
+    for (int ti = first; ti < last; ++ti)
+    {
+        if (solve_epoch_at(job, ti, have_state ? state : NULL, state))
+            have_state = true;
+    }
+}
+
+/**
+ * @brief Converts the ECEF fixes of block @p chunk to the geodetic table in one
+ *        batch (see ecef_to_geodetic_batch()) and copies them to the sink's fix slots.
+ *
+ * Writes only the block's slots, so different blocks can be converted concurrently.
+ */
+static void convert_chunk_geodetic(const epoch_job_t *job, int chunk)
+{
+    const estimated_position_t *ecef = &job->ctx->estimated_positions_ecef;
+    latlonalt_position_t *lla = &job->ctx->latlonalt_positions;
+    int first = chunk * RECEIVER_EPOCH_CHUNK;
+    int last = first + RECEIVER_EPOCH_CHUNK < job->n_epochs ? first + RECEIVER_EPOCH_CHUNK : job->n_epochs;
+    ecef_to_geodetic_batch((size_t)(last - first), ecef->x + first, ecef->y + first, ecef->z + first, GEODETIC_EXACT,
+                           lla->lat + first, lla->lon + first, lla->alt + first);
+
+    if (!job->fixes)
+        return;
+    for (int ti = first; ti < last; ++ti)
+    {
+        if (!job->solved[ti])
+            continue;
+        job->fixes[ti].lat_deg = lla->lat[ti];
+        job->fixes[ti].lon_deg = lla->lon[ti];
+        job->fixes[ti].alt_m = lla->alt[ti];
+    }
+}
+
+/**
+ * @brief Converts block @p chunk to geodetic, marks it solved and passes every
+ *        block that is now complete in order (no gap before it) to the job's track sink.
+ */
+static void emit_solved_chunk(epoch_job_t *job, int chunk)
+{
+    convert_chunk_geodetic(job, chunk);
+    if (!job->sink)
+        return;
+
+#ifndef _WIN32
+    pthread_mutex_lock(&job->emit_lock);
+#endif
+    job->chunk_done[chunk] = 1;
+    int n_chunks = (job->n_epochs + RECEIVER_EPOCH_CHUNK - 1) / RECEIVER_EPOCH_CHUNK;
+    while (job->next_emit < n_chunks && job->chunk_done[job->next_emit])
+    {
+        int first = job->next_emit * RECEIVER_EPOCH_CHUNK;
+        int last = first + RECEIVER_EPOCH_CHUNK < job->n_epochs ? first + RECEIVER_EPOCH_CHUNK : job->n_epochs;
+        for (int ti = first; ti < last; ++ti)
+            if (job->solved[ti])
+                track_sink_add(job->sink, &job->fixes[ti]);
+        job->next_emit++;
+    }
+#ifndef _WIN32
+    pthread_mutex_unlock(&job->emit_lock);
+#endif
+}
+
+/**
+ * @brief Resolves the thread count for a solve of @p n_epochs epochs.
+ *
+ * @p n_threads (gnss_context_t::n_threads) if set, else configured_thread_count();
+ * never more than one thread per RECEIVER_EPOCH_CHUNK epochs, and always 1 on
+ * platforms without POSIX threads.
+ */
+static int receiver_thread_count(int n_threads, int n_epochs)
+{
+#ifdef _WIN32
+    (void)n_threads;
+    (void)n_epochs;
+    return 1;
+#else
+    long n = n_threads > 0 ? n_threads : configured_thread_count();
+    if (n > RECEIVER_MAX_THREADS)
+        n = RECEIVER_MAX_THREADS;
+
+    long max_useful = (n_epochs + RECEIVER_EPOCH_CHUNK - 1) / RECEIVER_EPOCH_CHUNK;
+    if (n > max_useful)
+        n = max_useful;
+    return n < 1 ? 1 : (int)n;
+#endif
+}
+
+#ifndef _WIN32
+/** Worker: claims RECEIVER_EPOCH_CHUNK epochs at a time until none are left. */
+static void *epoch_worker(void *arg)
+{
+    epoch_job_t *job = (epoch_job_t *)arg;
+    for (;;)
+    {
+        int chunk = atomic_fetch_add(&job->next_chunk, 1);
+        int first = chunk * RECEIVER_EPOCH_CHUNK;
+        if (first >= job->n_epochs)
+            break;
+
+        int last = first + RECEIVER_EPOCH_CHUNK < job->n_epochs ? first + RECEIVER_EPOCH_CHUNK : job->n_epochs;
+        solve_epoch_chunk(job, first, last);
+        emit_solved_chunk(job, chunk);
+    }
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Solves every epoch of @p job with @p n_threads threads (the caller included).
+ *
+ * Each epoch is solved exactly as in the serial loop and stored at its own
+ * index, so the results do not depend on the thread count or scheduling.
+ * Falls back to fewer (or no) extra threads if they cannot be created.
+ */
+static void solve_epochs_parallel(epoch_job_t *job, int n_threads)
+{
+#ifdef _WIN32
+    (void)n_threads;
+    for (int first = 0; first < job->n_epochs; first += RECEIVER_EPOCH_CHUNK)
+    {
+        solve_epoch_chunk(job, first, first + RECEIVER_EPOCH_CHUNK < job->n_epochs ? first + RECEIVER_EPOCH_CHUNK : job->n_epochs);
+        emit_solved_chunk(job, first / RECEIVER_EPOCH_CHUNK);
+    }
+#else
+    atomic_init(&job->next_chunk, 0);
+    pthread_mutex_init(&job->emit_lock, NULL);
+
+    pthread_t threads[RECEIVER_MAX_THREADS];
+    int n_started = 0;
+    for (int i = 1; i < n_threads; ++i)
+    {
+        if (pthread_create(&threads[n_started], NULL, epoch_worker, job) != 0)
+            break; /* run with the threads we have */
+        n_started++;
+    }
+
+    epoch_worker(job);
+
+    for (int i = 0; i < n_started; ++i)
+        pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&job->emit_lock);
+#endif
+}
+
+/**
+ * @brief Runs the recursive filter over every epoch of @p job in time order, on the calling thread.
+ *
+ * See rx_ekf_step(). Each block of RECEIVER_EPOCH_CHUNK epochs goes to the
+ * track sink as soon as it is filtered.
+ */
+static void solve_epochs_ekf(epoch_job_t *job)
+{
+#ifndef _WIN32
+    pthread_mutex_init(&job->emit_lock, NULL);
+#endif
+    rx_ekf_t filter;
+    rx_ekf_init(&filter);
+    for (int first = 0; first < job->n_epochs; first += RECEIVER_EPOCH_CHUNK)
+    {
+        int last = first + RECEIVER_EPOCH_CHUNK < job->n_epochs ? first + RECEIVER_EPOCH_CHUNK : job->n_epochs;
+        for (int ti = first; ti < last; ++ti)
+        {
+            epoch_obs_t obs;
+            double state[RX_STATE_MAX];
+            if (gather_epoch(job, ti, &obs) == 0 ||
+                rx_ekf_step(&filter, job->refs[job->epoch_start[ti]].t, obs.n_svs, (const double(*)[3])obs.ecefs,
+                            obs.pseudoranges, obs.systems, obs.var_factor, state) != 0)
+                continue;
+            store_fix(job, ti, &obs, state, obs.n_svs, obs.systems[0]);
+        }
+        emit_solved_chunk(job, first / RECEIVER_EPOCH_CHUNK);
+    }
+#ifndef _WIN32
+    pthread_mutex_destroy(&job->emit_lock);
+#endif
+}
+
 /* ---------- main function ---------- */
-int estimate_receiver_positions(void)
+
+/**
+ * @brief Batch solver requested by the GPS_RESOLVER_SOLVER environment variable.
+ *
+ * @return RX_SOLVER_EKF for "ekf", else RX_SOLVER_LSQ.
+ */
+rx_solver_mode_t configured_solver_mode(void)
 {
-    /* 1) Epoch collection (np.unique over all PR times) */
-    uint32_t *all_times = (uint32_t *)malloc(sizeof(uint32_t) * (size_t)MAX_UNIQUE_EPOCHS);
-    if (!all_times)
+    const char *env = getenv("GPS_RESOLVER_SOLVER");
+    return (env && strcmp(env, "ekf") == 0) ? RX_SOLVER_EKF : RX_SOLVER_LSQ;
+}
+
+/**
+ * @brief Solves every epoch of the sorted, positioned series of @p ctx.
+ *
+ * ctx->signal_mode selects the observables: primary-signal pseudoranges, or
+ * their ionosphere-free combination with the L5 band (GPS_RESOLVER_SIGNALS=iflc).
+ * ctx->solver_mode selects independent per-epoch snapshots (weighted least
+ * squares with RAIM, on ctx->n_threads threads) or the recursive filter of
+ * receiver_ekf.c over the epochs in time order (GPS_RESOLVER_SOLVER=ekf, one thread).
+ *
+ * The fixes are stored per epoch in ctx->estimated_positions_ecef and
+ * ctx->latlonalt_positions (ctx->n_times entries) and streamed to
+ * ctx->track_sink if set.
+ *
+ * @param ctx Session state (after sort_satellites() and satellite_position_eci()).
+ * @return 0 on success, -1 on allocation failure.
+ */
+int estimate_receiver_positions(gnss_context_t *ctx)
+{
+    const gps_satellite_data_t *gps_list = ctx->gps_list;
+    const sat_ecef_history_t *sat_ecef_positions = ctx->sat_ecef_positions;
+
+    /* 1) Epoch collection (np.unique over all PR times) via the epoch index */
+    epoch_ref_t *refs = NULL;
+    size_t n_refs = build_epoch_index(ctx, &refs);
+
+    /* epoch_start[e] .. epoch_start[e + 1] is the run of refs belonging to epoch e */
+    size_t *epoch_start = (size_t *)malloc(sizeof(size_t) * (n_refs + 1));
+    if (!epoch_start)
     {
-        perror("malloc(all_times)");
+        perror("malloc(epoch_start)");
+        free(refs);
         return -1;
     }
-    for (int i = 0; i < MAX_UNIQUE_EPOCHS; ++i)
-        all_times[i] = 0;
 
-    n_times = collect_unique_pr_times_ms(gps_list, all_times);
-    printf("[C] total epochs = %d\n", n_times);
-    if (n_times > 0 && n_times <= 20)
+    size_t n_epochs = 0;
+    for (size_t i = 0; i < n_refs; ++i)
+        if (i == 0 || refs[i].t != refs[i - 1].t)
+            epoch_start[n_epochs++] = i;
+    epoch_start[n_epochs] = n_refs;
+
+    printf("[C] total epochs = %zu\n", n_epochs);
+    if (n_epochs > 0 && n_epochs <= 20)
     {
         printf("[C] epochs (ms): ");
-        for (int i = 0; i < n_times; ++i)
-            printf("%u%s", all_times[i], (i + 1 < n_times) ? ", " : "\n");
+        for (size_t e = 0; e < n_epochs; ++e)
+            printf("%u%s", refs[epoch_start[e]].t, (e + 1 < n_epochs) ? ", " : "\n");
+    }
+
+    if (gnss_context_alloc_fixes(ctx, n_epochs) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory for %zu receiver fixes.\n" COLOR_RESET, n_epochs);
+        free(epoch_start);
+        free(refs);
+        return -1;
     }
+    const int n_times = ctx->n_times;
 
     /* 2) Per-SV summary (PR samples, ECEF shape, first/last PR time) */
     for (int prn = 1; prn <= MAX_SAT; ++prn)
     {
-        int pr_cnt = pr_count_for_prn(prn);
-        int ecef_rows = 0;
-        for (int k = 0; k < MAX_EPOCHS; ++k)
+        size_t pr_cnt = gps_list[prn].n_pseudoranges;
+        size_t ecef_rows = 0;
+        for (size_t k = 0; k < pr_cnt; ++k)
             if (sat_ecef_positions[prn].t_ms[k] != 0.0)
                 ecef_rows++;
 
         if (pr_cnt > 0)
         {
             /* first/last PR time within recorded range */
-            int first_idx = -1, last_idx = -1;
-            for (int k = 0; k < MAX_EPOCHS; ++k)
-            {
-                if (gps_list[prn].times_of_pseudorange[k] != 0)
-                {
-                    first_idx = k;
-                    break;
-                }
-            }
-            for (int k = MAX_EPOCHS - 1; k >= 0; --k)
-            {
-                if (gps_list[prn].times_of_pseudorange[k] != 0)
-                {
-                    last_idx = k;
-                    break;
-                }
-            }
-            uint32_t first_t = (first_idx >= 0) ? gps_list[prn].times_of_pseudorange[first_idx] : 0u;
-            uint32_t last_t = (last_idx >= 0) ? gps_list[prn].times_of_pseudorange[last_idx] : 0u;
+            uint32_t first_t = gps_list[prn].times_of_pseudorange[0];
+            uint32_t last_t = gps_list[prn].times_of_pseudorange[pr_cnt - 1];
 
-            printf("[C] SV %02d: PR samples=%d, ECEF shape=(%d,3); first PR time=%u, last PR time=%u\n",
-                   prn, pr_cnt, ecef_rows, first_t, last_t);
+            char name[GNSS_SAT_NAME_LEN];
+            printf("[C] SV %s: PR samples=%zu, ECEF shape=(%zu,3); first PR time=%u, last PR time=%u\n",
+                   gnss_sat_name(prn, name), pr_cnt, ecef_rows, first_t, last_t);
         }
         else
         {
@@ -256,127 +1224,74 @@ int estimate_receiver_positions(void)
         }
     }
 
-    /* 3) Process each epoch independently */
-    for (int ti = 0; ti < n_times; ++ti)
+    /* 3) Process each epoch independently, on worker threads when there are enough epochs */
+    uint8_t *solved = (uint8_t *)calloc((size_t)n_times + 1, sizeof(uint8_t));
+    uint8_t *raim = (uint8_t *)calloc((size_t)n_times + 1, sizeof(uint8_t));
+    if (!solved || !raim)
     {
-        uint32_t t = all_times[ti];
-
-        int svs[MAX_SAT];
-        int pr_indices[MAX_SAT];
-        double ecefs[MAX_SAT][3];
-        double pseudoranges[MAX_SAT];
-        int n_svs = 0;
+        perror("calloc(solved)");
+        free(solved);
+        free(raim);
+        free(epoch_start);
+        free(refs);
+        return -1;
+    }
 
-        /* Gather same-time measurements (first match per SV) */
-        for (int prn = 1; prn <= MAX_SAT && n_svs < MAX_SAT; ++prn)
-        {
-            int n_pr = pr_count_for_prn(prn);
-            for (int k = 0; k < n_pr; ++k)
-            {
-                if (gps_list[prn].times_of_pseudorange[k] != t)
-                    continue;
-
-                svs[n_svs] = prn;
-                pr_indices[n_svs] = k;
-                ecefs[n_svs][0] = sat_ecef_positions[prn].x[k];
-                ecefs[n_svs][1] = sat_ecef_positions[prn].y[k];
-                ecefs[n_svs][2] = sat_ecef_positions[prn].z[k];
-                pseudoranges[n_svs] = gps_list[prn].pseudoranges[k];
-                n_svs++;
-                break;
-            }
-        }
+    epoch_job_t job = {.ctx = ctx, .refs = refs, .epoch_start = epoch_start, .n_epochs = n_times, .solved = solved, .raim = raim,
+                       .signal_mode = ctx->signal_mode != GNSS_SIGNALS_DEFAULT ? ctx->signal_mode : configured_signal_mode()};
+    if (job.signal_mode == GNSS_SIGNALS_IFLC)
+        printf("[C] solving with the ionosphere-free L1/L5 combination\n");
+    const rx_solver_mode_t solver_mode = ctx->solver_mode != RX_SOLVER_DEFAULT ? ctx->solver_mode : configured_solver_mode();
+    if (solver_mode == RX_SOLVER_EKF)
+        printf("[C] solving with the recursive (EKF) filter\n");
+    if (ctx->track_sink && n_times > 0)
+    {
+        job.fixes = (stream_fix_t *)calloc((size_t)n_times, sizeof(stream_fix_t));
+        job.chunk_done = (uint8_t *)calloc((size_t)(n_times + RECEIVER_EPOCH_CHUNK - 1) / RECEIVER_EPOCH_CHUNK, 1);
+        if (job.fixes && job.chunk_done)
+            job.sink = ctx->track_sink;
+        else
+            fprintf(stderr, COLOR_YELLOW "Warning: Out of memory for the track sink; fixes are not streamed.\n" COLOR_RESET);
+    }
+    if (solver_mode == RX_SOLVER_EKF)
+        solve_epochs_ekf(&job);
+    else
+        solve_epochs_parallel(&job, receiver_thread_count(ctx->n_threads, n_times));
+    if (job.sink)
+        track_sink_flush(job.sink);
+    free(job.fixes);
+    free(job.chunk_done);
 
-        if (n_svs < 4)
+    /* 4) Report in epoch order, independent of the thread count */
+    uint64_t n_solved = 0, n_alerts = 0;
+    for (int ti = 0; ti < n_times; ++ti)
+    {
+        if (!solved[ti])
             continue;
+        n_solved++;
 
-        /* --- Iterative least-squares (Newton) --- */
-        double assumed_pos[3] = {0.0, 0.0, 0.0};
-        double clock_bias = 0.0;
-
-        for (int it = 0; it < ITERATIONS; ++it)
+        /* optional print (comment out if noisy) */
+        printf("[C][epoch %d] LLA = (lat=%.8f deg, lon=%.8f deg)\n",
+               ti, ctx->latlonalt_positions.lat[ti], ctx->latlonalt_positions.lon[ti]);
+        if (raim[ti] == RAIM_ALERT)
+            n_alerts++;
+        else if (raim[ti])
         {
-            double assumed_ranges[MAX_SAT];
-            double unit_vectors[MAX_SAT][3];
-            double delta_tau[MAX_SAT];
-
-            for (int i = 0; i < n_svs; ++i)
-            {
-                double los[3] = {
-                    ecefs[i][0] - assumed_pos[0],
-                    ecefs[i][1] - assumed_pos[1],
-                    ecefs[i][2] - assumed_pos[2]};
-                double r = norm3(los);
-                if (!(r > 0.0) || !isfinite(r))
-                    r = 1.0;
-
-                assumed_ranges[i] = r;
-                unit_vectors[i][0] = los[0] / r;
-                unit_vectors[i][1] = los[1] / r;
-                unit_vectors[i][2] = los[2] / r;
-
-                delta_tau[i] = pseudoranges[i] - r - clock_bias;
-            }
-
-            /* Geometry matrix G (n_svs x 4) */
-            double G[MAX_SAT][4];
-            for (int i = 0; i < n_svs; ++i)
-            {
-                G[i][0] = -unit_vectors[i][0];
-                G[i][1] = -unit_vectors[i][1];
-                G[i][2] = -unit_vectors[i][2];
-                G[i][3] = 1.0;
-            }
-
-            /* delta = pinv(G) * delta_tau  (4x1) */
-            double delta_pos_time[4];
-            if (!pinv_normal_eq_apply(n_svs, G, delta_tau, delta_pos_time))
-            {
-                /* singular / ill-conditioned; skip this epoch */
-                n_svs = 0; /* to avoid storing a bogus result */
-                break;
-            }
-
-            assumed_pos[0] += delta_pos_time[0];
-            assumed_pos[1] += delta_pos_time[1];
-            assumed_pos[2] += delta_pos_time[2];
-            clock_bias += delta_pos_time[3];
-
-            // Optional prints:
-            double rms = 0.0;
-            for (int i = 0; i < n_svs; ++i)
-                rms += delta_tau[i] * delta_tau[i];
-            rms = sqrt(rms / n_svs);
-            // printf("[C][epoch %d][iter %d] rms=%.3f, clk=%.6f\n", ti, it, rms, clock_bias);
+            char name[GNSS_SAT_NAME_LEN];
+            printf("[C][epoch %d] RAIM excluded %s\n", ti, gnss_sat_name(raim[ti], name));
         }
+    }
 
-        if (n_svs >= 4)
-        {
-            /* store final ECEF estimate (per epoch index ti) */
-            estimated_positions_ecef.x[ti] = assumed_pos[0];
-            estimated_positions_ecef.y[ti] = assumed_pos[1];
-            estimated_positions_ecef.z[ti] = assumed_pos[2];
-            // printf("[C][epoch %d] FINAL pos ECEF = (%.3f, %.3f, %.3f) m, clock_bias=%.6f m\n",
-            //        ti, estimated_positions_ecef.x[ti], estimated_positions_ecef.x[ti], estimated_positions_ecef.x[ti], clock_bias);
-
-            /* --- Convert to geodetic and store --- */
-            if (ti < MAX_EPOCHS)
-            {
-                double lat_deg, lon_deg, alt_m;
-                ecef_to_geodetic(assumed_pos[0], assumed_pos[1], assumed_pos[2],
-                                 &lat_deg, &lon_deg, &alt_m);
-
-                /* single instance: store by epoch index */
-                latlonalt_positions.lat[ti] = lat_deg;
-                latlonalt_positions.lon[ti] = lon_deg;
+    if (n_alerts > 0)
+        printf("[C] RAIM alert: %llu epoch(s) fail the residual test with no single exclusion that passes\n",
+               (unsigned long long)n_alerts);
 
-                /* optional print (comment out if noisy) */
-                printf("[C][epoch %d] LLA = (lat=%.8f deg, lon=%.8f deg)\n",
-                       ti, lat_deg, lon_deg);
-            }
-        }
-    }
+    perf_count(PERF_EPOCHS_SOLVED, n_solved);
+    perf_count(PERF_EPOCHS_SKIPPED, (uint64_t)n_times - n_solved);
 
-    free(all_times);
+    free(raim);
+    free(solved);
+    free(epoch_start);
+    free(refs);
     return 0;
 }
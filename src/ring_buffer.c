@@ -0,0 +1,116 @@
+/**
+ * @file ring_buffer.c
+ * @brief Lock-free single-producer / single-consumer byte ring (see ring_buffer.h).
+ *
+ * Used by the live serial mode: the reader thread read()s into the free region
+ * and commits, the decoder thread frames RTCM3 out of the filled region and
+ * commits what it consumed. Neither side ever blocks the other.
+ */
+
+#include "../include/algo.h"
+#include "../include/ring_buffer.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Allocates a ring of at least @p min_capacity bytes (rounded up to a power of two).
+ *
+ * @param rb           Ring to initialize.
+ * @param min_capacity Requested capacity in bytes (> 0).
+ * @return 0 on success, -1 on invalid size or allocation failure.
+ */
+int ring_buffer_init(ring_buffer_t *rb, size_t min_capacity)
+{
+    if (!rb || min_capacity == 0 || min_capacity > (SIZE_MAX >> 1))
+        return -1;
+
+    size_t cap = 1;
+    while (cap < min_capacity)
+        cap <<= 1;
+
+    rb->data = malloc(cap);
+    if (!rb->data)
+        return -1;
+
+    rb->cap = cap;
+    rb->mask = cap - 1;
+    atomic_init(&rb->head, 0);
+    atomic_init(&rb->tail, 0);
+    atomic_init(&rb->n_overruns, 0);
+    return 0;
+}
+
+/**
+ * @brief Releases the ring storage. Both threads must be done with the ring.
+ *
+ * @param rb Ring to free.
+ */
+void ring_buffer_free(ring_buffer_t *rb)
+{
+    if (!rb)
+        return;
+
+    free(rb->data);
+    rb->data = NULL;
+    rb->cap = 0;
+    rb->mask = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Producer side: contiguous free space starting at the write position.
+ *
+ * The region stops at the end of the storage; after committing it, the next call
+ * returns the wrapped-around part.
+ *
+ * @param rb     Ring.
+ * @param region Output pointer to the free region.
+ * @return Bytes that may be written at @p region (0 if the ring is full).
+ */
+size_t ring_buffer_write_region(ring_buffer_t *rb, uint8_t **region)
+{
+    size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    size_t free_bytes = rb->cap - (head - tail);
+    size_t to_end = rb->cap - (head & rb->mask);
+
+    *region = rb->data + (head & rb->mask);
+    return free_bytes < to_end ? free_bytes : to_end;
+}
+
+/**
+ * @brief Producer side: publishes @p n bytes written into the last write region.
+ */
+void ring_buffer_commit_write(ring_buffer_t *rb, size_t n)
+{
+    size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    atomic_store_explicit(&rb->head, head + n, memory_order_release);
+}
+
+/**
+ * @brief Consumer side: contiguous filled bytes starting at the read position.
+ *
+ * @param rb     Ring.
+ * @param region Output pointer to the filled region.
+ * @return Bytes available at @p region (0 if the ring is empty).
+ */
+size_t ring_buffer_read_region(ring_buffer_t *rb, const uint8_t **region)
+{
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    size_t used = head - tail;
+    size_t to_end = rb->cap - (tail & rb->mask);
+
+    *region = rb->data + (tail & rb->mask);
+    return used < to_end ? used : to_end;
+}
+
+/**
+ * @brief Consumer side: releases @p n bytes of the last read region back to the producer.
+ */
+void ring_buffer_commit_read(ring_buffer_t *rb, size_t n)
+{
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    atomic_store_explicit(&rb->tail, tail + n, memory_order_release);
+}
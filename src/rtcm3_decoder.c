@@ -0,0 +1,839 @@
+/**
+ * @file rtcm3_decoder.c
+ * @brief Decodes binary RTCM3 frames (1002, 1019, 1042, 1045, 1046, MSM4, MSM headers) straight into the parser structures.
+ *
+ * This module is the binary counterpart of df_parser.c. It provides:
+ * - CRC-24Q and big-endian bit-field readers per RTCM 10403.x
+ * - An incremental frame synchronizer (0xD3 preamble, 10-bit length, CRC-24Q)
+ *   that accepts bytes in arbitrary chunks, so the same code serves files
+ *   and serial ports
+ * - Payload decoders that fill `rtcm_1019_ephemeris_t` (GPS, BeiDou and Galileo
+ *   ephemerides), `rtcm_1074_msm4_t` (GPS, GLONASS, Galileo and BeiDou MSM4)
+ *   and `rtcm_1002_msm1_t` with the same scaled values a PyRTCM text export
+ *   carries, so both input paths feed identical data to the solver
+ *
+ * No text formatting or sscanf is involved: every field is read from the
+ * payload bits and scaled with ldexp().
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/rtcm3_decoder.h"
+#include "../include/file_map.h"
+#include "../include/perf_stats.h"
+
+/// Bytes read from the input file per fread() call
+#define RTCM3_READ_CHUNK 65536
+
+/// MSM signal ID (1-based bit position in DF395) of the primary signal: GPS / GLONASS / Galileo "1C", BeiDou B1I "2I"
+#define MSM_SIG_PRIMARY 2
+/// MSM signal IDs of the L5 / E5a / B2a band: "5I", "5Q", "5X" (BeiDou "5D", "5P", "5X")
+#define MSM_SIG_L5_FIRST 22
+#define MSM_SIG_L5_LAST 24
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/// CRC-24Q lookup table (polynomial 0x1864CFB)
+static const uint32_t crc24q_table[256] = {
+    0x000000, 0x864CFB, 0x8AD50D, 0x0C99F6, 0x93E6E1, 0x15AA1A, 0x1933EC, 0x9F7F17,
+    0xA18139, 0x27CDC2, 0x2B5434, 0xAD18CF, 0x3267D8, 0xB42B23, 0xB8B2D5, 0x3EFE2E,
+    0xC54E89, 0x430272, 0x4F9B84, 0xC9D77F, 0x56A868, 0xD0E493, 0xDC7D65, 0x5A319E,
+    0x64CFB0, 0xE2834B, 0xEE1ABD, 0x685646, 0xF72951, 0x7165AA, 0x7DFC5C, 0xFBB0A7,
+    0x0CD1E9, 0x8A9D12, 0x8604E4, 0x00481F, 0x9F3708, 0x197BF3, 0x15E205, 0x93AEFE,
+    0xAD50D0, 0x2B1C2B, 0x2785DD, 0xA1C926, 0x3EB631, 0xB8FACA, 0xB4633C, 0x322FC7,
+    0xC99F60, 0x4FD39B, 0x434A6D, 0xC50696, 0x5A7981, 0xDC357A, 0xD0AC8C, 0x56E077,
+    0x681E59, 0xEE52A2, 0xE2CB54, 0x6487AF, 0xFBF8B8, 0x7DB443, 0x712DB5, 0xF7614E,
+    0x19A3D2, 0x9FEF29, 0x9376DF, 0x153A24, 0x8A4533, 0x0C09C8, 0x00903E, 0x86DCC5,
+    0xB822EB, 0x3E6E10, 0x32F7E6, 0xB4BB1D, 0x2BC40A, 0xAD88F1, 0xA11107, 0x275DFC,
+    0xDCED5B, 0x5AA1A0, 0x563856, 0xD074AD, 0x4F0BBA, 0xC94741, 0xC5DEB7, 0x43924C,
+    0x7D6C62, 0xFB2099, 0xF7B96F, 0x71F594, 0xEE8A83, 0x68C678, 0x645F8E, 0xE21375,
+    0x15723B, 0x933EC0, 0x9FA736, 0x19EBCD, 0x8694DA, 0x00D821, 0x0C41D7, 0x8A0D2C,
+    0xB4F302, 0x32BFF9, 0x3E260F, 0xB86AF4, 0x2715E3, 0xA15918, 0xADC0EE, 0x2B8C15,
+    0xD03CB2, 0x567049, 0x5AE9BF, 0xDCA544, 0x43DA53, 0xC596A8, 0xC90F5E, 0x4F43A5,
+    0x71BD8B, 0xF7F170, 0xFB6886, 0x7D247D, 0xE25B6A, 0x641791, 0x688E67, 0xEEC29C,
+    0x3347A4, 0xB50B5F, 0xB992A9, 0x3FDE52, 0xA0A145, 0x26EDBE, 0x2A7448, 0xAC38B3,
+    0x92C69D, 0x148A66, 0x181390, 0x9E5F6B, 0x01207C, 0x876C87, 0x8BF571, 0x0DB98A,
+    0xF6092D, 0x7045D6, 0x7CDC20, 0xFA90DB, 0x65EFCC, 0xE3A337, 0xEF3AC1, 0x69763A,
+    0x578814, 0xD1C4EF, 0xDD5D19, 0x5B11E2, 0xC46EF5, 0x42220E, 0x4EBBF8, 0xC8F703,
+    0x3F964D, 0xB9DAB6, 0xB54340, 0x330FBB, 0xAC70AC, 0x2A3C57, 0x26A5A1, 0xA0E95A,
+    0x9E1774, 0x185B8F, 0x14C279, 0x928E82, 0x0DF195, 0x8BBD6E, 0x872498, 0x016863,
+    0xFAD8C4, 0x7C943F, 0x700DC9, 0xF64132, 0x693E25, 0xEF72DE, 0xE3EB28, 0x65A7D3,
+    0x5B59FD, 0xDD1506, 0xD18CF0, 0x57C00B, 0xC8BF1C, 0x4EF3E7, 0x426A11, 0xC426EA,
+    0x2AE476, 0xACA88D, 0xA0317B, 0x267D80, 0xB90297, 0x3F4E6C, 0x33D79A, 0xB59B61,
+    0x8B654F, 0x0D29B4, 0x01B042, 0x87FCB9, 0x1883AE, 0x9ECF55, 0x9256A3, 0x141A58,
+    0xEFAAFF, 0x69E604, 0x657FF2, 0xE33309, 0x7C4C1E, 0xFA00E5, 0xF69913, 0x70D5E8,
+    0x4E2BC6, 0xC8673D, 0xC4FECB, 0x42B230, 0xDDCD27, 0x5B81DC, 0x57182A, 0xD154D1,
+    0x26359F, 0xA07964, 0xACE092, 0x2AAC69, 0xB5D37E, 0x339F85, 0x3F0673, 0xB94A88,
+    0x87B4A6, 0x01F85D, 0x0D61AB, 0x8B2D50, 0x145247, 0x921EBC, 0x9E874A, 0x18CBB1,
+    0xE37B16, 0x6537ED, 0x69AE1B, 0xEFE2E0, 0x709DF7, 0xF6D10C, 0xFA48FA, 0x7C0401,
+    0x42FA2F, 0xC4B6D4, 0xC82F22, 0x4E63D9, 0xD11CCE, 0x575035, 0x5BC9C3, 0xDD8538,
+};
+
+/**
+ * @brief Computes the CRC-24Q checksum used by RTCM3 frames.
+ *
+ * @param buf Bytes to checksum (frame header + payload).
+ * @param len Number of bytes.
+ * @return 24-bit CRC in the low bits of the result.
+ */
+uint32_t rtcm3_crc24q(const uint8_t *buf, size_t len)
+{
+    uint32_t crc = 0;
+    for (size_t i = 0; i < len; i++)
+        crc = ((crc << 8) & 0xFFFFFFu) ^ crc24q_table[(crc >> 16) ^ buf[i]];
+    return crc;
+}
+
+/**
+ * @brief Reads an unsigned big-endian bit field.
+ *
+ * @param buf Byte buffer.
+ * @param pos Bit offset of the first (most significant) bit.
+ * @param len Field width in bits (0..32).
+ * @return Field value.
+ */
+uint32_t rtcm3_getbitu(const uint8_t *buf, size_t pos, unsigned len)
+{
+    if (len == 0)
+        return 0;
+
+    size_t first = pos >> 3;
+    size_t last = (pos + len - 1) >> 3;
+    uint64_t acc = 0;
+    for (size_t i = first; i <= last; i++)
+        acc = (acc << 8) | buf[i];
+
+    unsigned tail = (unsigned)(((last + 1) << 3) - (pos + len));
+    uint64_t mask = (len == 32) ? 0xFFFFFFFFu : ((1u << len) - 1u);
+    return (uint32_t)((acc >> tail) & mask);
+}
+
+/**
+ * @brief Reads a two's-complement big-endian bit field.
+ *
+ * @param buf Byte buffer.
+ * @param pos Bit offset of the first (sign) bit.
+ * @param len Field width in bits (1..32).
+ * @return Sign-extended field value.
+ */
+int32_t rtcm3_getbits(const uint8_t *buf, size_t pos, unsigned len)
+{
+    uint32_t v = rtcm3_getbitu(buf, pos, len);
+    if (len > 0 && len < 32 && (v & (1u << (len - 1))))
+        v |= ~((1u << len) - 1u);
+    return (int32_t)v;
+}
+
+/* ---------- sequential bit cursor used by the payload decoders ---------- */
+
+typedef struct
+{
+    const uint8_t *buf; ///< Payload start
+    size_t pos;         ///< Next bit to read
+} rtcm3_bits_t;
+
+static inline uint32_t take_u(rtcm3_bits_t *b, unsigned len)
+{
+    uint32_t v = rtcm3_getbitu(b->buf, b->pos, len);
+    b->pos += len;
+    return v;
+}
+
+static inline int32_t take_s(rtcm3_bits_t *b, unsigned len)
+{
+    int32_t v = rtcm3_getbits(b->buf, b->pos, len);
+    b->pos += len;
+    return v;
+}
+
+/// Reads an unsigned field and applies a power-of-two scale factor
+static inline double take_u_scaled(rtcm3_bits_t *b, unsigned len, int exp2)
+{
+    return ldexp((double)take_u(b, len), exp2);
+}
+
+/// Reads a signed field and applies a power-of-two scale factor
+static inline double take_s_scaled(rtcm3_bits_t *b, unsigned len, int exp2)
+{
+    return ldexp((double)take_s(b, len), exp2);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Resets a framer to the "hunting for preamble" state.
+ *
+ * @param framer Framer to initialize.
+ */
+void rtcm3_framer_init(rtcm3_framer_t *framer)
+{
+    memset(framer, 0, sizeof(*framer));
+}
+
+/**
+ * @brief Drops the current preamble candidate and restarts on the next buffered 0xD3.
+ */
+static void framer_resync(rtcm3_framer_t *framer)
+{
+    size_t k = 1;
+    while (k < framer->len && framer->buf[k] != RTCM3_PREAMBLE)
+        k++;
+
+    framer->n_skipped += k;
+    memmove(framer->buf, framer->buf + k, framer->len - k);
+    framer->len -= k;
+}
+
+/**
+ * @brief Checks the buffered bytes for a complete frame, resynchronizing on errors.
+ *
+ * @return 1 if buf now holds a complete CRC-valid frame, 0 if more bytes are needed.
+ */
+static int framer_check(rtcm3_framer_t *framer)
+{
+    while (framer->len >= 3)
+    {
+        // 6 reserved bits must be zero
+        if (framer->buf[1] & 0xFC)
+        {
+            framer_resync(framer);
+            continue;
+        }
+
+        size_t frame_len = 3 + (((size_t)(framer->buf[1] & 0x03u) << 8) | framer->buf[2]) + 3;
+        if (framer->len < frame_len)
+            return 0;
+
+        uint32_t crc = ((uint32_t)framer->buf[frame_len - 3] << 16) |
+                       ((uint32_t)framer->buf[frame_len - 2] << 8) |
+                       (uint32_t)framer->buf[frame_len - 1];
+        if (rtcm3_crc24q(framer->buf, frame_len - 3) == crc)
+            return 1;
+
+        framer->n_crc_errors++;
+        framer_resync(framer);
+    }
+    return 0;
+}
+
+/**
+ * @brief Pushes bytes into the framer until one complete frame is available.
+ *
+ * Consumes input up to and including the last byte of the next valid frame, or all
+ * of @p data if no frame completes. When 1 is returned the frame is available in
+ * `framer->buf` (see RTCM3_FRAME_PAYLOAD / RTCM3_FRAME_PAYLOAD_LEN) until the next call.
+ * A frame can also complete from bytes still buffered after a resync, with
+ * *consumed set to 0.
+ *
+ * @param framer   Framer state.
+ * @param data     Input bytes.
+ * @param len      Number of input bytes.
+ * @param consumed Receives the number of bytes taken from @p data.
+ * @return 1 if a frame is ready, 0 if all input was consumed without completing one.
+ */
+int rtcm3_framer_next(rtcm3_framer_t *framer, const uint8_t *data, size_t len, size_t *consumed)
+{
+    if (framer->ready)
+    {
+        framer->ready = false;
+
+        // After a resync the buffer can hold bytes past the delivered frame: they are input too
+        size_t frame_len = 3 + RTCM3_FRAME_PAYLOAD_LEN(framer) + 3;
+        size_t rest = framer->len - frame_len, k = 0;
+        while (k < rest && framer->buf[frame_len + k] != RTCM3_PREAMBLE)
+            k++;
+        framer->n_skipped += k;
+        memmove(framer->buf, framer->buf + frame_len + k, rest - k);
+        framer->len = rest - k;
+
+        if (framer->len >= 3 && framer_check(framer))
+        {
+            framer->ready = true;
+            framer->n_frames++;
+            *consumed = 0;
+            return 1;
+        }
+    }
+
+    size_t i = 0;
+    while (i < len)
+    {
+        uint8_t byte = data[i++];
+        if (framer->len == 0 && byte != RTCM3_PREAMBLE)
+        {
+            framer->n_skipped++;
+            continue;
+        }
+
+        framer->buf[framer->len++] = byte;
+        if (framer->len >= 3 && framer_check(framer))
+        {
+            framer->ready = true;
+            framer->n_frames++;
+            *consumed = i;
+            return 1;
+        }
+    }
+
+    *consumed = i;
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Decodes an RTCM 1019 (GPS ephemeris) payload.
+ *
+ * @param payload Frame payload (without header and CRC).
+ * @param len     Payload length in bytes.
+ * @param eph     Ephemeris structure to populate (cleared first).
+ * @return 0 on success, -1 if the payload is too short.
+ */
+int rtcm3_decode_1019(const uint8_t *payload, size_t len, rtcm_1019_ephemeris_t *eph)
+{
+    if (!payload || !eph || len * 8 < 488)
+        return -1;
+
+    memset(eph, 0, sizeof(*eph));
+    rtcm3_bits_t b = {payload, 0};
+
+    eph->msg_type = (uint16_t)take_u(&b, 12);           // DF002
+    eph->satellite_id = (uint8_t)take_u(&b, 6);         // DF009
+    eph->gps_wn = (uint16_t)take_u(&b, 10);             // DF076
+    eph->gps_sv_acc = (uint8_t)take_u(&b, 4);           // DF077
+    eph->gps_code_l2 = (uint8_t)take_u(&b, 2);          // DF078
+    eph->gps_idot = take_s_scaled(&b, 14, -43);         // DF079
+    eph->gps_iode = (uint16_t)take_u(&b, 8);            // DF071
+    eph->gps_toc = take_u(&b, 16) * 16u;                // DF081
+    eph->gps_af2 = take_s_scaled(&b, 8, -55);           // DF082
+    eph->gps_af1 = take_s_scaled(&b, 16, -43);          // DF083
+    eph->gps_af0 = take_s_scaled(&b, 22, -31);          // DF084
+    eph->gps_iodc = (uint16_t)take_u(&b, 10);           // DF085
+    eph->gps_crs = take_s_scaled(&b, 16, -5);           // DF086
+    eph->gps_delta_n = take_s_scaled(&b, 16, -43);      // DF087
+    eph->gps_m0 = take_s_scaled(&b, 32, -31);           // DF088
+    eph->gps_cuc = take_s_scaled(&b, 16, -29);          // DF089
+    eph->gps_eccentricity = take_u_scaled(&b, 32, -33); // DF090
+    eph->gps_cus = take_s_scaled(&b, 16, -29);          // DF091
+    eph->gps_sqrt_a = take_u_scaled(&b, 32, -19);       // DF092
+    eph->gps_toe = take_u(&b, 16) * 16u;                // DF093
+    eph->gps_cic = take_s_scaled(&b, 16, -29);          // DF094
+    eph->gps_omega0 = take_s_scaled(&b, 32, -31);       // DF095
+    eph->gps_cis = take_s_scaled(&b, 16, -29);          // DF096
+    eph->gps_i0 = take_s_scaled(&b, 32, -31);           // DF097
+    eph->gps_crc = take_s_scaled(&b, 16, -5);           // DF098
+    eph->gps_omega = take_s_scaled(&b, 32, -31);        // DF099
+    eph->gps_omega_dot = take_s_scaled(&b, 24, -43);    // DF100
+    eph->gps_tgd = take_s_scaled(&b, 8, -31);           // DF101
+    eph->gps_sv_health = (uint8_t)take_u(&b, 6);        // DF102
+    eph->gps_l2p_data_flag = (uint8_t)take_u(&b, 1);    // DF103
+    eph->gps_fit_interval = (uint16_t)take_u(&b, 1);    // DF137
+
+    finalize_ephemeris(eph);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Decodes an RTCM 1045 / 1046 (Galileo F/NAV / I/NAV ephemeris) payload.
+ *
+ * Both share every field up to DF312; the health of the signal the message is
+ * broadcast on (E5a for 1045, E1-B for 1046) is kept.
+ *
+ * @param payload Frame payload (without header and CRC).
+ * @param len     Payload length in bytes.
+ * @param eph     Ephemeris structure to populate (cleared first).
+ * @return 0 on success, -1 if the payload is too short.
+ */
+int rtcm3_decode_1045(const uint8_t *payload, size_t len, rtcm_1019_ephemeris_t *eph)
+{
+    if (!payload || !eph || len * 8 < 489)
+        return -1;
+
+    memset(eph, 0, sizeof(*eph));
+    rtcm3_bits_t b = {payload, 0};
+
+    eph->msg_type = (uint16_t)take_u(&b, 12);           // DF002
+    if (eph->msg_type == 1046 && len * 8 < 502)
+        return -1;
+    eph->satellite_id = (uint8_t)take_u(&b, 6);         // DF252
+    eph->gps_wn = (uint16_t)take_u(&b, 12);             // DF289
+    eph->gps_iode = (uint16_t)take_u(&b, 10);           // DF290
+    eph->gps_sv_acc = (uint8_t)take_u(&b, 8);           // DF291
+    eph->gps_idot = take_s_scaled(&b, 14, -43);         // DF292
+    eph->gps_toc = take_u(&b, 14) * 60u;                // DF293
+    eph->gps_af2 = take_s_scaled(&b, 6, -59);           // DF294
+    eph->gps_af1 = take_s_scaled(&b, 21, -46);          // DF295
+    eph->gps_af0 = take_s_scaled(&b, 31, -34);          // DF296
+    eph->gps_crs = take_s_scaled(&b, 16, -5);           // DF297
+    eph->gps_delta_n = take_s_scaled(&b, 16, -43);      // DF298
+    eph->gps_m0 = take_s_scaled(&b, 32, -31);           // DF299
+    eph->gps_cuc = take_s_scaled(&b, 16, -29);          // DF300
+    eph->gps_eccentricity = take_u_scaled(&b, 32, -33); // DF301
+    eph->gps_cus = take_s_scaled(&b, 16, -29);          // DF302
+    eph->gps_sqrt_a = take_u_scaled(&b, 32, -19);       // DF303
+    eph->gps_toe = take_u(&b, 14) * 60u;                // DF304
+    eph->gps_cic = take_s_scaled(&b, 16, -29);          // DF305
+    eph->gps_omega0 = take_s_scaled(&b, 32, -31);       // DF306
+    eph->gps_cis = take_s_scaled(&b, 16, -29);          // DF307
+    eph->gps_i0 = take_s_scaled(&b, 32, -31);           // DF308
+    eph->gps_crc = take_s_scaled(&b, 16, -5);           // DF309
+    eph->gps_omega = take_s_scaled(&b, 32, -31);        // DF310
+    eph->gps_omega_dot = take_s_scaled(&b, 24, -43);    // DF311
+    eph->gps_tgd = take_s_scaled(&b, 10, -32);          // DF312
+    if (eph->msg_type == 1046)
+    {
+        take_s(&b, 10);                                 // DF313: BGD E5b/E1
+        take_u(&b, 3);                                  // DF316, DF317: E5b health, validity
+    }
+    eph->gps_sv_health = (uint8_t)take_u(&b, 2);        // DF314 (1045) / DF287 (1046)
+    eph->data_validity = (uint8_t)take_u(&b, 1);        // DF315 (1045) / DF288 (1046)
+
+    finalize_ephemeris(eph);
+    return 0;
+}
+
+/**
+ * @brief Decodes an RTCM 1042 (BeiDou ephemeris) payload.
+ *
+ * @param payload Frame payload (without header and CRC).
+ * @param len     Payload length in bytes.
+ * @param eph     Ephemeris structure to populate (cleared first).
+ * @return 0 on success, -1 if the payload is too short.
+ */
+int rtcm3_decode_1042(const uint8_t *payload, size_t len, rtcm_1019_ephemeris_t *eph)
+{
+    if (!payload || !eph || len * 8 < 511)
+        return -1;
+
+    memset(eph, 0, sizeof(*eph));
+    rtcm3_bits_t b = {payload, 0};
+
+    eph->msg_type = (uint16_t)take_u(&b, 12);           // DF002
+    eph->satellite_id = (uint8_t)take_u(&b, 6);         // DF488
+    eph->gps_wn = (uint16_t)take_u(&b, 13);             // DF489
+    eph->gps_sv_acc = (uint8_t)take_u(&b, 4);           // DF490
+    eph->gps_idot = take_s_scaled(&b, 14, -43);         // DF491
+    eph->gps_iode = (uint16_t)take_u(&b, 5);            // DF492
+    eph->gps_toc = take_u(&b, 17) * 8u;                 // DF493
+    eph->gps_af2 = take_s_scaled(&b, 11, -66);          // DF494
+    eph->gps_af1 = take_s_scaled(&b, 22, -50);          // DF495
+    eph->gps_af0 = take_s_scaled(&b, 24, -33);          // DF496
+    eph->gps_iodc = (uint16_t)take_u(&b, 5);            // DF497
+    eph->gps_crs = take_s_scaled(&b, 18, -6);           // DF498
+    eph->gps_delta_n = take_s_scaled(&b, 16, -43);      // DF499
+    eph->gps_m0 = take_s_scaled(&b, 32, -31);           // DF500
+    eph->gps_cuc = take_s_scaled(&b, 18, -31);          // DF501
+    eph->gps_eccentricity = take_u_scaled(&b, 32, -33); // DF502
+    eph->gps_cus = take_s_scaled(&b, 18, -31);          // DF503
+    eph->gps_sqrt_a = take_u_scaled(&b, 32, -19);       // DF504
+    eph->gps_toe = take_u(&b, 17) * 8u;                 // DF505
+    eph->gps_cic = take_s_scaled(&b, 18, -31);          // DF506
+    eph->gps_omega0 = take_s_scaled(&b, 32, -31);       // DF507
+    eph->gps_cis = take_s_scaled(&b, 18, -31);          // DF508
+    eph->gps_i0 = take_s_scaled(&b, 32, -31);           // DF509
+    eph->gps_crc = take_s_scaled(&b, 18, -6);           // DF510
+    eph->gps_omega = take_s_scaled(&b, 32, -31);        // DF511
+    eph->gps_omega_dot = take_s_scaled(&b, 24, -43);    // DF512
+    eph->gps_tgd = take_s(&b, 10) * 1e-10;              // DF513: TGD1, 0.1 ns
+    take_s(&b, 10);                                     // DF514: TGD2
+    eph->gps_sv_health = (uint8_t)take_u(&b, 1);        // DF515
+
+    finalize_ephemeris(eph);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief MSM_BAND_* of MSM signal ID @p sig_id. */
+static uint8_t msm_signal_band(uint8_t sig_id)
+{
+    if (sig_id == MSM_SIG_PRIMARY)
+        return MSM_BAND_PRIMARY;
+    if (sig_id >= MSM_SIG_L5_FIRST && sig_id <= MSM_SIG_L5_LAST)
+        return MSM_BAND_L5;
+    return MSM_BAND_OTHER;
+}
+
+/**
+ * @brief Decodes an RTCM 1074 (GPS MSM4) payload.
+ *
+ * Also decodes the GLONASS, Galileo and BeiDou MSM4 (1084, 1094, 1124), whose
+ * only difference is the 30-bit epoch time field (GLONASS: 3-bit DF416 day of
+ * week, 27-bit DF034 time of day).
+ *
+ * Satellite PRNs and cell PRN/signal mappings are expanded from the DF394/DF395/DF396
+ * masks in the same satellite-major order PyRTCM uses; every cell is kept, tagged with
+ * its band, and finalize_msm4_cells() pairs the satellites with their cells.
+ *
+ * @param payload Frame payload (without header and CRC).
+ * @param len     Payload length in bytes.
+ * @param msm4    MSM4 structure to populate (cleared first).
+ * @return 0 on success, -1 if the payload is too short or the masks are inconsistent.
+ */
+int rtcm3_decode_1074(const uint8_t *payload, size_t len, rtcm_1074_msm4_t *msm4)
+{
+    if (!payload || !msm4 || len * 8 < 169)
+        return -1;
+
+    memset(msm4, 0, sizeof(*msm4));
+    rtcm3_bits_t b = {payload, 0};
+
+    // Header
+    msm4->msg_type = (uint16_t)take_u(&b, 12);            // DF002
+    msm4->station_id = (uint16_t)take_u(&b, 12);          // DF003
+    if (msm4->msg_type == 1084)
+    {
+        msm4->glo_day_of_week = (uint8_t)take_u(&b, 3);   // DF416
+        msm4->gps_epoch_time = take_u(&b, 27);            // DF034
+    }
+    else
+    {
+        msm4->gps_epoch_time = take_u(&b, 30);            // DF004 / DF248 / DF427
+    }
+    msm4->msm_sync_flag = (uint8_t)take_u(&b, 1);         // DF393
+    msm4->iods_reserved = (uint8_t)take_u(&b, 3);         // DF409
+    msm4->reserved_DF001_07 = (uint8_t)take_u(&b, 7);     // DF001_7
+    msm4->clk_steering_flag = (uint8_t)take_u(&b, 2);     // DF411
+    msm4->external_clk_flag = (uint8_t)take_u(&b, 2);     // DF412
+    msm4->smooth_interval_flag = (uint8_t)take_u(&b, 1);  // DF417
+    take_u(&b, 3);                                        // DF418: smoothing interval
+
+    // Satellite mask (DF394, 64 bits) and signal mask (DF395, 32 bits)
+    uint8_t sat_ids[64], sig_ids[32];
+    uint8_t n_sat = 0, n_sig = 0;
+    for (uint8_t i = 1; i <= 64; i++)
+        if (take_u(&b, 1))
+            sat_ids[n_sat++] = i;
+    for (uint8_t i = 1; i <= 32; i++)
+        if (take_u(&b, 1))
+            sig_ids[n_sig++] = i;
+
+    if (n_sat > MSM_MAX_SAT || n_sat * n_sig > MAX_CELL)
+        return -1;
+
+    // Cell mask (DF396, NSat x NSig bits) must fit before reading it
+    size_t n_mask = (size_t)n_sat * n_sig;
+    if (b.pos + n_mask > len * 8)
+        return -1;
+
+    uint8_t n_cell = 0;
+    for (uint8_t s = 0; s < n_sat; s++)
+    {
+        for (uint8_t g = 0; g < n_sig; g++)
+        {
+            if (!take_u(&b, 1))
+                continue;
+            msm4->cell_prn[n_cell] = sat_ids[s];
+            msm4->cell_sig[n_cell] = msm_signal_band(sig_ids[g]);
+            n_cell++;
+        }
+    }
+
+    msm4->n_sat = n_sat;
+    msm4->n_sig = n_sig;
+    msm4->n_cell = n_cell;
+
+    // Satellite data (18 bits/sat) + signal data (48 bits/cell) must fit
+    if (b.pos + (size_t)n_sat * 18 + (size_t)n_cell * 48 > len * 8)
+        return -1;
+
+    for (uint8_t s = 0; s < n_sat; s++)
+    {
+        msm4->prn[s] = sat_ids[s];
+        msm4->pseudorange_integer[s] = (uint8_t)take_u(&b, 8); // DF397
+    }
+    for (uint8_t s = 0; s < n_sat; s++)
+        msm4->pseudorange_mod_1s[s] = take_u_scaled(&b, 10, -10); // DF398
+
+    for (uint8_t c = 0; c < n_cell; c++)
+        msm4->pseudorange_fine[c] = take_s_scaled(&b, 15, -24); // DF400
+    for (uint8_t c = 0; c < n_cell; c++)
+        msm4->phase_range[c] = take_s_scaled(&b, 22, -29); // DF401
+    for (uint8_t c = 0; c < n_cell; c++)
+        msm4->lock_time[c] = (uint8_t)take_u(&b, 4); // DF402
+    for (uint8_t c = 0; c < n_cell; c++)
+        msm4->half_cycle_amb[c] = (uint8_t)take_u(&b, 1); // DF420
+    for (uint8_t c = 0; c < n_cell; c++)
+        msm4->cnr[c] = (uint8_t)take_u(&b, 6); // DF403
+
+    finalize_msm4_cells(msm4);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Decodes an RTCM 1002 (GPS L1 legacy observations) payload.
+ *
+ * @param payload Frame payload (without header and CRC).
+ * @param len     Payload length in bytes.
+ * @param msm1    MSM1 structure to populate (cleared first).
+ * @return 0 on success, -1 if the payload is too short.
+ */
+int rtcm3_decode_1002(const uint8_t *payload, size_t len, rtcm_1002_msm1_t *msm1)
+{
+    if (!payload || !msm1 || len * 8 < 64)
+        return -1;
+
+    memset(msm1, 0, sizeof(*msm1));
+    rtcm3_bits_t b = {payload, 0};
+
+    msm1->msg_type = (uint16_t)take_u(&b, 12);             // DF002
+    msm1->station_id = (uint16_t)take_u(&b, 12);           // DF003
+    msm1->time_of_week = take_u(&b, 30);                   // DF004
+    msm1->sync_gps_message_flag = (uint8_t)take_u(&b, 1);  // DF005
+    msm1->num_satellites = (uint8_t)take_u(&b, 5);         // DF006
+    msm1->smooth_interval_flag = (uint8_t)take_u(&b, 1);   // DF007
+    msm1->smooth_interval = (uint8_t)take_u(&b, 3);        // DF008
+
+    if (msm1->num_satellites > MAX_PRN_GPS ||
+        b.pos + (size_t)msm1->num_satellites * 74 > len * 8)
+        return -1;
+
+    for (int i = 0; i < msm1->num_satellites; i++)
+    {
+        msm1->svs[i] = (uint8_t)take_u(&b, 6);                // DF009
+        msm1->sig_id[i] = (uint8_t)take_u(&b, 1);             // DF010
+        msm1->remainders[i] = take_u(&b, 24) * 0.02;          // DF011 (m)
+        msm1->phase_pr_diff[i] = take_s(&b, 20) * 0.0005;     // DF012 (m)
+        msm1->lock_time[i] = (uint8_t)take_u(&b, 7);          // DF013
+        msm1->ambiguities[i] = (uint8_t)take_u(&b, 8);        // DF014
+        msm1->cnr[i] = (uint8_t)(take_u(&b, 8) * 0.25);       // DF015 (dB-Hz)
+    }
+
+    finalize_msm1(msm1);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Decodes the common header of an MSM message of any constellation.
+ *
+ * The epoch time field is 30 bits wide for every constellation (GLONASS packs
+ * day-of-week and time-of-day into it), so DF393 always sits at bit 54.
+ *
+ * @param payload Frame payload (without header and CRC).
+ * @param len     Payload length in bytes.
+ * @param hdr     Output header.
+ * @return 0 on success, -1 if the payload is too short.
+ */
+int rtcm3_decode_msm_header(const uint8_t *payload, size_t len, rtcm_msm_header_t *hdr)
+{
+    if (!payload || !hdr || len * 8 < 55)
+        return -1;
+
+    memset(hdr, 0, sizeof(*hdr));
+    rtcm3_bits_t b = {payload, 0};
+
+    hdr->msg_type = (uint16_t)take_u(&b, 12);      // DF002
+    hdr->station_id = (uint16_t)take_u(&b, 12);    // DF003
+    take_u(&b, 30);                                // Constellation-specific epoch time
+    hdr->msm_sync_flag = (uint8_t)take_u(&b, 1);   // DF393
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Decodes any supported RTCM3 payload into a tagged message.
+ *
+ * @param payload Frame payload (without header and CRC).
+ * @param len     Payload length in bytes.
+ * @param msg     Output message.
+ * @return 0 on success, 1 if the message type is not supported, -1 on decode failure.
+ */
+int rtcm3_decode_payload(const uint8_t *payload, size_t len, rtcm_message_t *msg)
+{
+    if (!payload || !msg || len < 2)
+        return -1;
+
+    uint16_t msg_type = (uint16_t)rtcm3_getbitu(payload, 0, 12);
+    msg->msg_type = msg_type;
+
+    switch (msg_type)
+    {
+    case 1002:
+        return rtcm3_decode_1002(payload, len, &msg->data.msm1);
+    case 1019:
+        return rtcm3_decode_1019(payload, len, &msg->data.eph);
+    case 1042:
+        return rtcm3_decode_1042(payload, len, &msg->data.eph);
+    case 1045:
+    case 1046:
+        return rtcm3_decode_1045(payload, len, &msg->data.eph);
+    case 1074:
+    case 1084:
+    case 1094:
+    case 1124:
+        return rtcm3_decode_1074(payload, len, &msg->data.msm4);
+    default:
+        if (RTCM_IS_MSM(msg_type))
+            return rtcm3_decode_msm_header(payload, len, &msg->data.msm_header);
+        return 1;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Decodes one CRC-valid frame payload, counts it in @p tally and hands
+ *        the message to the consumer.
+ *
+ * @return 1 if the payload did not decode, 0 otherwise.
+ */
+static int dispatch_frame(const uint8_t *payload, size_t len, rtcm_message_t *msg,
+                          rtcm_message_handler_t on_message, void *ctx, perf_tally_t *tally)
+{
+    int status = rtcm3_decode_payload(payload, len, msg);
+    perf_tally_message(tally, status, msg->msg_type);
+    if (status < 0)
+        return 1;
+    if (status == 0 && on_message)
+        on_message(msg, ctx);
+    else if (status == 0)
+        store_rtcm_message((gnss_context_t *)ctx, msg);
+    return 0;
+}
+
+/**
+ * @brief Frames and decodes a buffer holding a whole RTCM3 log, in place.
+ *
+ * Same framing rules and statistics as rtcm3_framer_next() (resync on the next
+ * preamble after a bad header or CRC), but frames are CRC-checked and decoded
+ * where they lie instead of being copied into the framer first. A truncated
+ * frame at the end of the buffer is ignored.
+ *
+ * @param data       Log bytes (e.g. a memory-mapped file).
+ * @param len        Length of @p data.
+ * @param stats      Receives the frame / CRC error / skipped byte counts.
+ * @param on_message Called once per decoded message; NULL stores it with store_rtcm_message().
+ * @param ctx        Passed through to @p on_message; with a NULL @p on_message, the
+ *                   gnss_context_t that receives the messages.
+ * @param tally      Receives the message counts.
+ * @return Number of CRC-valid frames that did not decode.
+ */
+static unsigned long scan_buffer_frames(const uint8_t *data, size_t len, rtcm3_framer_t *stats,
+                                        rtcm_message_handler_t on_message, void *ctx, perf_tally_t *tally)
+{
+    rtcm_message_t msg;
+    unsigned long n_failed = 0;
+    size_t off = 0;
+
+    while (off < len)
+    {
+        if (data[off] != RTCM3_PREAMBLE)
+        {
+            const uint8_t *next = memchr(data + off, RTCM3_PREAMBLE, len - off);
+            size_t to = next ? (size_t)(next - data) : len;
+            stats->n_skipped += to - off;
+            off = to;
+            continue;
+        }
+        if (len - off < 3)
+            break; // Truncated header at the end
+
+        const uint8_t *frame = data + off;
+        if (frame[1] & 0xFC) // 6 reserved bits must be zero
+        {
+            stats->n_skipped++;
+            off++;
+            continue;
+        }
+
+        size_t payload_len = ((size_t)(frame[1] & 0x03u) << 8) | frame[2];
+        size_t frame_len = 3 + payload_len + 3;
+        if (len - off < frame_len)
+            break; // Truncated frame at the end
+
+        uint32_t crc = ((uint32_t)frame[frame_len - 3] << 16) |
+                       ((uint32_t)frame[frame_len - 2] << 8) |
+                       (uint32_t)frame[frame_len - 1];
+        if (rtcm3_crc24q(frame, frame_len - 3) != crc)
+        {
+            stats->n_crc_errors++;
+            stats->n_skipped++;
+            off++;
+            continue;
+        }
+
+        stats->n_frames++;
+        n_failed += (unsigned long)dispatch_frame(frame + 3, payload_len, &msg, on_message, ctx, tally);
+        off += frame_len;
+    }
+    return n_failed;
+}
+
+/**
+ * @brief Reads a raw binary RTCM3 log and hands every supported message to a consumer.
+ *
+ * Binary counterpart of read_next_rtcm_message(). Regular files are memory-mapped
+ * and framed in place (see scan_buffer_frames()); other inputs are read in large
+ * chunks through the incremental framer. Both are CRC-checked and decoded alike.
+ *
+ * @param fp         File opened in binary mode.
+ * @param on_message Called once per decoded message; NULL stores it with store_rtcm_message().
+ * @param ctx        Passed through to @p on_message; with a NULL @p on_message, the
+ *                   gnss_context_t that receives the messages.
+ * @return 0 on success, non-zero on read error.
+ */
+int rtcm3_read_stream(FILE *fp, rtcm_message_handler_t on_message, void *ctx)
+{
+    rtcm3_framer_t framer;
+    rtcm_message_t msg;
+    unsigned long n_failed = 0;
+    perf_tally_t tally = {{0}};
+
+    rtcm3_framer_init(&framer);
+
+    file_map_t map;
+    if (file_map_open(fp, &map) == 0)
+    {
+        n_failed = scan_buffer_frames(map.data, map.len, &framer, on_message, ctx, &tally);
+        file_map_close(&map);
+    }
+    else
+    {
+        uint8_t *chunk = malloc(RTCM3_READ_CHUNK); // per call, so concurrent sessions can read
+        if (!chunk)
+        {
+            fprintf(stderr, COLOR_RED "Error: Out of memory for the read buffer.\n" COLOR_RESET);
+            return 1;
+        }
+
+        size_t n;
+        while ((n = fread(chunk, 1, RTCM3_READ_CHUNK, fp)) > 0)
+        {
+            size_t off = 0;
+            while (off < n)
+            {
+                size_t used = 0;
+                int ready = rtcm3_framer_next(&framer, chunk + off, n - off, &used);
+                off += used;
+                if (!ready)
+                    break;
+
+                n_failed += (unsigned long)dispatch_frame(RTCM3_FRAME_PAYLOAD(&framer),
+                                                          RTCM3_FRAME_PAYLOAD_LEN(&framer), &msg, on_message, ctx, &tally);
+            }
+        }
+        free(chunk);
+
+        if (ferror(fp))
+        {
+            perror("[ERR] fread(rtcm3)");
+            perf_add_tally(&tally);
+            return 1;
+        }
+    }
+
+    tally.n[PERF_FRAMES_READ] += framer.n_frames;
+    tally.n[PERF_CRC_ERRORS] += framer.n_crc_errors;
+    perf_add_tally(&tally);
+
+    printf(COLOR_GREEN "RTCM3: %lu frames, %lu CRC errors, %lu undecodable, %lu bytes skipped.\n" COLOR_RESET,
+           framer.n_frames, framer.n_crc_errors, n_failed, framer.n_skipped);
+    return 0;
+}
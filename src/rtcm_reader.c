@@ -3,117 +3,264 @@
  * @brief Reads RTCM messages from a text-formatted file and dispatches parsing for known message types.
  *
  * This function handles the input of RTCM messages in text format (one per line), as exported from logs or
- * test files. It identifies supported message types (currently 1019 and 1074), and calls the appropriate
+ * test files. It identifies supported message types (currently 1002, the 1019 / 1042 / 1045 / 1046 ephemerides
+ * and the 1074 / 1084 / 1094 / 1124 MSM4 observations), and calls the appropriate
  * parser function to extract useful GNSS data structures for later processing.
  *
  * Unsupported or malformed lines are safely skipped. Ephemeris and MSM4 messages are handled separately.
+ *
+ * Regular files are memory-mapped and scanned in place: every line is handed to the
+ * parsers as a (pointer, length) span of the mapping, so nothing is copied and there
+ * is no line-length limit. Large mapped logs that go straight to the store are parsed
+ * on several threads (see ingest_parallel.c). Other inputs are read line by line into a buffer that
+ * grows with the longest line.
  */
 
 #include "../include/algo.h"
 #include "../include/rtcm_reader.h"
 #include "../include/df_parser.h"
+#include "../include/obs_store.h"
+#include "../include/file_map.h"
+#include "../include/ingest_parallel.h"
+#include "../include/perf_stats.h"
+
+#include <limits.h>
+
+/// Initial capacity of the line buffer used when the input cannot be mapped
+#define RTCM_LINE_INITIAL 4096
+
+/**
+ * @brief Finds the first occurrence of @p key in a span (memmem() is not standard C).
+ *
+ * @return Pointer to the match inside @p s, or NULL.
+ */
+static const char *span_find(const char *s, size_t len, const char *key, size_t key_len)
+{
+    const char *end = s + len;
+    while ((size_t)(end - s) >= key_len)
+    {
+        const char *c = memchr(s, key[0], (size_t)(end - s) - key_len + 1);
+        if (!c)
+            return NULL;
+        if (memcmp(c, key, key_len) == 0)
+            return c;
+        s = c + 1;
+    }
+    return NULL;
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Reads the next valid RTCM message line from file and parses it if supported.
+ * @brief Parses one text-formatted RTCM line into a tagged message.
  *
  * Currently supports:
+ * - RTCM 1002: Legacy GPS L1 observations
  * - RTCM 1019: Ephemeris (GPS)
+ * - RTCM 1042, 1045, 1046: Ephemeris (BeiDou, Galileo F/NAV and I/NAV)
  * - RTCM 1074: MSM4 (GPS L1 pseudorange and phase)
+ * - RTCM 1084, 1094, 1124: MSM4 (GLONASS, Galileo, BeiDou first-frequency code and phase)
+ * - Any other MSM message: common header only (see rtcm_msm_header_t)
  *
- * Lines not matching these types are skipped. Each line should contain a complete message.
- *
- * @param fp Pointer to an open file for reading RTCM text lines.
- * @return 0 on successful read and parse, non-zero otherwise.
+ * @param line Input line (one complete message), not necessarily NUL-terminated.
+ * @param len  Length of @p line in bytes.
+ * @param msg  Output message; `msg->msg_type` tells which union member is valid.
+ * @return 0 on success, 1 if the line is not a supported RTCM message, -1 on parse failure.
  */
-int read_next_rtcm_message(FILE *fp)
+int parse_rtcm_span(const char *line, size_t len, rtcm_message_t *msg)
 {
-    char line[4096]; // Buffer for reading lines
-    // unsigned int line_count = 1; // Counter for lines processed
+    // Skip empty lines or comments
+    if (len == 0 || line[0] == '\n' || line[0] == '\r' || line[0] == '#' || line[0] == '\0' || line[0] == ' ' || line[0] == '\t')
+        return 1;
+
+    // Extract DF002 = message type
+    const char *df002_ptr = span_find(line, len, "DF002=", 6);
+    if (!df002_ptr)
+        return 1;
 
-    while (fgets(line, sizeof(line), fp) != NULL)
+    int message_type = 0;
+    for (const char *d = df002_ptr + 6; d < line + len && *d >= '0' && *d <= '9' && message_type < 100000; d++)
+        message_type = message_type * 10 + (*d - '0');
+
+    switch (message_type)
     {
-        // Skip empty lines or comments
-        if (line[0] == '\n' || line[0] == '#' || line[0] == '\0' || line[0] == ' ' || line[0] == '\t')
-        {
-            continue;
-        }
+    case 1002:
+        memset(&msg->data.msm1, 0, sizeof(msg->data.msm1));
+        msg->msg_type = 1002;
+        return parse_rtcm_1002(line, len, &msg->data.msm1) == 0 ? 0 : -1;
 
-        // Debug print
-        // printf(COLOR_GREEN "Processing Line: %d \n" COLOR_RESET, line_count++);
+    case 1019:
+        memset(&msg->data.eph, 0, sizeof(msg->data.eph));
+        msg->msg_type = 1019;
+        return parse_rtcm_1019(line, len, &msg->data.eph) == 0 ? 0 : -1;
 
-        // Extract DF002 = message type
-        char *df002_ptr = strstr(line, "DF002=");
-        if (!df002_ptr)
-        {
-            // fprintf(stderr, COLOR_YELLOW "Warning: DF002 not found in mess\age. Skipping.\n" COLOR_RESET);
-            continue;
-        }
+    case 1042:
+        memset(&msg->data.eph, 0, sizeof(msg->data.eph));
+        msg->msg_type = 1042;
+        return parse_rtcm_1042(line, len, &msg->data.eph) == 0 ? 0 : -1;
 
-        int message_type = atoi(df002_ptr + 6);
+    case 1045:
+    case 1046:
+        memset(&msg->data.eph, 0, sizeof(msg->data.eph));
+        msg->msg_type = (uint16_t)message_type;
+        return parse_rtcm_1045(line, len, &msg->data.eph) == 0 ? 0 : -1;
 
-        if (message_type != 1002 && message_type != 1019 && message_type != 1074)
+    case 1074:
+    case 1084:
+    case 1094:
+    case 1124:
+        memset(&msg->data.msm4, 0, sizeof(msg->data.msm4));
+        msg->msg_type = (uint16_t)message_type;
+        return parse_rtcm_1074(line, len, &msg->data.msm4) == 0 ? 0 : -1;
+
+    default:
+        if (RTCM_IS_MSM(message_type))
         {
-            // fprintf(stderr, COLOR_YELLOW "Warning: Unsupported message type %d. Skipping.\n" COLOR_RESET, message_type);
-            continue;
+            // Other constellations: keep the header so epoch boundaries (DF393) stay visible
+            memset(&msg->data.msm_header, 0, sizeof(msg->data.msm_header));
+            msg->msg_type = (uint16_t)message_type;
+            return parse_rtcm_msm_header(line, len, &msg->data.msm_header) == 0 ? 0 : -1;
         }
+        // fprintf(stderr, COLOR_YELLOW "Warning: Unsupported message type %d. Skipping.\n" COLOR_RESET, message_type);
+        return 1;
+    }
+}
 
-        if (message_type == 1002)
-        {
-            observation_type = 1; // Set observation type for MSM1
-            rtcm_1002_msm1_t msm1 = {0};
-            if (parse_rtcm_1002(line, &msm1) != 0)
-            {
-                // fprintf(stderr, COLOR_YELLOW "Warning: Failed to parse RTCM 1002 message. Skipping.\n" COLOR_RESET);
-                continue;
-            }
+/**
+ * @brief Parses one NUL-terminated text-formatted RTCM line (see parse_rtcm_span()).
+ *
+ * @param line Input line (one complete message).
+ * @param msg  Output message; `msg->msg_type` tells which union member is valid.
+ * @return 0 on success, 1 if the line is not a supported RTCM message, -1 on parse failure.
+ */
+int parse_rtcm_line(const char *line, rtcm_message_t *msg)
+{
+    return parse_rtcm_span(line, strlen(line), msg);
+}
 
-            if (store_msm1(&msm1) != 0)
-            {
-                // fprintf(stderr, COLOR_YELLOW "Warning: Failed to store RTCM MSM1 data.\n" COLOR_RESET);
-            }
-            continue;
-        }
+//////////////////////////////////////////////////////////////////////////////////////////////
 
-        else if (message_type == 1019)
-        {
-            rtcm_1019_ephemeris_t eph = {0};
-            if (parse_rtcm_1019(line, &eph) != 0)
-            {
-                fprintf(stderr, COLOR_YELLOW "Warning: Failed to parse RTCM 1019 message. Skipping.\n" COLOR_RESET);
-                continue;
-            }
+/**
+ * @brief Parses one line span, counts it in @p tally and hands the message to the consumer.
+ */
+static void dispatch_line(const char *line, size_t len, rtcm_message_t *msg,
+                          rtcm_message_handler_t on_message, void *ctx, perf_tally_t *tally)
+{
+    int status = parse_rtcm_span(line, len, msg);
+    tally->n[PERF_LINES_READ]++;
+    if (status > 0)
+        return; // Not a supported RTCM message
 
-            if (store_ephemeris(&eph) != 0)
-            {
-                // fprintf(stderr, COLOR_YELLOW "Warning: Failed to store/update ephemeris for PRN %d\n" COLOR_RESET, eph.satellite_id);
-            }
+    perf_tally_message(tally, status, msg->msg_type);
 
-            continue;
-        }
+    if (status < 0)
+    {
+        fprintf(stderr, COLOR_YELLOW "Warning: Failed to parse RTCM %u message. Skipping.\n" COLOR_RESET, msg->msg_type);
+        return;
+    }
 
-        else if (message_type == 1074)
-        {
-            observation_type = 4; // Set observation type for MSM4
-            rtcm_1074_msm4_t msm4 = {0};
-            if (parse_rtcm_1074(line, &msm4) != 0)
-            {
-                // fprintf(stderr, COLOR_YELLOW "Warning: Failed to parse RTCM 1074 message. Skipping.\n" COLOR_RESET);
-                continue;
-            }
+    if (on_message)
+    {
+        on_message(msg, ctx);
+    }
+    else if (store_rtcm_message((gnss_context_t *)ctx, msg) != 0)
+    {
+        // fprintf(stderr, COLOR_YELLOW "Warning: Failed to store RTCM %u data.\n" COLOR_RESET, msg->msg_type);
+    }
+}
 
-            if (store_msm4(&msm4) != 0)
+/**
+ * @brief Parses every RTCM text line of an in-memory buffer, in place.
+ *
+ * @param data       Text (need not be NUL-terminated).
+ * @param len        Length of @p data in bytes.
+ * @param on_message Called once per parsed message; NULL stores it with store_rtcm_message().
+ * @param ctx        Passed through to @p on_message; with a NULL @p on_message, the
+ *                   gnss_context_t that receives the messages.
+ * @return 0 (malformed lines are skipped).
+ */
+int read_rtcm_text_buffer(const char *data, size_t len, rtcm_message_handler_t on_message, void *ctx)
+{
+    rtcm_message_t msg;
+    perf_tally_t tally = {{0}};
+    const char *p = data, *end = data + len;
+
+    while (p < end)
+    {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = nl ? nl : end;
+        dispatch_line(p, (size_t)(line_end - p), &msg, on_message, ctx, &tally);
+        p = nl ? nl + 1 : end;
+    }
+    perf_add_tally(&tally);
+    return 0;
+}
+
+/**
+ * @brief Reads every valid RTCM message line from file and hands it to a consumer.
+ *
+ * Lines not matching a supported type are skipped. Each line should contain a complete
+ * message; lines of any length are accepted.
+ *
+ * @param fp         Pointer to an open file for reading RTCM text lines.
+ * @param on_message Called once per parsed message; NULL stores it with store_rtcm_message().
+ * @param ctx        Passed through to @p on_message; with a NULL @p on_message, the
+ *                   gnss_context_t that receives the messages.
+ * @return 0 on successful read and parse, non-zero otherwise.
+ */
+int read_next_rtcm_message(FILE *fp, rtcm_message_handler_t on_message, void *ctx)
+{
+    file_map_t map;
+    if (file_map_open(fp, &map) == 0)
+    {
+        // Storing (no consumer) does not depend on message order across lines: parse in parallel
+        int status = -1;
+        int n_threads = on_message ? 1 : ingest_thread_count(map.len);
+        if (n_threads > 1)
+            status = ingest_text_parallel((gnss_context_t *)ctx, (const char *)map.data, map.len, n_threads);
+        if (status == -1)
+            status = read_rtcm_text_buffer((const char *)map.data, map.len, on_message, ctx);
+        file_map_close(&map);
+        return status == 0 ? 0 : 1;
+    }
+
+    // Not mappable (pipe, terminal, ...): read whole lines into a growing buffer
+    char *line = NULL;
+    size_t cap = 0;
+    rtcm_message_t msg;
+    perf_tally_t tally = {{0}};
+
+    if (grow_array((void **)&line, &cap, RTCM_LINE_INITIAL, 1) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory for the line buffer.\n" COLOR_RESET);
+        return 1;
+    }
+
+    size_t len = 0;
+    while (fgets(line + len, (int)(cap - len > INT_MAX ? INT_MAX : cap - len), fp) != NULL)
+    {
+        len += strlen(line + len);
+        if (len > 0 && line[len - 1] != '\n' && !feof(fp))
+        {
+            // Line longer than the buffer: grow and keep reading it
+            if (grow_array((void **)&line, &cap, cap + 1, 1) != 0)
             {
-                // fprintf(stderr, COLOR_YELLOW "Warning: Failed to store MSM4 data for epoch.\n" COLOR_RESET);
+                fprintf(stderr, COLOR_RED "Error: Out of memory for the line buffer.\n" COLOR_RESET);
+                free(line);
+                return 1;
             }
             continue;
         }
 
-        continue; // Successfully read and processed a supported message
+        dispatch_line(line, len, &msg, on_message, ctx, &tally);
+        len = 0;
     }
+    if (len > 0)
+        dispatch_line(line, len, &msg, on_message, ctx, &tally); // last line without '\n'
     // print_all_stored_pseudoranges(); // debug print all stored pseudoranges
     // print_all_stored_ephemeris(); // debug print all stored ephemeris
 
-    return 0; // End of file or no valid message found
+    perf_add_tally(&tally);
+    free(line);
+    return ferror(fp) ? 1 : 0; // End of file or no valid message found
 }
@@ -5,104 +5,130 @@
  * For each PRN that has ephemeris, we sweep true anomaly f from 0..2π,
  * compute PQW coordinates (in meters), then rotate to ECI with:
  *   Rz(-ω) -> Rx(-i) -> Rz(-Ω)
+ *
+ * The sweep is only plotted, so it is computed on demand (satellite_orbit_sweep())
+ * rather than as a stage of every solve, and kept per satellite under the
+ * (TOE, IODE) of the ephemeris it came from: re-solving the same log, or
+ * writing the plots again, reuses it.
  */
 
 #include "../include/satellites.h"
 #include "../include/algo.h"
 #include "../include/df_parser.h"
 #include "../include/rtcm_reader.h"
+#include "../include/gnss_context.h"
+#include "../include/perf_stats.h"
 
 // Column-vector multiply: out = M * v
 extern void mat3x3_vec3_mult(const double mat[3][3], const double vec[3], double out[3]);
 
-int satellite_orbit_eci(const gps_satellite_data_t gps_lists[])
+/**
+ * @brief Fills @p sweep with the orbit of @p eph, swept in true anomaly.
+ */
+static void sweep_orbit(const rtcm_1019_ephemeris_t *eph, sat_orbit_sweep_t *sweep)
 {
-    // Step size in radians (~0.57 deg). Adjust as needed.
-    const double step_size = 0.01;
-
-    // Number of steps to cover 0..2π inclusive
-    int n_steps = (int)(2.0 * M_PI / step_size) + 1;
-    if (n_steps < 2)
-        n_steps = 2;
-
-    int max_store = n_steps + 1;
-
-    for (int prn = 1; prn <= MAX_SAT; prn++)
+    const double a = eph->semi_major_axis;                       // meters
+    const double e = eph->eccentricity;                          // unitless
+    const double i = eph->inclination;                           // radians
+    const double omega = eph->argument_of_periapsis;             // radians
+    const double Omega = eph->right_ascension_of_ascending_node; // radians
+
+    // Rotation matrices for column-vector convention
+    const double Rz_omega[3][3] = {
+        {cos(-omega), sin(-omega), 0.0},
+        {-sin(-omega), cos(-omega), 0.0},
+        {0.0, 0.0, 1.0}};
+
+    const double Rx_i[3][3] = {
+        {1.0, 0.0, 0.0},
+        {0.0, cos(-i), sin(-i)},
+        {0.0, -sin(-i), cos(-i)}};
+
+    const double Rz_Omega[3][3] = {
+        {cos(-Omega), sin(-Omega), 0.0},
+        {-sin(-Omega), cos(-Omega), 0.0},
+        {0.0, 0.0, 1.0}};
+
+    // Sweep true anomaly f and build orbit
+    for (size_t k = 0; k < sweep->n_points; k++)
     {
-        // Require ephemeris for this PRN
-        if (gps_lists[prn].times_of_ephemeris[0] == 0)
-        {
-            // printf("No EPH data available for PRN %d\n", prn);
-            continue;
-        }
-
-        // Pull first-epoch orbital elements (as your Python does with [0])
-        const double a = gps_lists[prn].semi_major_axes[0];                       // meters
-        const double e = gps_lists[prn].eccentricities[0];                        // unitless
-        const double i = gps_lists[prn].inclinations[0];                          // radians
-        const double omega = gps_lists[prn].argument_of_periapsis[0];             // radians
-        const double Omega = gps_lists[prn].right_ascension_of_ascending_node[0]; // radians
+        double f = (double)k * ORBIT_SWEEP_STEP_RAD;
+        if (f > 2.0 * M_PI)
+            f = 2.0 * M_PI; // clamp last point
 
-        // Rotation matrices for column-vector convention
-        const double Rz_omega[3][3] = {
-            {cos(-omega), sin(-omega), 0.0},
-            {-sin(-omega), cos(-omega), 0.0},
-            {0.0, 0.0, 1.0}};
+        // PQW radius (meters), using true anomaly f
+        const double denom = 1.0 + e * cos(f);
+        if (denom == 0.0) // extremely pathological; skip (left at zero)
+            continue;
 
-        const double Rx_i[3][3] = {
-            {1.0, 0.0, 0.0},
-            {0.0, cos(-i), sin(-i)},
-            {0.0, -sin(-i), cos(-i)}};
+        double r = (a * (1.0 - e * e)) / denom; // meters
+
+        // PQW coords (meters)
+        double pqw[3] = {r * cos(f), r * sin(f), 0.0};
+        sweep->p[k] = pqw[0];
+        sweep->q[k] = pqw[1];
+        sweep->w[k] = pqw[2];
+
+        // Rotate PQW -> ECI with Rz(-ω), Rx(-i), Rz(-Ω)
+        double tmp1[3], tmp2[3], eci[3];
+        mat3x3_vec3_mult(Rz_omega, pqw, tmp1);
+        mat3x3_vec3_mult(Rx_i, tmp1, tmp2);
+        mat3x3_vec3_mult(Rz_Omega, tmp2, eci);
+        sweep->x[k] = eci[0];
+        sweep->y[k] = eci[1];
+        sweep->z[k] = eci[2];
+    }
+}
 
-        const double Rz_Omega[3][3] = {
-            {cos(-Omega), sin(-Omega), 0.0},
-            {-sin(-Omega), cos(-Omega), 0.0},
-            {0.0, 0.0, 1.0}};
+/**
+ * @brief Orbit sweep of satellite @p prn, computed on first use.
+ *
+ * Sweeps the first (earliest TOE) ephemeris of the satellite's history into
+ * ctx->orbit_sweep[prn], ORBIT_SWEEP_POINTS points. A sweep already made from
+ * the same (TOE, IODE) is returned as is.
+ *
+ * @param ctx Session state with the stored ephemerides.
+ * @param prn Satellite index.
+ * @return The sweep, or NULL if the satellite has no ephemeris or on allocation failure.
+ */
+const sat_orbit_sweep_t *satellite_orbit_sweep(gnss_context_t *ctx, int prn)
+{
+    if (!ctx || prn < 1 || prn > MAX_SAT || ctx->eph_history[prn].count == 0)
+        return NULL;
+
+    // Pull first-epoch orbital elements (as your Python does with [0])
+    const rtcm_1019_ephemeris_t *eph = &ctx->eph_history[prn].eph[0];
+    sat_orbit_sweep_t *sweep = &ctx->orbit_sweep[prn];
+    if (sweep->valid && sweep->toe == eph->gps_toe && sweep->iode == eph->gps_iode)
+        return sweep;
+
+    if (gnss_context_alloc_orbit_sweep(ctx, prn, ORBIT_SWEEP_POINTS) != 0)
+        return NULL;
+    sweep_orbit(eph, sweep);
+    sweep->toe = eph->gps_toe;
+    sweep->iode = eph->gps_iode;
+    sweep->valid = true;
+    perf_count(PERF_ORBIT_SWEEPS, 1);
+    return sweep;
+}
 
-        // Sweep true anomaly f and build orbit
-        for (int k = 0; k < max_store; k++)
+/**
+ * @brief Makes the orbit sweep of every satellite with an ephemeris available in ctx->orbit_sweep.
+ *
+ * Only the sweeps that are missing or stale are computed (see satellite_orbit_sweep()).
+ *
+ * @param ctx Session state with the stored ephemerides.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int satellite_orbit_eci(gnss_context_t *ctx)
+{
+    for (int prn = 1; prn <= MAX_SAT; prn++)
+    {
+        if (ctx->eph_history[prn].count > 0 && !satellite_orbit_sweep(ctx, prn))
         {
-            double f = k * step_size;
-            if (f > 2.0 * M_PI)
-                f = 2.0 * M_PI; // clamp last point
-
-            // PQW radius (meters), using true anomaly f
-            const double denom = 1.0 + e * cos(f);
-            if (denom == 0.0) // extremely pathological; skip
-            {
-                sat_orbit_pqw_positions[prn].p[k] = 0.0;
-                sat_orbit_pqw_positions[prn].q[k] = 0.0;
-                sat_orbit_pqw_positions[prn].w[k] = 0.0;
-                sat_orbit_eci_positions[prn].x[k] = 0.0;
-                sat_orbit_eci_positions[prn].y[k] = 0.0;
-                sat_orbit_eci_positions[prn].z[k] = 0.0;
-                continue;
-            }
-
-            double r = (a * (1.0 - e * e)) / denom; // meters
-
-            // PQW coords (meters)
-            double pqw[3] = {r * cos(f), r * sin(f), 0.0};
-
-            // Save PQW (meters)
-            sat_orbit_pqw_positions[prn].p[k] = pqw[0];
-            sat_orbit_pqw_positions[prn].q[k] = pqw[1];
-            sat_orbit_pqw_positions[prn].w[k] = pqw[2];
-
-            // Rotate PQW -> ECI with Rz(-ω), Rx(-i), Rz(-Ω)
-            double tmp1[3], tmp2[3], eci[3];
-            mat3x3_vec3_mult(Rz_omega, pqw, tmp1);
-            mat3x3_vec3_mult(Rx_i, tmp1, tmp2);
-            mat3x3_vec3_mult(Rz_Omega, tmp2, eci);
-
-            // Store ECI (meters)
-            sat_orbit_eci_positions[prn].x[k] = eci[0];
-            sat_orbit_eci_positions[prn].y[k] = eci[1];
-            sat_orbit_eci_positions[prn].z[k] = eci[2];
-
-            // printf("PRN: %d, Orbit ECI[%d][0]: %.3f, Orbit ECI[%d][1]: %.3f, Orbit ECI[%d][2]: %.3f\n", prn, k, sat_orbit_eci_positions[prn].x[k] / 1000, k, sat_orbit_eci_positions[prn].y[k] / 1000, k, sat_orbit_eci_positions[prn].z[k] / 1000);
+            fprintf(stderr, COLOR_RED "Error: Out of memory for the satellite orbits.\n" COLOR_RESET);
+            return -1;
         }
     }
-
     return 0;
 }
@@ -1,16 +1,29 @@
 /**
  * @file satellites_position_eci.c
- * @brief Calculates the satellite position in ECI frame using ephemeris data.
- * This function computes the satellite position in Earth-Centered Inertial (ECI)
- * coordinates based on the provided ephemeris data and time of week.
+ * @brief Calculates the satellite positions in ECI (and ECEF) frame using ephemeris data.
+ * satellite_eci_position() computes one satellite position in Earth-Centered Inertial (ECI)
+ * coordinates based on the provided ephemeris data and time of week; satellite_position_eci()
+ * positions all stored observations through the orbit cache (orbit_cache.c) or the
+ * batched kernel (orbit_batch.c), with their analytic ECEF velocities.
  */
 
 #include "../include/satellites.h"
 #include "../include/algo.h"
 #include "../include/df_parser.h"
 #include "../include/rtcm_reader.h"
-#include "../include/df_parser.h"
-#include "../include/satellites.h"
+#include "../include/eph_index.h"
+#include "../include/orbit_batch.h"
+#include "../include/orbit_cache.h"
+#include "../include/gnss_context.h"
+
+/// One observation to position: gps_list[prn] sample k at time t with its ephemeris
+typedef struct
+{
+    uint8_t prn;
+    size_t k;
+    double t;                         ///< Observation time (s of week)
+    const rtcm_1019_ephemeris_t *eph; ///< Selected ephemeris
+} obs_ref_t;
 
 // Helper: Rotation matrix multiplication for 3x3 and 1x3 vector
 void mat3x3_vec3_mult(const double mat[3][3], const double vec[3], double out[3])
@@ -21,154 +34,250 @@ void mat3x3_vec3_mult(const double mat[3][3], const double vec[3], double out[3]
     }
 }
 
-// Helper: Find the closest eph index for prn whose EPH time_of_week is just before or equal to pseudorange_time
-static int find_closest_eph_idx(const eph_history_t *hist, uint32_t pseudorange_time)
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Computes one satellite position in ECI from a single ephemeris.
+ *
+ * IS-GPS-200 broadcast orbit: propagates the mean anomaly from TOE to the
+ * observation time, solves Kepler's equation, applies the second-harmonic
+ * corrections to the argument of latitude, radius and inclination, and rotates
+ * the orbit-plane position by the inclination and the node. The ECI frame is the
+ * ECEF frame at the start of the GPS week of @p t_obs (see satellite_eci_to_ecef()).
+ *
+ * @param eph   Ephemeris to propagate.
+ * @param t_obs Observation time in seconds of the GPS week.
+ * @param eci   Output ECI position (m).
+ * @return 0 on success, -1 if the elements or the resulting radius are invalid.
+ */
+int satellite_eci_position(const rtcm_1019_ephemeris_t *eph, double t_obs, double eci[3])
 {
-    int best_idx = -1;
-    uint32_t best_toe = 0;
-    for (size_t i = 0; i < hist->count; i++)
+    // Pull elements from ephemeris (radians & meters as you stored them)
+    const double a = eph->semi_major_axis;
+    const double e = eph->eccentricity;
+    const double i0 = eph->inclination;
+    const double omega = eph->argument_of_periapsis;
+    const double M0 = eph->mean_anomaly;
+    const double toe = (double)eph->gps_toe; // seconds
+
+    // Basic sanity guards
+    if (!(a > 0.0) || !(e >= 0.0 && e < 1.0) || !isfinite(i0) || !isfinite(M0))
     {
-        uint32_t toe = hist->eph[i].gps_toe;
-        if ((toe >= pseudorange_time || toe <= pseudorange_time) && toe >= best_toe)
-        {
-            best_toe = toe;
-            best_idx = (int)i;
-        }
+        return -1;
     }
-    return best_idx;
+
+    // --- 1) Time since ephemeris epoch, across a week crossover ---
+    double tk = t_obs - toe;
+    if (tk > 302400.0)
+        tk -= 604800.0;
+    else if (tk < -302400.0)
+        tk += 604800.0;
+
+    // --- 2) Corrected mean motion (rad/s) and mean anomaly ---
+    const double n = sqrt(MU / (a * a * a)) + eph->gps_delta_n * PI; // MU in m^3/s^2
+    double M = M0 + n * tk;
+
+    // Normalize M into [-pi, pi] for numerical stability
+    M = fmod(M + M_PI, 2.0 * M_PI);
+    if (M < 0)
+        M += 2.0 * M_PI;
+    M -= M_PI;
+
+    // --- 3) Solve Kepler for E (eccentric anomaly) via simple iteration (good enough for GPS e) ---
+    double E = M; // initial guess
+    for (int it = 0; it < 10; ++it)
+    {
+        double f = E - e * sin(E) - M;
+        double fp = 1.0 - e * cos(E);
+        double dE = -f / fp;
+        E += dE;
+        if (fabs(dE) < 1e-12)
+            break;
+    }
+
+    // True anomaly and argument of latitude
+    double cosE = cos(E), sinE = sin(E);
+    double sqrt1me2 = sqrt(fmax(0.0, 1.0 - e * e));
+    double v = atan2(sqrt1me2 * sinE, cosE - e);
+    double phi = v + omega;
+
+    // --- 4) Second-harmonic corrections ---
+    double s2 = sin(2.0 * phi), c2 = cos(2.0 * phi);
+    double u = phi + eph->gps_cus * s2 + eph->gps_cuc * c2;
+    double r = a * (1.0 - e * cosE) + eph->gps_crs * s2 + eph->gps_crc * c2;
+    double i = i0 + eph->gps_cis * s2 + eph->gps_cic * c2 + eph->gps_idot * PI * tk;
+    if (!(r > 0.0) || !isfinite(r))
+    {
+        return -1;
+    }
+
+    // --- 5) Node in the ECI frame: OMEGA0 refers to the start of the ephemeris' week ---
+    double Omega = eph->right_ascension_of_ascending_node + eph->gps_omega_dot * PI * tk -
+                   OMEGA_EARTH * (toe + tk - t_obs);
+
+    // Orbit-plane position rotated to ECI: Rz(Omega) * Rx(i) * (r cos u, r sin u, 0)
+    double xp = r * cos(u), yp = r * sin(u);
+    eci[0] = xp * cos(Omega) - yp * cos(i) * sin(Omega);
+    eci[1] = xp * sin(Omega) + yp * cos(i) * cos(Omega);
+    eci[2] = yp * sin(i);
+    return 0;
 }
 
-int satellite_position_eci(const gps_satellite_data_t gps_lists[])
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Writes one computed position, ECEF velocity and clock offset into ctx->sat_eci_positions / sat_ecef_positions.
+ */
+static void store_sat_position(gnss_context_t *ctx, const obs_ref_t *ref, const double eci[3], const double ecef[3],
+                               const double vel[3], double clk)
 {
+    sat_eci_history_t *sat_eci = &ctx->sat_eci_positions[ref->prn];
+    sat_ecef_history_t *sat_ecef = &ctx->sat_ecef_positions[ref->prn];
+
+    sat_eci->x[ref->k] = eci[0];
+    sat_eci->y[ref->k] = eci[1];
+    sat_eci->z[ref->k] = eci[2];
+
+    sat_ecef->x[ref->k] = ecef[0];
+    sat_ecef->y[ref->k] = ecef[1];
+    sat_ecef->z[ref->k] = ecef[2];
+    sat_ecef->vx[ref->k] = vel[0];
+    sat_ecef->vy[ref->k] = vel[1];
+    sat_ecef->vz[ref->k] = vel[2];
+    sat_ecef->clk[ref->k] = clk;
+    sat_ecef->t_ms[ref->k] = ref->t * 1000.0; // store as ms
+}
+
+/**
+ * @brief Computes the ECI and ECEF position and ECEF velocity of every stored (PRN, epoch) observation.
+ *
+ * Selects the ephemeris for each observation time, then handles each run of
+ * observations that share a PRN and an ephemeris in one of two ways:
+ *  - Dense runs (more observations than ORBIT_CACHE_NODE_S grid nodes they span,
+ *    i.e. rates above one per ORBIT_CACHE_NODE_S): the PRN's orbit cache is
+ *    prepared over the run and every position is interpolated from it
+ *  - Sparse runs: every (ephemeris, time) pair is queued into one orbit batch
+ *    that is propagated in a single pass (orbit_batch.c)
+ * Both paths also give the ECEF velocity of the same orbit model (kernel
+ * derivative, interpolated from the cache nodes on dense runs), so no stage
+ * has to difference positions, and the broadcast satellite clock offset that
+ * the solvers add to the pseudoranges. Results go to ctx->sat_eci_positions and
+ * ctx->sat_ecef_positions, sized to the series. Observations without a valid ephemeris or with invalid elements
+ * are left at zero.
+ *
+ * @param ctx Session state with the sorted per-PRN series (see sort_satellites()).
+ * @return 0 on success, -1 on allocation failure.
+ */
+int satellite_position_eci(gnss_context_t *ctx)
+{
+    const gps_satellite_data_t *gps_lists = ctx->gps_list;
+    const eph_history_t *eph_history = ctx->eph_history;
+    if (gnss_context_alloc_sat_positions(ctx) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory for the satellite positions.\n" COLOR_RESET);
+        return -1;
+    }
+
+    size_t n_total = 0;
+    for (int prn = 1; prn <= MAX_SAT; prn++)
+        n_total += gps_lists[prn].n_pseudoranges;
+
+    orbit_batch_t batch;
+    orbit_batch_init(&batch, ORBIT_BATCH_VELOCITY | ORBIT_BATCH_CLOCK);
+    obs_ref_t *refs = malloc((n_total ? n_total : 1) * sizeof(obs_ref_t));
+    obs_ref_t *direct = malloc((n_total ? n_total : 1) * sizeof(obs_ref_t));
+    if (!refs || !direct || orbit_batch_reserve(&batch, n_total) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory while queueing satellite positions.\n" COLOR_RESET);
+        free(refs);
+        free(direct);
+        orbit_batch_free(&batch);
+        return -1;
+    }
+
+    // --- 1) Pick the ephemeris of every observation ---
+    size_t n_refs = 0;
     for (int prn = 1; prn <= MAX_SAT; prn++)
     {
         // Skip PRNs with no ephemeris history at all
         if (eph_history[prn].count == 0)
-        {
-            // printf("No ephemeris history for PRN %d\n", prn);
             continue;
-        }
 
-        for (int k = 0; k < MAX_EPOCHS; k++)
+        size_t eph_cursor = 0; // O(1) per step while the observation times are monotonic
+        for (size_t k = 0; k < gps_lists[prn].n_pseudoranges; k++)
         {
             if (gps_lists[prn].times_of_pseudorange[k] == 0)
                 continue;
 
-            // --- 1) Normalize observation time to seconds ---
+            // Normalize observation time to seconds
             double t_obs = gps_lists[prn].times_of_pseudorange[k];
 
             if (t_obs > 604800.0)
                 t_obs *= 1.0 / 1000.0;
 
-            // --- 2) Find best ephemeris for this observation time (TOE <= t_obs) ---
-            int eph_idx = find_closest_eph_idx(&eph_history[prn], (uint32_t)t_obs);
-            if (eph_idx < 0)
-            {
-                // No suitable ephemeris before/at this time; skip
-                // printf("No suitable ephemeris for PRN %d at t=%.3f\n", prn, t_obs);
-                continue;
-            }
+            // Find the valid ephemeris with the TOE closest to t_obs
+            const rtcm_1019_ephemeris_t *eph = eph_select_cursor(&eph_history[prn], t_obs, &eph_cursor);
+            if (!eph)
+                continue; // No ephemeris within EPH_MAX_AGE_S of this time; skip
 
-            const rtcm_1019_ephemeris_t *eph = &eph_history[prn].eph[eph_idx];
+            refs[n_refs].prn = (uint8_t)prn;
+            refs[n_refs].k = k;
+            refs[n_refs].t = t_obs;
+            refs[n_refs].eph = eph;
+            n_refs++;
+        }
+    }
 
-            // Pull elements from ephemeris (radians & meters as you stored them)
-            const double a = eph->semi_major_axis;
-            const double e = eph->eccentricity;
-            const double i = eph->inclination;
-            const double Omega = eph->right_ascension_of_ascending_node;
-            const double omega = eph->argument_of_periapsis;
-            const double M0 = eph->mean_anomaly;
-            const double toe = (double)eph->gps_toe; // seconds
+    // --- 2) Interpolate dense (PRN, ephemeris) runs, queue the others ---
+    size_t n_direct = 0;
+    for (size_t r0 = 0, r1; r0 < n_refs; r0 = r1)
+    {
+        r1 = r0 + 1;
+        while (r1 < n_refs && refs[r1].prn == refs[r0].prn && refs[r1].eph == refs[r0].eph)
+            r1++;
 
-            // Basic sanity guards
-            if (!(a > 0.0) || !(e >= 0.0 && e < 1.0) || !isfinite(i) || !isfinite(M0))
+        // Span of the run (its times only go back in a log out of time order)
+        double t_from = refs[r0].t, t_to = refs[r0].t;
+        for (size_t r = r0 + 1; r < r1; r++)
+        {
+            t_from = fmin(t_from, refs[r].t);
+            t_to = fmax(t_to, refs[r].t);
+        }
+        orbit_cache_t *cache = &ctx->orbit_cache[refs[r0].prn];
+        bool dense = orbit_cache_nodes_for(t_from, t_to) < r1 - r0;
+        if (dense && orbit_cache_prepare(cache, refs[r0].eph, t_from, t_to) == 0)
+        {
+            for (size_t r = r0; r < r1; r++)
             {
-                // printf("Bad elements for PRN %d at k=%d (a=%g, e=%g)\n", prn, k, a, e);
-                continue;
+                double eci[3], ecef[3], vel[3], clk;
+                if (orbit_cache_position(cache, refs[r].t, eci, ecef, vel, &clk) == 0)
+                    store_sat_position(ctx, &refs[r], eci, ecef, vel, clk);
             }
+            continue;
+        }
 
-            // --- 3) Time since ephemeris epoch ---
-            const double dt = t_obs - toe;
-            // printf("PRN %d, Epoch %d: dt = %.3f seconds\n", prn, k, dt);
-
-            // --- 4) Mean motion (rad/s) and mean anomaly ---
-            const double n = sqrt(MU / (a * a * a)); // MU in m^3/s^2
-            double M = M0 + n * dt;
-
-            // Normalize M into [-pi, pi] for numerical stability
-            M = fmod(M + M_PI, 2.0 * M_PI);
-            if (M < 0)
-                M += 2.0 * M_PI;
-            M -= M_PI;
-
-            // --- 5) Solve Kepler for E (eccentric anomaly) via simple iteration (good enough for GPS e) ---
-            double E = M; // initial guess
-            for (int it = 0; it < 10; ++it)
-            {
-                double f = E - e * sin(E) - M;
-                double fp = 1.0 - e * cos(E);
-                double dE = -f / fp;
-                E += dE;
-                if (fabs(dE) < 1e-12)
-                    break;
-            }
+        for (size_t r = r0; r < r1; r++)
+        {
+            direct[n_direct++] = refs[r];
+            orbit_batch_add(&batch, refs[r].eph, refs[r].t); // capacity reserved above
+        }
+    }
 
-            // True anomaly
-            double cosE = cos(E), sinE = sin(E);
-            double sqrt1me2 = sqrt(fmax(0.0, 1.0 - e * e));
-            double sinv = (sqrt1me2 * sinE) / (1.0 - e * cosE);
-            double cosv = (cosE - e) / (1.0 - e * cosE);
-            double v = atan2(sinv, cosv);
-            // printf("PRN %d, Epoch %d: True Anomaly = %.6f\n", prn, k, v);
-
-            // Radius in the orbital plane
-            double r = a * (1.0 - e * cosE);
-            if (!(r > 0.0) || !isfinite(r))
-            {
-                // printf("Bad radius for PRN %d (r=%g)\n", prn, r);
-                continue;
-            }
+    // --- 3) Propagate the queued observations at once and scatter ---
+    orbit_batch_propagate(&batch);
+    for (size_t j = 0; j < batch.n; j++)
+    {
+        if (!batch.ok[j])
+            continue; // Bad elements or radius
 
-            // PQW coordinates (perifocal frame)
-            double pqw[3] = {r * cos(v), r * sin(v), 0.0};
-
-            // printf("PRN %d, Epoch %d: PQW = [%.3f, %.3f, %.3f]\n", prn, k, pqw[0], pqw[1], pqw[2]);
-
-            // --- 6) Rotation matrices to ECI: Rz(Ω) * Rx(i) * Rz(ω) ---
-            // We rotate +ω about z, +i about x, +Ω about z (no leading negatives needed)
-            const double cO = cos(Omega), sO = sin(Omega);
-            const double ci = cos(i), si = sin(i);
-            const double co = cos(omega), so = sin(omega);
-
-            // Rz(ω)
-            double Rz_omega[3][3] = {
-                {co, -so, 0},
-                {so, co, 0},
-                {0, 0, 1}};
-            // Rx(i)
-            double Rx_i[3][3] = {
-                {1, 0, 0},
-                {0, ci, -si},
-                {0, si, ci}};
-            // Rz(Ω)
-            double Rz_Omega[3][3] = {
-                {cO, -sO, 0},
-                {sO, cO, 0},
-                {0, 0, 1}};
-
-            // Apply rotations: ECI = Rz(Ω) * Rx(i) * Rz(ω) * pqw
-            double tmp1[3], tmp2[3], eci[3];
-            mat3x3_vec3_mult(Rz_omega, pqw, tmp1);
-            mat3x3_vec3_mult(Rx_i, tmp1, tmp2);
-            mat3x3_vec3_mult(Rz_Omega, tmp2, eci);
-
-            // Save
-            sat_eci_positions[prn].x[k] = eci[0];
-            sat_eci_positions[prn].y[k] = eci[1];
-            sat_eci_positions[prn].z[k] = eci[2];
-
-            // printf("PRN %d, Epoch %d: ECI = [%.3f, %.3f, %.3f]\n", prn, k, sat_eci_positions[prn].x[k] / 1000, sat_eci_positions[prn].y[k] / 1000, sat_eci_positions[prn].z[k] / 1000);
-        }
+        const double eci[3] = {batch.eci_x[j], batch.eci_y[j], batch.eci_z[j]};
+        const double ecef[3] = {batch.x[j], batch.y[j], batch.z[j]};
+        const double vel[3] = {batch.vx[j], batch.vy[j], batch.vz[j]};
+        store_sat_position(ctx, &direct[j], eci, ecef, vel, batch.clk[j]);
     }
+
+    free(refs);
+    free(direct);
+    orbit_batch_free(&batch);
     return 0;
 }
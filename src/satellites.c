@@ -9,209 +9,144 @@
 #include "../include/df_parser.h"
 #include "../include/rtcm_reader.h"
 #include "../include/receiver.h"
+#include "../include/obs_store.h"
+#include "../include/eph_index.h"
+#include "../include/gnss_context.h"
 
-gps_satellite_data_t gps_list[MAX_SAT + 1];
-sat_eci_history_t sat_eci_positions[MAX_SAT + 1];
-sat_ecef_history_t sat_ecef_positions[MAX_SAT + 1];
-sat_orbit_pqw_history_t sat_orbit_pqw_positions[MAX_SAT + 1];
-sat_orbit_eci_history_t sat_orbit_eci_positions[MAX_SAT + 1];
+#define MS_PER_WEEK (7u * 86400000u)
 
-// Helper: Find the closest eph index for prn whose EPH time_of_week is just before or equal to pseudorange_time
-static int find_closest_eph_idx(const eph_history_t *hist, uint32_t pseudorange_time)
+/// Unique week + TOE keys in a sorted ephemeris history (see eph_history_insert())
+static size_t count_unique_toes(const eph_history_t *hist)
 {
-    int best_idx = -1;
-    uint32_t best_toe = 0;
+    size_t n = 0;
     for (size_t i = 0; i < hist->count; i++)
-    {
-        uint32_t toe = hist->eph[i].gps_toe; // use TOE
-        if (toe <= pseudorange_time && toe >= best_toe)
-        {
-            best_toe = toe;
-            best_idx = (int)i;
-        }
-    }
-    return best_idx;
+        if (i == 0 || eph_toe_diff(&hist->eph[i], &hist->eph[i - 1]) != 0.0)
+            n++;
+    return n;
 }
 
-/* Populate gps_list[prn].{eccentricities,...,times_of_ephemeris} with the
+/* Populate sat->{eccentricities,...,times_of_ephemeris} with the
    FULL ephemeris history (unique by TOE), independent of pseudorange epochs. */
-static void populate_ephemeris_series_from_history(int prn, const eph_history_t *hist)
+static void populate_ephemeris_series_from_history(gps_satellite_data_t *sat, const eph_history_t *hist)
 {
-    // Reset ephemeris arrays
-    for (int k = 0; k < MAX_EPOCHS; k++)
-    {
-        gps_list[prn].eccentricities[k] = 0.0;
-        gps_list[prn].inclinations[k] = 0.0;
-        gps_list[prn].mean_anomalies[k] = 0.0;
-        gps_list[prn].semi_major_axes[k] = 0.0;
-        gps_list[prn].right_ascension_of_ascending_node[k] = 0.0;
-        gps_list[prn].argument_of_periapsis[k] = 0.0;
-        gps_list[prn].times_of_ephemeris[k] = 0;
-    }
-
     size_t eidx = 0;
-    uint32_t last_toe = UINT32_MAX; // ensures first entry is accepted
 
-    for (size_t i = 0; i < hist->count && eidx < MAX_EPOCHS; i++)
+    for (size_t i = 0; i < hist->count && eidx < sat->n_ephemerides; i++)
     {
         const rtcm_1019_ephemeris_t *eph = &hist->eph[i];
         uint32_t toe = eph->gps_toe;
 
-        // Append only when TOE changes (unique-by-TOE), mirroring Python's unique list
-        if (i == 0 || toe != last_toe)
+        // Append only when week + TOE changes (unique-by-TOE), mirroring Python's unique list
+        if (i == 0 || eph_toe_diff(eph, &hist->eph[i - 1]) != 0.0)
         {
-            gps_list[prn].eccentricities[eidx] = eph->eccentricity;
-            gps_list[prn].inclinations[eidx] = eph->inclination;
-            gps_list[prn].mean_anomalies[eidx] = eph->mean_anomaly;
-            gps_list[prn].semi_major_axes[eidx] = eph->semi_major_axis;
-            gps_list[prn].right_ascension_of_ascending_node[eidx] = eph->right_ascension_of_ascending_node;
-            gps_list[prn].argument_of_periapsis[eidx] = eph->argument_of_periapsis;
-            gps_list[prn].times_of_ephemeris[eidx] = toe;
-
-            last_toe = toe;
+            sat->eccentricities[eidx] = eph->eccentricity;
+            sat->inclinations[eidx] = eph->inclination;
+            sat->mean_anomalies[eidx] = eph->mean_anomaly;
+            sat->semi_major_axes[eidx] = eph->semi_major_axis;
+            sat->right_ascension_of_ascending_node[eidx] = eph->right_ascension_of_ascending_node;
+            sat->argument_of_periapsis[eidx] = eph->argument_of_periapsis;
+            sat->times_of_ephemeris[eidx] = toe;
             eidx++;
         }
     }
 }
 
-int sort_satellites(eph_history_t *eph_history_table,
-                    rtcm_1074_msm4_t msm4_history_table[MAX_SAT][MAX_EPOCHS],
-                    rtcm_1002_msm1_t msm1_history_table[MAX_SAT][MAX_EPOCHS])
+/**
+ * @brief Elapsed time from record @p a to record @p b if their carrier ranges can be differenced.
+ *
+ * Both records need a tracked phase, the gap (across a week rollover too) must
+ * be within RANGE_RATE_MAX_GAP_MS and the lock time indicator must not have
+ * dropped in between, which would mark a cycle slip or loss of lock.
+ *
+ * @return Elapsed time (s), or 0 if the pair is unusable.
+ */
+static double carrier_interval(const obs_record_t *a, const obs_record_t *b)
 {
-    memset(gps_list, 0, sizeof(gps_list));
+    if (a->carrier_range == 0.0 || b->carrier_range == 0.0 || b->lock_time < a->lock_time)
+        return 0.0;
 
-    if (observation_type == 1)
-    {
-        for (int prn = 1; prn <= MAX_SAT; prn++)
-        {
-            gps_list[prn].prn = prn;
+    uint32_t elapsed = (b->time_ms + MS_PER_WEEK - a->time_ms) % MS_PER_WEEK;
+    if (elapsed == 0 || elapsed > RANGE_RATE_MAX_GAP_MS)
+        return 0.0;
+    return elapsed * 1e-3;
+}
 
-            size_t msm1_len = msm1_count[prn];
-            for (size_t i = 0; i < msm1_len && i < MAX_EPOCHS; i++)
-            {
-                // Find the index of this PRN in the MSM1 message (could be at any position)
-                int found = 0;
-                for (int j = 0; j < msm1_history_table[prn][i].num_satellites; j++)
-                {
-                    if (msm1_history_table[prn][i].svs[j] == prn)
-                    {
-                        gps_list[prn].pseudoranges[i] = msm1_history_table[prn][i].pseudoranges[j];
-                        gps_list[prn].times_of_pseudorange[i] = msm1_history_table[prn][i].time_of_week;
-                        found = 1;
-
-                        // Find the latest eph for this pseudorange time
-                        int eph_idx = find_closest_eph_idx(&eph_history[prn],
-                                                           msm1_history_table[prn][i].time_of_week);
-                        if (eph_idx >= 0)
-                        {
-                            const rtcm_1019_ephemeris_t *eph = &eph_history_table[prn].eph[eph_idx];
-                            gps_list[prn].eccentricities[i] = eph->eccentricity;
-                            gps_list[prn].inclinations[i] = eph->inclination;
-                            gps_list[prn].mean_anomalies[i] = eph->mean_anomaly;
-                            gps_list[prn].semi_major_axes[i] = eph->semi_major_axis;
-                            gps_list[prn].right_ascension_of_ascending_node[i] = eph->right_ascension_of_ascending_node;
-                            gps_list[prn].argument_of_periapsis[i] = eph->argument_of_periapsis;
-                            gps_list[prn].times_of_ephemeris[i] = eph->gps_toe; // store TOE
-                        }
-                        else
-                        {
-                            gps_list[prn].eccentricities[i] = 0;
-                            gps_list[prn].inclinations[i] = 0;
-                            gps_list[prn].mean_anomalies[i] = 0;
-                            gps_list[prn].semi_major_axes[i] = 0;
-                            gps_list[prn].right_ascension_of_ascending_node[i] = 0;
-                            gps_list[prn].argument_of_periapsis[i] = 0;
-                            gps_list[prn].times_of_ephemeris[i] = 0;
-                        }
-                        break;
-                    }
-                }
-                if (!found)
-                {
-                    gps_list[prn].pseudoranges[i] = 0;
-                    gps_list[prn].times_of_pseudorange[i] = 0;
-                    gps_list[prn].eccentricities[i] = 0;
-                    gps_list[prn].inclinations[i] = 0;
-                    gps_list[prn].mean_anomalies[i] = 0;
-                    gps_list[prn].semi_major_axes[i] = 0;
-                    gps_list[prn].right_ascension_of_ascending_node[i] = 0;
-                    gps_list[prn].argument_of_periapsis[i] = 0;
-                    gps_list[prn].times_of_ephemeris[i] = 0;
-                }
-            }
-        }
-    }
-    else if (observation_type == 4)
+/**
+ * @brief Fills sat->range_rates from the carrier ranges of the PRN's records.
+ *
+ * Central difference where both neighbouring intervals are clean, one-sided
+ * where only one is, NAN otherwise.
+ */
+static void populate_range_rates(gps_satellite_data_t *sat, const obs_store_t *store, int prn)
+{
+    const size_t n = sat->n_pseudoranges;
+    for (size_t i = 0; i < n; i++)
     {
-        for (int prn = 1; prn <= MAX_SAT; prn++)
-        {
-            gps_list[prn].prn = prn;
+        const obs_record_t *rec = OBS_STORE_PRN_RECORD(store, prn, i);
+        const obs_record_t *prev = i > 0 ? OBS_STORE_PRN_RECORD(store, prn, i - 1) : NULL;
+        const obs_record_t *next = i + 1 < n ? OBS_STORE_PRN_RECORD(store, prn, i + 1) : NULL;
+        double dt_prev = prev ? carrier_interval(prev, rec) : 0.0;
+        double dt_next = next ? carrier_interval(rec, next) : 0.0;
 
-            size_t msm4_len = msm4_count[prn];
-            for (size_t i = 0; i < msm4_len && i < MAX_EPOCHS; i++)
-            {
-                // Find the index of this PRN in the MSM4 message (could be at any position)
-                int found = 0;
-                for (int j = 0; j < msm4_history_table[prn][i].n_sat; j++)
-                {
-                    if (msm4_history_table[prn][i].prn[j] == prn)
-                    {
-                        gps_list[prn].pseudoranges[i] = msm4_history_table[prn][i].pseudorange[j];
-                        gps_list[prn].times_of_pseudorange[i] = msm4_history_table[prn][i].time_of_pseudorange;
-                        found = 1;
-
-                        // Find the latest eph for this pseudorange time
-                        int eph_idx = find_closest_eph_idx(&eph_history[prn],
-                                                           msm4_history_table[prn][i].time_of_pseudorange);
-                        if (eph_idx >= 0)
-                        {
-                            const rtcm_1019_ephemeris_t *eph = &eph_history_table[prn].eph[eph_idx];
-                            gps_list[prn].eccentricities[i] = eph->eccentricity;
-                            gps_list[prn].inclinations[i] = eph->inclination;
-                            gps_list[prn].mean_anomalies[i] = eph->mean_anomaly;
-                            gps_list[prn].semi_major_axes[i] = eph->semi_major_axis;
-                            gps_list[prn].right_ascension_of_ascending_node[i] = eph->right_ascension_of_ascending_node;
-                            gps_list[prn].argument_of_periapsis[i] = eph->argument_of_periapsis;
-                            gps_list[prn].times_of_ephemeris[i] = eph->gps_toe; // store TOE
-                        }
-                        else
-                        {
-                            gps_list[prn].eccentricities[i] = 0;
-                            gps_list[prn].inclinations[i] = 0;
-                            gps_list[prn].mean_anomalies[i] = 0;
-                            gps_list[prn].semi_major_axes[i] = 0;
-                            gps_list[prn].right_ascension_of_ascending_node[i] = 0;
-                            gps_list[prn].argument_of_periapsis[i] = 0;
-                            gps_list[prn].times_of_ephemeris[i] = 0;
-                        }
-                        break;
-                    }
-                }
-                if (!found)
-                {
-                    gps_list[prn].pseudoranges[i] = 0;
-                    gps_list[prn].times_of_pseudorange[i] = 0;
-                    gps_list[prn].eccentricities[i] = 0;
-                    gps_list[prn].inclinations[i] = 0;
-                    gps_list[prn].mean_anomalies[i] = 0;
-                    gps_list[prn].semi_major_axes[i] = 0;
-                    gps_list[prn].right_ascension_of_ascending_node[i] = 0;
-                    gps_list[prn].argument_of_periapsis[i] = 0;
-                    gps_list[prn].times_of_ephemeris[i] = 0;
-                }
-            }
-        }
+        if (dt_prev > 0.0 && dt_next > 0.0)
+            sat->range_rates[i] = (next->carrier_range - prev->carrier_range) / (dt_prev + dt_next);
+        else if (dt_next > 0.0)
+            sat->range_rates[i] = (next->carrier_range - rec->carrier_range) / dt_next;
+        else if (dt_prev > 0.0)
+            sat->range_rates[i] = (rec->carrier_range - prev->carrier_range) / dt_prev;
+        else
+            sat->range_rates[i] = NAN;
     }
-    else
+}
+
+/**
+ * @brief Builds the per-satellite series in ctx->gps_list from the stored observations.
+ *
+ * Pseudorange series come straight from each PRN's record list in the observation
+ * store (arrival order), with the carrier range rates differenced in the same
+ * pass; the ephemeris series hold every unique TOE of the history.
+ * The series are allocated to those sizes; every table derived from a previous
+ * sort is released.
+ *
+ * @param ctx Session state holding the observation store and ephemeris history.
+ * @return 0 on success, 1 if no observations were stored, -1 on allocation failure.
+ */
+int sort_satellites(gnss_context_t *ctx)
+{
+    gnss_context_free_solution(ctx);
+
+    const obs_store_t *store = &ctx->obs_store;
+    if (store->n_epochs == 0)
     {
-        fprintf(stderr, COLOR_RED "Error: Unsupported observation type %d for sorting satellites.\n" COLOR_RESET, observation_type);
+        fprintf(stderr, COLOR_RED "Error: No MSM1/MSM4 observations stored for sorting satellites.\n" COLOR_RESET);
         return 1;
     }
 
-    // ---- Ephemeris history (independent of pseudoranges) — mirrors Python behavior ----
     for (int prn = 1; prn <= MAX_SAT; prn++)
     {
-        populate_ephemeris_series_from_history(prn, &eph_history[prn]);
+        const eph_history_t *hist = &ctx->eph_history[prn];
+        size_t n_obs = store->prn_count[prn];
+        if (gnss_context_alloc_series(ctx, prn, n_obs, count_unique_toes(hist)) != 0)
+        {
+            char name[GNSS_SAT_NAME_LEN];
+            fprintf(stderr, COLOR_RED "Error: Out of memory for the series of %s.\n" COLOR_RESET, gnss_sat_name(prn, name));
+            gnss_context_free_solution(ctx);
+            return -1;
+        }
+
+        gps_satellite_data_t *sat = &ctx->gps_list[prn];
+        for (size_t i = 0; i < n_obs; i++)
+        {
+            const obs_record_t *rec = OBS_STORE_PRN_RECORD(store, prn, i);
+            sat->pseudoranges[i] = rec->pseudorange;
+            sat->pseudoranges_l5[i] = rec->pseudorange_l5;
+            sat->cnrs[i] = rec->cnr;
+            sat->times_of_pseudorange[i] = rec->time_ms;
+        }
+        populate_range_rates(sat, store, prn);
+
+        // ---- Ephemeris history (independent of pseudoranges) — mirrors Python behavior ----
+        populate_ephemeris_series_from_history(sat, hist);
     }
 
     return 0;
@@ -220,21 +155,23 @@ int sort_satellites(eph_history_t *eph_history_table,
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Prints the GPS satellite data summary.
+ * @brief Prints the satellite data summary.
  * This function prints the pseudorange table (rows with valid PR)
  * and then prints a Python-style ephemeris series that lists all unique TOE entries.
  */
-void print_gps_list(void)
+void print_gps_list(const gnss_context_t *ctx)
 {
+    const gps_satellite_data_t *gps_list = ctx->gps_list;
+
     printf("============================================\n");
-    printf("         GPS Satellite Data Summary         \n");
+    printf("           Satellite Data Summary           \n");
     printf("============================================\n");
 
     for (int prn = 1; prn <= MAX_SAT; prn++)
     {
         // Any pseudorange?
         int any_pr = 0;
-        for (int i = 0; i < MAX_EPOCHS; i++)
+        for (size_t i = 0; i < gps_list[prn].n_pseudoranges; i++)
             if (gps_list[prn].pseudoranges[i] != 0)
             {
                 any_pr = 1;
@@ -242,7 +179,7 @@ void print_gps_list(void)
             }
         // Any ephemeris TOE?
         int any_eph = 0;
-        for (int i = 0; i < MAX_EPOCHS; i++)
+        for (size_t i = 0; i < gps_list[prn].n_ephemerides; i++)
             if (gps_list[prn].times_of_ephemeris[i] != 0)
             {
                 any_eph = 1;
@@ -252,19 +189,20 @@ void print_gps_list(void)
         if (!any_pr && !any_eph)
             continue;
 
-        printf("\nPRN %d:\n", prn);
+        char name[GNSS_SAT_NAME_LEN];
+        printf("\n%s:\n", gnss_sat_name(prn, name));
 
         // Pseudorange table (like before)
         if (any_pr)
         {
             printf("Idx | Pseudorange      | Time_of_PR    \n");
             printf("----+------------------+---------------\n");
-            for (int i = 0; i < MAX_EPOCHS; i++)
+            for (size_t i = 0; i < gps_list[prn].n_pseudoranges; i++)
             {
                 if (gps_list[prn].pseudoranges[i] == 0)
                     continue;
 
-                printf("%3d | %16.6f | %3d\n",
+                printf("%3zu | %16.6f | %3u\n",
                        i,
                        gps_list[prn].pseudoranges[i],
                        gps_list[prn].times_of_pseudorange[i]);
@@ -277,7 +215,7 @@ void print_gps_list(void)
             // Eccentricities
             printf("\n  Eccentricities             : [");
             int first = 1;
-            for (int i = 0; i < MAX_EPOCHS && gps_list[prn].times_of_ephemeris[i] != 0; i++)
+            for (size_t i = 0; i < gps_list[prn].n_ephemerides && gps_list[prn].times_of_ephemeris[i] != 0; i++)
             {
                 printf("%s%.16g", first ? "" : ", ", gps_list[prn].eccentricities[i]);
                 first = 0;
@@ -287,7 +225,7 @@ void print_gps_list(void)
             // Inclinations
             printf("  Inclinations               : [");
             first = 1;
-            for (int i = 0; i < MAX_EPOCHS && gps_list[prn].times_of_ephemeris[i] != 0; i++)
+            for (size_t i = 0; i < gps_list[prn].n_ephemerides && gps_list[prn].times_of_ephemeris[i] != 0; i++)
             {
                 printf("%s%.16g", first ? "" : ", ", gps_list[prn].inclinations[i]);
                 first = 0;
@@ -297,7 +235,7 @@ void print_gps_list(void)
             // Mean Anomalies
             printf("  Mean Anomalies             : [");
             first = 1;
-            for (int i = 0; i < MAX_EPOCHS && gps_list[prn].times_of_ephemeris[i] != 0; i++)
+            for (size_t i = 0; i < gps_list[prn].n_ephemerides && gps_list[prn].times_of_ephemeris[i] != 0; i++)
             {
                 printf("%s%.16g", first ? "" : ", ", gps_list[prn].mean_anomalies[i]);
                 first = 0;
@@ -307,7 +245,7 @@ void print_gps_list(void)
             // Semi-Major Axes
             printf("  Semi-Major Axes            : [");
             first = 1;
-            for (int i = 0; i < MAX_EPOCHS && gps_list[prn].times_of_ephemeris[i] != 0; i++)
+            for (size_t i = 0; i < gps_list[prn].n_ephemerides && gps_list[prn].times_of_ephemeris[i] != 0; i++)
             {
                 printf("%s%.16g", first ? "" : ", ", gps_list[prn].semi_major_axes[i]);
                 first = 0;
@@ -317,7 +255,7 @@ void print_gps_list(void)
             // RA of Ascending Node
             printf("  RA of Ascending Node       : [");
             first = 1;
-            for (int i = 0; i < MAX_EPOCHS && gps_list[prn].times_of_ephemeris[i] != 0; i++)
+            for (size_t i = 0; i < gps_list[prn].n_ephemerides && gps_list[prn].times_of_ephemeris[i] != 0; i++)
             {
                 printf("%s%.16g", first ? "" : ", ", gps_list[prn].right_ascension_of_ascending_node[i]);
                 first = 0;
@@ -327,7 +265,7 @@ void print_gps_list(void)
             // Argument of Periapsis
             printf("  Argument of Periapsis      : [");
             first = 1;
-            for (int i = 0; i < MAX_EPOCHS && gps_list[prn].times_of_ephemeris[i] != 0; i++)
+            for (size_t i = 0; i < gps_list[prn].n_ephemerides && gps_list[prn].times_of_ephemeris[i] != 0; i++)
             {
                 printf("%s%.16g", first ? "" : ", ", gps_list[prn].argument_of_periapsis[i]);
                 first = 0;
@@ -337,7 +275,7 @@ void print_gps_list(void)
             // Times of Ephemeris
             printf("  Times of Ephemeris         : [");
             first = 1;
-            for (int i = 0; i < MAX_EPOCHS && gps_list[prn].times_of_ephemeris[i] != 0; i++)
+            for (size_t i = 0; i < gps_list[prn].n_ephemerides && gps_list[prn].times_of_ephemeris[i] != 0; i++)
             {
                 printf("%s%u", first ? "" : ", ", (unsigned)gps_list[prn].times_of_ephemeris[i]);
                 first = 0;
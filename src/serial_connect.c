@@ -5,14 +5,16 @@
  * This module provides a small, interactive helper that lists available serial
  * ports and opens the one the user selects. On Windows it searches COM ports
  * via `QueryDosDeviceA()`. On macOS/Linux it scans `/dev` for `tty.usb*` and
- * `ttyUSB*` device nodes and configures the port for 8-N-1 at 9600 baud.
+ * `ttyUSB*` device nodes. The port is configured for 8-N-1 raw input at the
+ * requested baud rate (see serial_baud_supported()).
+ *
+ * On POSIX the descriptor is non-blocking with VMIN = VTIME = 0: the live reader
+ * (serial_input_mode.c) waits with poll() and then drains everything the driver
+ * has buffered in one read(), instead of waking up per byte.
  *
  * @note Logic is intentionally minimal and interactive; error handling favors
  *       clear console messages via `printf()`/`perror()`.
  *
- * @todo Make baud rate and serial settings configurable (currently hard-coded
- *       to 9600 8-N-1).
- * @todo Add non-blocking / timeout configuration knobs.
  * @todo Optionally accept a preselected port (skip interactive prompt).
  */
 
@@ -29,13 +31,14 @@
  * @brief List and connect to available COM ports on Windows.
  *
  * Enumerates COM1..COM256 using QueryDosDeviceA, prompts the user to choose a
- * port, and attempts to open it with CreateFileA.
+ * port, and attempts to open it with CreateFileA at @p baud, 8-N-1.
  *
  * @param[out] selected_port  Buffer to receive the selected port name (e.g. "\\\\.\\COM3").
  * @param[in]  size           Size of @p selected_port buffer in bytes.
+ * @param[in]  baud           Baud rate, see serial_baud_supported().
  * @return HANDLE to the opened serial port, or INVALID_HANDLE_VALUE on failure.
  */
-HANDLE serial_connect_windows(char *selected_port, size_t size)
+HANDLE serial_connect_windows(char *selected_port, size_t size, long baud)
 {
     char ports[256][16];
     int count = 0;
@@ -89,12 +92,37 @@ HANDLE serial_connect_windows(char *selected_port, size_t size)
     {
         DWORD err = GetLastError();
         printf("Failed to open serial port (Error %lu)\n", err);
+        return hSerial;
     }
-    else
+
+    /* baud 8-N-1, no flow control */
+    DCB dcb = {0};
+    dcb.DCBlength = sizeof(dcb);
+    if (!GetCommState(hSerial, &dcb))
     {
-        printf("Connected to %s\n", selected_port);
+        printf("GetCommState failed (Error %lu)\n", GetLastError());
+        CloseHandle(hSerial);
+        return INVALID_HANDLE_VALUE;
     }
+    dcb.BaudRate = (DWORD)baud;
+    dcb.ByteSize = 8;
+    dcb.Parity = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.fOutxCtsFlow = FALSE;
+    dcb.fRtsControl = RTS_CONTROL_ENABLE;
+    if (!SetCommState(hSerial, &dcb))
+    {
+        printf("SetCommState failed (Error %lu)\n", GetLastError());
+        CloseHandle(hSerial);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    /* ReadFile returns at once with whatever is buffered */
+    COMMTIMEOUTS timeouts = {0};
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    SetCommTimeouts(hSerial, &timeouts);
 
+    printf("Connected to %s at %ld baud\n", selected_port, baud);
     return hSerial;
 }
 
@@ -106,19 +134,55 @@ HANDLE serial_connect_windows(char *selected_port, size_t size)
 #include <termios.h>
 #include <unistd.h>
 
+/** @brief termios speed constant for a supported @p baud (B0 if unsupported). */
+static speed_t baud_to_speed(long baud)
+{
+    switch (baud)
+    {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    case 230400:
+        return B230400;
+#ifdef B921600
+    case 460800:
+        return B460800;
+    case 921600:
+        return B921600;
+#endif
+    default:
+        return B0;
+    }
+}
+
 /**
  * @brief List and connect to USB serial ports on macOS/Linux.
  *
  * Scans `/dev` for `tty.usb*` and `ttyUSB*` device nodes, prompts for a choice,
- * opens the device, and applies 9600 8-N-1 with basic raw settings.
+ * opens the device non-blocking, and applies @p baud 8-N-1 with raw settings.
  *
  * @param[out] selected_port  Buffer to receive the selected device path.
  * @param[in]  size           Size of @p selected_port buffer in bytes.
+ * @param[in]  baud           Baud rate, see serial_baud_supported().
  * @return File descriptor (>=0) on success, or -1 on failure.
  */
-int serial_connect_mac(char *selected_port, size_t size)
+int serial_connect_mac(char *selected_port, size_t size, long baud)
 {
-    char ports[64][256];
+    speed_t speed = baud_to_speed(baud);
+    if (speed == B0)
+    {
+        printf("Unsupported baud rate %ld.\n", baud);
+        return -1;
+    }
+
+    char ports[64][sizeof("/dev/") + 256]; /* "/dev/" + d_name */
     size_t count = 0;
 
     DIR *dp = opendir("/dev");
@@ -164,7 +228,7 @@ int serial_connect_mac(char *selected_port, size_t size)
 
     snprintf(selected_port, size, "%s", ports[choice - 1]);
 
-    int fd = open(selected_port, O_RDWR | O_NOCTTY | O_SYNC);
+    int fd = open(selected_port, O_RDWR | O_NOCTTY | O_NONBLOCK);
     if (fd == -1)
     {
         perror("open serial port");
@@ -179,9 +243,8 @@ int serial_connect_mac(char *selected_port, size_t size)
         return -1;
     }
 
-    /* 9600 baud */
-    cfsetospeed(&tty, B9600);
-    cfsetispeed(&tty, B9600);
+    cfsetospeed(&tty, speed);
+    cfsetispeed(&tty, speed);
 
     /* 8-N-1, no flow control */
     tty.c_cflag &= (tcflag_t)(~CSIZE);
@@ -196,9 +259,9 @@ int serial_connect_mac(char *selected_port, size_t size)
     tty.c_oflag = 0;
     tty.c_iflag = 0;
 
-    /* Read returns as soon as 1 byte is available, with ~0.1s interbyte timeout */
-    tty.c_cc[VMIN] = 1;
-    tty.c_cc[VTIME] = 1;
+    /* Pure non-blocking reads: the caller waits with poll() and drains in bulk */
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
 
     if (tcsetattr(fd, TCSANOW, &tty) != 0)
     {
@@ -207,11 +270,36 @@ int serial_connect_mac(char *selected_port, size_t size)
         return -1;
     }
 
-    printf("Connected to %s\n", selected_port);
+    tcflush(fd, TCIFLUSH); /* drop bytes buffered before the settings applied */
+
+    printf("Connected to %s at %ld baud\n", selected_port, baud);
     return fd;
 }
 #endif /* _WIN32 */
 
+/// Baud rates accepted by serial_connect(), ascending
+static const long serial_baud_rates[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600};
+
+/**
+ * @brief Checks whether @p baud is one of the rates serial_connect() can apply.
+ *
+ * @param baud Requested rate (bit/s).
+ * @return true if supported on this platform.
+ */
+bool serial_baud_supported(long baud)
+{
+#if !defined(_WIN32) && !defined(B921600)
+    if (baud > 230400) /* e.g. macOS termios stops at B230400 */
+        return false;
+#endif
+    for (size_t i = 0; i < sizeof(serial_baud_rates) / sizeof(serial_baud_rates[0]); i++)
+    {
+        if (serial_baud_rates[i] == baud)
+            return true;
+    }
+    return false;
+}
+
 /**
  * @brief Cross-platform serial connect wrapper.
  *
@@ -221,14 +309,16 @@ int serial_connect_mac(char *selected_port, size_t size)
  *
  * @param[out] selected_port  Buffer to receive the chosen port path/name.
  * @param[in]  size           Size of @p selected_port buffer in bytes.
+ * @param[in]  baud           Baud rate, see serial_baud_supported().
  * @return Opaque handle to the opened port, or NULL on failure.
  */
-void *serial_connect(char *selected_port, size_t size)
+void *serial_connect(char *selected_port, size_t size, long baud)
 {
 #ifdef _WIN32
-    return (void *)serial_connect_windows(selected_port, size);
+    HANDLE h = serial_connect_windows(selected_port, size, baud);
+    return (h != INVALID_HANDLE_VALUE) ? (void *)h : NULL;
 #else
-    int fd = serial_connect_mac(selected_port, size);
+    int fd = serial_connect_mac(selected_port, size, baud);
     return (fd >= 0) ? (void *)(intptr_t)fd : NULL;
 #endif
 }
@@ -0,0 +1,340 @@
+/**
+ * @file serial_input_mode.c
+ * @brief Live mode: raw RTCM3 from a serial port, solved epoch by epoch as it arrives.
+ *
+ * Two threads share a lock-free single-producer / single-consumer ring
+ * (ring_buffer.c):
+ *  - the reader waits on the port with poll() and drains everything the driver
+ *    has buffered in one non-blocking read(), straight into the ring;
+ *  - the decoder frames RTCM3 out of the ring (rtcm3_framer_next()), decodes
+ *    each frame and pushes it to the stream solver, which reports every solved
+ *    epoch like stream_input_mode() does for files.
+ *
+ * The main thread only waits for the user to press Enter (or for the port to
+ * close) and then stops both threads.
+ *
+ * At 921600 baud (~92 KB/s) the default ring holds more than ten seconds of
+ * input, so a slow epoch solve never makes the reader drop bytes.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/rtcm3_decoder.h"
+#include "../include/ring_buffer.h"
+#include "../include/stream_solver.h"
+#include "../include/track_sink.h"
+
+#ifndef _WIN32
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+/// Ring capacity between the reader and decoder threads (bytes)
+#define SERIAL_RING_BYTES (1u << 20)
+/// Longest the reader blocks in poll() before rechecking the stop flag (ms)
+#define SERIAL_POLL_MS 100
+/// Back-off of a thread that found the ring empty (decoder) or full (reader) (ns)
+#define SERIAL_IDLE_NS 1000000L
+
+#ifndef _WIN32
+
+/// State shared by the live mode threads
+typedef struct
+{
+    int fd;                     ///< Serial port (non-blocking)
+    ring_buffer_t ring;         ///< Reader -> decoder bytes
+    atomic_bool stop;           ///< Set by the main thread to end both threads
+    atomic_bool reader_done;    ///< Set by the reader once it stopped producing
+    atomic_bool decoder_done;   ///< Set by the decoder once it drained the ring
+    int read_errno;             ///< errno of a failed read()/poll() (0 if none)
+    unsigned long long n_bytes; ///< Bytes read from the port (reader only)
+    unsigned long n_failed;     ///< Frames that did not decode (decoder only)
+    rtcm3_framer_t framer;      ///< Decoder framing state
+    stream_solver_t solver;     ///< Epoch-by-epoch solver fed by the decoder
+    track_sink_t sink;          ///< Track files (decoder only)
+} serial_live_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Sleeps SERIAL_IDLE_NS. */
+static void idle_wait(void)
+{
+    struct timespec ts = {0, SERIAL_IDLE_NS};
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * @brief Reader thread: port -> ring, in bulk non-blocking reads.
+ *
+ * Ends on the stop flag, a hang-up (read() returning 0 / POLLHUP) or a read error.
+ */
+static void *serial_reader(void *arg)
+{
+    serial_live_t *live = (serial_live_t *)arg;
+
+    while (!atomic_load(&live->stop))
+    {
+        uint8_t *region;
+        size_t space = ring_buffer_write_region(&live->ring, &region);
+        if (space == 0)
+        {
+            // Decoder is behind; the driver keeps buffering meanwhile
+            atomic_fetch_add_explicit(&live->ring.n_overruns, 1, memory_order_relaxed);
+            idle_wait();
+            continue;
+        }
+
+        struct pollfd pfd = {live->fd, POLLIN, 0};
+        int rc = poll(&pfd, 1, SERIAL_POLL_MS);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            live->read_errno = errno;
+            break;
+        }
+        if (rc == 0)
+            continue; // Timeout: recheck the stop flag
+
+        if (!(pfd.revents & POLLIN) && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+            break; // Port closed or unplugged
+
+        ssize_t n = read(live->fd, region, space);
+        if (n > 0)
+        {
+            ring_buffer_commit_write(&live->ring, (size_t)n);
+            live->n_bytes += (unsigned long long)n;
+        }
+        else if (n == 0)
+        {
+            break; // Hang-up
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            live->read_errno = errno;
+            break;
+        }
+    }
+
+    atomic_store(&live->reader_done, true);
+    return NULL;
+}
+
+/**
+ * @brief Frames, decodes and solves every complete RTCM3 frame in @p data.
+ *
+ * @return Bytes consumed (all of @p len; a partial frame stays in the framer).
+ */
+static size_t decode_bytes(serial_live_t *live, const uint8_t *data, size_t len)
+{
+    rtcm_message_t msg;
+    size_t off = 0;
+    while (off < len)
+    {
+        size_t used = 0;
+        int ready = rtcm3_framer_next(&live->framer, data + off, len - off, &used);
+        off += used;
+        if (!ready)
+            break;
+
+        int status = rtcm3_decode_payload(RTCM3_FRAME_PAYLOAD(&live->framer),
+                                          RTCM3_FRAME_PAYLOAD_LEN(&live->framer), &msg);
+        if (status < 0)
+            live->n_failed++;
+        else if (status == 0)
+            stream_solver_push(&live->solver, &msg);
+    }
+    return off;
+}
+
+/**
+ * @brief Decoder thread: ring -> framer -> stream solver.
+ *
+ * Runs until the reader is done and the ring is drained, or the stop flag is set.
+ */
+static void *serial_decoder(void *arg)
+{
+    serial_live_t *live = (serial_live_t *)arg;
+
+    for (;;)
+    {
+        const uint8_t *region;
+        size_t avail = ring_buffer_read_region(&live->ring, &region);
+        if (avail > 0)
+        {
+            ring_buffer_commit_read(&live->ring, decode_bytes(live, region, avail));
+            continue;
+        }
+
+        if (atomic_load(&live->stop))
+            break;
+        if (atomic_load(&live->reader_done))
+        {
+            // The reader may have committed its last bytes after our empty check
+            if (ring_buffer_read_region(&live->ring, &region) == 0)
+                break;
+            continue;
+        }
+        idle_wait();
+    }
+
+    stream_solver_flush(&live->solver);
+    atomic_store(&live->decoder_done, true);
+    return NULL;
+}
+
+/** @brief stream_fix_handler_t: prints the live fix and hands it to the track sink. */
+static void on_live_fix(const stream_fix_t *fix, void *ctx)
+{
+    serial_live_t *live = (serial_live_t *)ctx;
+
+    printf("[L][epoch %lu] t=%u ms, %d SVs, LLA = (lat=%.8f deg, lon=%.8f deg, alt=%.3f m)\n",
+           fix->epoch, fix->time_ms, fix->n_svs, fix->lat_deg, fix->lon_deg, fix->alt_m);
+    fflush(stdout);
+
+    track_sink_add(&live->sink, fix);
+}
+
+/**
+ * @brief Blocks until the user presses Enter (or stdin closes) or the decoder finished.
+ */
+static void wait_for_stop(serial_live_t *live)
+{
+    char line[16];
+    while (!atomic_load(&live->decoder_done))
+    {
+        struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        int rc = poll(&pfd, 1, SERIAL_POLL_MS);
+        if (rc > 0)
+        {
+            if (!fgets(line, sizeof(line), stdin))
+                clearerr(stdin); // EOF also stops; keep stdin usable for the menu
+            return;
+        }
+        if (rc < 0 && errno != EINTR)
+            return;
+    }
+}
+
+#endif /* !_WIN32 */
+
+/**
+ * @brief Asks for the baud rate; an empty line selects SERIAL_DEFAULT_BAUD.
+ *
+ * @return Supported baud rate, or -1 on invalid input / EOF.
+ */
+static long prompt_baud(void)
+{
+    char buf[32];
+    printf("Baud rate [%ld] (9600-921600): ", SERIAL_DEFAULT_BAUD);
+    fflush(stdout);
+    if (!fgets(buf, sizeof(buf), stdin))
+        return -1;
+
+    char *end = NULL;
+    long baud = strtol(buf, &end, 10);
+    if (end == buf)
+    {
+        while (*end == ' ' || *end == '\t')
+            end++;
+        if (*end == '\n' || *end == '\r' || *end == '\0')
+            return SERIAL_DEFAULT_BAUD;
+    }
+
+    if (!serial_baud_supported(baud))
+    {
+        printf(COLOR_RED "Unsupported baud rate.\n" COLOR_RESET);
+        return -1;
+    }
+    return baud;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Live raw RTCM3 input from a serial port, one fix per solved epoch.
+ *
+ * Prompts for the baud rate and port, then streams until Enter is pressed or the
+ * port closes. Fixes go to stdout and to the receiver track files as in
+ * stream_input_mode().
+ *
+ * @return 0 on success, 1 on error (connect, allocation, threads or read).
+ */
+int serial_input_mode(void)
+{
+    long baud = prompt_baud();
+    if (baud < 0)
+        return 1;
+
+#ifdef _WIN32
+    printf(COLOR_YELLOW "Note: Live serial input is only implemented for macOS/Linux so far.\n" COLOR_RESET);
+    return 1;
+#else
+    char port[300];
+    void *handle = serial_connect(port, sizeof(port), baud);
+    if (!handle)
+        return 1;
+
+    static serial_live_t live; // holds the stream solver; too large for the stack
+    memset(&live, 0, sizeof(live));
+    live.fd = (int)(intptr_t)handle;
+    atomic_init(&live.stop, false);
+    atomic_init(&live.reader_done, false);
+    atomic_init(&live.decoder_done, false);
+    rtcm3_framer_init(&live.framer);
+    stream_solver_init(&live.solver, on_live_fix, &live);
+
+    if (ring_buffer_init(&live.ring, SERIAL_RING_BYTES) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Out of memory for the serial ring buffer.\n" COLOR_RESET);
+        close(live.fd);
+        return 1;
+    }
+
+    track_sink_open(&live.sink, "plots", TRACK_SINK_ALL);
+
+    int status = 0;
+    pthread_t reader, decoder;
+    if (pthread_create(&decoder, NULL, serial_decoder, &live) != 0)
+    {
+        fprintf(stderr, COLOR_RED "Error: Could not start the decoder thread.\n" COLOR_RESET);
+        status = 1;
+    }
+    else
+    {
+        if (pthread_create(&reader, NULL, serial_reader, &live) != 0)
+        {
+            fprintf(stderr, COLOR_RED "Error: Could not start the reader thread.\n" COLOR_RESET);
+            atomic_store(&live.stop, true);
+            status = 1;
+        }
+        else
+        {
+            printf(COLOR_GREEN "Streaming live RTCM3. Press Enter to stop.\n" COLOR_RESET);
+            wait_for_stop(&live);
+            atomic_store(&live.stop, true);
+            pthread_join(reader, NULL);
+        }
+        pthread_join(decoder, NULL);
+    }
+
+    if (live.read_errno != 0)
+    {
+        fprintf(stderr, COLOR_YELLOW "Warning: Serial read failed: %s\n" COLOR_RESET, strerror(live.read_errno));
+        status = 1;
+    }
+
+    printf(COLOR_GREEN "RTCM3: %llu bytes, %lu frames, %lu CRC errors, %lu undecodable, %lu bytes skipped, %lu ring overruns.\n" COLOR_RESET,
+           live.n_bytes, live.framer.n_frames, live.framer.n_crc_errors, live.n_failed, live.framer.n_skipped,
+           atomic_load(&live.ring.n_overruns));
+    printf(COLOR_GREEN "Streamed %lu epochs, %lu solved.\n" COLOR_RESET, live.solver.n_epochs, live.solver.n_fixes);
+
+    stream_solver_free(&live.solver);
+    ring_buffer_free(&live.ring);
+    if (track_sink_close(&live.sink) != 0)
+        fprintf(stderr, COLOR_YELLOW "Warning: Failed to write the receiver track files.\n" COLOR_RESET);
+    close(live.fd);
+    return status;
+#endif
+}
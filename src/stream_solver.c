@@ -0,0 +1,179 @@
+/**
+ * @file stream_solver.c
+ * @brief Solves the receiver position epoch by epoch while messages are still arriving.
+ *
+ * The batch pipeline (file_input_mode) stores the whole input in the history tables
+ * and then runs the sorter, orbit propagation and least squares as full-table passes.
+ * This module is the streaming counterpart:
+ *  - Ephemerides (1019, 1042, 1045, 1046) update a per-satellite "current" slot
+ *    (latest week + TOE wins, used only within EPH_MAX_AGE_S of its TOE)
+ *  - Observation messages (1074 / 1084 / 1094 / 1124, 1002) go to an epoch
+ *    assembler (epoch_assembler.c), which hands over each epoch exactly once, on
+ *    the last message of its burst (DF393 / DF005 == 0), when another epoch time
+ *    shows up, or at end of input
+ *  - A complete epoch is solved immediately and then discarded
+ *
+ * Satellite positions come from a per-satellite orbit cache (orbit_cache.c), which only
+ * propagates the ephemeris every ORBIT_CACHE_NODE_S and interpolates in between;
+ * the position step is the weighted least squares with RAIM of the batch path
+ * (solve_receiver_epoch_wls(), same per-satellite variance factors), with one
+ * receiver clock per constellation.
+ */
+
+#include "../include/algo.h"
+#include "../include/df_parser.h"
+#include "../include/satellites.h"
+#include "../include/receiver.h"
+#include "../include/eph_index.h"
+#include "../include/epoch_assembler.h"
+#include "../include/stream_solver.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief epoch_handler_t: solves a complete epoch with the current ephemerides.
+ *
+ * Satellites without a current ephemeris valid at the epoch time (see eph_is_valid_at()),
+ * with invalid orbital elements or without the observables of the signal mode are left out. Epochs with fewer than MIN_SATS usable satellites are counted but not solved.
+ * As in the batch path, pseudoranges are corrected for the satellite clock, the
+ * satellites moved to the transmit time (sat_transmit_position()) and each one
+ * weighted by its C/N0 and the noise of the signal mode's observable.
+ *
+ * @param ep  Epoch from the solver's assembler.
+ * @param ctx The stream_solver_t.
+ */
+static void solve_epoch(const gnss_epoch_t *ep, void *ctx)
+{
+    stream_solver_t *solver = (stream_solver_t *)ctx;
+    double ecefs[MAX_SAT][3];
+    double pseudoranges[MAX_SAT];
+    uint8_t systems[MAX_SAT];
+    double var_factor[MAX_SAT];
+    int n_svs = 0;
+    double t_sec = (double)ep->time_ms * 1e-3;
+
+    for (int prn = 1; prn <= MAX_SAT; prn++)
+    {
+        if (!ep->have[prn] || !solver->eph_valid[prn] || !eph_is_valid_at(&solver->eph[prn], t_sec))
+            continue;
+        gnss_sys_t sys = gnss_sat_sys(prn);
+        double pr = gnss_solve_pseudorange(solver->signal_mode, sys, ep->obs[prn].pseudorange, ep->obs[prn].pseudorange_l5);
+        if (pr < 0.0)
+            continue;
+
+        // Interpolated from nodes every ORBIT_CACHE_NODE_S, extended as epochs advance
+        double sat_clk, vel[3];
+        if (orbit_cache_prepare(&solver->orbit[prn], &solver->eph[prn], t_sec, t_sec) != 0 ||
+            orbit_cache_position(&solver->orbit[prn], t_sec, NULL, ecefs[n_svs], vel, &sat_clk) != 0)
+            continue;
+
+        pseudoranges[n_svs] = pr + SPEED_OF_LIGHT * sat_clk; // Satellite clock corrected
+        sat_transmit_position(ecefs[n_svs], vel, pseudoranges[n_svs], ecefs[n_svs]);
+        systems[n_svs] = (uint8_t)sys;
+        var_factor[n_svs] = gnss_solve_variance_factor(solver->signal_mode, sys) * cnr_variance_factor(ep->obs[prn].cnr);
+        n_svs++;
+    }
+
+    stream_fix_t fix = {0};
+    fix.epoch = solver->n_epochs++;
+    fix.time_ms = ep->time_ms;
+
+    // Warm start from the previous fix; a failed warm start is retried cold
+    const rx_wls_opts_t opts = {.var_factor = var_factor, .raim = true};
+    rx_wls_quality_t quality;
+    const double *initial_state = solver->have_state ? solver->state : NULL;
+    double state[RX_STATE_MAX];
+    int rc = solve_receiver_epoch_wls(n_svs, (const double(*)[3])ecefs, pseudoranges, systems, &opts, initial_state, state, &quality);
+    if (rc != 0 && initial_state)
+        rc = solve_receiver_epoch_wls(n_svs, (const double(*)[3])ecefs, pseudoranges, systems, &opts, NULL, state, &quality);
+
+    if (rc == 0)
+    {
+        memcpy(solver->state, state, sizeof(state));
+        solver->have_state = true;
+        fix.n_svs = quality.n_used;
+        memcpy(fix.ecef, state, sizeof(fix.ecef));
+        // Lowest constellation in use is the reference clock
+        fix.clock_bias = state[3 + systems[quality.excluded == 0 ? 1 : 0]];
+
+        ecef_to_geodetic(fix.ecef[0], fix.ecef[1], fix.ecef[2], &fix.lat_deg, &fix.lon_deg, &fix.alt_m);
+        solver->n_fixes++;
+        if (solver->on_fix)
+            solver->on_fix(&fix, solver->ctx);
+    }
+}
+
+/**
+ * @brief Resets a solver to an empty state.
+ *
+ * @param solver Solver to initialize.
+ * @param on_fix Called once per solved epoch (may be NULL).
+ * @param ctx    Passed through to @p on_fix.
+ */
+void stream_solver_init(stream_solver_t *solver, stream_fix_handler_t on_fix, void *ctx)
+{
+    memset(solver, 0, sizeof(*solver));
+    epoch_assembler_init(&solver->assembler, solve_epoch, solver);
+    solver->signal_mode = configured_signal_mode();
+    solver->on_fix = on_fix;
+    solver->ctx = ctx;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Feeds one decoded message to the solver.
+ *
+ * May solve (and report) the previous or the current epoch before returning.
+ *
+ * @param solver Solver state.
+ * @param msg    Decoded message from the text parser or the binary decoder.
+ */
+void stream_solver_push(stream_solver_t *solver, const rtcm_message_t *msg)
+{
+    if (!solver || !msg)
+        return;
+
+    if (RTCM_IS_EPHEMERIS(msg->msg_type))
+    {
+        const rtcm_1019_ephemeris_t *eph = &msg->data.eph;
+        int prn = ephemeris_sat_index(eph);
+        if (prn < 1)
+            return;
+
+        // Keep the newest week + TOE received so far; its EPH_MAX_AGE_S window is checked at solve time
+        if (!solver->eph_valid[prn] || eph_toe_diff(eph, &solver->eph[prn]) >= 0.0)
+        {
+            solver->eph[prn] = *eph;
+            solver->eph_valid[prn] = true;
+        }
+        return;
+    }
+
+    epoch_assembler_push(&solver->assembler, msg);
+}
+
+/**
+ * @brief Solves the epoch still open at end of input, if any.
+ *
+ * @param solver Solver state.
+ */
+void stream_solver_flush(stream_solver_t *solver)
+{
+    if (solver)
+        epoch_assembler_flush(&solver->assembler);
+}
+
+/**
+ * @brief Releases the orbit caches of a solver.
+ *
+ * @param solver Solver state (flush it first to solve the last epoch).
+ */
+void stream_solver_free(stream_solver_t *solver)
+{
+    if (!solver)
+        return;
+
+    for (int prn = 0; prn <= MAX_SAT; prn++)
+        orbit_cache_free(&solver->orbit[prn]);
+}
@@ -0,0 +1,196 @@
+/**
+ * @file text_writer.c
+ * @brief Buffered text output with a fast fixed-point double formatter.
+ *
+ * The plot writers emit tens of thousands of `%.6f` columns per run; going
+ * through fprintf() for each of them made output a visible share of a long
+ * batch run. text_writer_fixed() instead rounds the scaled value to an integer
+ * and prints its digits directly. Whenever that rounding could differ from the
+ * correctly rounded result printf() produces (values too large for the scaled
+ * integer, or a scaled fraction within one ulp of .5) it falls back to
+ * snprintf(), so the text is always identical to printf("%.*f").
+ */
+
+#include "../include/algo.h"
+#include "../include/text_writer.h"
+
+/// Buffer size: a flush block plus room for the longest single item
+#define TEXT_WRITER_CAP (TEXT_WRITER_FLUSH_BYTES + 512u)
+/// Longest single item appended at once (snprintf of %.9f of DBL_MAX is 320 bytes)
+#define TEXT_WRITER_ITEM_MAX 400u
+
+static const double pow10_f[TEXT_WRITER_MAX_DECIMALS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+static const uint64_t pow10_u[TEXT_WRITER_MAX_DECIMALS + 1] = {1u, 10u, 100u, 1000u, 10000u, 100000u,
+                                                               1000000u, 10000000u, 100000000u, 1000000000u};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Creates (truncates) @p path for buffered writing.
+ *
+ * @return 0 on success, -1 if the file or the buffer could not be created.
+ */
+int text_writer_open(text_writer_t *w, const char *path)
+{
+    memset(w, 0, sizeof(*w));
+    w->data = malloc(TEXT_WRITER_CAP);
+    if (!w->data)
+        return -1;
+    w->fp = fopen(path, "w");
+    if (!w->fp)
+    {
+        free(w->data);
+        w->data = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/** @brief Hands the pending bytes to stdio. */
+static void write_pending(text_writer_t *w)
+{
+    if (w->len > 0 && fwrite(w->data, 1, w->len, w->fp) != w->len)
+        w->status = -1;
+    w->len = 0;
+}
+
+/**
+ * @brief Writes everything appended so far through to the file, so readers
+ *        of the file see it (used by the incremental track outputs).
+ */
+void text_writer_flush(text_writer_t *w)
+{
+    if (!w->fp)
+        return;
+    write_pending(w);
+    if (fflush(w->fp) != 0)
+        w->status = -1;
+}
+
+/**
+ * @brief Returns room for @p n more bytes, flushing a full block first.
+ */
+static char *text_writer_reserve(text_writer_t *w, size_t n)
+{
+    if (w->len + n > TEXT_WRITER_CAP || w->len >= TEXT_WRITER_FLUSH_BYTES)
+        write_pending(w);
+    return w->data + w->len;
+}
+
+/**
+ * @brief Flushes and closes the file and releases the buffer.
+ *
+ * @return 0 if every byte was written, -1 after any I/O error.
+ */
+int text_writer_close(text_writer_t *w)
+{
+    if (!w->fp)
+        return -1;
+    write_pending(w);
+    if (fclose(w->fp) != 0)
+        w->status = -1;
+    free(w->data);
+    int status = w->status;
+    memset(w, 0, sizeof(*w));
+    return status;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Writes the decimal digits of @p v to @p dst, zero-padded to @p width.
+ *
+ * @return Number of characters written.
+ */
+static size_t put_digits(char *dst, uint64_t v, int width)
+{
+    char tmp[24];
+    int n = 0;
+    do
+    {
+        tmp[n++] = (char)('0' + (int)(v % 10u));
+        v /= 10u;
+    } while (v > 0);
+    while (n < width)
+        tmp[n++] = '0';
+    for (int i = 0; i < n; i++)
+        dst[i] = tmp[n - 1 - i];
+    return (size_t)n;
+}
+
+/**
+ * @brief Appends @p v formatted exactly like printf("%.*f", decimals, v).
+ *
+ * @param w        Writer.
+ * @param v        Value.
+ * @param decimals Digits after the decimal point.
+ */
+void text_writer_fixed(text_writer_t *w, double v, int decimals)
+{
+    char *dst = text_writer_reserve(w, TEXT_WRITER_ITEM_MAX);
+
+    if (isfinite(v) && decimals >= 0 && decimals <= TEXT_WRITER_MAX_DECIMALS)
+    {
+        // One rounding: |s - exact| <= ulp(s) / 2 <= s * 2^-53
+        double s = fabs(v) * pow10_f[decimals];
+        if (s < 0x1p53)
+        {
+            double whole = floor(s);
+            double frac = s - whole; // exact
+            if (fabs(frac - 0.5) > s * 0x1p-52)
+            {
+                uint64_t r = (uint64_t)whole + (frac > 0.5 ? 1u : 0u);
+                size_t n = 0;
+                if (signbit(v))
+                    dst[n++] = '-';
+                n += put_digits(dst + n, r / pow10_u[decimals], 1);
+                if (decimals > 0)
+                {
+                    dst[n++] = '.';
+                    n += put_digits(dst + n, r % pow10_u[decimals], decimals);
+                }
+                w->len += n;
+                return;
+            }
+        }
+    }
+
+    // Near a rounding tie, too large, or not finite: let libc round it
+    int n = snprintf(dst, TEXT_WRITER_ITEM_MAX, "%.*f", decimals, v);
+    if (n < 0 || (size_t)n >= TEXT_WRITER_ITEM_MAX)
+        w->status = -1;
+    else
+        w->len += (size_t)n;
+}
+
+/** @brief Appends @p v formatted like printf("%d"). */
+void text_writer_int(text_writer_t *w, int v)
+{
+    char *dst = text_writer_reserve(w, 16);
+    size_t n = 0;
+    uint64_t mag = (uint64_t)(v < 0 ? -(int64_t)v : (int64_t)v);
+    if (v < 0)
+        dst[n++] = '-';
+    w->len += n + put_digits(dst + n, mag, 1);
+}
+
+/** @brief Appends the NUL-terminated string @p s. */
+void text_writer_str(text_writer_t *w, const char *s)
+{
+    size_t n = strlen(s);
+    while (n > 0)
+    {
+        size_t chunk = n < TEXT_WRITER_ITEM_MAX ? n : TEXT_WRITER_ITEM_MAX;
+        memcpy(text_writer_reserve(w, chunk), s, chunk);
+        w->len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+/** @brief Appends one character. */
+void text_writer_char(text_writer_t *w, char c)
+{
+    text_writer_reserve(w, 1)[0] = c;
+    w->len++;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file thread_count.c
+ * @brief Default worker thread count shared by the parallel stages.
+ *
+ * The parallel ingest and the batch epoch solver size their thread pools from
+ * the same setting: the GPS_RESOLVER_THREADS environment variable, else the
+ * number of online CPUs. Each stage then caps it by its own amount of work.
+ */
+
+#include "../include/algo.h"
+
+/**
+ * @brief Thread count requested by the environment, else the online CPU count.
+ *
+ * @return Thread count in [1, MAX_WORKER_THREADS]; always 1 without POSIX threads.
+ */
+int configured_thread_count(void)
+{
+#ifdef _WIN32
+    return 1;
+#else
+    const char *env = getenv("GPS_RESOLVER_THREADS");
+    long n = env ? strtol(env, NULL, 10) : 0;
+    if (n <= 0)
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > MAX_WORKER_THREADS)
+        n = MAX_WORKER_THREADS;
+    return n < 1 ? 1 : (int)n;
+#endif
+}
@@ -0,0 +1,321 @@
+/**
+ * @file track_sink.c
+ * @brief Streams receiver fixes to KML, CSV, NMEA GGA and the plot track files.
+ *
+ * Previously the only KML came from `plots/kml.bash`, a second pass over
+ * receiver_track_geo.dat after the run, so a long reprocess or a live session
+ * could not be watched. A track sink instead receives every fix as it is
+ * solved (batch, streaming and live modes alike) and appends it to:
+ *  - receiver_track_ecef.dat / receiver_track_geo.dat (TRACK_SINK_DAT), in the
+ *    formats of write_receiver_track_ecef() / write_receiver_track_geo()
+ *  - receiver_track.csv (TRACK_SINK_CSV), one row per fix with a header line; the
+ *    velocity columns are left empty for fixes without a velocity
+ *  - receiver_track.nmea (TRACK_SINK_NMEA), one $GPGGA sentence per fix
+ *  - receiver_track.kml (TRACK_SINK_KML), the same document kml.bash writes,
+ *    completed when the sink is closed
+ *
+ * With TRACK_SINK_KML the sink also keeps the last TRACK_SINK_KML_WINDOW fixes
+ * and, on every flush, atomically replaces receiver_track_live.kml with them
+ * (a track plus a "Current fix" point). receiver_track_link.kml is a
+ * NetworkLink that makes Google Earth reload the live file every
+ * TRACK_SINK_KML_REFRESH_S seconds.
+ *
+ * Rows are buffered in text_writer_t blocks and written through when
+ * TRACK_SINK_FLUSH_MS have passed or TRACK_SINK_FLUSH_BYTES are pending, so the
+ * I/O cost does not grow with the fix rate.
+ */
+
+#include "../include/algo.h"
+#include "../include/track_sink.h"
+
+#include <time.h>
+
+/// Placemark / LineString preamble shared by receiver_track.kml and the live file
+#define KML_TRACK_HEAD                                                                \
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"                                    \
+    "<kml xmlns=\"http://www.opengis.net/kml/2.2\"><Document>\n"                      \
+    "<name>Receiver track</name><Placemark><name>Receiver track</name>\n"             \
+    "<Style><LineStyle><color>ff0066ff</color><width>3</width></LineStyle></Style>\n" \
+    "<LineString><tessellate>1</tessellate><coordinates>\n"
+/// Closes the LineString placemark opened by KML_TRACK_HEAD
+#define KML_TRACK_TAIL "</coordinates></LineString></Placemark>"
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Milliseconds on a clock that does not jump with the wall clock where available. */
+static int64_t clock_ms(void)
+{
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/** @brief Opens `<dir>/<name>` into @p w; returns true on success. */
+static bool open_output(const track_sink_t *sink, text_writer_t *w, const char *name)
+{
+    char path[256];
+    int n = snprintf(path, sizeof(path), "%s/%s", sink->dir, name);
+    return n > 0 && (size_t)n < sizeof(path) && text_writer_open(w, path) == 0;
+}
+
+/** @brief Appends one `lon,lat,0` KML coordinate line. */
+static void put_kml_coordinate(text_writer_t *w, double lat_deg, double lon_deg)
+{
+    text_writer_str(w, "  ");
+    text_writer_fixed(w, lon_deg, 8);
+    text_writer_char(w, ',');
+    text_writer_fixed(w, lat_deg, 8);
+    text_writer_str(w, ",0\n");
+}
+
+/**
+ * @brief Writes receiver_track_link.kml, the NetworkLink onto the live file.
+ */
+static int write_network_link(const track_sink_t *sink)
+{
+    text_writer_t w;
+    if (!open_output(sink, &w, "receiver_track_link.kml"))
+        return -1;
+
+    text_writer_str(&w, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                        "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n"
+                        "<NetworkLink><name>Receiver track (live)</name><flyToView>0</flyToView>\n"
+                        "<Link><href>receiver_track_live.kml</href><refreshMode>onInterval</refreshMode><refreshInterval>");
+    text_writer_int(&w, TRACK_SINK_KML_REFRESH_S);
+    text_writer_str(&w, "</refreshInterval></Link></NetworkLink>\n</kml>\n");
+    return text_writer_close(&w);
+}
+
+/**
+ * @brief Replaces receiver_track_live.kml with the rolling window (write + rename).
+ */
+static void write_live_kml(track_sink_t *sink)
+{
+    char path[256], tmp_path[264];
+    if (snprintf(path, sizeof(path), "%s/receiver_track_live.kml", sink->dir) >= (int)sizeof(path))
+        return;
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    text_writer_t w;
+    if (text_writer_open(&w, tmp_path) != 0)
+        return;
+
+    text_writer_str(&w, KML_TRACK_HEAD);
+    for (int i = 0; i < sink->window_len; i++)
+    {
+        int j = (sink->window_head + i) % TRACK_SINK_KML_WINDOW;
+        put_kml_coordinate(&w, sink->window_lat[j], sink->window_lon[j]);
+    }
+    text_writer_str(&w, KML_TRACK_TAIL "\n");
+    if (sink->window_len > 0)
+    {
+        int last = (sink->window_head + sink->window_len - 1) % TRACK_SINK_KML_WINDOW;
+        text_writer_str(&w, "<Placemark><name>Current fix</name><Point><coordinates>");
+        text_writer_fixed(&w, sink->window_lon[last], 8);
+        text_writer_char(&w, ',');
+        text_writer_fixed(&w, sink->window_lat[last], 8);
+        text_writer_str(&w, ",0</coordinates></Point></Placemark>\n");
+    }
+    text_writer_str(&w, "</Document></kml>\n");
+
+    if (text_writer_close(&w) != 0 || rename(tmp_path, path) != 0)
+        remove(tmp_path);
+    sink->window_dirty = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Formats a $GPGGA sentence (with checksum and CRLF) for @p fix.
+ *
+ * The time field is the GPS time of day from DF004 (no leap-second
+ * correction), HDOP is left empty, and the altitude field carries the
+ * ellipsoidal height with an empty geoid separation.
+ *
+ * @return Length of the sentence, or 0 if it did not fit.
+ */
+static size_t format_gga(const stream_fix_t *fix, char *out, size_t size)
+{
+    uint32_t day_ms = fix->time_ms % 86400000u;
+    unsigned hh = day_ms / 3600000u, mm = day_ms / 60000u % 60u, ss = day_ms / 1000u % 60u, cs = day_ms % 1000u / 10u;
+
+    // Latitude / longitude as (d)ddmm.mmmmm, rounded once in 1e-5 minute units
+    long long lat_u = llround(fabs(fix->lat_deg) * 60.0 * 1e5);
+    long long lon_u = llround(fabs(fix->lon_deg) * 60.0 * 1e5);
+
+    int n = snprintf(out, size, "$GPGGA,%02u%02u%02u.%02u,%02lld%02lld.%05lld,%c,%03lld%02lld.%05lld,%c,1,%02d,,%.1f,M,,M,,",
+                     hh, mm, ss, cs,
+                     lat_u / 6000000, lat_u / 100000 % 60, lat_u % 100000, fix->lat_deg < 0.0 ? 'S' : 'N',
+                     lon_u / 6000000, lon_u / 100000 % 60, lon_u % 100000, fix->lon_deg < 0.0 ? 'W' : 'E',
+                     fix->n_svs, fix->alt_m);
+    if (n < 0 || (size_t)n + 6 > size)
+        return 0;
+
+    uint8_t checksum = 0;
+    for (int i = 1; i < n; i++)
+        checksum ^= (uint8_t)out[i];
+    int m = snprintf(out + n, size - (size_t)n, "*%02X\r\n", checksum);
+    return m > 0 ? (size_t)(n + m) : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Creates the output files of @p outputs in @p dir.
+ *
+ * Outputs that cannot be created are dropped with a warning; the others work.
+ *
+ * @param sink    Sink to initialise.
+ * @param dir     Output directory (e.g. "plots").
+ * @param outputs TRACK_SINK_* flags.
+ * @return 0 if every requested output was created, -1 otherwise.
+ */
+int track_sink_open(track_sink_t *sink, const char *dir, unsigned outputs)
+{
+    memset(sink, 0, sizeof(*sink));
+    snprintf(sink->dir, sizeof(sink->dir), "%s", dir);
+    sink->last_flush_ms = clock_ms();
+
+    if ((outputs & TRACK_SINK_DAT) && open_output(sink, &sink->ecef, "receiver_track_ecef.dat"))
+    {
+        if (open_output(sink, &sink->geo, "receiver_track_geo.dat"))
+            sink->outputs |= TRACK_SINK_DAT;
+        else
+            text_writer_close(&sink->ecef);
+    }
+    if ((outputs & TRACK_SINK_CSV) && open_output(sink, &sink->csv, "receiver_track.csv"))
+    {
+        sink->outputs |= TRACK_SINK_CSV;
+        text_writer_str(&sink->csv, "epoch,time_ms,n_svs,lat_deg,lon_deg,alt_m,x_m,y_m,z_m,clock_bias_m,"
+                                   "vx_mps,vy_mps,vz_mps,clock_drift_mps\n");
+    }
+    if ((outputs & TRACK_SINK_NMEA) && open_output(sink, &sink->nmea, "receiver_track.nmea"))
+        sink->outputs |= TRACK_SINK_NMEA;
+    if ((outputs & TRACK_SINK_KML) && open_output(sink, &sink->kml, "receiver_track.kml"))
+    {
+        sink->outputs |= TRACK_SINK_KML;
+        text_writer_str(&sink->kml, KML_TRACK_HEAD);
+        if (write_network_link(sink) != 0)
+            fprintf(stderr, COLOR_YELLOW "Warning: Could not write %s/receiver_track_link.kml.\n" COLOR_RESET, dir);
+        write_live_kml(sink);
+    }
+
+    if (sink->outputs != outputs)
+    {
+        fprintf(stderr, COLOR_YELLOW "Warning: Could not create every receiver track file in %s.\n" COLOR_RESET, dir);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Appends one fix to every open output; flushes if the budget is used up.
+ *
+ * @param sink Open sink.
+ * @param fix  Solved epoch.
+ */
+void track_sink_add(track_sink_t *sink, const stream_fix_t *fix)
+{
+    if (sink->outputs & TRACK_SINK_DAT)
+    {
+        text_writer_fixed(&sink->ecef, fix->ecef[0], 8);
+        text_writer_char(&sink->ecef, ' ');
+        text_writer_fixed(&sink->ecef, fix->ecef[1], 8);
+        text_writer_char(&sink->ecef, ' ');
+        text_writer_fixed(&sink->ecef, fix->ecef[2], 8);
+        text_writer_char(&sink->ecef, '\n');
+
+        text_writer_fixed(&sink->geo, fix->lat_deg, 8);
+        text_writer_char(&sink->geo, ' ');
+        text_writer_fixed(&sink->geo, fix->lon_deg, 8);
+        text_writer_char(&sink->geo, '\n');
+    }
+    if (sink->outputs & TRACK_SINK_CSV)
+    {
+        char head[48];
+        snprintf(head, sizeof(head), "%lu,%u,%d,", fix->epoch, fix->time_ms, fix->n_svs);
+        text_writer_str(&sink->csv, head);
+        const double cols[7] = {fix->lat_deg, fix->lon_deg, fix->alt_m, fix->ecef[0], fix->ecef[1], fix->ecef[2], fix->clock_bias};
+        const int decimals[7] = {8, 8, 3, 3, 3, 3, 3};
+        for (int i = 0; i < 7; i++)
+        {
+            text_writer_fixed(&sink->csv, cols[i], decimals[i]);
+            text_writer_char(&sink->csv, ',');
+        }
+        const double vel[4] = {fix->vel[0], fix->vel[1], fix->vel[2], fix->clock_drift};
+        for (int i = 0; i < 4; i++)
+        {
+            if (fix->has_velocity)
+                text_writer_fixed(&sink->csv, vel[i], 4);
+            text_writer_char(&sink->csv, i < 3 ? ',' : '\n');
+        }
+    }
+    if (sink->outputs & TRACK_SINK_NMEA)
+    {
+        char gga[128];
+        if (format_gga(fix, gga, sizeof(gga)) > 0)
+            text_writer_str(&sink->nmea, gga);
+    }
+    if (sink->outputs & TRACK_SINK_KML)
+    {
+        put_kml_coordinate(&sink->kml, fix->lat_deg, fix->lon_deg);
+
+        int slot = (sink->window_head + sink->window_len) % TRACK_SINK_KML_WINDOW;
+        sink->window_lat[slot] = fix->lat_deg;
+        sink->window_lon[slot] = fix->lon_deg;
+        if (sink->window_len < TRACK_SINK_KML_WINDOW)
+            sink->window_len++;
+        else
+            sink->window_head = (sink->window_head + 1) % TRACK_SINK_KML_WINDOW;
+        sink->window_dirty = true;
+    }
+    sink->n_fixes++;
+
+    size_t pending = sink->ecef.len + sink->geo.len + sink->csv.len + sink->nmea.len + sink->kml.len;
+    if (pending >= TRACK_SINK_FLUSH_BYTES || clock_ms() - sink->last_flush_ms >= TRACK_SINK_FLUSH_MS)
+        track_sink_flush(sink);
+}
+
+/**
+ * @brief Writes every buffered fix through to the files and refreshes the live KML.
+ */
+void track_sink_flush(track_sink_t *sink)
+{
+    text_writer_flush(&sink->ecef);
+    text_writer_flush(&sink->geo);
+    text_writer_flush(&sink->csv);
+    text_writer_flush(&sink->nmea);
+    text_writer_flush(&sink->kml);
+    if ((sink->outputs & TRACK_SINK_KML) && sink->window_dirty)
+        write_live_kml(sink);
+    sink->last_flush_ms = clock_ms();
+}
+
+/**
+ * @brief Completes receiver_track.kml, writes the final live KML and closes every output.
+ *
+ * @return 0 if all outputs were written completely, -1 after any I/O error.
+ */
+int track_sink_close(track_sink_t *sink)
+{
+    int status = 0;
+    if (sink->outputs & TRACK_SINK_KML)
+    {
+        text_writer_str(&sink->kml, KML_TRACK_TAIL "</Document></kml>\n");
+        if (sink->window_dirty)
+            write_live_kml(sink);
+    }
+
+    text_writer_t *writers[] = {&sink->ecef, &sink->geo, &sink->csv, &sink->nmea, &sink->kml};
+    for (size_t i = 0; i < sizeof(writers) / sizeof(writers[0]); i++)
+    {
+        if (writers[i]->fp && text_writer_close(writers[i]) != 0)
+            status = -1;
+    }
+    sink->outputs = 0;
+    return status;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file test_wls_convergence.c
+ * @brief Checks that the batch solve converges on every epoch and lands on the truth.
+ *
+ * Runs the pipeline of file_input_mode() (ingest without the observation
+ * cache, sort, satellite positions, weighted least-squares receiver solve) on
+ * example/parsed_log.txt and example/raw_log.rtcm3 and fails unless:
+ *  - no Newton solve reached ITERATIONS without converging
+ *    (newton_unconverged in run_stats.json);
+ *  - every epoch was solved;
+ *  - the Newton iterations average at most TEST_MAX_MEAN_ITERATIONS per epoch.
+ *
+ * Logs synthesized by rtcm_loggen at its default receiver position (TEST_TRUTH_*,
+ * `make test` writes one text and one binary log) must also put every fix within
+ * TEST_MAX_HORIZONTAL_M / TEST_MAX_VERTICAL_M of it. The vertical bound leaves room
+ * for the ionosphere and troposphere the generator adds and the solver does not model.
+ *
+ * Usage: test_wls_convergence [TEXT_LOG [BINARY_LOG [SYNTHETIC_TEXT_LOG [SYNTHETIC_BINARY_LOG]]]]
+ * (run from the repository root).
+ */
+
+#include "../include/algo.h"
+#include "../include/rtcm_reader.h"
+#include "../include/rtcm3_decoder.h"
+#include "../include/gnss_context.h"
+#include "../include/satellites.h"
+#include "../include/receiver.h"
+#include "../include/perf_stats.h"
+
+#include <fcntl.h>
+
+/// Mean Newton steps per epoch: a warm-started epoch is one weighted solve of ~2 steps
+#define TEST_MAX_MEAN_ITERATIONS 3
+
+/// Receiver position of the rtcm_loggen logs (its -p default)
+#define TEST_TRUTH_LAT_DEG 49.18804128
+#define TEST_TRUTH_LON_DEG -123.11684646
+#define TEST_TRUTH_ALT_M 3.6
+/// Largest horizontal distance of a synthetic-log fix from the truth (m)
+#define TEST_MAX_HORIZONTAL_M 5.0
+/// Largest height error of a synthetic-log fix (m): ~10 m of unmodelled atmosphere, plus noise
+#define TEST_MAX_VERTICAL_M 25.0
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Largest horizontal and vertical distance of the fixes of @p ctx from the truth.
+ *
+ * The difference to the truth is split along the local vertical of the truth.
+ */
+static void fix_errors(const gnss_context_t *ctx, double *max_horizontal, double *max_vertical)
+{
+    double truth[3];
+    geodetic_to_ecef(TEST_TRUTH_LAT_DEG, TEST_TRUTH_LON_DEG, TEST_TRUTH_ALT_M, truth);
+    const double lat = TEST_TRUTH_LAT_DEG / RAD2DEG, lon = TEST_TRUTH_LON_DEG / RAD2DEG;
+    const double up[3] = {cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat)};
+
+    *max_horizontal = *max_vertical = 0.0;
+    const estimated_position_t *fix = &ctx->estimated_positions_ecef;
+    for (int ti = 0; ti < ctx->n_times; ti++)
+    {
+        const double d[3] = {fix->x[ti] - truth[0], fix->y[ti] - truth[1], fix->z[ti] - truth[2]};
+        const double v = d[0] * up[0] + d[1] * up[1] + d[2] * up[2];
+        const double h = sqrt(fmax(0.0, d[0] * d[0] + d[1] * d[1] + d[2] * d[2] - v * v));
+        *max_horizontal = fmax(*max_horizontal, h);
+        *max_vertical = fmax(*max_vertical, fabs(v));
+    }
+}
+
+/**
+ * @brief Solves @p path and checks the convergence counters and, for a log with
+ *        known truth, the fixes. The pipeline's own progress output is muted.
+ *
+ * @param path      Log to solve.
+ * @param is_parsed True for a text log, false for binary RTCM3.
+ * @param has_truth The log was synthesized at TEST_TRUTH_*.
+ * @return 0 if the log passes, -1 otherwise.
+ */
+static int check_log(const char *path, bool is_parsed, bool has_truth)
+{
+    FILE *fp = fopen(path, is_parsed ? "r" : "rb");
+    if (!fp)
+    {
+        fprintf(stderr, COLOR_RED "Error: Cannot open %s: %s\n" COLOR_RESET, path, strerror(errno));
+        return -1;
+    }
+
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0)
+        dup2(devnull, STDOUT_FILENO);
+
+    gnss_context_t ctx;
+    gnss_context_init(&ctx);
+    perf_reset();
+    int status = is_parsed ? read_next_rtcm_message(fp, NULL, &ctx) : rtcm3_read_stream(fp, NULL, &ctx);
+    status |= status == 0 ? sort_satellites(&ctx) : 0;
+    status |= status == 0 ? satellite_position_eci(&ctx) : 0;
+    status |= status == 0 ? estimate_receiver_positions(&ctx) : 0;
+
+    fflush(stdout);
+    if (saved_stdout >= 0)
+    {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+    if (devnull >= 0)
+        close(devnull);
+    fclose(fp);
+    double max_horizontal = 0.0, max_vertical = 0.0;
+    if (status == 0 && has_truth)
+        fix_errors(&ctx, &max_horizontal, &max_vertical);
+    gnss_context_free(&ctx);
+
+    if (status != 0)
+    {
+        printf(COLOR_RED "FAIL" COLOR_RESET " %s: the pipeline failed\n", path);
+        return -1;
+    }
+
+    const uint64_t solved = perf_counter_value(PERF_EPOCHS_SOLVED);
+    const uint64_t skipped = perf_counter_value(PERF_EPOCHS_SKIPPED);
+    const uint64_t unconverged = perf_counter_value(PERF_NEWTON_UNCONVERGED);
+    const uint64_t iterations = perf_counter_value(PERF_NEWTON_ITERATIONS);
+    const uint64_t epochs = solved + skipped;
+    const bool pass = epochs > 0 && unconverged == 0 && skipped == 0 &&
+                      iterations <= epochs * TEST_MAX_MEAN_ITERATIONS &&
+                      max_horizontal <= TEST_MAX_HORIZONTAL_M && max_vertical <= TEST_MAX_VERTICAL_M;
+
+    printf("%s %s: %llu/%llu epochs solved, %llu Newton iterations, %llu unconverged",
+           pass ? COLOR_GREEN "PASS" COLOR_RESET : COLOR_RED "FAIL" COLOR_RESET, path,
+           (unsigned long long)solved, (unsigned long long)epochs, (unsigned long long)iterations,
+           (unsigned long long)unconverged);
+    if (has_truth)
+        printf(", max error %.2f m horizontal / %.2f m vertical", max_horizontal, max_vertical);
+    printf("\n");
+    return pass ? 0 : -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+    const char *text_log = argc > 1 ? argv[1] : "example/parsed_log.txt";
+    const char *binary_log = argc > 2 ? argv[2] : "example/raw_log.rtcm3";
+
+    int status = check_log(text_log, true, false);
+    status |= check_log(binary_log, false, false);
+    if (argc > 3)
+        status |= check_log(argv[3], true, true);
+    if (argc > 4)
+        status |= check_log(argv[4], false, true);
+    return status == 0 ? 0 : 1;
+}